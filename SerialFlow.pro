@@ -1,7 +1,7 @@
 #-------------------------------------------------
 # Project setup
 #-------------------------------------------------
-QT += core widgets serialport
+QT += core widgets serialport network
 
 CONFIG += c++17
 CONFIG += qt warn_on release
@@ -15,18 +15,93 @@ VERSION = 1.0
 # Source files
 #-------------------------------------------------
 SOURCES += \
+    src/byteformatter.cpp \
+    src/captureformat.cpp \
+    src/capturereader.cpp \
+    src/capturereplayer.cpp \
+    src/capturewindow.cpp \
+    src/chunkpool.cpp \
+    src/consolebuffer.cpp \
+    src/consolefilter.cpp \
+    src/consolesearch.cpp \
+    src/consoleview.cpp \
+    src/filetransfer.cpp \
+    src/framedecoder.cpp \
+    src/headlesscapture.cpp \
+    src/hexview.cpp \
+    src/logwriter.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
+    src/multiportwindow.cpp \
+    src/packetdissector.cpp \
+    src/packetview.cpp \
+    src/plotterwindow.cpp \
+    src/plotview.cpp \
+    src/portbridge.cpp \
+    src/portsessionmanager.cpp \
+    src/portwatcher.cpp \
+    src/rxcoalescer.cpp \
+    src/scriptengine.cpp \
+    src/searchbar.cpp \
+    src/serialclock.cpp \
     src/serialportmanager.cpp \
-    src/settingsdialog.cpp
+    src/serialportworker.cpp \
+    src/serialtransport.cpp \
+    src/settingsdialog.cpp \
+    src/simulatedtransport.cpp \
+    src/statisticsexporter.cpp \
+    src/statisticspanel.cpp \
+    src/telemetrystore.cpp \
+    src/terminaldecoder.cpp \
+    src/triggercapture.cpp
 
 #-------------------------------------------------
 # Header files
 #-------------------------------------------------
 HEADERS += \
+    src/byteformatter.h \
+    src/captureformat.h \
+    src/capturereader.h \
+    src/capturereplayer.h \
+    src/capturewindow.h \
+    src/chunkpool.h \
+    src/consolebuffer.h \
+    src/consolefilter.h \
+    src/consolesearch.h \
+    src/consolesource.h \
+    src/consoleview.h \
+    src/filetransfer.h \
+    src/framedecoder.h \
+    src/headlesscapture.h \
+    src/hexview.h \
+    src/logwriter.h \
     src/mainwindow.h \
+    src/multiportwindow.h \
+    src/packetdissector.h \
+    src/packetview.h \
+    src/plotterwindow.h \
+    src/plotview.h \
+    src/portbridge.h \
+    src/portsessionmanager.h \
+    src/portstatistics.h \
+    src/portwatcher.h \
+    src/rxcoalescer.h \
+    src/scriptengine.h \
+    src/searchbar.h \
+    src/serialchunk.h \
+    src/serialclock.h \
     src/serialportmanager.h \
-    src/settingsdialog.h
+    src/serialportworker.h \
+    src/serialtransport.h \
+    src/settingsdialog.h \
+    src/simulatedtransport.h \
+    src/spscringbuffer.h \
+    src/statisticsexporter.h \
+    src/statisticspanel.h \
+    src/telemetrystore.h \
+    src/terminaldecoder.h \
+    src/triggercapture.h \
+    src/txoptions.h
 
 #-------------------------------------------------
 # UI files
@@ -0,0 +1,246 @@
+#include "byteformatter.h"
+#include <cstring>
+
+// MSVC never defines __SSE2__; x64 always has it and x86 with /arch:SSE2 or
+// higher sets _M_IX86_FP to 2
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERIALFLOW_SSE2
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char HexDigits[] = "0123456789ABCDEF";
+
+inline bool isControl(char c) {
+  const quint8 byte = static_cast<quint8>(c);
+  return (byte < 0x20 && byte != '\t') || byte == 0x7F;
+}
+
+qsizetype formatHexScalar(const char *data, qsizetype length, char *out,
+                          qsizetype from) {
+  char *dest = out + from * 3;
+  for (qsizetype i = from; i < length; ++i) {
+    const quint8 byte = static_cast<quint8>(data[i]);
+    if (i > 0) {
+      dest[-1] = ' ';
+    }
+    dest[0] = HexDigits[byte >> 4];
+    dest[1] = HexDigits[byte & 0x0F];
+    dest += 3;
+  }
+  return dest - out - 1;
+}
+
+#if defined(SERIALFLOW_SSE2)
+
+// Nibbles (0-15) to their upper-case hex digits
+inline __m128i hexDigits(__m128i nibbles) {
+  const __m128i letters =
+      _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)),
+                    _mm_set1_epi8('A' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// Bytes that isControl() accepts, as a lane mask
+inline __m128i controlMask(__m128i bytes) {
+  const __m128i low = _mm_and_si128(
+      _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x20)),
+      _mm_cmpgt_epi8(bytes, _mm_set1_epi8(-1)));
+  const __m128i tab = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'));
+  const __m128i del = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x7F));
+  return _mm_or_si128(_mm_andnot_si128(tab, low), del);
+}
+
+#endif
+
+#if defined(__SSSE3__)
+
+// Spreads the digit pairs of 16 bytes (a: bytes 0-7, b: bytes 8-15) over
+// three 16-character outputs of "HH " triplets
+const __m128i ShuffleA0 = _mm_setr_epi8(0, 1, -128, 2, 3, -128, 4, 5, -128,
+                                        6, 7, -128, 8, 9, -128, 10);
+const __m128i ShuffleA1 = _mm_setr_epi8(11, -128, 12, 13, -128, 14, 15, -128,
+                                        -128, -128, -128, -128, -128, -128,
+                                        -128, -128);
+const __m128i ShuffleB1 = _mm_setr_epi8(-128, -128, -128, -128, -128, -128,
+                                        -128, -128, 0, 1, -128, 2, 3, -128, 4,
+                                        5);
+const __m128i ShuffleB2 = _mm_setr_epi8(-128, 6, 7, -128, 8, 9, -128, 10, 11,
+                                        -128, 12, 13, -128, 14, 15, -128);
+const __m128i Spaces0 = _mm_setr_epi8(0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0,
+                                      ' ', 0, 0, ' ', 0);
+const __m128i Spaces1 = _mm_setr_epi8(0, ' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ',
+                                      0, 0, ' ', 0, 0);
+const __m128i Spaces2 = _mm_setr_epi8(' ', 0, 0, ' ', 0, 0, ' ', 0, 0, ' ', 0,
+                                      0, ' ', 0, 0, ' ');
+
+#endif
+
+} // namespace
+
+namespace ByteFormatter {
+
+qsizetype formatHex(const char *data, qsizetype length, char *out) {
+  if (length <= 0) {
+    return 0;
+  }
+
+  qsizetype i = 0;
+
+  // Every block writes a trailing space, so the last byte is always left to
+  // the scalar tail to stay within hexLength(length).
+#if defined(__AVX2__)
+  const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+  const __m256i nine = _mm256_set1_epi8(9);
+  const __m256i zero = _mm256_set1_epi8('0');
+  const __m256i letters = _mm256_set1_epi8('A' - '0' - 10);
+  const __m256i shuffleA0 = _mm256_broadcastsi128_si256(ShuffleA0);
+  const __m256i shuffleA1 = _mm256_broadcastsi128_si256(ShuffleA1);
+  const __m256i shuffleB1 = _mm256_broadcastsi128_si256(ShuffleB1);
+  const __m256i shuffleB2 = _mm256_broadcastsi128_si256(ShuffleB2);
+  const __m256i spaces0 = _mm256_broadcastsi128_si256(Spaces0);
+  const __m256i spaces1 = _mm256_broadcastsi128_si256(Spaces1);
+  const __m256i spaces2 = _mm256_broadcastsi128_si256(Spaces2);
+  for (; i + 32 < length; i += 32) {
+    const __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    const __m256i high =
+        _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibbleMask);
+    const __m256i low = _mm256_and_si256(bytes, nibbleMask);
+    const __m256i h = _mm256_add_epi8(
+        _mm256_add_epi8(high, zero),
+        _mm256_and_si256(_mm256_cmpgt_epi8(high, nine), letters));
+    const __m256i l = _mm256_add_epi8(
+        _mm256_add_epi8(low, zero),
+        _mm256_and_si256(_mm256_cmpgt_epi8(low, nine), letters));
+
+    // Unpacking is per 128-bit lane, so each lane formats its own 16 bytes
+    const __m256i a = _mm256_unpacklo_epi8(h, l);
+    const __m256i b = _mm256_unpackhi_epi8(h, l);
+    const __m256i out0 =
+        _mm256_or_si256(_mm256_shuffle_epi8(a, shuffleA0), spaces0);
+    const __m256i out1 = _mm256_or_si256(
+        _mm256_or_si256(_mm256_shuffle_epi8(a, shuffleA1),
+                        _mm256_shuffle_epi8(b, shuffleB1)),
+        spaces1);
+    const __m256i out2 =
+        _mm256_or_si256(_mm256_shuffle_epi8(b, shuffleB2), spaces2);
+
+    __m128i *dest = reinterpret_cast<__m128i *>(out + i * 3);
+    _mm_storeu_si128(dest, _mm256_castsi256_si128(out0));
+    _mm_storeu_si128(dest + 1, _mm256_castsi256_si128(out1));
+    _mm_storeu_si128(dest + 2, _mm256_castsi256_si128(out2));
+    _mm_storeu_si128(dest + 3, _mm256_extracti128_si256(out0, 1));
+    _mm_storeu_si128(dest + 4, _mm256_extracti128_si256(out1, 1));
+    _mm_storeu_si128(dest + 5, _mm256_extracti128_si256(out2, 1));
+  }
+#endif
+
+#if defined(SERIALFLOW_SSE2)
+  const __m128i mask = _mm_set1_epi8(0x0F);
+  for (; i + 16 < length; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    const __m128i h = hexDigits(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    const __m128i l = hexDigits(_mm_and_si128(bytes, mask));
+    const __m128i a = _mm_unpacklo_epi8(h, l);
+    const __m128i b = _mm_unpackhi_epi8(h, l);
+    char *dest = out + i * 3;
+
+#if defined(__SSSE3__)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest),
+                     _mm_or_si128(_mm_shuffle_epi8(a, ShuffleA0), Spaces0));
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(dest + 16),
+        _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, ShuffleA1),
+                                  _mm_shuffle_epi8(b, ShuffleB1)),
+                     Spaces1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 32),
+                     _mm_or_si128(_mm_shuffle_epi8(b, ShuffleB2), Spaces2));
+#else
+    // Without a byte shuffle, widen each digit pair to a 32-bit "HH ?" lane
+    // and store the lanes three bytes apart, each overwriting the previous
+    // lane's spare byte.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i spaces = _mm_set1_epi32(0x00200000);
+    const __m128i quads[4] = {
+        _mm_or_si128(_mm_unpacklo_epi16(a, zero), spaces),
+        _mm_or_si128(_mm_unpackhi_epi16(a, zero), spaces),
+        _mm_or_si128(_mm_unpacklo_epi16(b, zero), spaces),
+        _mm_or_si128(_mm_unpackhi_epi16(b, zero), spaces)};
+    for (const __m128i &quad : quads) {
+      alignas(16) quint32 lanes[4];
+      _mm_store_si128(reinterpret_cast<__m128i *>(lanes), quad);
+      for (quint32 lane : lanes) {
+        std::memcpy(dest, &lane, sizeof(lane));
+        dest += 3;
+      }
+    }
+#endif
+  }
+#endif
+
+  return formatHexScalar(data, length, out, i);
+}
+
+qsizetype formatText(const char *data, qsizetype length, char *out) {
+  while (length > 0 &&
+         (data[length - 1] == '\n' || data[length - 1] == '\r')) {
+    --length;
+  }
+
+  qsizetype i = 0;
+#if defined(SERIALFLOW_SSE2)
+  // Blocks without control characters are copied as they are
+  for (; i + 16 <= length; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    const __m128i controls = controlMask(bytes);
+    const __m128i cleaned = _mm_or_si128(
+        _mm_andnot_si128(controls, bytes),
+        _mm_and_si128(controls, _mm_set1_epi8('.')));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), cleaned);
+  }
+#endif
+
+  for (; i < length; ++i) {
+    out[i] = isControl(data[i]) ? '.' : data[i];
+  }
+  return length;
+}
+
+void formatDumpRow(quint64 offset, const char *data, int first, int length,
+                   char *out) {
+  // Scalar: a row is 16 bytes, too few for the vector kernels to pay off
+  std::memset(out, ' ', DumpRowLength);
+  for (int i = DumpOffsetDigits - 1; i >= 0; --i, offset >>= 4) {
+    out[i] = HexDigits[offset & 0x0F];
+  }
+  out[dumpAsciiColumn(0) - 1] = '|';
+  out[DumpRowLength - 1] = '|';
+
+  for (int i = 0; i < length; ++i) {
+    const quint8 byte = static_cast<quint8>(data[i]);
+    char *hex = out + dumpHexColumn(first + i);
+    hex[0] = HexDigits[byte >> 4];
+    hex[1] = HexDigits[byte & 0x0F];
+    out[dumpAsciiColumn(first + i)] =
+        byte >= 0x20 && byte < 0x7F ? char(byte) : '.';
+  }
+}
+
+const char *implementation() {
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(__SSSE3__)
+  return "SSSE3";
+#elif defined(SERIALFLOW_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+} // namespace ByteFormatter
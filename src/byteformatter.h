@@ -0,0 +1,55 @@
+#ifndef BYTEFORMATTER_H
+#define BYTEFORMATTER_H
+
+#include <QtGlobal>
+
+// Formatting kernels for displaying raw bytes. Each one makes a single pass
+// over the input into a caller-provided buffer, vectorized with AVX2 or SSE2
+// when the compiler targets them and scalar otherwise.
+namespace ByteFormatter {
+
+// Characters needed for length bytes of spaced hex ("0D 0A")
+constexpr qsizetype hexLength(qsizetype length)
+{
+    return length > 0 ? length * 3 - 1 : 0;
+}
+
+// Writes upper-case, space-separated hex; out must hold hexLength(length)
+// characters. Returns the number of characters written.
+qsizetype formatHex(const char *data, qsizetype length, char *out);
+
+// Copies data for single-line display: trailing line terminators are dropped
+// and any other control character except tab becomes '.'. Bytes above 0x7F
+// are left alone for UTF-8 decoding. out must hold length bytes. Returns the
+// number of bytes written.
+qsizetype formatText(const char *data, qsizetype length, char *out);
+
+// Hex dump rows in the classic layout, 16 bytes each:
+// "OOOOOOOOOO  HH HH HH HH HH HH HH HH  HH HH HH HH HH HH HH HH  |AAAA...|"
+constexpr int DumpBytesPerRow = 16;
+constexpr int DumpOffsetDigits = 10;
+constexpr int DumpRowLength = DumpOffsetDigits + 2 + 48 + 2 + 18;
+
+// Columns of byte i of a row in its hex and ASCII parts
+constexpr int dumpHexColumn(int i)
+{
+    return DumpOffsetDigits + 2 + i * 3 + (i >= DumpBytesPerRow / 2 ? 1 : 0);
+}
+constexpr int dumpAsciiColumn(int i)
+{
+    return DumpRowLength - 1 - DumpBytesPerRow + i;
+}
+
+// Writes the row starting at offset, whose bytes [first, first + length)
+// are given by data; other positions are left blank, as at either end of a
+// history. out must hold DumpRowLength characters, which are all written.
+// Printable ASCII is shown as is and anything else as '.'.
+void formatDumpRow(quint64 offset, const char *data, int first, int length,
+                   char *out);
+
+// Name of the kernel set compiled in: "AVX2", "SSSE3", "SSE2" or "scalar"
+const char *implementation();
+
+} // namespace ByteFormatter
+
+#endif // BYTEFORMATTER_H
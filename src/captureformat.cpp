@@ -0,0 +1,78 @@
+#include "captureformat.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace CaptureFormat {
+
+QByteArray fileHeader(qint64 startTimeNs, const QByteArray &metadata) {
+  QByteArray header(FileHeaderSize, '\0');
+  uchar *p = reinterpret_cast<uchar *>(header.data());
+  std::memcpy(p, Magic, sizeof(Magic));
+  qToLittleEndian<quint16>(Version, p + 4);
+  qToLittleEndian<quint16>(0, p + 6);
+  qToLittleEndian<qint64>(startTimeNs, p + 8);
+  qToLittleEndian<quint32>(static_cast<quint32>(metadata.size()), p + 16);
+  qToLittleEndian<quint32>(0, p + 20);
+  return header + metadata;
+}
+
+void appendRecord(QByteArray &out, Direction direction, qint64 timestampNs,
+                  const char *data, qsizetype size) {
+  const qsizetype start = out.size();
+  out.resize(start + RecordHeaderSize + size);
+  uchar *p = reinterpret_cast<uchar *>(out.data() + start);
+  qToLittleEndian<quint32>(static_cast<quint32>(size), p);
+  p[4] = direction;
+  p[5] = 0;
+  qToLittleEndian<quint16>(0, p + 6);
+  qToLittleEndian<qint64>(timestampNs, p + 8);
+  std::memcpy(p + RecordHeaderSize, data, size);
+}
+
+QByteArray indexRecord(const QVector<IndexEntry> &entries, quint64 recordCount,
+                       quint32 longestRecord) {
+  const qsizetype payloadSize =
+      entries.size() * IndexEntrySize + IndexTrailerSize;
+  QByteArray payload(payloadSize, Qt::Uninitialized);
+  uchar *p = reinterpret_cast<uchar *>(payload.data());
+  for (const IndexEntry &entry : entries) {
+    qToLittleEndian<quint64>(entry.offset, p);
+    qToLittleEndian<qint64>(entry.timestamp, p + 8);
+    qToLittleEndian<quint64>(entry.record, p + 16);
+    p += IndexEntrySize;
+  }
+  qToLittleEndian<quint64>(recordCount, p);
+  qToLittleEndian<quint32>(longestRecord, p + 8);
+  qToLittleEndian<quint32>(static_cast<quint32>(entries.size()), p + 12);
+  std::memcpy(p + 16, IndexMagic, sizeof(IndexMagic));
+  qToLittleEndian<quint32>(
+      static_cast<quint32>(RecordHeaderSize + payloadSize), p + 20);
+
+  const qint64 timestamp = entries.isEmpty() ? 0 : entries.last().timestamp;
+  QByteArray record;
+  appendRecord(record, Index, timestamp, payload.constData(), payload.size());
+  return record;
+}
+
+QByteArray encodeMetadata(const QMap<QString, QString> &values) {
+  QByteArray metadata;
+  for (auto it = values.cbegin(); it != values.cend(); ++it) {
+    metadata += it.key().toUtf8() + '=' + it.value().toUtf8() + '\n';
+  }
+  return metadata;
+}
+
+QMap<QString, QString> decodeMetadata(const QByteArray &metadata) {
+  QMap<QString, QString> values;
+  const QList<QByteArray> lines = metadata.split('\n');
+  for (const QByteArray &line : lines) {
+    const qsizetype separator = line.indexOf('=');
+    if (separator > 0) {
+      values.insert(QString::fromUtf8(line.left(separator)),
+                    QString::fromUtf8(line.mid(separator + 1)));
+    }
+  }
+  return values;
+}
+
+} // namespace CaptureFormat
@@ -0,0 +1,84 @@
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// On-disk layout shared by the log writer and capture tools. All integers
+// are little-endian.
+//
+//   File header (24 bytes)
+//     char    magic[4]        "SFCP"
+//     quint16 version
+//     quint16 flags
+//     qint64  startTime       ns since Unix epoch
+//     quint32 metadataLength  UTF-8 "key=value\n" lines that follow
+//     quint32 reserved
+//   Records, repeated
+//     quint32 length          payload bytes
+//     quint8  direction       Direction
+//     quint8  flags
+//     quint16 reserved
+//     qint64  timestamp       ns since Unix epoch
+//     payload
+//   Index record (direction Index), the last record of a closed segment
+//     IndexEntry entries[entryCount]
+//     quint64 recordCount     data records in the segment
+//     quint32 longestRecord   largest payload
+//     quint32 entryCount
+//     char    magic[4]        "SFIX"
+//     quint32 recordLength    header + payload of the index record
+//   IndexEntry (24 bytes), one for every IndexInterval-th data record
+//     quint64 offset          file offset of the record header
+//     qint64  timestamp
+//     quint64 record          record number
+//
+// Readers find the index through the last 8 bytes of the file; segments cut
+// short without one are indexed by scanning the records. The metadata holds
+// the port settings: port, baud, and dataBits, stopBits and parity as
+// QSerialPort enum values.
+//
+// Compressed segments (".qz" appended to the name) are a sequence of
+// blocks, each a quint32 block length followed by qCompress() output for up
+// to CompressedBlockSize bytes of the original file.
+namespace CaptureFormat {
+
+constexpr char Magic[4] = {'S', 'F', 'C', 'P'};
+constexpr quint16 Version = 1;
+constexpr int FileHeaderSize = 24;
+constexpr int RecordHeaderSize = 16;
+constexpr char IndexMagic[4] = {'S', 'F', 'I', 'X'};
+constexpr int IndexInterval = 256;
+constexpr int IndexEntrySize = 24;
+constexpr int IndexTrailerSize = 24;
+constexpr qsizetype CompressedBlockSize = 1024 * 1024;
+constexpr char CompressedSuffix[] = ".qz";
+
+enum Direction : quint8 {
+    Rx = 0,
+    Tx = 1,
+    Index = 0xFF
+};
+
+struct IndexEntry
+{
+    quint64 offset;
+    qint64 timestamp;
+    quint64 record;
+};
+
+QByteArray fileHeader(qint64 startTimeNs, const QByteArray &metadata = {});
+void appendRecord(QByteArray &out, Direction direction, qint64 timestampNs,
+                  const char *data, qsizetype size);
+QByteArray indexRecord(const QVector<IndexEntry> &entries, quint64 recordCount,
+                       quint32 longestRecord);
+
+QByteArray encodeMetadata(const QMap<QString, QString> &values);
+QMap<QString, QString> decodeMetadata(const QByteArray &metadata);
+
+} // namespace CaptureFormat
+
+#endif // CAPTUREFORMAT_H
@@ -0,0 +1,334 @@
+#include "capturereader.h"
+#include <QTemporaryFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+quint32 recordLength(const uchar *header) {
+  return qFromLittleEndian<quint32>(header);
+}
+
+qint64 recordTimestamp(const uchar *header) {
+  return qFromLittleEndian<qint64>(header + 8);
+}
+
+} // namespace
+
+CaptureReader::CaptureReader()
+    : m_map(nullptr), m_size(0), m_startTime(0), m_dataStart(0),
+      m_dataEnd(0), m_recordCount(0), m_longestRecord(0),
+      m_storedIndex(false), m_cursorRecord(0), m_cursorOffset(0) {}
+
+CaptureReader::~CaptureReader() { close(); }
+
+bool CaptureReader::open(const QString &path) {
+  close();
+  m_path = path;
+  m_errorString.clear();
+
+  QString mappedPath = path;
+  if (path.endsWith(CaptureFormat::CompressedSuffix)) {
+    if (!inflate(path)) {
+      return false;
+    }
+    mappedPath = m_inflated->fileName();
+  }
+
+  m_file.setFileName(mappedPath);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    return fail("Cannot open " + path + ": " + m_file.errorString());
+  }
+  m_size = m_file.size();
+  if (m_size < CaptureFormat::FileHeaderSize) {
+    return fail(path + " is not a SerialFlow capture");
+  }
+  m_map = m_file.map(0, m_size);
+  if (!m_map) {
+    return fail("Cannot map " + path + ": " + m_file.errorString());
+  }
+
+  if (std::memcmp(m_map, CaptureFormat::Magic, sizeof(CaptureFormat::Magic))) {
+    return fail(path + " is not a SerialFlow capture");
+  }
+  if (qFromLittleEndian<quint16>(m_map + 4) > CaptureFormat::Version) {
+    return fail(path + " was written by a newer version of SerialFlow");
+  }
+  m_startTime = qFromLittleEndian<qint64>(m_map + 8);
+  const quint32 metadataLength = qFromLittleEndian<quint32>(m_map + 16);
+  m_dataStart = CaptureFormat::FileHeaderSize + quint64(metadataLength);
+  if (m_dataStart > quint64(m_size)) {
+    return fail(path + " has a damaged header");
+  }
+  m_metadata = CaptureFormat::decodeMetadata(QByteArray::fromRawData(
+      reinterpret_cast<const char *>(m_map + CaptureFormat::FileHeaderSize),
+      metadataLength));
+
+  m_storedIndex = loadIndex();
+  if (!m_storedIndex) {
+    buildIndex();
+  }
+  m_cursorRecord = 0;
+  m_cursorOffset = m_dataStart;
+  return true;
+}
+
+void CaptureReader::close() {
+  if (m_map) {
+    m_file.unmap(m_map);
+    m_map = nullptr;
+  }
+  m_file.close();
+  m_inflated.reset();
+  m_size = 0;
+  m_metadata.clear();
+  m_index.clear();
+  m_recordCount = 0;
+  m_longestRecord = 0;
+  m_storedIndex = false;
+}
+
+bool CaptureReader::isOpen() const { return m_map != nullptr; }
+
+QString CaptureReader::fileName() const { return m_path; }
+
+QString CaptureReader::errorString() const { return m_errorString; }
+
+qint64 CaptureReader::startTime() const { return m_startTime; }
+
+QMap<QString, QString> CaptureReader::metadata() const { return m_metadata; }
+
+bool CaptureReader::hasStoredIndex() const { return m_storedIndex; }
+
+QByteArray CaptureReader::recordData(qint64 id) const {
+  const Record r = record(id);
+  return QByteArray(reinterpret_cast<const char *>(m_map + r.offset),
+                    r.length);
+}
+
+qint64 CaptureReader::findRecord(qint64 timestampNs) const {
+  if (m_index.isEmpty()) {
+    return 0;
+  }
+
+  // Start from the last indexed record stamped before the target
+  auto it = std::lower_bound(m_index.cbegin(), m_index.cend(), timestampNs,
+                             [](const CaptureFormat::IndexEntry &entry,
+                                qint64 value) {
+                               return entry.timestamp < value;
+                             });
+  if (it != m_index.cbegin()) {
+    --it;
+  }
+
+  qint64 id = qint64(it->record);
+  quint64 offset = it->offset;
+  while (id < m_recordCount &&
+         offset + CaptureFormat::RecordHeaderSize <= m_dataEnd &&
+         recordTimestamp(m_map + offset) < timestampNs) {
+    offset = nextRecord(offset);
+    ++id;
+  }
+  return id;
+}
+
+qint64 CaptureReader::firstRecord() const { return 0; }
+
+qint64 CaptureReader::endRecord() const { return m_recordCount; }
+
+ConsoleSource::Record CaptureReader::record(qint64 id) const {
+  Q_ASSERT(id >= 0 && id < m_recordCount);
+  const quint64 offset = seekRecord(id);
+  Record r;
+  r.flags = 0;
+  r.source = 0;
+  if (offset + CaptureFormat::RecordHeaderSize > m_dataEnd) {
+    // Only a damaged capture gets here; show an empty record
+    r.offset = m_dataEnd;
+    r.length = 0;
+    r.direction = Rx;
+    r.timestamp = 0;
+    return r;
+  }
+
+  const uchar *header = m_map + offset;
+  r.offset = offset + CaptureFormat::RecordHeaderSize;
+  r.length = quint32(qMin<quint64>(recordLength(header), m_dataEnd - r.offset));
+  r.direction = header[4] == CaptureFormat::Tx ? Tx : Rx;
+  r.timestamp = recordTimestamp(header);
+  return r;
+}
+
+qint64 CaptureReader::longestRecord() const { return m_longestRecord; }
+
+qsizetype CaptureReader::copyBytes(quint64 offset, char *dest,
+                                   qsizetype length) const {
+  if (offset >= quint64(m_size)) {
+    return 0;
+  }
+  const qsizetype available =
+      qMin<qsizetype>(length, qsizetype(quint64(m_size) - offset));
+  std::memcpy(dest, m_map + offset, available);
+  return available;
+}
+
+bool CaptureReader::fail(const QString &error) {
+  m_errorString = error;
+  close();
+  return false;
+}
+
+bool CaptureReader::inflate(const QString &path) {
+  QFile input(path);
+  if (!input.open(QIODevice::ReadOnly)) {
+    return fail("Cannot open " + path + ": " + input.errorString());
+  }
+
+  m_inflated = std::make_unique<QTemporaryFile>();
+  if (!m_inflated->open()) {
+    return fail("Cannot create a temporary file: " +
+                m_inflated->errorString());
+  }
+
+  // Block by block, so only one block is held in memory at a time
+  while (!input.atEnd()) {
+    uchar length[4];
+    if (input.read(reinterpret_cast<char *>(length), 4) != 4) {
+      return fail(path + " is truncated");
+    }
+    const QByteArray block =
+        qUncompress(input.read(qFromLittleEndian<quint32>(length)));
+    if (block.isEmpty() || m_inflated->write(block) != block.size()) {
+      return fail("Cannot decompress " + path);
+    }
+  }
+  m_inflated->flush();
+  return true;
+}
+
+bool CaptureReader::loadIndex() {
+  // Trailer: ... magic[4] recordLength
+  if (quint64(m_size) < m_dataStart + CaptureFormat::RecordHeaderSize +
+                            CaptureFormat::IndexTrailerSize) {
+    return false;
+  }
+  const uchar *tail = m_map + m_size - 8;
+  if (std::memcmp(tail, CaptureFormat::IndexMagic,
+                  sizeof(CaptureFormat::IndexMagic))) {
+    return false;
+  }
+  const quint32 indexLength = qFromLittleEndian<quint32>(tail + 4);
+  const quint64 indexStart = quint64(m_size) - indexLength;
+  if (indexLength > quint64(m_size) - m_dataStart ||
+      indexLength < quint32(CaptureFormat::RecordHeaderSize +
+                            CaptureFormat::IndexTrailerSize)) {
+    return false;
+  }
+
+  const uchar *header = m_map + indexStart;
+  const quint32 payloadLength = recordLength(header);
+  if (header[4] != CaptureFormat::Index ||
+      payloadLength != indexLength - CaptureFormat::RecordHeaderSize) {
+    return false;
+  }
+
+  const uchar *trailer = m_map + m_size - CaptureFormat::IndexTrailerSize;
+  const quint64 recordCount = qFromLittleEndian<quint64>(trailer);
+  const quint32 longest = qFromLittleEndian<quint32>(trailer + 8);
+  const quint32 entryCount = qFromLittleEndian<quint32>(trailer + 12);
+  if (quint64(entryCount) * CaptureFormat::IndexEntrySize +
+          CaptureFormat::IndexTrailerSize !=
+      payloadLength) {
+    return false;
+  }
+
+  // Entries must be in order and point into the data, or the records are
+  // walked instead. The records themselves are not read here, so opening
+  // stays instant; lookups check every length they follow.
+  QVector<CaptureFormat::IndexEntry> index(entryCount);
+  const uchar *p = header + CaptureFormat::RecordHeaderSize;
+  for (quint32 i = 0; i < entryCount; ++i, p += CaptureFormat::IndexEntrySize) {
+    CaptureFormat::IndexEntry &entry = index[i];
+    entry.offset = qFromLittleEndian<quint64>(p);
+    entry.timestamp = qFromLittleEndian<qint64>(p + 8);
+    entry.record = qFromLittleEndian<quint64>(p + 16);
+    if (entry.offset < m_dataStart ||
+        entry.offset + CaptureFormat::RecordHeaderSize > indexStart ||
+        entry.record >= recordCount) {
+      return false;
+    }
+    if (i > 0 && (entry.offset <= index[i - 1].offset ||
+                  entry.record <= index[i - 1].record)) {
+      return false;
+    }
+  }
+  if (recordCount > 0 && (index.isEmpty() || index.first().record != 0)) {
+    return false;
+  }
+
+  m_index = index;
+  m_recordCount = qint64(recordCount);
+  m_longestRecord = qMin<quint64>(longest, indexStart - m_dataStart);
+  m_dataEnd = indexStart;
+  return true;
+}
+
+void CaptureReader::buildIndex() {
+  // The writer did not get to close the segment: walk the record headers,
+  // stopping at the first one that runs past the end of the file
+  m_index.clear();
+  m_recordCount = 0;
+  m_longestRecord = 0;
+
+  quint64 offset = m_dataStart;
+  while (offset + CaptureFormat::RecordHeaderSize <= quint64(m_size)) {
+    const uchar *header = m_map + offset;
+    const quint32 length = recordLength(header);
+    const quint64 next = offset + CaptureFormat::RecordHeaderSize + length;
+    if (next > quint64(m_size) || header[4] == CaptureFormat::Index) {
+      break;
+    }
+    if (m_recordCount % CaptureFormat::IndexInterval == 0) {
+      m_index.append({offset, recordTimestamp(header),
+                      quint64(m_recordCount)});
+    }
+    ++m_recordCount;
+    m_longestRecord = qMax<qint64>(m_longestRecord, length);
+    offset = next;
+  }
+  m_dataEnd = offset;
+}
+
+quint64 CaptureReader::seekRecord(qint64 id) const {
+  // Rows are painted in order, so most lookups step from the previous one;
+  // anything else restarts at the nearest index entry at or before id
+  if (id < m_cursorRecord ||
+      id - m_cursorRecord >= CaptureFormat::IndexInterval) {
+    auto it = std::upper_bound(m_index.cbegin(), m_index.cend(), id,
+                               [](qint64 value,
+                                  const CaptureFormat::IndexEntry &entry) {
+                                 return value < qint64(entry.record);
+                               });
+    --it;
+    m_cursorRecord = qint64(it->record);
+    m_cursorOffset = it->offset;
+  }
+
+  while (m_cursorRecord < id) {
+    m_cursorOffset = nextRecord(m_cursorOffset);
+    ++m_cursorRecord;
+  }
+  return m_cursorOffset;
+}
+
+quint64 CaptureReader::nextRecord(quint64 offset) const {
+  // Lengths come from the file; a damaged one must not lead a walk out of
+  // the data, let alone the mapping
+  if (offset + CaptureFormat::RecordHeaderSize > m_dataEnd) {
+    return m_dataEnd;
+  }
+  return qMin<quint64>(offset + CaptureFormat::RecordHeaderSize +
+                           recordLength(m_map + offset),
+                       m_dataEnd);
+}
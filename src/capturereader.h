@@ -0,0 +1,87 @@
+#ifndef CAPTUREREADER_H
+#define CAPTUREREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "captureformat.h"
+#include "consolesource.h"
+
+class QTemporaryFile;
+
+// Random access to a .sfcap capture. The file is memory-mapped, so opening
+// costs the same for any size: records are located through the sparse index
+// at the end of the file and only the pages actually read are touched.
+// Compressed (.qz) segments are inflated to a temporary file first. As a
+// ConsoleSource, record ids are record numbers and byte offsets are file
+// offsets, so a ConsoleView can show a capture directly.
+class CaptureReader : public ConsoleSource
+{
+public:
+    CaptureReader();
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    // File header
+    qint64 startTime() const; // ns since epoch
+    QMap<QString, QString> metadata() const;
+
+    // False when the index had to be rebuilt because the capture was not
+    // closed cleanly
+    bool hasStoredIndex() const;
+
+    QByteArray recordData(qint64 id) const;
+    // First record stamped at or after timestampNs
+    qint64 findRecord(qint64 timestampNs) const;
+
+    // ConsoleSource
+    qint64 firstRecord() const override;
+    qint64 endRecord() const override;
+    Record record(qint64 id) const override;
+    qint64 longestRecord() const override;
+    qsizetype copyBytes(quint64 offset, char *dest,
+                        qsizetype length) const override;
+
+private:
+    bool fail(const QString &error);
+    bool inflate(const QString &path);
+    bool loadIndex();
+    void buildIndex();
+    quint64 seekRecord(qint64 id) const;
+    // Header of the record after the one at offset, at most m_dataEnd
+    quint64 nextRecord(quint64 offset) const;
+
+    QFile m_file;
+    std::unique_ptr<QTemporaryFile> m_inflated;
+    QString m_path;
+    QString m_errorString;
+    uchar *m_map;
+    qint64 m_size;
+
+    qint64 m_startTime;
+    QMap<QString, QString> m_metadata;
+    quint64 m_dataStart; // first record header
+    quint64 m_dataEnd;   // end of the last data record
+
+    QVector<CaptureFormat::IndexEntry> m_index;
+    qint64 m_recordCount;
+    qint64 m_longestRecord;
+    bool m_storedIndex;
+
+    // Last record located; consecutive lookups walk on from here
+    mutable qint64 m_cursorRecord;
+    mutable quint64 m_cursorOffset;
+};
+
+#endif // CAPTUREREADER_H
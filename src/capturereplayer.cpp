@@ -0,0 +1,129 @@
+#include "capturereplayer.h"
+#include "capturereader.h"
+#include "serialportmanager.h"
+#include <QTimer>
+
+CaptureReplayer::CaptureReplayer(QObject *parent)
+    : QObject(parent), m_reader(nullptr), m_port(nullptr),
+      m_timer(new QTimer(this)), m_selection(ReplayRx), m_speed(1.0),
+      m_running(false), m_next(0), m_baseTimestamp(0) {
+  m_timer->setSingleShot(true);
+  m_timer->setTimerType(Qt::PreciseTimer);
+  connect(m_timer, &QTimer::timeout, this, &CaptureReplayer::step);
+}
+
+void CaptureReplayer::setReader(const CaptureReader *reader) {
+  stop();
+  m_reader = reader;
+}
+
+void CaptureReplayer::setPort(SerialPortManager *port) {
+  if (m_port) {
+    disconnect(m_port, nullptr, this, nullptr);
+  }
+  m_port = port;
+  if (m_port) {
+    // At full speed the port's queue paces the replay
+    connect(m_port, &SerialPortManager::txQueueChanged, this, [this]() {
+      if (m_running && m_speed <= 0 && !m_timer->isActive()) {
+        step();
+      }
+    });
+  }
+}
+
+void CaptureReplayer::setSelection(Selection selection) {
+  m_selection = selection;
+}
+
+void CaptureReplayer::setSpeed(double speed) {
+  m_speed = qMax(0.0, speed);
+  if (m_running) {
+    // Keep the current position: rebase so the next record is due now.
+    // Records played at full speed ran ahead of the clock, so a switch back
+    // to a timed speed needs this too.
+    if (m_next < m_reader->endRecord()) {
+      m_baseTimestamp = m_reader->record(m_next).timestamp;
+    }
+    m_clock.start();
+    m_timer->start(0);
+  }
+}
+
+double CaptureReplayer::speed() const { return m_speed; }
+
+void CaptureReplayer::start(qint64 fromRecord) {
+  stop();
+  if (!m_reader || fromRecord < 0 || fromRecord >= m_reader->endRecord()) {
+    return;
+  }
+
+  m_next = fromRecord;
+  m_baseTimestamp = m_reader->record(fromRecord).timestamp;
+  m_running = true;
+  m_clock.start();
+  step();
+}
+
+void CaptureReplayer::stop() {
+  m_timer->stop();
+  m_running = false;
+}
+
+bool CaptureReplayer::isRunning() const { return m_running; }
+
+qint64 CaptureReplayer::position() const { return m_next; }
+
+void CaptureReplayer::step() {
+  if (!m_running) {
+    return;
+  }
+
+  const qint64 end = m_reader->endRecord();
+  const qint64 elapsed = m_clock.nsecsElapsed();
+  for (int batch = 0; m_next < end; ++batch) {
+    if (batch == MaxBatchRecords) {
+      // Let the event loop breathe during long bursts
+      m_timer->start(0);
+      break;
+    }
+
+    const ConsoleSource::Record record = m_reader->record(m_next);
+    if (m_speed > 0) {
+      const qint64 due = qint64((record.timestamp - m_baseTimestamp) / m_speed);
+      if (due > elapsed) {
+        m_timer->start(int((due - elapsed) / 1000000));
+        break;
+      }
+    } else if (m_port && m_port->txQueuedBytes() >= PortWindow) {
+      break; // txQueueChanged() resumes
+    }
+
+    if (selected(record.direction)) {
+      const QByteArray data = m_reader->recordData(m_next);
+      if (m_port && m_port->isOpen()) {
+        m_port->sendData(data);
+      }
+      emit recordReplayed(record.direction, record.timestamp, data);
+    }
+    ++m_next;
+  }
+
+  emit progress(m_next, end);
+  if (m_next >= end) {
+    stop();
+    emit finished();
+  }
+}
+
+bool CaptureReplayer::selected(ConsoleSource::Direction direction) const {
+  switch (m_selection) {
+  case ReplayRx:
+    return direction == ConsoleSource::Rx;
+  case ReplayTx:
+    return direction == ConsoleSource::Tx;
+  case ReplayBoth:
+    break;
+  }
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef CAPTUREREPLAYER_H
+#define CAPTUREREPLAYER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include "consolesource.h"
+
+class CaptureReader;
+class QTimer;
+class SerialPortManager;
+
+// Plays the records of a capture back in time order. Selected records are
+// written to a SerialPortManager when one is set and always announced through
+// recordReplayed(), so a replay can also drive a view without any port.
+class CaptureReplayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Selection {
+        ReplayRx,
+        ReplayTx,
+        ReplayBoth
+    };
+
+    static constexpr int MaxBatchRecords = 1024; // per event loop pass
+    static constexpr qint64 PortWindow = 64 * 1024; // bytes queued at speed 0
+
+    explicit CaptureReplayer(QObject *parent = nullptr);
+
+    void setReader(const CaptureReader *reader);
+    void setPort(SerialPortManager *port);
+    void setSelection(Selection selection);
+    // 1 keeps the original timing, 10 plays ten times faster and 0 as fast
+    // as the port (or the event loop) accepts
+    void setSpeed(double speed);
+    double speed() const;
+
+    void start(qint64 fromRecord = 0);
+    void stop();
+    bool isRunning() const;
+    qint64 position() const;
+
+signals:
+    void recordReplayed(ConsoleSource::Direction direction, qint64 timestamp,
+                        const QByteArray &data);
+    void progress(qint64 record, qint64 recordCount);
+    void finished();
+
+private slots:
+    void step();
+
+private:
+    bool selected(ConsoleSource::Direction direction) const;
+
+    const CaptureReader *m_reader;
+    SerialPortManager *m_port;
+    QTimer *m_timer;
+    Selection m_selection;
+    double m_speed;
+    bool m_running;
+    qint64 m_next;
+    qint64 m_baseTimestamp; // capture time that maps to the start of replay
+    QElapsedTimer m_clock;
+};
+
+#endif // CAPTUREREPLAYER_H
@@ -0,0 +1,229 @@
+#include "capturewindow.h"
+#include "capturereplayer.h"
+#include "consoleview.h"
+#include "searchbar.h"
+#include "serialportmanager.h"
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDateTime>
+#include <QDateTimeEdit>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSerialPort>
+#include <QVBoxLayout>
+
+namespace {
+
+enum ReplayTarget { ConsoleTarget, PortTarget };
+
+QDateTime toDateTime(qint64 timestampNs) {
+  return QDateTime::fromMSecsSinceEpoch(timestampNs / 1000000);
+}
+
+QString frameFormat(const QMap<QString, QString> &metadata) {
+  // dataBits, stopBits and parity hold QSerialPort enum values
+  static const QMap<int, QString> parities = {
+      {QSerialPort::NoParity, "N"},   {QSerialPort::EvenParity, "E"},
+      {QSerialPort::OddParity, "O"},  {QSerialPort::SpaceParity, "S"},
+      {QSerialPort::MarkParity, "M"}};
+  const int stopBits = metadata.value("stopBits").toInt();
+  return metadata.value("dataBits") +
+         parities.value(metadata.value("parity").toInt(), "?") +
+         (stopBits == QSerialPort::OneAndHalfStop ? QString("1.5")
+                                                  : QString::number(stopBits));
+}
+
+} // namespace
+
+CaptureWindow::CaptureWindow(SerialPortManager *port, QWidget *parent)
+    : QWidget(parent, Qt::Window), m_replayer(new CaptureReplayer(this)),
+      m_port(port), m_startRecord(0) {
+  resize(1000, 600);
+
+  m_infoLabel = new QLabel(this);
+  m_infoLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+  m_view = new ConsoleView(this);
+  m_view->setFont(QFont("Courier", 10));
+  m_view->setShowTimestamp(true);
+  m_view->setAutoScroll(false);
+
+  // Navigation row
+  m_hexCheckBox = new QCheckBox("Hex", this);
+  m_timeEdit = new QDateTimeEdit(this);
+  m_timeEdit->setDisplayFormat("yyyy-MM-dd HH:mm:ss.zzz");
+  QPushButton *goButton = new QPushButton("Go", this);
+
+  QHBoxLayout *navigation = new QHBoxLayout;
+  navigation->addWidget(m_hexCheckBox);
+  navigation->addStretch();
+  navigation->addWidget(new QLabel("Go to time:", this));
+  navigation->addWidget(m_timeEdit);
+  navigation->addWidget(goButton);
+
+  // Replay row
+  m_selectionComboBox = new QComboBox(this);
+  m_selectionComboBox->addItem("RX", CaptureReplayer::ReplayRx);
+  m_selectionComboBox->addItem("TX", CaptureReplayer::ReplayTx);
+  m_selectionComboBox->addItem("RX + TX", CaptureReplayer::ReplayBoth);
+
+  m_speedComboBox = new QComboBox(this);
+  m_speedComboBox->addItem("1x", 1.0);
+  m_speedComboBox->addItem("2x", 2.0);
+  m_speedComboBox->addItem("10x", 10.0);
+  m_speedComboBox->addItem("100x", 100.0);
+  m_speedComboBox->addItem("Max", 0.0);
+
+  m_targetComboBox = new QComboBox(this);
+  m_targetComboBox->addItem("Console", ConsoleTarget);
+  m_targetComboBox->addItem("Connected port", PortTarget);
+
+  m_replayButton = new QPushButton("Replay", this);
+  m_progressLabel = new QLabel(this);
+
+  QHBoxLayout *replay = new QHBoxLayout;
+  replay->addWidget(new QLabel("Replay:", this));
+  replay->addWidget(m_selectionComboBox);
+  replay->addWidget(new QLabel("Speed:", this));
+  replay->addWidget(m_speedComboBox);
+  replay->addWidget(new QLabel("To:", this));
+  replay->addWidget(m_targetComboBox);
+  replay->addWidget(m_replayButton);
+  replay->addWidget(m_progressLabel, 1);
+
+  m_searchBar = new SearchBar(this);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addWidget(m_infoLabel);
+  layout->addLayout(navigation);
+  layout->addWidget(m_searchBar);
+  layout->addWidget(m_view, 1);
+  layout->addLayout(replay);
+
+  connect(m_hexCheckBox, &QCheckBox::toggled, m_view,
+          &ConsoleView::setHexMode);
+  connect(goButton, &QPushButton::clicked, this, &CaptureWindow::goToTime);
+  connect(m_replayButton, &QPushButton::clicked, this,
+          &CaptureWindow::toggleReplay);
+  connect(m_speedComboBox,
+          QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          [this]() {
+            m_replayer->setSpeed(m_speedComboBox->currentData().toDouble());
+          });
+
+  connect(m_replayer, &CaptureReplayer::recordReplayed, this,
+          [this](ConsoleSource::Direction direction, qint64 timestamp,
+                 const QByteArray &data) {
+            Q_UNUSED(timestamp);
+            if (m_targetComboBox->currentData().toInt() == ConsoleTarget) {
+              emit recordReplayed(direction, data);
+            }
+          });
+  connect(m_replayer, &CaptureReplayer::progress, this,
+          &CaptureWindow::onReplayProgress);
+  connect(m_replayer, &CaptureReplayer::finished, this,
+          &CaptureWindow::onReplayFinished);
+}
+
+CaptureWindow::~CaptureWindow() {
+  // The replayer reads from m_reader, which goes first
+  m_replayer->stop();
+}
+
+bool CaptureWindow::open(const QString &path) {
+  m_replayer->setReader(nullptr);
+  m_view->setSource(nullptr);
+  if (!m_reader.open(path)) {
+    return false;
+  }
+
+  m_replayer->setReader(&m_reader);
+  m_view->setSource(&m_reader);
+  m_searchBar->setView(m_view, &m_reader);
+  m_startRecord = 0;
+
+  const QDateTime start = toDateTime(m_reader.startTime());
+  QDateTime end = start;
+  if (m_reader.recordCount() > 0) {
+    end = toDateTime(m_reader.record(m_reader.endRecord() - 1).timestamp);
+  }
+  m_timeEdit->setDateTimeRange(start, end);
+  m_timeEdit->setDateTime(start);
+
+  setWindowTitle(QFileInfo(path).fileName() + " - Capture");
+  updateInfo();
+  m_progressLabel->clear();
+  return true;
+}
+
+QString CaptureWindow::errorString() const { return m_reader.errorString(); }
+
+void CaptureWindow::goToTime() {
+  if (!m_reader.isOpen()) {
+    return;
+  }
+  const qint64 timestamp = m_timeEdit->dateTime().toMSecsSinceEpoch() * 1000000;
+  m_startRecord =
+      qMin(m_reader.findRecord(timestamp), m_reader.endRecord() - 1);
+  m_view->scrollToRecord(m_startRecord);
+}
+
+void CaptureWindow::toggleReplay() {
+  if (m_replayer->isRunning()) {
+    m_replayer->stop();
+    onReplayFinished();
+    return;
+  }
+  if (!m_reader.isOpen() || m_reader.recordCount() == 0) {
+    return;
+  }
+
+  const bool toPort = m_targetComboBox->currentData().toInt() == PortTarget;
+  if (toPort && !m_port->isOpen()) {
+    m_progressLabel->setText("Connect a port first");
+    return;
+  }
+
+  m_replayer->setPort(toPort ? m_port : nullptr);
+  m_replayer->setSelection(static_cast<CaptureReplayer::Selection>(
+      m_selectionComboBox->currentData().toInt()));
+  m_replayer->setSpeed(m_speedComboBox->currentData().toDouble());
+  m_selectionComboBox->setEnabled(false);
+  m_targetComboBox->setEnabled(false);
+  m_replayButton->setText("Stop");
+  m_replayer->start(m_startRecord);
+}
+
+void CaptureWindow::onReplayProgress(qint64 record, qint64 recordCount) {
+  m_progressLabel->setText(
+      QString("Record %1 of %2").arg(record).arg(recordCount));
+}
+
+void CaptureWindow::onReplayFinished() {
+  m_selectionComboBox->setEnabled(true);
+  m_targetComboBox->setEnabled(true);
+  m_replayButton->setText("Replay");
+}
+
+void CaptureWindow::updateInfo() {
+  const QMap<QString, QString> metadata = m_reader.metadata();
+  QStringList parts;
+  if (metadata.contains("port")) {
+    parts << metadata.value("port");
+  }
+  if (metadata.contains("baud")) {
+    parts << metadata.value("baud") + " baud";
+  }
+  if (metadata.contains("dataBits")) {
+    parts << frameFormat(metadata);
+  }
+  parts << toDateTime(m_reader.startTime())
+               .toString("yyyy-MM-dd HH:mm:ss.zzz");
+  parts << QString("%1 records").arg(m_reader.recordCount());
+  if (!m_reader.hasStoredIndex()) {
+    parts << "index rebuilt (capture was not closed cleanly)";
+  }
+  m_infoLabel->setText(parts.join(" | "));
+}
@@ -0,0 +1,63 @@
+#ifndef CAPTUREWINDOW_H
+#define CAPTUREWINDOW_H
+
+#include <QWidget>
+#include <QByteArray>
+#include <QString>
+#include "capturereader.h"
+
+class CaptureReplayer;
+class ConsoleView;
+class QCheckBox;
+class QComboBox;
+class QDateTimeEdit;
+class QLabel;
+class QPushButton;
+class SearchBar;
+class SerialPortManager;
+
+// Browses a .sfcap capture and replays it. The capture is shown straight
+// from the mapped file, one row per recorded chunk; a replay goes to the
+// connected port or, through recordReplayed(), to the main console.
+class CaptureWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit CaptureWindow(SerialPortManager *port, QWidget *parent = nullptr);
+    ~CaptureWindow();
+
+    bool open(const QString &path);
+    QString errorString() const;
+
+signals:
+    void recordReplayed(ConsoleSource::Direction direction,
+                        const QByteArray &data);
+
+private slots:
+    void goToTime();
+    void toggleReplay();
+    void onReplayProgress(qint64 record, qint64 recordCount);
+    void onReplayFinished();
+
+private:
+    void updateInfo();
+
+    CaptureReader m_reader;
+    CaptureReplayer *m_replayer;
+    SerialPortManager *m_port;
+    qint64 m_startRecord; // where a replay starts, set by goToTime()
+
+    QLabel *m_infoLabel;
+    ConsoleView *m_view;
+    SearchBar *m_searchBar;
+    QCheckBox *m_hexCheckBox;
+    QDateTimeEdit *m_timeEdit;
+    QComboBox *m_selectionComboBox;
+    QComboBox *m_speedComboBox;
+    QComboBox *m_targetComboBox;
+    QPushButton *m_replayButton;
+    QLabel *m_progressLabel;
+};
+
+#endif // CAPTUREWINDOW_H
@@ -0,0 +1,70 @@
+#include "chunkpool.h"
+#include <utility>
+
+ChunkPool::ChunkPool(qsizetype chunkSize, int maxChunks)
+    : m_chunkSize(qMax<qsizetype>(1, chunkSize)),
+      m_maxChunks(qMax(1, maxChunks)), m_next(0), m_current(nullptr),
+      m_acquisitions(0), m_allocations(0), m_pooledChunks(0) {
+  // Slots never move, so m_current stays valid between acquire and commit
+  m_slots.reserve(m_maxChunks);
+}
+
+qsizetype ChunkPool::chunkSize() const { return m_chunkSize; }
+
+QByteArray *ChunkPool::findFreeSlot() {
+  const int count = m_slots.size();
+  for (int i = 0; i < count; ++i) {
+    const int index = (m_next + i) % count;
+    QByteArray &slot = m_slots[index];
+    if (slot.isDetached()) {
+      // The last copy may have been released on another thread; make sure
+      // its reads are finished before the slot is written again.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      m_next = (index + 1) % count;
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+char *ChunkPool::acquire() {
+  m_current = findFreeSlot();
+  if (!m_current && m_slots.size() < m_maxChunks) {
+    m_slots.append(QByteArray(m_chunkSize, Qt::Uninitialized));
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    m_pooledChunks.store(m_slots.size(), std::memory_order_relaxed);
+    m_current = &m_slots.last();
+  }
+  if (!m_current) {
+    m_overflow = QByteArray(m_chunkSize, Qt::Uninitialized);
+    m_allocations.fetch_add(1, std::memory_order_relaxed);
+    m_current = &m_overflow;
+  }
+
+  // Only grows back to the capacity the slot already has
+  m_current->resize(m_chunkSize);
+  return m_current->data();
+}
+
+QByteArray ChunkPool::commit(qsizetype size) {
+  Q_ASSERT(m_current);
+  QByteArray *slot = std::exchange(m_current, nullptr);
+  if (size <= 0) {
+    return QByteArray();
+  }
+
+  slot->resize(qMin(size, m_chunkSize));
+  m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+  if (slot == &m_overflow) {
+    return std::exchange(m_overflow, QByteArray());
+  }
+  return *slot;
+}
+
+ChunkPool::Stats ChunkPool::stats() const {
+  Stats stats;
+  stats.acquisitions = m_acquisitions.load(std::memory_order_relaxed);
+  stats.allocations = m_allocations.load(std::memory_order_relaxed);
+  stats.pooledChunks = m_pooledChunks.load(std::memory_order_relaxed);
+  return stats;
+}
@@ -0,0 +1,59 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include <QByteArray>
+#include <QVector>
+#include <atomic>
+
+// Recycled receive buffers for the I/O thread.
+// Each slot is a QByteArray the pool keeps a reference to; chunks handed out
+// by commit() are shallow copies of it, so consumers share the bytes through
+// Qt's reference count. A slot is written again only once every copy has been
+// destroyed, which makes steady-state reception allocation free. acquire()
+// and commit() must be called from a single thread; the counters may be read
+// from any thread.
+class ChunkPool
+{
+public:
+    static constexpr qsizetype DefaultChunkSize = 16 * 1024;
+    static constexpr int DefaultMaxChunks = 256;
+
+    struct Stats
+    {
+        quint64 acquisitions = 0; // buffers handed out by commit()
+        quint64 allocations = 0;  // heap allocations made to serve them
+        int pooledChunks = 0;     // slots currently owned by the pool
+    };
+
+    explicit ChunkPool(qsizetype chunkSize = DefaultChunkSize,
+                       int maxChunks = DefaultMaxChunks);
+
+    ChunkPool(const ChunkPool &) = delete;
+    ChunkPool &operator=(const ChunkPool &) = delete;
+
+    qsizetype chunkSize() const;
+
+    // Returns chunkSize() writable bytes. If every slot is still referenced
+    // and the pool is at its limit, the storage is a one-off allocation.
+    char *acquire();
+    // Hands out the first size bytes written since acquire(); size 0 returns
+    // the slot to the pool unused
+    QByteArray commit(qsizetype size);
+
+    Stats stats() const;
+
+private:
+    QByteArray *findFreeSlot();
+
+    qsizetype m_chunkSize;
+    int m_maxChunks;
+    QVector<QByteArray> m_slots;
+    int m_next;
+    QByteArray *m_current;
+    QByteArray m_overflow;
+    std::atomic<quint64> m_acquisitions;
+    std::atomic<quint64> m_allocations;
+    std::atomic<int> m_pooledChunks;
+};
+
+#endif // CHUNKPOOL_H
@@ -0,0 +1,170 @@
+#include "consolebuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+qsizetype roundUpToPowerOfTwo(qsizetype value) {
+  qsizetype size = 2;
+  while (size < value) {
+    size <<= 1;
+  }
+  return size;
+}
+
+} // namespace
+
+ConsoleBuffer::ConsoleBuffer(qsizetype byteCapacity, qsizetype recordCapacity)
+    : m_endByte(0), m_firstRecord(0), m_endRecord(0), m_longestRecord(0),
+      m_firstTextState(0) {
+  m_bytes.resize(roundUpToPowerOfTwo(byteCapacity));
+  m_byteMask = static_cast<quint64>(m_bytes.size()) - 1;
+  m_records.resize(roundUpToPowerOfTwo(recordCapacity));
+  m_recordMask = m_records.size() - 1;
+}
+
+void ConsoleBuffer::append(Direction direction, const QByteArray &data,
+                           qint64 timestamp, quint16 source) {
+  const char *bytes = data.constData();
+  const qsizetype size = data.size();
+  quint8 flags = 0;
+  qsizetype start = 0;
+
+  // Device output is decoded as one stream per direction and source, so
+  // colours and characters can run on across lines and reads
+  TerminalDecoder *decoder = nullptr;
+  if (direction == Rx || direction == Tx) {
+    decoder = &m_decoders[quint32(source) << 1 | (direction == Tx ? 1 : 0)];
+  }
+  auto appendLine = [&](qsizetype end) {
+    if (decoder) {
+      if (!decoder->state().isInitial()) {
+        m_textStates.append(TextState{m_endRecord, decoder->state()});
+      }
+      decoder->advance(bytes + start, end - start);
+    }
+    appendRecord(direction, bytes + start, end - start, flags, source,
+                 timestamp);
+  };
+
+  for (qsizetype i = 0; i < size; ++i) {
+    if (bytes[i] != '\n' && bytes[i] != '\r') {
+      continue;
+    }
+    if (bytes[i] == '\r' && i + 1 < size && bytes[i + 1] == '\n') {
+      ++i;
+    }
+    appendLine(i + 1);
+    flags = Continuation;
+    start = i + 1;
+  }
+
+  if (start < size || size == 0) {
+    appendLine(size);
+  }
+}
+
+void ConsoleBuffer::appendFrame(Direction direction, const QByteArray &data,
+                                qint64 timestamp, quint16 source) {
+  appendRecord(direction, data.constData(), data.size(), 0, source, timestamp);
+}
+
+void ConsoleBuffer::clear() {
+  m_firstRecord = m_endRecord;
+  m_longestRecord = 0;
+  m_textStates.clear();
+  m_firstTextState = 0;
+}
+
+ConsoleBuffer::Record ConsoleBuffer::record(qint64 id) const {
+  Q_ASSERT(id >= m_firstRecord && id < m_endRecord);
+  return m_records[id & m_recordMask];
+}
+
+QByteArray ConsoleBuffer::recordData(qint64 id) const {
+  const Record &r = record(id);
+  QByteArray data(r.length, Qt::Uninitialized);
+  copyBytes(r.offset, data.data(), r.length);
+  return data;
+}
+
+TerminalDecoder::State ConsoleBuffer::textState(qint64 id) const {
+  const auto end = m_textStates.cend();
+  const auto it = std::lower_bound(
+      m_textStates.cbegin() + m_firstTextState, end, id,
+      [](const TextState &state, qint64 id) { return state.record < id; });
+  return it != end && it->record == id ? it->state : TerminalDecoder::State();
+}
+
+quint64 ConsoleBuffer::firstByte() const {
+  return m_firstRecord < m_endRecord ? record(m_firstRecord).offset
+                                     : m_endByte;
+}
+
+qsizetype ConsoleBuffer::copyBytes(quint64 offset, char *dest,
+                                   qsizetype length) const {
+  if (offset < firstByte() || offset >= m_endByte) {
+    return 0;
+  }
+  length = qMin<qsizetype>(length, m_endByte - offset);
+
+  // Copy in at most two pieces around the wrap point
+  qsizetype copied = 0;
+  while (copied < length) {
+    const quint64 index = (offset + copied) & m_byteMask;
+    const qsizetype piece =
+        qMin<qsizetype>(length - copied, m_bytes.size() - index);
+    std::memcpy(dest + copied, m_bytes.constData() + index, piece);
+    copied += piece;
+  }
+  return copied;
+}
+
+void ConsoleBuffer::appendRecord(Direction direction, const char *data,
+                                 qsizetype length, quint8 flags,
+                                 quint16 source, qint64 timestamp) {
+  // A single line longer than the whole store keeps only its tail
+  if (length > m_bytes.size()) {
+    data += length - m_bytes.size();
+    length = m_bytes.size();
+  }
+
+  // Evict whatever the new bytes or the new record slot will overwrite
+  const quint64 newEnd = m_endByte + length;
+  const quint64 capacity = static_cast<quint64>(m_bytes.size());
+  while (m_firstRecord < m_endRecord &&
+         (m_endRecord - m_firstRecord > m_recordMask ||
+          newEnd - record(m_firstRecord).offset > capacity)) {
+    ++m_firstRecord;
+  }
+  while (m_firstTextState < m_textStates.size() &&
+         m_textStates[m_firstTextState].record < m_firstRecord) {
+    ++m_firstTextState;
+  }
+  // Evicted states are dropped in bulk rather than one at a time
+  if (m_firstTextState > 1024 && m_firstTextState * 2 > m_textStates.size()) {
+    m_textStates.remove(0, m_firstTextState);
+    m_firstTextState = 0;
+  }
+
+  qsizetype written = 0;
+  while (written < length) {
+    const quint64 index = (m_endByte + written) & m_byteMask;
+    const qsizetype piece =
+        qMin<qsizetype>(length - written, m_bytes.size() - index);
+    std::memcpy(m_bytes.data() + index, data + written, piece);
+    written += piece;
+  }
+
+  Record &r = m_records[m_endRecord & m_recordMask];
+  r.offset = m_endByte;
+  r.length = static_cast<quint32>(length);
+  r.direction = direction;
+  r.flags = flags;
+  r.source = source;
+  r.timestamp = timestamp;
+
+  m_endByte = newEnd;
+  ++m_endRecord;
+  m_longestRecord = qMax<qint64>(m_longestRecord, length);
+}
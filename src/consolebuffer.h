@@ -0,0 +1,74 @@
+#ifndef CONSOLEBUFFER_H
+#define CONSOLEBUFFER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <QtGlobal>
+#include "consolesource.h"
+
+// Fixed-capacity history of console traffic. Raw bytes go into a circular
+// byte store and every display line gets a small metadata record pointing
+// into it. Records are addressed by absolute, ever-increasing ids so views can
+// keep their position while the oldest entries are evicted.
+//
+// RX and TX are also run through a TerminalDecoder per direction and source,
+// and records that do not start in its initial state keep the state they
+// start in: a colour still set, or a character cut in two by a read.
+class ConsoleBuffer : public ConsoleSource
+{
+public:
+    static constexpr qsizetype DefaultByteCapacity = 16 * 1024 * 1024;
+    static constexpr qsizetype DefaultRecordCapacity = 256 * 1024;
+
+    explicit ConsoleBuffer(qsizetype byteCapacity = DefaultByteCapacity,
+                           qsizetype recordCapacity = DefaultRecordCapacity);
+
+    // Stores data and splits it into one record per line (CR, LF or CRLF)
+    void append(Direction direction, const QByteArray &data, qint64 timestamp,
+                quint16 source = 0);
+    // Stores data as one record regardless of the bytes it contains
+    void appendFrame(Direction direction, const QByteArray &data,
+                     qint64 timestamp, quint16 source = 0);
+    void clear();
+
+    // Record access
+    qint64 firstRecord() const override { return m_firstRecord; }
+    qint64 endRecord() const override { return m_endRecord; }
+    Record record(qint64 id) const override;
+    QByteArray recordData(qint64 id) const;
+    qint64 longestRecord() const override { return m_longestRecord; }
+
+    // Raw byte stream access
+    quint64 firstByte() const;
+    quint64 endByte() const { return m_endByte; }
+    qsizetype copyBytes(quint64 offset, char *dest,
+                        qsizetype length) const override;
+    TerminalDecoder::State textState(qint64 id) const override;
+
+private:
+    struct TextState
+    {
+        qint64 record;
+        TerminalDecoder::State state;
+    };
+
+    void appendRecord(Direction direction, const char *data, qsizetype length,
+                      quint8 flags, quint16 source, qint64 timestamp);
+
+    QByteArray m_bytes;
+    quint64 m_byteMask;
+    quint64 m_endByte;
+
+    QVector<Record> m_records;
+    qint64 m_recordMask;
+    qint64 m_firstRecord;
+    qint64 m_endRecord;
+    qint64 m_longestRecord;
+
+    QHash<quint32, TerminalDecoder> m_decoders; // By direction and source
+    QVector<TextState> m_textStates;            // Ascending record ids
+    qsizetype m_firstTextState;                 // Evicted ones come before
+};
+
+#endif // CONSOLEBUFFER_H
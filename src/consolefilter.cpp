@@ -0,0 +1,71 @@
+#include "consolefilter.h"
+#include "consolesearch.h"
+#include <algorithm>
+
+ConsoleFilter::ConsoleFilter(const ConsoleSearch *search)
+    : m_search(search), m_dropped(0), m_scannedEnd(0) {}
+
+void ConsoleFilter::rebuild() {
+  m_ids.clear();
+  m_dropped = 0;
+  m_scannedEnd = 0;
+  update();
+}
+
+void ConsoleFilter::update() {
+  const ConsoleSource *source = m_search->source();
+  if (!source) {
+    return;
+  }
+
+  const qint64 first = source->firstRecord();
+  const qint64 end = source->endRecord();
+  if (end < m_scannedEnd) {
+    m_dropped += m_ids.size();
+    m_ids.clear();
+    m_scannedEnd = 0;
+  }
+  while (!m_ids.isEmpty() && m_ids.first() < first) {
+    m_ids.removeFirst();
+    ++m_dropped;
+  }
+
+  m_search->collectMatches(qMax(m_scannedEnd, first), end, m_ids);
+  m_scannedEnd = end;
+}
+
+qint64 ConsoleFilter::filteredId(qint64 sourceId) const {
+  const auto it = std::lower_bound(m_ids.cbegin(), m_ids.cend(), sourceId);
+  if (it == m_ids.cend() || *it != sourceId) {
+    return -1;
+  }
+  return m_dropped + (it - m_ids.cbegin());
+}
+
+qint64 ConsoleFilter::firstRecord() const { return m_dropped; }
+
+qint64 ConsoleFilter::endRecord() const { return m_dropped + m_ids.size(); }
+
+ConsoleSource::Record ConsoleFilter::record(qint64 id) const {
+  Q_ASSERT(id >= firstRecord() && id < endRecord());
+  Record r = m_search->source()->record(m_ids[id - m_dropped]);
+  // A matching line stands on its own here
+  r.flags &= ~Continuation;
+  return r;
+}
+
+TerminalDecoder::State ConsoleFilter::textState(qint64 id) const {
+  Q_ASSERT(id >= firstRecord() && id < endRecord());
+  return m_search->source()->textState(m_ids[id - m_dropped]);
+}
+
+qint64 ConsoleFilter::longestRecord() const {
+  const ConsoleSource *source = m_search->source();
+  return source ? source->longestRecord() : 0;
+}
+
+qsizetype ConsoleFilter::copyBytes(quint64 offset, char *dest,
+                                   qsizetype length) const {
+  const ConsoleSource *source = m_search->source();
+  return source ? source->copyBytes(offset, dest, length) : 0;
+}
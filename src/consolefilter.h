@@ -0,0 +1,41 @@
+#ifndef CONSOLEFILTER_H
+#define CONSOLEFILTER_H
+
+#include <QVector>
+#include "consolesource.h"
+
+class ConsoleSearch;
+
+// The records of another source that match a ConsoleSearch, as a source of
+// its own so a ConsoleView can show only them. update() picks up appended
+// records through the search index and drops evicted ones; ids keep
+// increasing across both, like ConsoleBuffer's.
+class ConsoleFilter : public ConsoleSource
+{
+public:
+    explicit ConsoleFilter(const ConsoleSearch *search);
+
+    // Matches the whole history again, after the pattern or source changed
+    void rebuild();
+    void update();
+
+    // Id in this filter of a source record, or -1 when it does not match
+    qint64 filteredId(qint64 sourceId) const;
+
+    // ConsoleSource
+    qint64 firstRecord() const override;
+    qint64 endRecord() const override;
+    Record record(qint64 id) const override;
+    qint64 longestRecord() const override;
+    qsizetype copyBytes(quint64 offset, char *dest,
+                        qsizetype length) const override;
+    TerminalDecoder::State textState(qint64 id) const override;
+
+private:
+    const ConsoleSearch *m_search;
+    QVector<qint64> m_ids;  // Matching source ids, ascending
+    qint64 m_dropped;       // Evicted matches; id of m_ids.first()
+    qint64 m_scannedEnd;    // Source records below this were matched
+};
+
+#endif // CONSOLEFILTER_H
@@ -0,0 +1,303 @@
+#include "consolesearch.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+char foldCase(char c) { return c >= 'A' && c <= 'Z' ? char(c + 32) : c; }
+
+int bloomBit(quint32 key) {
+  // Fibonacci hashing down to 12 bits
+  return int((key * 0x9E3779B1u) >> 20);
+}
+
+int byteBit(char c) { return bloomBit(0x10000u | quint8(c)); }
+
+int pairBit(char first, char second) {
+  return bloomBit(quint32(quint8(first)) << 8 | quint8(second));
+}
+
+bool isHexDigit(char16_t c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F');
+}
+
+bool parseHex(const QString &text, QByteArray &bytes) {
+  QByteArray digits;
+  for (QChar c : text) {
+    if (c.isSpace()) {
+      continue;
+    }
+    if (!isHexDigit(c.unicode())) {
+      return false;
+    }
+    digits += char(c.unicode());
+  }
+  if (digits.size() % 2) {
+    return false;
+  }
+  bytes = QByteArray::fromHex(digits);
+  return true;
+}
+
+} // namespace
+
+ConsoleSearch::ConsoleSearch(const ConsoleSource *source)
+    : m_source(source), m_firstBlock(0), m_indexedEnd(0), m_mode(Text),
+      m_caseSensitive(false), m_active(false) {}
+
+void ConsoleSearch::setSource(const ConsoleSource *source) {
+  m_source = source;
+  m_blocks.clear();
+  m_firstBlock = 0;
+  m_indexedEnd = 0;
+}
+
+const ConsoleSource *ConsoleSearch::source() const { return m_source; }
+
+bool ConsoleSearch::setPattern(const QString &pattern, Mode mode,
+                               bool caseSensitive) {
+  m_mode = mode;
+  m_caseSensitive = caseSensitive;
+  m_active = false;
+  m_errorString.clear();
+  m_literal.clear();
+  m_requiredBits.clear();
+  if (pattern.isEmpty()) {
+    return true;
+  }
+
+  switch (mode) {
+  case Text:
+    m_literal = pattern.toUtf8();
+    break;
+  case Hex:
+    if (!parseHex(pattern, m_literal)) {
+      m_errorString = "Hex patterns are pairs of hex digits, e.g. 0D 0A";
+      return false;
+    }
+    m_caseSensitive = true;
+    break;
+  case Regex:
+    m_regex.setPattern(pattern);
+    m_regex.setPatternOptions(caseSensitive
+                                  ? QRegularExpression::NoPatternOption
+                                  : QRegularExpression::CaseInsensitiveOption);
+    if (!m_regex.isValid()) {
+      m_errorString = m_regex.errorString();
+      return false;
+    }
+    m_active = true;
+    return true;
+  }
+
+  if (!m_caseSensitive) {
+    std::transform(m_literal.begin(), m_literal.end(), m_literal.begin(),
+                   foldCase);
+  }
+  m_matcher.setPattern(m_literal);
+
+  // The index is case folded, whatever the search
+  if (m_literal.size() == 1) {
+    m_requiredBits.append(byteBit(foldCase(m_literal[0])));
+  }
+  for (qsizetype i = 1; i < m_literal.size(); ++i) {
+    m_requiredBits.append(
+        pairBit(foldCase(m_literal[i - 1]), foldCase(m_literal[i])));
+  }
+  std::sort(m_requiredBits.begin(), m_requiredBits.end());
+  m_requiredBits.erase(
+      std::unique(m_requiredBits.begin(), m_requiredBits.end()),
+      m_requiredBits.end());
+  m_active = true;
+  return true;
+}
+
+bool ConsoleSearch::isActive() const { return m_active; }
+
+QString ConsoleSearch::errorString() const { return m_errorString; }
+
+void ConsoleSearch::update() {
+  if (!m_source) {
+    return;
+  }
+
+  const qint64 first = m_source->firstRecord();
+  const qint64 end = m_source->endRecord();
+  if (end < m_indexedEnd) {
+    // Not the history that was indexed
+    m_blocks.clear();
+    m_indexedEnd = 0;
+  }
+
+  const qint64 firstBlock = first / BlockRecords;
+  while (!m_blocks.isEmpty() && m_firstBlock < firstBlock) {
+    m_blocks.removeFirst();
+    ++m_firstBlock;
+  }
+  if (m_blocks.isEmpty()) {
+    m_firstBlock = firstBlock;
+  }
+
+  for (qint64 id = qMax(m_indexedEnd, first); id < end; ++id) {
+    const qint64 block = id / BlockRecords;
+    while (m_firstBlock + m_blocks.size() <= block) {
+      m_blocks.append(Block{});
+    }
+    indexRecord(m_blocks[block - m_firstBlock], id);
+  }
+  m_indexedEnd = end;
+}
+
+ConsoleSearch::Match ConsoleSearch::findNext(qint64 record, int start) const {
+  if (!m_active || !m_source) {
+    return Match();
+  }
+
+  const qint64 end = m_source->endRecord();
+  qint64 id = qMax(record, m_source->firstRecord());
+  if (id != record) {
+    start = 0;
+  }
+  while (id < end) {
+    if (!blockMayMatch(id)) {
+      id = (id / BlockRecords + 1) * BlockRecords;
+      start = 0;
+      continue;
+    }
+    const QVector<Range> ranges = matchesIn(m_source->record(id));
+    for (const Range &range : ranges) {
+      if (range.start >= start) {
+        return Match{id, range.start, range.length};
+      }
+    }
+    ++id;
+    start = 0;
+  }
+  return Match();
+}
+
+ConsoleSearch::Match ConsoleSearch::findPrevious(qint64 record,
+                                                 int start) const {
+  if (!m_active || !m_source) {
+    return Match();
+  }
+
+  const qint64 first = m_source->firstRecord();
+  qint64 id = qMin(record, m_source->endRecord() - 1);
+  if (id != record) {
+    start = std::numeric_limits<int>::max();
+  }
+  while (id >= first) {
+    if (!blockMayMatch(id)) {
+      id = (id / BlockRecords) * BlockRecords - 1;
+      start = std::numeric_limits<int>::max();
+      continue;
+    }
+    const QVector<Range> ranges = matchesIn(m_source->record(id));
+    for (auto it = ranges.crbegin(); it != ranges.crend(); ++it) {
+      if (it->start < start) {
+        return Match{id, it->start, it->length};
+      }
+    }
+    --id;
+    start = std::numeric_limits<int>::max();
+  }
+  return Match();
+}
+
+QVector<ConsoleSearch::Range>
+ConsoleSearch::matchesIn(const ConsoleSource::Record &record) const {
+  QVector<Range> ranges;
+  if (!m_active || !m_source) {
+    return ranges;
+  }
+  loadRecord(record);
+
+  if (m_mode == Regex) {
+    // Latin-1 keeps one character per byte, so offsets stay byte offsets
+    QRegularExpressionMatchIterator it =
+        m_regex.globalMatch(QString::fromLatin1(m_scratch));
+    while (it.hasNext()) {
+      const QRegularExpressionMatch match = it.next();
+      if (match.capturedLength() > 0) {
+        ranges.append(
+            {int(match.capturedStart()), int(match.capturedLength())});
+      }
+    }
+    return ranges;
+  }
+
+  if (!m_caseSensitive) {
+    std::transform(m_scratch.begin(), m_scratch.end(), m_scratch.begin(),
+                   foldCase);
+  }
+  qsizetype pos = m_matcher.indexIn(m_scratch.constData(), m_scratch.size());
+  while (pos >= 0) {
+    ranges.append({int(pos), int(m_literal.size())});
+    pos = m_matcher.indexIn(m_scratch.constData(), m_scratch.size(),
+                            pos + m_literal.size());
+  }
+  return ranges;
+}
+
+bool ConsoleSearch::recordMatches(qint64 id) const {
+  return blockMayMatch(id) && !matchesIn(m_source->record(id)).isEmpty();
+}
+
+void ConsoleSearch::collectMatches(qint64 first, qint64 end,
+                                   QVector<qint64> &ids) const {
+  if (!m_active || !m_source) {
+    return;
+  }
+  qint64 id = first;
+  while (id < end) {
+    if (!blockMayMatch(id)) {
+      id = (id / BlockRecords + 1) * BlockRecords;
+      continue;
+    }
+    if (!matchesIn(m_source->record(id)).isEmpty()) {
+      ids.append(id);
+    }
+    ++id;
+  }
+}
+
+void ConsoleSearch::indexRecord(Block &block, qint64 id) {
+  loadRecord(m_source->record(id));
+  const char *data = m_scratch.constData();
+  char previous = 0;
+  for (qsizetype i = 0; i < m_scratch.size(); ++i) {
+    const char c = foldCase(data[i]);
+    const int byte = byteBit(c);
+    block.bits[byte >> 6] |= quint64(1) << (byte & 63);
+    if (i > 0) {
+      const int pair = pairBit(previous, c);
+      block.bits[pair >> 6] |= quint64(1) << (pair & 63);
+    }
+    previous = c;
+  }
+}
+
+bool ConsoleSearch::blockMayMatch(qint64 id) const {
+  const qint64 block = id / BlockRecords;
+  // Regexes have no required bits; unindexed records are always visited
+  if (m_requiredBits.isEmpty() || (block + 1) * BlockRecords > m_indexedEnd ||
+      block < m_firstBlock) {
+    return true;
+  }
+
+  const Block &bloom = m_blocks[block - m_firstBlock];
+  for (int bit : m_requiredBits) {
+    if (!(bloom.bits[bit >> 6] & (quint64(1) << (bit & 63)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ConsoleSearch::loadRecord(const ConsoleSource::Record &record) const {
+  m_scratch.resize(record.length);
+  m_scratch.resize(
+      m_source->copyBytes(record.offset, m_scratch.data(), record.length));
+}
@@ -0,0 +1,96 @@
+#ifndef CONSOLESEARCH_H
+#define CONSOLESEARCH_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+#include "consolesource.h"
+
+// Finds a pattern in the raw bytes of a ConsoleSource. Records are grouped
+// into blocks of BlockRecords, and each block keeps a small Bloom filter of
+// the byte pairs it contains (ASCII case folded). A literal pattern only
+// visits blocks holding all of its pairs, so searching a long history
+// touches a fraction of it. update() indexes whatever was appended since
+// the last call and forgets evicted blocks. Regexes see bytes as Latin-1
+// and visit every record. Matches never span records.
+class ConsoleSearch
+{
+public:
+    enum Mode {
+        Text,  // Literal, UTF-8 encoded
+        Hex,   // Literal bytes, e.g. "0D 0A" or "0d0a"
+        Regex
+    };
+
+    struct Match
+    {
+        qint64 record = -1;
+        int start = 0; // Byte offset in the record
+        int length = 0;
+
+        bool isValid() const { return record >= 0; }
+    };
+
+    struct Range
+    {
+        int start;
+        int length;
+    };
+
+    static constexpr int BlockRecords = 256;
+    static constexpr int BloomWords = 64; // 4096 bits per block
+
+    explicit ConsoleSearch(const ConsoleSource *source = nullptr);
+
+    // Drops the index
+    void setSource(const ConsoleSource *source);
+    const ConsoleSource *source() const;
+
+    // Returns false, with errorString() set, for a malformed hex string or
+    // regex. An empty pattern turns the search off.
+    bool setPattern(const QString &pattern, Mode mode, bool caseSensitive);
+    bool isActive() const;
+    QString errorString() const;
+
+    void update();
+
+    // First match at or after (record, start), or the last one before it
+    Match findNext(qint64 record, int start) const;
+    Match findPrevious(qint64 record, int start) const;
+
+    // Matches within one record, for highlighting
+    QVector<Range> matchesIn(const ConsoleSource::Record &record) const;
+    bool recordMatches(qint64 id) const;
+    // Appends the ids in [first, end) holding a match
+    void collectMatches(qint64 first, qint64 end, QVector<qint64> &ids) const;
+
+private:
+    struct Block
+    {
+        quint64 bits[BloomWords];
+    };
+
+    void indexRecord(Block &block, qint64 id);
+    bool blockMayMatch(qint64 id) const;
+    void loadRecord(const ConsoleSource::Record &record) const;
+
+    const ConsoleSource *m_source;
+    QVector<Block> m_blocks;
+    qint64 m_firstBlock;  // Block number of m_blocks.first()
+    qint64 m_indexedEnd;  // Records below this are in the index
+
+    Mode m_mode;
+    bool m_caseSensitive;
+    bool m_active;
+    QString m_errorString;
+    QByteArray m_literal; // Folded when matching without case
+    QByteArrayMatcher m_matcher;
+    QRegularExpression m_regex;
+    QVector<int> m_requiredBits; // Bloom bits a block needs to be visited
+
+    mutable QByteArray m_scratch; // Bytes of the record being looked at
+};
+
+#endif // CONSOLESEARCH_H
@@ -0,0 +1,55 @@
+#ifndef CONSOLESOURCE_H
+#define CONSOLESOURCE_H
+
+#include <QtGlobal>
+#include "terminaldecoder.h"
+
+// Read-only history shown by ConsoleView. Records are addressed by absolute
+// ids in [firstRecord(), endRecord()) and point at their bytes by absolute
+// offset, so a view never needs to know whether the data lives in memory or
+// in a mapped capture file.
+class ConsoleSource
+{
+public:
+    enum Direction : quint8 {
+        Rx,
+        Tx,
+        Info,
+        Error
+    };
+
+    enum RecordFlag : quint8 {
+        Continuation = 0x01 // Not the first line of an appended chunk
+    };
+
+    struct Record
+    {
+        quint64 offset;    // Absolute byte offset of the first byte
+        quint32 length;    // Including any line terminator
+        Direction direction;
+        quint8 flags;
+        quint16 source;    // Origin when several ports share a buffer
+        qint64 timestamp;  // Nanoseconds since epoch
+    };
+
+    virtual ~ConsoleSource() = default;
+
+    virtual qint64 firstRecord() const = 0;
+    virtual qint64 endRecord() const = 0;
+    qint64 recordCount() const { return endRecord() - firstRecord(); }
+    virtual Record record(qint64 id) const = 0;
+    virtual qint64 longestRecord() const = 0;
+    virtual qsizetype copyBytes(quint64 offset, char *dest,
+                                qsizetype length) const = 0;
+
+    // Decoder state at the start of record id, for colours and characters
+    // that carry over from earlier records; by default every record starts
+    // afresh
+    virtual TerminalDecoder::State textState(qint64 id) const
+    {
+        Q_UNUSED(id);
+        return TerminalDecoder::State();
+    }
+};
+
+#endif // CONSOLESOURCE_H
@@ -0,0 +1,512 @@
+#include "consoleview.h"
+#include "byteformatter.h"
+#include "consolesearch.h"
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QStringList>
+#include <limits>
+
+ConsoleView::ConsoleView(QWidget *parent)
+    : QAbstractScrollArea(parent), m_source(nullptr), m_hexMode(false),
+      m_showTimestamp(true), m_autoScroll(true), m_search(nullptr),
+      m_currentMatchOffset(0), m_currentMatchLength(0), m_topRecord(0),
+      m_followTail(true), m_selectionAnchor(-1), m_selectionEnd(-1),
+      m_rowTextLength(0) {
+  setFocusPolicy(Qt::StrongFocus);
+  viewport()->setCursor(Qt::IBeamCursor);
+
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &ConsoleView::onVerticalScroll);
+  connect(horizontalScrollBar(), &QScrollBar::valueChanged, viewport(),
+          QOverload<>::of(&QWidget::update));
+}
+
+void ConsoleView::setSource(ConsoleSource *source) {
+  m_source = source;
+  m_topRecord = source ? source->firstRecord() : 0;
+  m_followTail = true;
+  clearSelection();
+  refresh();
+}
+
+ConsoleSource *ConsoleView::source() const { return m_source; }
+
+void ConsoleView::setHexMode(bool enabled) {
+  m_hexMode = enabled;
+  refresh();
+}
+
+bool ConsoleView::hexMode() const { return m_hexMode; }
+
+void ConsoleView::setShowTimestamp(bool enabled) {
+  m_showTimestamp = enabled;
+  viewport()->update();
+}
+
+bool ConsoleView::showTimestamp() const { return m_showTimestamp; }
+
+void ConsoleView::setAutoScroll(bool enabled) { m_autoScroll = enabled; }
+
+bool ConsoleView::autoScroll() const { return m_autoScroll; }
+
+void ConsoleView::setSourceNames(const QStringList &names) {
+  m_sourceNames = names;
+  viewport()->update();
+}
+
+void ConsoleView::setSearch(const ConsoleSearch *search) {
+  m_search = search;
+  m_currentMatchLength = 0;
+  viewport()->update();
+}
+
+void ConsoleView::setCurrentMatch(quint64 offset, int length) {
+  m_currentMatchOffset = offset;
+  m_currentMatchLength = length;
+  viewport()->update();
+}
+
+bool ConsoleView::isAtBottom() const { return m_followTail; }
+
+void ConsoleView::refresh() {
+  if (m_source) {
+    const qint64 first = m_source->firstRecord();
+    const qint64 maxTop =
+        qMax(first, m_source->endRecord() - visibleRowCount());
+    if (m_autoScroll && m_followTail) {
+      m_topRecord = maxTop;
+    }
+    m_topRecord = qBound(first, m_topRecord, maxTop);
+  }
+
+  updateScrollBars();
+  viewport()->update();
+}
+
+void ConsoleView::scrollToBottom() {
+  m_followTail = true;
+  if (m_source) {
+    m_topRecord = m_source->endRecord();
+  }
+  refresh();
+}
+
+void ConsoleView::scrollToRecord(qint64 id) {
+  if (!m_source || m_source->recordCount() == 0) {
+    return;
+  }
+  id = qBound(m_source->firstRecord(), id, m_source->endRecord() - 1);
+  m_followTail = false;
+  m_topRecord = id;
+  m_selectionAnchor = id;
+  m_selectionEnd = id;
+  refresh();
+}
+
+void ConsoleView::showRecord(qint64 id) {
+  if (!m_source || m_source->recordCount() == 0) {
+    return;
+  }
+  if (id >= m_topRecord && id < m_topRecord + visibleRowCount()) {
+    viewport()->update();
+    return;
+  }
+  m_followTail = false;
+  m_topRecord = qMax(m_source->firstRecord(), id - visibleRowCount() / 2);
+  refresh();
+}
+
+void ConsoleView::copy() {
+  if (!m_source || m_selectionAnchor < 0) {
+    return;
+  }
+
+  const qint64 first =
+      qMax(qMin(m_selectionAnchor, m_selectionEnd), m_source->firstRecord());
+  const qint64 last =
+      qMin(qMax(m_selectionAnchor, m_selectionEnd), m_source->endRecord() - 1);
+
+  QStringList lines;
+  for (qint64 id = first; id <= last; ++id) {
+    lines.append(rowText(id));
+  }
+  QGuiApplication::clipboard()->setText(lines.join('\n'));
+}
+
+void ConsoleView::selectAll() {
+  if (m_source && m_source->recordCount() > 0) {
+    m_selectionAnchor = m_source->firstRecord();
+    m_selectionEnd = m_source->endRecord() - 1;
+    viewport()->update();
+  }
+}
+
+void ConsoleView::clearSelection() {
+  m_selectionAnchor = -1;
+  m_selectionEnd = -1;
+  viewport()->update();
+}
+
+void ConsoleView::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+  QPainter painter(viewport());
+  if (!m_source) {
+    return;
+  }
+
+  const int height = lineHeight();
+  const int ascent = fontMetrics().ascent();
+  const int x = 4 - horizontalScrollBar()->value();
+  const qint64 first = qMax(m_topRecord, m_source->firstRecord());
+  const qint64 end =
+      qMin(m_source->endRecord(), first + visibleRowCount() + 1);
+  const qint64 selectionFirst = qMin(m_selectionAnchor, m_selectionEnd);
+  const qint64 selectionLast = qMax(m_selectionAnchor, m_selectionEnd);
+
+  int y = 0;
+  for (qint64 id = first; id < end; ++id, y += height) {
+    if (m_selectionAnchor >= 0 && id >= selectionFirst &&
+        id <= selectionLast) {
+      painter.fillRect(0, y, viewport()->width(), height,
+                       palette().highlight());
+      painter.setPen(palette().highlightedText().color());
+      painter.drawText(x, y + ascent, rowText(id));
+      continue;
+    }
+
+    int prefixLength = 0;
+    const QString text = rowText(id, &prefixLength, &m_rowRuns);
+    paintRow(painter, id, text, prefixLength, m_rowRuns, x, y);
+  }
+}
+
+void ConsoleView::resizeEvent(QResizeEvent *event) {
+  QAbstractScrollArea::resizeEvent(event);
+  refresh();
+}
+
+void ConsoleView::keyPressEvent(QKeyEvent *event) {
+  if (event->matches(QKeySequence::Copy)) {
+    copy();
+    return;
+  }
+  if (event->matches(QKeySequence::SelectAll)) {
+    selectAll();
+    return;
+  }
+
+  QScrollBar *bar = verticalScrollBar();
+  switch (event->key()) {
+  case Qt::Key_Up:
+    bar->triggerAction(QAbstractSlider::SliderSingleStepSub);
+    break;
+  case Qt::Key_Down:
+    bar->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+    break;
+  case Qt::Key_PageUp:
+    bar->triggerAction(QAbstractSlider::SliderPageStepSub);
+    break;
+  case Qt::Key_PageDown:
+    bar->triggerAction(QAbstractSlider::SliderPageStepAdd);
+    break;
+  case Qt::Key_Home:
+    bar->triggerAction(QAbstractSlider::SliderToMinimum);
+    break;
+  case Qt::Key_End:
+    bar->triggerAction(QAbstractSlider::SliderToMaximum);
+    break;
+  default:
+    QAbstractScrollArea::keyPressEvent(event);
+    return;
+  }
+}
+
+void ConsoleView::mousePressEvent(QMouseEvent *event) {
+  if (event->button() == Qt::LeftButton) {
+    m_selectionAnchor = rowAt(event->position().toPoint().y());
+    m_selectionEnd = m_selectionAnchor;
+    viewport()->update();
+  }
+  QAbstractScrollArea::mousePressEvent(event);
+}
+
+void ConsoleView::mouseMoveEvent(QMouseEvent *event) {
+  if ((event->buttons() & Qt::LeftButton) && m_selectionAnchor >= 0) {
+    m_selectionEnd = rowAt(event->position().toPoint().y());
+    viewport()->update();
+  }
+  QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void ConsoleView::changeEvent(QEvent *event) {
+  QAbstractScrollArea::changeEvent(event);
+  if (event->type() == QEvent::FontChange) {
+    refresh();
+  }
+}
+
+void ConsoleView::onVerticalScroll(int value) {
+  if (m_source) {
+    m_topRecord = m_source->firstRecord() + value;
+  }
+  m_followTail = value >= verticalScrollBar()->maximum();
+  viewport()->update();
+}
+
+QString ConsoleView::rowText(qint64 id, int *prefixLength,
+                             QVector<TerminalDecoder::Run> *runs) const {
+  const ConsoleSource::Record &record = m_source->record(id);
+  const bool traffic = record.direction == ConsoleSource::Rx ||
+                       record.direction == ConsoleSource::Tx;
+
+  // Only the first line of a chunk carries the prefix
+  QString prefix;
+  if (!(record.flags & ConsoleSource::Continuation)) {
+    if (m_showTimestamp || !traffic) {
+      prefix += '[';
+      prefix += m_timestampFormatter.format(record.timestamp);
+      prefix += "] ";
+    }
+    if (record.source < m_sourceNames.size()) {
+      prefix += m_sourceNames.at(record.source) + " ";
+    }
+    if (record.direction == ConsoleSource::Rx) {
+      prefix += "RX: ";
+    } else if (record.direction == ConsoleSource::Tx) {
+      prefix += "TX: ";
+    }
+  }
+
+  if (prefixLength) {
+    *prefixLength = prefix.size();
+  }
+
+  // Bytes are formatted through buffers reused across rows, so the returned
+  // string is the only allocation per row.
+  m_rowBytes.resize(record.length);
+  const qsizetype length =
+      m_source->copyBytes(record.offset, m_rowBytes.data(), record.length);
+
+  QVector<TerminalDecoder::Run> &styled = runs ? *runs : m_rowRuns;
+  styled.clear();
+  if (m_hexMode && traffic) {
+    m_rowFormatted.resize(ByteFormatter::hexLength(length));
+    const qsizetype size = ByteFormatter::formatHex(
+        m_rowBytes.constData(), length, m_rowFormatted.data());
+    return prefix + QLatin1String(m_rowFormatted.constData(), size);
+  }
+
+  // Decoded from the state the record starts in, so a colour set on an
+  // earlier line or a character split across reads comes out right. Line
+  // terminators end the row rather than showing as control characters.
+  qsizetype textLength = length;
+  while (textLength > 0 && (m_rowBytes[textLength - 1] == '\n' ||
+                            m_rowBytes[textLength - 1] == '\r')) {
+    --textLength;
+  }
+  m_rowTextLength = textLength;
+  m_rowState = m_source->textState(id);
+  TerminalDecoder decoder(m_rowState);
+  m_rowDecoded.clear();
+  decoder.decode(m_rowBytes.constData(), textLength, m_rowDecoded, styled);
+  for (TerminalDecoder::Run &run : styled) {
+    run.start += prefix.size();
+  }
+  return prefix + m_rowDecoded;
+}
+
+void ConsoleView::paintRow(QPainter &painter, qint64 id, const QString &text,
+                           int prefixLength,
+                           const QVector<TerminalDecoder::Run> &runs, int x,
+                           int y) const {
+  const QColor color = rowColor(m_source->record(id).direction);
+  const bool search = m_search && m_search->isActive();
+  const int ascent = fontMetrics().ascent();
+
+  // Rows without escape sequences are drawn in one go
+  if (runs.isEmpty() ||
+      (runs.size() == 1 && runs.first().style.isDefault())) {
+    if (search) {
+      paintMatches(painter, id, text, prefixLength, x, y);
+    }
+    painter.setPen(color);
+    painter.drawText(x, y + ascent, text);
+    return;
+  }
+
+  // Runs are laid out on the plain font's grid so bold text does not push
+  // the rest of the row aside
+  struct Piece {
+    int left;
+    int width;
+    QColor foreground;
+    QColor background;
+  };
+  const QFontMetrics metrics = fontMetrics();
+  QVector<Piece> pieces;
+  pieces.reserve(runs.size());
+  int left = x + metrics.horizontalAdvance(text.left(prefixLength));
+  for (const TerminalDecoder::Run &run : runs) {
+    const TerminalDecoder::Style &style = run.style;
+    Piece piece;
+    piece.left = left;
+    piece.width = metrics.horizontalAdvance(text.mid(run.start, run.length));
+    piece.foreground =
+        style.foreground
+            ? QColor::fromRgb(TerminalDecoder::rgb(style.foreground))
+            : color;
+    if (style.background) {
+      piece.background =
+          QColor::fromRgb(TerminalDecoder::rgb(style.background));
+    }
+    if (style.attributes & TerminalDecoder::Inverse) {
+      const QColor background = piece.background.isValid()
+                                    ? piece.background
+                                    : palette().base().color();
+      piece.background = piece.foreground;
+      piece.foreground = background;
+    }
+    if (style.attributes & TerminalDecoder::Faint) {
+      piece.foreground.setAlphaF(0.6f);
+    }
+    pieces.append(piece);
+    left += piece.width;
+  }
+
+  const int height = lineHeight();
+  for (const Piece &piece : std::as_const(pieces)) {
+    if (piece.background.isValid()) {
+      painter.fillRect(piece.left, y, piece.width, height, piece.background);
+    }
+  }
+  if (search) {
+    paintMatches(painter, id, text, prefixLength, x, y);
+  }
+
+  painter.setPen(color);
+  painter.drawText(x, y + ascent, text.left(prefixLength));
+  const QFont plain = font();
+  for (int i = 0; i < runs.size(); ++i) {
+    const quint8 attributes = runs[i].style.attributes;
+    if (attributes & TerminalDecoder::Conceal) {
+      continue;
+    }
+    QFont styled = plain;
+    styled.setBold(attributes & TerminalDecoder::Bold);
+    styled.setItalic(attributes & TerminalDecoder::Italic);
+    styled.setUnderline(attributes & TerminalDecoder::Underline);
+    styled.setStrikeOut(attributes & TerminalDecoder::Strikeout);
+    painter.setFont(styled);
+    painter.setPen(pieces[i].foreground);
+    painter.drawText(pieces[i].left, y + ascent,
+                     text.mid(runs[i].start, runs[i].length));
+  }
+  painter.setFont(plain);
+}
+
+void ConsoleView::paintMatches(QPainter &painter, qint64 id,
+                               const QString &text, int prefixLength, int x,
+                               int y) const {
+  const ConsoleSource::Record record = m_source->record(id);
+  const QVector<ConsoleSearch::Range> matches = m_search->matchesIn(record);
+  if (matches.isEmpty()) {
+    return;
+  }
+
+  // Byte offsets to columns: three per byte in hex, and in text whatever
+  // the preceding bytes decode to
+  const bool hex = m_hexMode && (record.direction == ConsoleSource::Rx ||
+                                 record.direction == ConsoleSource::Tx);
+  auto column = [&](int byte) -> int {
+    return prefixLength + (hex ? byte * 3 : textColumn(byte));
+  };
+
+  const QFontMetrics metrics = fontMetrics();
+  const int height = lineHeight();
+  for (const ConsoleSearch::Range &match : matches) {
+    const int start = column(match.start);
+    const int end = column(match.start + match.length) - (hex ? 1 : 0);
+    if (end <= start) {
+      continue;
+    }
+    const bool current =
+        m_currentMatchLength > 0 &&
+        record.offset + quint64(match.start) == m_currentMatchOffset;
+    const int left = x + metrics.horizontalAdvance(text.left(start));
+    const int width = metrics.horizontalAdvance(text.mid(start, end - start));
+    painter.fillRect(left, y, width, height,
+                     current ? QColor("#fb923c") : QColor("#fde047"));
+  }
+}
+
+int ConsoleView::textColumn(qsizetype bytes) const {
+  // m_rowBytes and m_rowState still hold the row rowText() decoded last
+  TerminalDecoder decoder(m_rowState);
+  QString text;
+  QVector<TerminalDecoder::Run> runs;
+  decoder.decode(m_rowBytes.constData(), qMin(bytes, m_rowTextLength), text,
+                 runs);
+  return int(text.size());
+}
+
+QColor ConsoleView::rowColor(ConsoleSource::Direction direction) const {
+  switch (direction) {
+  case ConsoleSource::Tx:
+    return QColor("#2563eb");
+  case ConsoleSource::Error:
+    return QColor(Qt::red);
+  case ConsoleSource::Rx:
+  case ConsoleSource::Info:
+    break;
+  }
+  return QColor("#16a34a");
+}
+
+int ConsoleView::lineHeight() const {
+  return qMax(1, fontMetrics().lineSpacing());
+}
+
+int ConsoleView::visibleRowCount() const {
+  return qMax(1, viewport()->height() / lineHeight());
+}
+
+qint64 ConsoleView::rowAt(int y) const {
+  if (!m_source || m_source->recordCount() == 0) {
+    return -1;
+  }
+  const qint64 id = m_topRecord + qMax(0, y) / lineHeight();
+  return qBound(m_source->firstRecord(), id, m_source->endRecord() - 1);
+}
+
+void ConsoleView::updateScrollBars() {
+  const qint64 count = m_source ? m_source->recordCount() : 0;
+  const qint64 first = m_source ? m_source->firstRecord() : 0;
+  const int rows = visibleRowCount();
+
+  QScrollBar *vertical = verticalScrollBar();
+  {
+    const QSignalBlocker blocker(vertical);
+    vertical->setRange(0, static_cast<int>(qMax<qint64>(0, count - rows)));
+    vertical->setPageStep(rows);
+    vertical->setValue(static_cast<int>(m_topRecord - first));
+  }
+
+  // Rows are not measured individually; the widest possible one is derived
+  // from the longest record seen so far.
+  const int charWidth = qMax(1, fontMetrics().horizontalAdvance('0'));
+  const qint64 longest = m_source ? m_source->longestRecord() : 0;
+  const qint64 columns = 20 + longest * (m_hexMode ? 3 : 1);
+  const qint64 width = columns * charWidth + 8;
+
+  QScrollBar *horizontal = horizontalScrollBar();
+  horizontal->setRange(
+      0, static_cast<int>(qBound<qint64>(0, width - viewport()->width(),
+                                         std::numeric_limits<int>::max())));
+  horizontal->setPageStep(viewport()->width());
+  horizontal->setSingleStep(charWidth);
+}
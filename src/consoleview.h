@@ -0,0 +1,113 @@
+#ifndef CONSOLEVIEW_H
+#define CONSOLEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QColor>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "consolesource.h"
+#include "serialclock.h"
+
+class ConsoleSearch;
+class QPainter;
+
+// Virtualized console: draws only the rows currently visible, formatting them
+// on demand from the raw bytes in a ConsoleSource (a ConsoleBuffer or an
+// open capture). Appending and scrolling cost the same regardless of how much
+// history the source holds.
+class ConsoleView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit ConsoleView(QWidget *parent = nullptr);
+
+    void setSource(ConsoleSource *source);
+    ConsoleSource *source() const;
+
+    // Display options; they apply to the whole history
+    void setHexMode(bool enabled);
+    bool hexMode() const;
+    void setShowTimestamp(bool enabled);
+    bool showTimestamp() const;
+    void setAutoScroll(bool enabled);
+    bool autoScroll() const;
+
+    // When set, rows are labelled with the name of their record's source
+    void setSourceNames(const QStringList &names);
+
+    // Matches of an active search are highlighted; the current one, given
+    // by its absolute byte offset, stands out
+    void setSearch(const ConsoleSearch *search);
+    void setCurrentMatch(quint64 offset, int length);
+
+    bool isAtBottom() const;
+
+public slots:
+    // Call after the buffer changed
+    void refresh();
+    void scrollToBottom();
+    // Brings record id to the top of the view and selects it
+    void scrollToRecord(qint64 id);
+    // Scrolls only if record id is off screen, then centres it
+    void showRecord(qint64 id);
+    void copy();
+    void selectAll();
+    void clearSelection();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private slots:
+    void onVerticalScroll(int value);
+
+private:
+    // Runs, when given, style the decoded text after the prefix; their
+    // starts are relative to the returned string
+    QString rowText(qint64 id, int *prefixLength = nullptr,
+                    QVector<TerminalDecoder::Run> *runs = nullptr) const;
+    void paintRow(QPainter &painter, qint64 id, const QString &text,
+                  int prefixLength, const QVector<TerminalDecoder::Run> &runs,
+                  int x, int y) const;
+    void paintMatches(QPainter &painter, qint64 id, const QString &text,
+                      int prefixLength, int x, int y) const;
+    int textColumn(qsizetype bytes) const;
+    QColor rowColor(ConsoleSource::Direction direction) const;
+    int lineHeight() const;
+    int visibleRowCount() const;
+    qint64 rowAt(int y) const;
+    void updateScrollBars();
+
+    ConsoleSource *m_source;
+    bool m_hexMode;
+    bool m_showTimestamp;
+    bool m_autoScroll;
+    QStringList m_sourceNames;
+    const ConsoleSearch *m_search;
+    quint64 m_currentMatchOffset;
+    int m_currentMatchLength;
+
+    qint64 m_topRecord;   // Absolute id of the first visible row
+    bool m_followTail;    // Scrolled to the bottom, keep it there
+    qint64 m_selectionAnchor;
+    qint64 m_selectionEnd;
+
+    // Scratch space for formatting rows; the bytes and decoder state of the
+    // last row formatted as text stay for mapping matches to columns
+    mutable QByteArray m_rowBytes;
+    mutable QByteArray m_rowFormatted;
+    mutable qsizetype m_rowTextLength;
+    mutable TerminalDecoder::State m_rowState;
+    mutable QString m_rowDecoded;
+    mutable QVector<TerminalDecoder::Run> m_rowRuns;
+    mutable TimestampFormatter m_timestampFormatter;
+};
+
+#endif // CONSOLEVIEW_H
@@ -0,0 +1,410 @@
+#include "filetransfer.h"
+#include "serialportmanager.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTimer>
+
+namespace {
+
+const char Soh = 0x01;
+const char Stx = 0x02;
+const char Eot = 0x04;
+const char Ack = 0x06;
+const char Nak = 0x15;
+const char Can = 0x18;
+const char SubPad = 0x1A;
+const char CrcStart = 'C';
+const char StreamStart = 'G';
+
+const int ProgressIntervalMs = 100;
+
+} // namespace
+
+FileTransfer::FileTransfer(SerialPortManager *port, QObject *parent)
+    : QObject(parent), m_port(port), m_timer(new QTimer(this)),
+      m_map(nullptr), m_protocol(Raw), m_state(Idle), m_crc(true),
+      m_streaming(false), m_filling(false), m_total(0), m_offset(0),
+      m_acked(0), m_lastPayload(0), m_blockNumber(0), m_retries(0),
+      m_cancelBytes(0), m_lastProgressMs(0) {
+  m_timer->setSingleShot(true);
+  connect(m_timer, &QTimer::timeout, this, &FileTransfer::onTimeout);
+  connect(m_port, &SerialPortManager::dataReceived, this,
+          &FileTransfer::onDataReceived);
+  connect(m_port, &SerialPortManager::txQueueChanged, this,
+          &FileTransfer::onTxQueueChanged);
+  connect(m_port, &SerialPortManager::connectionStatusChanged, this,
+          [this](bool connected) {
+            if (!connected && m_state != Idle) {
+              finish(false, "Port closed during transfer");
+            }
+          });
+}
+
+bool FileTransfer::start(const QString &path, Protocol protocol) {
+  if (m_state != Idle) {
+    return false;
+  }
+  if (!m_port->isOpen()) {
+    emit finished(false, "Port is not open");
+    return false;
+  }
+
+  m_file.setFileName(path);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    emit finished(false, "Cannot open " + path + ": " + m_file.errorString());
+    return false;
+  }
+  m_total = m_file.size();
+  // Falls back to seek and read when the file cannot be mapped
+  m_map = m_total > 0 ? m_file.map(0, m_total) : nullptr;
+
+  m_protocol = protocol;
+  m_crc = true;
+  m_streaming = false;
+  m_offset = 0;
+  m_acked = 0;
+  m_lastPayload = 0;
+  m_blockNumber = 0;
+  m_lastPacket.clear();
+  m_retries = 0;
+  m_cancelBytes = 0;
+  m_lastProgressMs = 0;
+  m_clock.start();
+  reportProgress(0, true);
+
+  if (protocol == Raw) {
+    m_state = Streaming;
+    fillStream();
+  } else {
+    m_state = WaitStart;
+    m_timer->start(StartTimeoutMs);
+  }
+  return true;
+}
+
+void FileTransfer::cancel() {
+  if (m_state == Idle) {
+    return;
+  }
+  // The rest of the stream window must not follow the cancel
+  m_port->clearTx();
+  if (m_protocol != Raw) {
+    m_port->sendData(QByteArray(3, Can));
+  }
+  finish(false, "Cancelled");
+}
+
+bool FileTransfer::isActive() const { return m_state != Idle; }
+
+FileTransfer::Protocol FileTransfer::protocol() const { return m_protocol; }
+
+qint64 FileTransfer::totalBytes() const { return m_total; }
+
+QString FileTransfer::protocolName(Protocol protocol) {
+  switch (protocol) {
+  case Raw:
+    return "Raw";
+  case Xmodem1k:
+    return "XMODEM-1K";
+  case Ymodem:
+    return "YMODEM";
+  }
+  return QString();
+}
+
+quint16 FileTransfer::crc16(const char *data, qsizetype length) {
+  // CRC-16/XMODEM: polynomial 0x1021, initial value 0
+  quint16 crc = 0;
+  for (qsizetype i = 0; i < length; ++i) {
+    crc ^= quint16(quint8(data[i])) << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = crc & 0x8000 ? quint16((crc << 1) ^ 0x1021) : quint16(crc << 1);
+    }
+  }
+  return crc;
+}
+
+void FileTransfer::onDataReceived(const QByteArray &data) {
+  if (m_state == Idle || m_protocol == Raw) {
+    return;
+  }
+  for (char byte : data) {
+    handleByte(byte);
+    if (m_state == Idle) {
+      break;
+    }
+  }
+}
+
+void FileTransfer::onTxQueueChanged(qint64 queuedBytes) {
+  Q_UNUSED(queuedBytes);
+  if (m_state == Streaming) {
+    fillStream();
+  } else if (m_state != Idle && m_timer->isActive()) {
+    // Earlier blocks are still draining; the receiver cannot answer yet
+    m_timer->start();
+  }
+}
+
+void FileTransfer::onTimeout() {
+  if (m_state == WaitStart) {
+    finish(false, "Receiver did not start the transfer");
+  } else if (m_state != Idle && m_state != Streaming) {
+    retry();
+  }
+}
+
+void FileTransfer::handleByte(char byte) {
+  // Two CANs in a row abort the transfer from the receiving side
+  if (byte == Can) {
+    if (++m_cancelBytes >= 2) {
+      finish(false, "Cancelled by receiver");
+    }
+    return;
+  }
+  m_cancelBytes = 0;
+
+  const bool startByte = byte == CrcStart || byte == StreamStart;
+  switch (m_state) {
+  case WaitStart:
+    if (byte == CrcStart || byte == Nak ||
+        (byte == StreamStart && m_protocol == Ymodem)) {
+      m_crc = byte != Nak;
+      m_streaming = byte == StreamStart;
+      if (m_protocol == Ymodem) {
+        sendPacket(headerBlock(false), WaitHeaderAck);
+      } else {
+        m_blockNumber = 1;
+        sendNextDataBlock();
+      }
+    }
+    break;
+  case WaitHeaderAck:
+    if (byte == Ack) {
+      m_retries = 0;
+      m_state = WaitDataStart;
+      m_timer->start(AckTimeoutMs);
+    } else if (byte == Nak || (byte == CrcStart && !m_streaming)) {
+      retry();
+    } else if (byte == StreamStart) {
+      // YMODEM-g receivers may skip the ACK for block 0
+      handleByte(Ack);
+      handleByte(byte);
+    }
+    break;
+  case WaitDataStart:
+    if (startByte) {
+      m_streaming = byte == StreamStart;
+      m_blockNumber = 1;
+      m_retries = 0;
+      if (m_streaming) {
+        m_timer->stop();
+        m_state = Streaming;
+        fillStream();
+      } else {
+        sendNextDataBlock();
+      }
+    }
+    break;
+  case WaitBlockAck:
+    if (byte == Ack) {
+      m_acked += m_lastPayload;
+      m_retries = 0;
+      reportProgress(m_acked);
+      sendNextDataBlock();
+    } else if (byte == Nak) {
+      retry();
+    }
+    break;
+  case WaitEotAck:
+    if (byte == Ack) {
+      m_retries = 0;
+      if (m_protocol == Ymodem) {
+        m_state = WaitBatchStart;
+        m_timer->start(AckTimeoutMs);
+      } else {
+        finish(true, "Transfer complete");
+      }
+    } else if (byte == Nak) {
+      // Receivers commonly NAK the first EOT to confirm the end of file
+      retry();
+    }
+    break;
+  case WaitBatchStart:
+    if (startByte) {
+      sendPacket(headerBlock(true), WaitBatchEndAck);
+    }
+    break;
+  case WaitBatchEndAck:
+    if (byte == Ack) {
+      finish(true, "Transfer complete");
+    } else if (byte == Nak) {
+      retry();
+    }
+    break;
+  case Idle:
+  case Streaming:
+    break;
+  }
+}
+
+QByteArray FileTransfer::readFile(qint64 offset, qint64 length) {
+  if (m_map) {
+    return QByteArray(reinterpret_cast<const char *>(m_map + offset), length);
+  }
+  if (!m_file.seek(offset)) {
+    return QByteArray();
+  }
+  return m_file.read(length);
+}
+
+QByteArray FileTransfer::makeBlock(quint8 number, const QByteArray &payload,
+                                   int blockSize, char pad) const {
+  QByteArray block;
+  block.reserve(3 + blockSize + 2);
+  block.append(blockSize == 1024 ? Stx : Soh);
+  block.append(char(number));
+  block.append(char(0xFF - number));
+  block.append(payload);
+  block.append(blockSize - payload.size(), pad);
+
+  const char *data = block.constData() + 3;
+  if (m_crc) {
+    const quint16 crc = crc16(data, blockSize);
+    block.append(char(crc >> 8));
+    block.append(char(crc & 0xFF));
+  } else {
+    quint8 sum = 0;
+    for (int i = 0; i < blockSize; ++i) {
+      sum += quint8(data[i]);
+    }
+    block.append(char(sum));
+  }
+  return block;
+}
+
+QByteArray FileTransfer::headerBlock(bool last) const {
+  // Block 0: "name\0size mtime"; an empty one ends the batch
+  QByteArray info;
+  if (!last) {
+    const QFileInfo fileInfo(m_file.fileName());
+    info = fileInfo.fileName().toUtf8();
+    info += '\0';
+    info += QByteArray::number(m_total);
+    info += ' ';
+    info += QByteArray::number(fileInfo.lastModified().toSecsSinceEpoch(), 8);
+    info.truncate(1024);
+  }
+  return makeBlock(0, info, info.size() > 128 ? 1024 : 128, '\0');
+}
+
+QByteArray FileTransfer::nextDataBlock() {
+  // 1K blocks need the CRC trailer; a short tail goes in a 128-byte block
+  const qint64 remaining = m_total - m_offset;
+  const int blockSize = m_crc && remaining > 128 ? 1024 : 128;
+  const qint64 length = qMin<qint64>(remaining, blockSize);
+  const QByteArray payload = readFile(m_offset, length);
+  if (payload.size() != length) {
+    return QByteArray();
+  }
+
+  m_offset += length;
+  m_lastPayload = length;
+  return makeBlock(m_blockNumber++, payload, blockSize, SubPad);
+}
+
+void FileTransfer::sendPacket(const QByteArray &packet, State next) {
+  m_lastPacket = packet;
+  m_state = next;
+  m_timer->start(AckTimeoutMs);
+  m_port->sendData(packet);
+}
+
+void FileTransfer::sendNextDataBlock() {
+  if (m_offset >= m_total) {
+    sendPacket(QByteArray(1, Eot), WaitEotAck);
+    return;
+  }
+
+  const QByteArray block = nextDataBlock();
+  if (block.isEmpty()) {
+    m_port->sendData(QByteArray(3, Can));
+    finish(false, "Read error: " + m_file.errorString());
+    return;
+  }
+  sendPacket(block, WaitBlockAck);
+}
+
+void FileTransfer::fillStream() {
+  if (m_filling) {
+    return;
+  }
+
+  // Keep a window queued so the line never idles between chunks, without
+  // pulling more of the file into memory than that
+  m_filling = true;
+  while (m_state == Streaming && m_offset < m_total &&
+         m_port->txQueuedBytes() < StreamWindow) {
+    QByteArray data;
+    if (m_protocol == Raw) {
+      data = readFile(m_offset, qMin<qint64>(m_total - m_offset, RawChunkSize));
+      m_offset += data.size();
+    } else {
+      data = nextDataBlock();
+    }
+    if (data.isEmpty()) {
+      finish(false, "Read error: " + m_file.errorString());
+      break;
+    }
+    m_port->sendData(data);
+  }
+  m_filling = false;
+
+  if (m_state != Streaming) {
+    return;
+  }
+  const qint64 queued = m_port->txQueuedBytes();
+  reportProgress(qMax<qint64>(0, m_offset - queued));
+  if (m_offset == m_total) {
+    if (m_protocol != Raw) {
+      // YMODEM-g: only the end of file is acknowledged
+      sendPacket(QByteArray(1, Eot), WaitEotAck);
+    } else if (queued == 0) {
+      finish(true, "Transfer complete");
+    }
+  }
+}
+
+void FileTransfer::retry() {
+  if (++m_retries > MaxRetries) {
+    m_port->sendData(QByteArray(3, Can));
+    finish(false, "No acknowledgement after " + QString::number(MaxRetries) +
+                      " retries");
+    return;
+  }
+  sendPacket(m_lastPacket, m_state);
+}
+
+void FileTransfer::reportProgress(qint64 bytesDone, bool force) {
+  const qint64 elapsed = m_clock.elapsed();
+  if (!force && elapsed - m_lastProgressMs < ProgressIntervalMs) {
+    return;
+  }
+  m_lastProgressMs = elapsed;
+  const double rate = elapsed > 0 ? bytesDone * 1000.0 / elapsed : 0.0;
+  emit progress(bytesDone, m_total, rate);
+}
+
+void FileTransfer::finish(bool success, const QString &message) {
+  m_timer->stop();
+  if (success) {
+    reportProgress(m_total, true);
+  }
+  m_state = Idle;
+  if (m_map) {
+    m_file.unmap(m_map);
+    m_map = nullptr;
+  }
+  m_file.close();
+  emit finished(success, message);
+}
@@ -0,0 +1,108 @@
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+
+class QTimer;
+class SerialPortManager;
+
+// Sends a file over an open SerialPortManager.
+// The file is memory-mapped when possible and read block by block otherwise,
+// so it is never loaded whole. Raw mode keeps a window of data queued for
+// transmission; XMODEM-1K and YMODEM send CRC-16 blocks, resending on NAK or
+// timeout. A YMODEM receiver that starts with 'G' (YMODEM-g) gets the blocks
+// streamed back to back without waiting for acknowledgements.
+class FileTransfer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Protocol {
+        Raw,
+        Xmodem1k,
+        Ymodem
+    };
+
+    static constexpr int RawChunkSize = 4096;
+    static constexpr qint64 StreamWindow = 64 * 1024; // bytes kept queued
+    static constexpr int MaxRetries = 10;
+    static constexpr int StartTimeoutMs = 60000;
+    static constexpr int AckTimeoutMs = 10000;
+
+    explicit FileTransfer(SerialPortManager *port, QObject *parent = nullptr);
+
+    // Returns false if the transfer could not start. Unless another transfer
+    // is already running the reason is also reported through finished().
+    bool start(const QString &path, Protocol protocol);
+    void cancel();
+
+    bool isActive() const;
+    Protocol protocol() const;
+    qint64 totalBytes() const;
+
+    static QString protocolName(Protocol protocol);
+    static quint16 crc16(const char *data, qsizetype length);
+
+signals:
+    // bytesDone counts data acknowledged by the receiver, or handed to the
+    // driver in raw mode
+    void progress(qint64 bytesDone, qint64 totalBytes, double bytesPerSecond);
+    void finished(bool success, const QString &message);
+
+private slots:
+    void onDataReceived(const QByteArray &data);
+    void onTxQueueChanged(qint64 queuedBytes);
+    void onTimeout();
+
+private:
+    enum State {
+        Idle,
+        Streaming,       // raw or YMODEM-g data
+        WaitStart,       // receiver's 'C', 'G' or NAK
+        WaitHeaderAck,   // YMODEM block 0
+        WaitDataStart,   // YMODEM 'C' or 'G' after block 0
+        WaitBlockAck,
+        WaitEotAck,
+        WaitBatchStart,  // YMODEM 'C' before the closing empty block 0
+        WaitBatchEndAck
+    };
+
+    void handleByte(char byte);
+    QByteArray readFile(qint64 offset, qint64 length);
+    QByteArray makeBlock(quint8 number, const QByteArray &payload,
+                         int blockSize, char pad) const;
+    QByteArray headerBlock(bool last) const;
+    QByteArray nextDataBlock();
+    void sendPacket(const QByteArray &packet, State next);
+    void sendNextDataBlock();
+    void fillStream();
+    void retry();
+    void reportProgress(qint64 bytesDone, bool force = false);
+    void finish(bool success, const QString &message);
+
+    SerialPortManager *m_port;
+    QTimer *m_timer;
+    QFile m_file;
+    uchar *m_map;
+    Protocol m_protocol;
+    State m_state;
+    bool m_crc;        // CRC-16 trailer rather than an 8-bit checksum
+    bool m_streaming;  // YMODEM-g
+    bool m_filling;    // guards fillStream() against re-entry
+    qint64 m_total;
+    qint64 m_offset;   // file bytes already packed into blocks
+    qint64 m_acked;
+    qint64 m_lastPayload;
+    quint8 m_blockNumber;
+    QByteArray m_lastPacket;
+    int m_retries;
+    int m_cancelBytes;
+    QElapsedTimer m_clock;
+    qint64 m_lastProgressMs;
+};
+
+#endif // FILETRANSFER_H
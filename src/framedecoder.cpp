@@ -0,0 +1,349 @@
+#include "framedecoder.h"
+#include <QByteArrayView>
+#include <cstring>
+
+namespace {
+
+constexpr char SlipEnd = '\xC0';
+constexpr char SlipEsc = '\xDB';
+constexpr char SlipEscEnd = '\xDC';
+constexpr char SlipEscEsc = '\xDD';
+
+} // namespace
+
+std::unique_ptr<FrameDecoder> FrameDecoder::create(const Options &options) {
+  const int maxFrameSize = qMax(1, options.maxFrameSize);
+  switch (options.type) {
+  case Delimiter:
+    return std::make_unique<DelimitedFrameDecoder>(
+        options.delimiter.isEmpty() ? QByteArray("\n") : options.delimiter,
+        options.includeDelimiter, false, maxFrameSize);
+  case FixedLength:
+    return std::make_unique<FixedLengthFrameDecoder>(
+        qMax(1, options.frameLength));
+  case LengthPrefix:
+    return std::make_unique<LengthPrefixFrameDecoder>(
+        qBound(1, options.lengthFieldSize, 4), options.lengthBigEndian,
+        options.lengthIncludesHeader, maxFrameSize);
+  case Slip:
+    return std::make_unique<SlipFrameDecoder>(maxFrameSize);
+  case Cobs:
+    return std::make_unique<CobsFrameDecoder>(maxFrameSize);
+  case NoFraming:
+    break;
+  }
+  return nullptr;
+}
+
+FrameDecoder::FrameDecoder(int maxFrameSize)
+    : m_maxFrameSize(maxFrameSize), m_errorCount(0), m_streamOffset(0) {}
+
+void FrameDecoder::feed(const QByteArray &chunk, QList<Frame> &frames) {
+  if (chunk.isEmpty()) {
+    return;
+  }
+  decode(chunk, m_streamOffset, frames);
+  m_streamOffset += chunk.size();
+}
+
+void FrameDecoder::reset() {
+  resetState();
+  m_streamOffset = 0;
+  m_errorCount = 0;
+}
+
+QByteArray FrameDecoder::slice(const QByteArray &source, qsizetype from,
+                               qsizetype length) {
+  if (from == 0 && length == source.size()) {
+    return source;
+  }
+  return source.sliced(from, length);
+}
+
+DelimitedFrameDecoder::DelimitedFrameDecoder(const QByteArray &delimiter,
+                                             bool includeDelimiter,
+                                             bool skipEmptyFrames,
+                                             int maxFrameSize)
+    : FrameDecoder(maxFrameSize), m_delimiter(delimiter),
+      m_includeDelimiter(includeDelimiter), m_skipEmptyFrames(skipEmptyFrames),
+      m_partialOffset(0), m_discarding(false) {}
+
+void DelimitedFrameDecoder::decode(const QByteArray &chunk, quint64 base,
+                                   QList<Frame> &frames) {
+  const qsizetype size = chunk.size();
+  const qsizetype delimiterSize = m_delimiter.size();
+  const QByteArrayView delimiter(m_delimiter);
+  qsizetype pos = 0;
+
+  // Complete the frame carried over from earlier chunks. A multi-byte
+  // delimiter may itself be split across the boundary.
+  if (!m_partial.isEmpty() || m_discarding) {
+    qsizetype end = -1;
+    for (qsizetype k = delimiterSize - 1; k > 0 && end < 0; --k) {
+      if (m_partial.endsWith(delimiter.first(k)) &&
+          chunk.startsWith(delimiter.sliced(k))) {
+        end = delimiterSize - k;
+      }
+    }
+    if (end < 0) {
+      const qsizetype index = chunk.indexOf(m_delimiter);
+      if (index >= 0) {
+        end = index + delimiterSize;
+      }
+    }
+
+    if (end < 0) {
+      m_partial.append(chunk);
+      limitPartial();
+      return;
+    }
+
+    if (m_discarding) {
+      m_discarding = false;
+    } else {
+      m_partial.append(chunk.constData(), end);
+      finishFrame(m_partial, 0, m_partial.size(), m_partialOffset, frames);
+    }
+    m_partial.clear();
+    pos = end;
+  }
+
+  while (pos < size) {
+    const qsizetype index = chunk.indexOf(m_delimiter, pos);
+    if (index < 0) {
+      break;
+    }
+    const qsizetype end = index + delimiterSize;
+    finishFrame(chunk, pos, end - pos, base + pos, frames);
+    pos = end;
+  }
+
+  if (pos < size) {
+    m_partial = slice(chunk, pos, size - pos);
+    m_partialOffset = base + pos;
+    limitPartial();
+  }
+}
+
+void DelimitedFrameDecoder::resetState() {
+  m_partial.clear();
+  m_partialOffset = 0;
+  m_discarding = false;
+}
+
+bool DelimitedFrameDecoder::decodeFrame(const QByteArray &source,
+                                        qsizetype from, qsizetype length,
+                                        QByteArray &payload) {
+  payload = slice(source, from, length);
+  return true;
+}
+
+void DelimitedFrameDecoder::finishFrame(const QByteArray &source,
+                                        qsizetype from, qsizetype length,
+                                        quint64 offset, QList<Frame> &frames) {
+  const qsizetype frameLength =
+      m_includeDelimiter ? length : length - m_delimiter.size();
+  if (frameLength == 0 && m_skipEmptyFrames) {
+    return;
+  }
+
+  QByteArray payload;
+  if (frameLength > m_maxFrameSize ||
+      !decodeFrame(source, from, frameLength, payload)) {
+    ++m_errorCount;
+    return;
+  }
+  frames.append({payload, offset, length});
+}
+
+void DelimitedFrameDecoder::limitPartial() {
+  if (m_partial.size() <= m_maxFrameSize + m_delimiter.size()) {
+    return;
+  }
+  if (!m_discarding) {
+    ++m_errorCount;
+    m_discarding = true;
+  }
+  // Drop the oversized frame up to its delimiter, keeping just enough to
+  // recognise a delimiter split across chunks
+  m_partial = m_partial.right(m_delimiter.size() - 1);
+}
+
+FixedLengthFrameDecoder::FixedLengthFrameDecoder(int frameLength)
+    : FrameDecoder(frameLength), m_frameLength(frameLength),
+      m_partialOffset(0) {}
+
+void FixedLengthFrameDecoder::decode(const QByteArray &chunk, quint64 base,
+                                     QList<Frame> &frames) {
+  const qsizetype size = chunk.size();
+  qsizetype pos = 0;
+
+  if (!m_partial.isEmpty()) {
+    pos = qMin(m_frameLength - m_partial.size(), size);
+    m_partial.append(chunk.constData(), pos);
+    if (m_partial.size() < m_frameLength) {
+      return;
+    }
+    frames.append({m_partial, m_partialOffset, m_frameLength});
+    m_partial.clear();
+  }
+
+  for (; size - pos >= m_frameLength; pos += m_frameLength) {
+    frames.append(
+        {slice(chunk, pos, m_frameLength), base + pos, m_frameLength});
+  }
+
+  if (pos < size) {
+    m_partial = slice(chunk, pos, size - pos);
+    m_partialOffset = base + pos;
+  }
+}
+
+void FixedLengthFrameDecoder::resetState() {
+  m_partial.clear();
+  m_partialOffset = 0;
+}
+
+LengthPrefixFrameDecoder::LengthPrefixFrameDecoder(int fieldSize,
+                                                   bool bigEndian,
+                                                   bool includesHeader,
+                                                   int maxFrameSize)
+    : FrameDecoder(maxFrameSize), m_fieldSize(fieldSize),
+      m_bigEndian(bigEndian), m_includesHeader(includesHeader),
+      m_partialOffset(0) {}
+
+void LengthPrefixFrameDecoder::decode(const QByteArray &chunk, quint64 base,
+                                      QList<Frame> &frames) {
+  const char *data = chunk.constData();
+  const qsizetype size = chunk.size();
+  qsizetype pos = 0;
+
+  while (pos < size) {
+    if (m_partial.isEmpty()) {
+      // Frames lying entirely inside the chunk are copied out directly
+      if (size - pos >= m_fieldSize) {
+        const qsizetype total = frameSize(data + pos);
+        if (total < 0) {
+          // No way to resynchronise on a length field; try the next byte
+          ++m_errorCount;
+          ++pos;
+          continue;
+        }
+        if (size - pos >= total) {
+          frames.append({slice(chunk, pos + m_fieldSize, total - m_fieldSize),
+                         base + pos, total});
+          pos += total;
+          continue;
+        }
+      }
+      m_partial = slice(chunk, pos, size - pos);
+      m_partialOffset = base + pos;
+      return;
+    }
+
+    // Top up the carried frame: first its header, then its payload
+    qsizetype wanted = m_fieldSize;
+    if (m_partial.size() >= m_fieldSize) {
+      wanted = frameSize(m_partial.constData());
+    }
+    const qsizetype take = qMin(wanted - m_partial.size(), size - pos);
+    m_partial.append(data + pos, take);
+    pos += take;
+
+    if (m_partial.size() < m_fieldSize) {
+      continue;
+    }
+    const qsizetype total = frameSize(m_partial.constData());
+    if (total < 0) {
+      ++m_errorCount;
+      m_partial.clear();
+    } else if (m_partial.size() == total) {
+      frames.append(
+          {m_partial.sliced(m_fieldSize), m_partialOffset, total});
+      m_partial.clear();
+    }
+  }
+}
+
+void LengthPrefixFrameDecoder::resetState() {
+  m_partial.clear();
+  m_partialOffset = 0;
+}
+
+qsizetype LengthPrefixFrameDecoder::frameSize(const char *header) const {
+  quint32 length = 0;
+  for (int i = 0; i < m_fieldSize; ++i) {
+    const int index = m_bigEndian ? i : m_fieldSize - 1 - i;
+    length = (length << 8) | static_cast<quint8>(header[index]);
+  }
+
+  const qint64 total =
+      m_includesHeader ? qint64(length) : qint64(length) + m_fieldSize;
+  if (total < m_fieldSize || total - m_fieldSize > m_maxFrameSize) {
+    return -1;
+  }
+  return static_cast<qsizetype>(total);
+}
+
+SlipFrameDecoder::SlipFrameDecoder(int maxFrameSize)
+    : DelimitedFrameDecoder(QByteArray(1, SlipEnd), false, true,
+                            maxFrameSize) {}
+
+bool SlipFrameDecoder::decodeFrame(const QByteArray &source, qsizetype from,
+                                   qsizetype length, QByteArray &payload) {
+  const char *data = source.constData() + from;
+  if (!std::memchr(data, SlipEsc, length)) {
+    payload = slice(source, from, length);
+    return true;
+  }
+
+  payload.resize(length);
+  char *out = payload.data();
+  for (qsizetype i = 0; i < length; ++i) {
+    char c = data[i];
+    if (c == SlipEsc) {
+      if (++i == length) {
+        return false;
+      }
+      if (data[i] == SlipEscEnd) {
+        c = SlipEnd;
+      } else if (data[i] == SlipEscEsc) {
+        c = SlipEsc;
+      } else {
+        return false;
+      }
+    }
+    *out++ = c;
+  }
+  payload.truncate(out - payload.constData());
+  return true;
+}
+
+CobsFrameDecoder::CobsFrameDecoder(int maxFrameSize)
+    : DelimitedFrameDecoder(QByteArray(1, '\0'), false, true, maxFrameSize) {}
+
+bool CobsFrameDecoder::decodeFrame(const QByteArray &source, qsizetype from,
+                                   qsizetype length, QByteArray &payload) {
+  const char *data = source.constData() + from;
+
+  // Decoded data is always shorter than its encoding
+  payload.resize(length);
+  char *out = payload.data();
+  qsizetype i = 0;
+  while (i < length) {
+    const quint8 code = static_cast<quint8>(data[i++]);
+    const qsizetype run = code - 1;
+    if (code == 0 || i + run > length) {
+      return false;
+    }
+    std::memcpy(out, data + i, run);
+    out += run;
+    i += run;
+    // Every block except a full one and the last stands for a zero byte
+    if (code != 0xFF && i < length) {
+      *out++ = '\0';
+    }
+  }
+  payload.truncate(out - payload.constData());
+  return true;
+}
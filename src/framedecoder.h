@@ -0,0 +1,168 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QtGlobal>
+#include <memory>
+
+// Streaming frame reassembly. Chunks are fed in as they arrive from the port
+// and complete frames come out regardless of how the driver split them.
+// Frames lying inside one chunk are copied out of it once; only frames that
+// span chunks go through the decoder's carry-over buffer, and a frame that
+// is exactly one chunk shares that chunk's data.
+class FrameDecoder
+{
+public:
+    enum Type {
+        NoFraming,
+        Delimiter,
+        FixedLength,
+        LengthPrefix,
+        Slip,
+        Cobs
+    };
+
+    struct Options
+    {
+        Type type = NoFraming;
+        QByteArray delimiter = "\n";        // Delimiter
+        bool includeDelimiter = false;      // Delimiter
+        int frameLength = 16;               // FixedLength
+        int lengthFieldSize = 2;            // LengthPrefix: 1, 2 or 4 bytes
+        bool lengthBigEndian = true;        // LengthPrefix
+        bool lengthIncludesHeader = false;  // LengthPrefix
+        int maxFrameSize = 64 * 1024;       // Longer frames are discarded
+    };
+
+    struct Frame
+    {
+        QByteArray payload;   // Decoded frame without framing bytes
+        quint64 offset;       // Stream offset of the frame's first wire byte
+        qsizetype wireLength; // Bytes the frame occupied on the wire
+    };
+
+    // Returns nullptr for NoFraming
+    static std::unique_ptr<FrameDecoder> create(const Options &options);
+
+    virtual ~FrameDecoder() = default;
+
+    // Appends every frame completed by chunk to frames
+    void feed(const QByteArray &chunk, QList<Frame> &frames);
+    void reset();
+
+    quint64 streamOffset() const { return m_streamOffset; }
+    quint64 errorCount() const { return m_errorCount; }
+
+protected:
+    explicit FrameDecoder(int maxFrameSize);
+
+    // chunk starts at stream offset base
+    virtual void decode(const QByteArray &chunk, quint64 base,
+                        QList<Frame> &frames) = 0;
+    virtual void resetState() = 0;
+
+    // Copies the range, but shares source when the range covers all of it
+    static QByteArray slice(const QByteArray &source, qsizetype from,
+                            qsizetype length);
+
+    int m_maxFrameSize;
+    quint64 m_errorCount;
+
+private:
+    quint64 m_streamOffset;
+};
+
+// Frames end with a delimiter sequence; also the base for SLIP and COBS,
+// which are delimited by a single reserved byte and decoded per frame.
+class DelimitedFrameDecoder : public FrameDecoder
+{
+public:
+    DelimitedFrameDecoder(const QByteArray &delimiter, bool includeDelimiter,
+                          bool skipEmptyFrames, int maxFrameSize);
+
+protected:
+    void decode(const QByteArray &chunk, quint64 base,
+                QList<Frame> &frames) override;
+    void resetState() override;
+
+    // Turns the raw bytes of one frame into its payload. Returns false if
+    // the frame is malformed or should be skipped.
+    virtual bool decodeFrame(const QByteArray &source, qsizetype from,
+                             qsizetype length, QByteArray &payload);
+
+private:
+    void finishFrame(const QByteArray &source, qsizetype from,
+                     qsizetype length, quint64 offset, QList<Frame> &frames);
+    void limitPartial();
+
+    QByteArray m_delimiter;
+    bool m_includeDelimiter;
+    bool m_skipEmptyFrames;
+    QByteArray m_partial;     // Bytes of a frame that spans chunks
+    quint64 m_partialOffset;
+    bool m_discarding;        // Skipping an oversized frame
+};
+
+class FixedLengthFrameDecoder : public FrameDecoder
+{
+public:
+    explicit FixedLengthFrameDecoder(int frameLength);
+
+protected:
+    void decode(const QByteArray &chunk, quint64 base,
+                QList<Frame> &frames) override;
+    void resetState() override;
+
+private:
+    qsizetype m_frameLength;
+    QByteArray m_partial;
+    quint64 m_partialOffset;
+};
+
+// Frames start with an unsigned length field; the payload follows it
+class LengthPrefixFrameDecoder : public FrameDecoder
+{
+public:
+    LengthPrefixFrameDecoder(int fieldSize, bool bigEndian,
+                             bool includesHeader, int maxFrameSize);
+
+protected:
+    void decode(const QByteArray &chunk, quint64 base,
+                QList<Frame> &frames) override;
+    void resetState() override;
+
+private:
+    // Total wire size of the frame starting at header, or -1 if invalid
+    qsizetype frameSize(const char *header) const;
+
+    int m_fieldSize;
+    bool m_bigEndian;
+    bool m_includesHeader;
+    QByteArray m_partial;
+    quint64 m_partialOffset;
+};
+
+// RFC 1055 SLIP
+class SlipFrameDecoder : public DelimitedFrameDecoder
+{
+public:
+    explicit SlipFrameDecoder(int maxFrameSize);
+
+protected:
+    bool decodeFrame(const QByteArray &source, qsizetype from,
+                     qsizetype length, QByteArray &payload) override;
+};
+
+// Consistent Overhead Byte Stuffing, frames terminated by a zero byte
+class CobsFrameDecoder : public DelimitedFrameDecoder
+{
+public:
+    explicit CobsFrameDecoder(int maxFrameSize);
+
+protected:
+    bool decodeFrame(const QByteArray &source, qsizetype from,
+                     qsizetype length, QByteArray &payload) override;
+};
+
+#endif // FRAMEDECODER_H
@@ -0,0 +1,500 @@
+#include "headlesscapture.h"
+#include "logwriter.h"
+#include "portbridge.h"
+#include "scriptengine.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+#include "triggercapture.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <csignal>
+#include <cstdio>
+
+namespace {
+
+volatile std::sig_atomic_t g_interrupted = 0;
+
+void handleInterrupt(int) { g_interrupted = 1; }
+
+QTextStream &err() {
+  static QTextStream stream(stderr);
+  return stream;
+}
+
+bool parseDataBits(const QString &value, QSerialPort::DataBits &dataBits) {
+  const int bits = value.toInt();
+  if (bits < 5 || bits > 8) {
+    return false;
+  }
+  dataBits = static_cast<QSerialPort::DataBits>(bits);
+  return true;
+}
+
+bool parseStopBits(const QString &value, QSerialPort::StopBits &stopBits) {
+  if (value == "1") {
+    stopBits = QSerialPort::OneStop;
+  } else if (value == "1.5") {
+    stopBits = QSerialPort::OneAndHalfStop;
+  } else if (value == "2") {
+    stopBits = QSerialPort::TwoStop;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parseParity(const QString &value, QSerialPort::Parity &parity) {
+  const QString name = value.toLower();
+  if (name == "none") {
+    parity = QSerialPort::NoParity;
+  } else if (name == "even") {
+    parity = QSerialPort::EvenParity;
+  } else if (name == "odd") {
+    parity = QSerialPort::OddParity;
+  } else if (name == "space") {
+    parity = QSerialPort::SpaceParity;
+  } else if (name == "mark") {
+    parity = QSerialPort::MarkParity;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+HeadlessCapture::HeadlessCapture(const Options &options, QObject *parent)
+    : QObject(parent), m_options(options),
+      m_serialPortManager(new SerialPortManager(this)), m_logWriter(nullptr),
+      m_scriptEngine(nullptr), m_bridge(nullptr), m_trigger(nullptr),
+      m_output(nullptr),
+      m_flushTimer(new QTimer(this)), m_bytesCaptured(0), m_started(false),
+      m_stopping(false), m_outputFailed(false) {
+  connect(m_serialPortManager, &SerialPortManager::chunkReceived, this,
+          &HeadlessCapture::onChunkReceived);
+  connect(m_serialPortManager, &SerialPortManager::errorOccurred, this,
+          &HeadlessCapture::onErrorOccurred);
+  connect(m_serialPortManager, &SerialPortManager::connectionStatusChanged,
+          this, &HeadlessCapture::onConnectionStatusChanged);
+  connect(m_serialPortManager, &SerialPortManager::reconnected, this,
+          [this](qint64 downtimeMs) {
+            err() << "Reconnected to " << m_options.portName << " after "
+                  << downtimeMs << " ms" << Qt::endl;
+          });
+
+  // Raw output is buffered by QFile; push it out regularly for pipes
+  connect(m_flushTimer, &QTimer::timeout, this, [this]() {
+    if (m_output && !m_outputFailed && !m_output->flush()) {
+      failOutput();
+    }
+  });
+}
+
+HeadlessCapture::~HeadlessCapture() { stop(); }
+
+bool HeadlessCapture::start() {
+  if (!openOutput() || !openStatistics() || !startBridge() ||
+      !startTrigger()) {
+    return false;
+  }
+  if (!m_options.scriptPath.isEmpty()) {
+    m_scriptEngine = new ScriptEngine(m_serialPortManager, this);
+    if (!m_scriptEngine->loadFile(m_options.scriptPath)) {
+      err() << m_scriptEngine->errorString() << Qt::endl;
+      return false;
+    }
+    connect(m_scriptEngine, &ScriptEngine::message, this,
+            [](const QString &text) { err() << text << Qt::endl; });
+    connect(m_scriptEngine, &ScriptEngine::finished, this,
+            [this](bool success, const QString &message) {
+              err() << "Script: " << message << Qt::endl;
+              emit finished(success ? 0 : 1);
+            });
+  }
+
+  m_serialPortManager->setThreadedIo(m_options.threadedIo);
+  m_serialPortManager->setAutoReconnect(m_options.reconnect);
+  if (!m_serialPortManager->openPort(m_options.portName, m_options.baudRate,
+                                     m_options.dataBits, m_options.stopBits,
+                                     m_options.parity)) {
+    return false;
+  }
+
+  m_started = true;
+  m_flushTimer->start(200);
+  if (m_options.durationSeconds > 0) {
+    QTimer::singleShot(m_options.durationSeconds * 1000, this,
+                       [this]() { emit finished(0); });
+  }
+
+  err() << "Capturing " << m_options.portName << " at " << m_options.baudRate
+        << " baud" << Qt::endl;
+
+  // From the event loop, so the result reaches whoever handles finished()
+  if (m_scriptEngine) {
+    QTimer::singleShot(0, this, [this]() {
+      if (!m_scriptEngine->start()) {
+        err() << m_scriptEngine->errorString() << Qt::endl;
+        emit finished(1);
+      }
+    });
+  }
+  return true;
+}
+
+void HeadlessCapture::stop() {
+  if (!m_started || m_stopping) {
+    return;
+  }
+  m_stopping = true;
+
+  if (m_bridge) {
+    m_bridge->stop();
+  }
+  m_serialPortManager->closePort();
+  m_flushTimer->stop();
+  if (m_output && !m_outputFailed && !m_output->flush()) {
+    failOutput();
+  }
+  if (m_logWriter) {
+    m_logWriter->stop();
+  }
+  if (m_trigger) {
+    m_trigger->stop();
+  }
+  m_statisticsExporter.close();
+
+  err() << "Captured " << m_bytesCaptured << " bytes";
+  if (m_serialPortManager->rxOverrunBytes() > 0) {
+    err() << ", " << m_serialPortManager->rxOverrunBytes()
+          << " bytes lost to overruns";
+  }
+  err() << Qt::endl;
+}
+
+quint64 HeadlessCapture::bytesCaptured() const { return m_bytesCaptured; }
+
+void HeadlessCapture::onChunkReceived(const SerialChunk &chunk) {
+  const QByteArray &data = chunk.data;
+  if (m_trigger) {
+    m_trigger->addData(CaptureFormat::Rx,
+                       SerialClock::toEpochNs(chunk.timestamp), data);
+  }
+
+  // Only what the output took counts as captured
+  if (m_logWriter) {
+    if (!m_logWriter->hasFailed()) {
+      m_logWriter->write(CaptureFormat::Rx,
+                         SerialClock::toEpochNs(chunk.timestamp), data);
+      m_bytesCaptured += data.size();
+    }
+  } else if (!m_outputFailed) {
+    const qint64 written = m_output->write(data);
+    if (written > 0) {
+      m_bytesCaptured += quint64(written);
+    }
+    if (written != data.size()) {
+      failOutput();
+    }
+  }
+}
+
+void HeadlessCapture::failOutput() {
+  // Reported once; what is still buffered will not be written either, and
+  // data arriving before the capture stops is discarded
+  m_outputFailed = true;
+  const quint64 buffered = quint64(qMax<qint64>(0, m_output->bytesToWrite()));
+  m_bytesCaptured -= qMin(m_bytesCaptured, buffered);
+  err() << "Failed to write output: " << m_output->errorString() << Qt::endl;
+  emit finished(1);
+}
+
+void HeadlessCapture::onErrorOccurred(const QString &error) {
+  err() << "Error: " << error << Qt::endl;
+}
+
+void HeadlessCapture::onConnectionStatusChanged(bool connected) {
+  if (!connected && !m_stopping &&
+      !m_serialPortManager->isReconnecting()) {
+    emit finished(1);
+  }
+}
+
+bool HeadlessCapture::openOutput() {
+  const bool toStdout =
+      m_options.outputPath.isEmpty() || m_options.outputPath == "-";
+
+  if (m_options.format == CaptureOutput) {
+    if (toStdout) {
+      err() << "Capture output needs a file, use --output" << Qt::endl;
+      return false;
+    }
+
+    m_logWriter = new LogWriter(this);
+    connect(m_logWriter, &LogWriter::errorOccurred, this,
+            [this](const QString &error) {
+              onErrorOccurred(error);
+              // Nothing more can be captured
+              if (m_logWriter->hasFailed()) {
+                emit finished(1);
+              }
+            });
+    LogWriter::Options options;
+    options.path = m_options.outputPath;
+    options.metadata = CaptureFormat::encodeMetadata(
+        {{"port", m_options.portName},
+         {"baud", QString::number(m_options.baudRate)},
+         {"dataBits", QString::number(int(m_options.dataBits))},
+         {"stopBits", QString::number(int(m_options.stopBits))},
+         {"parity", QString::number(int(m_options.parity))}});
+    return m_logWriter->start(options);
+  }
+
+  m_output = new QFile(this);
+  bool opened;
+  if (toStdout) {
+    opened = m_output->open(stdout, QIODevice::WriteOnly);
+  } else {
+    m_output->setFileName(m_options.outputPath);
+    opened = m_output->open(QIODevice::WriteOnly | QIODevice::Truncate);
+  }
+  if (!opened) {
+    err() << "Failed to open output: " << m_output->errorString() << Qt::endl;
+  }
+  return opened;
+}
+
+bool HeadlessCapture::openStatistics() {
+  if (m_options.statisticsPath.isEmpty()) {
+    return true;
+  }
+
+  if (!m_statisticsExporter.open(m_options.statisticsPath)) {
+    err() << "Failed to open statistics output: "
+          << m_statisticsExporter.errorString() << Qt::endl;
+    return false;
+  }
+  connect(m_serialPortManager, &SerialPortManager::statisticsUpdated, this,
+          [this](const PortStatistics &stats) {
+            if (m_statisticsExporter.isOpen() &&
+                !m_statisticsExporter.write(stats)) {
+              onErrorOccurred(m_statisticsExporter.errorString());
+            }
+          });
+  m_serialPortManager->setStatisticsInterval(m_options.statisticsIntervalMs);
+  return true;
+}
+
+bool HeadlessCapture::startBridge() {
+  if (m_options.bridgePort == 0) {
+    return true;
+  }
+
+  const QHostAddress address(m_options.bridgeAddress);
+  const quint16 port = m_options.bridgePort;
+  m_bridge = new PortBridge(m_serialPortManager, this);
+  if (address.isNull() ||
+      !m_bridge->listenTcp(PortBridge::RawTcp, address, port) ||
+      !m_bridge->listenTcp(PortBridge::Rfc2217, address, port + 1) ||
+      !m_bridge->listenUdp(address, port)) {
+    err() << "Failed to share the port on " << m_options.bridgeAddress
+          << ": "
+          << (address.isNull() ? "invalid address" : m_bridge->errorString())
+          << Qt::endl;
+    return false;
+  }
+  connect(m_bridge, &PortBridge::clientsChanged, this, [](int count) {
+    err() << "Network clients: " << count << Qt::endl;
+  });
+  err() << "Sharing on " << m_options.bridgeAddress << ": raw TCP and UDP "
+        << port << ", RFC 2217 " << port + 1 << Qt::endl;
+  return true;
+}
+
+bool HeadlessCapture::startTrigger() {
+  if (m_options.triggerSpec.isEmpty()) {
+    return true;
+  }
+
+  TriggerCapture::Options options;
+  QString error;
+  if (!TriggerCapture::parseOptions(m_options.triggerSpec, options, error)) {
+    err() << error << Qt::endl;
+    return false;
+  }
+  options.metadata = {{"port", m_options.portName},
+                      {"baud", QString::number(m_options.baudRate)},
+                      {"dataBits", QString::number(int(m_options.dataBits))},
+                      {"stopBits", QString::number(int(m_options.stopBits))},
+                      {"parity", QString::number(int(m_options.parity))}};
+
+  m_trigger = new TriggerCapture(this);
+  if (!m_trigger->start(options)) {
+    err() << m_trigger->errorString() << Qt::endl;
+    return false;
+  }
+  connect(m_serialPortManager, &SerialPortManager::errorOccurred, m_trigger,
+          &TriggerCapture::reportError);
+  connect(m_serialPortManager, &SerialPortManager::rxOverrun, m_trigger,
+          [this](quint64 totalDroppedBytes) {
+            m_trigger->reportError(
+                QString("RX overrun, %1 bytes dropped").arg(totalDroppedBytes));
+          });
+  connect(m_trigger, &TriggerCapture::triggered, this,
+          [](const QString &reason) {
+            err() << "Trigger: " << reason << Qt::endl;
+          });
+  connect(m_trigger, &TriggerCapture::captureSaved, this,
+          [](const QString &path) {
+            err() << "Saved " << path << Qt::endl;
+          });
+  connect(m_trigger, &TriggerCapture::errorOccurred, this,
+          &HeadlessCapture::onErrorOccurred);
+  err() << "Trigger armed, captures go to " << options.directory << Qt::endl;
+  return true;
+}
+
+void HeadlessCapture::addOptions(QCommandLineParser &parser) {
+  parser.addOptions({
+      {"headless", "Run without a GUI."},
+      {"list", "List available serial ports and exit."},
+      {{"p", "port"}, "Serial port to open, or sim[:options].", "name"},
+      {{"b", "baud"}, "Baud rate (default 115200).", "rate", "115200"},
+      {"data-bits", "Data bits: 5, 6, 7 or 8 (default 8).", "bits", "8"},
+      {"stop-bits", "Stop bits: 1, 1.5 or 2 (default 1).", "bits", "1"},
+      {"parity", "Parity: none, even, odd, space or mark (default none).",
+       "parity", "none"},
+      {{"o", "output"}, "Output file, '-' for stdout (default).", "file"},
+      {{"f", "format"}, "Output format: raw or sfcap (default raw).",
+       "format", "raw"},
+      {{"d", "duration"}, "Stop after this many seconds.", "seconds"},
+      {"no-io-thread", "Service the port from the main thread."},
+      {"reconnect", "Keep capturing when the device resets or is replugged."},
+      {"stats", "Write port statistics to a CSV or .jsonl file.", "file"},
+      {"stats-interval",
+       "Statistics interval in milliseconds (default 1000).", "ms", "1000"},
+      {"script", "Run a send/expect script, exit with its result.", "file"},
+      {"bridge",
+       "Share the port over the network: raw TCP and UDP on this port, "
+       "RFC 2217 on the next.",
+       "port"},
+      {"bridge-address",
+       "Address to share the port on (default 127.0.0.1).", "address",
+       "127.0.0.1"},
+      {"trigger",
+       "Save the traffic around events to trigger_*.sfcap files, e.g. "
+       "pattern=DEADBEEF,before=64K,after=10s,dir=faults.",
+       "options"},
+  });
+}
+
+bool HeadlessCapture::parseOptions(const QCommandLineParser &parser,
+                                   Options &options, QString *error) {
+  options.portName = parser.value("port");
+  options.baudRate = parser.value("baud").toInt();
+  options.outputPath = parser.value("output");
+  options.threadedIo = !parser.isSet("no-io-thread");
+  options.reconnect = parser.isSet("reconnect");
+  options.statisticsPath = parser.value("stats");
+  options.scriptPath = parser.value("script");
+  options.bridgeAddress = parser.value("bridge-address");
+  options.triggerSpec = parser.value("trigger");
+
+  const QString format = parser.value("format").toLower();
+  if (format == "sfcap") {
+    options.format = CaptureOutput;
+  } else if (format != "raw") {
+    *error = "Unknown output format: " + format;
+    return false;
+  }
+
+  // A typo must not fall back to 0, which means "forever" or no interval
+  bool ok = true;
+  if (parser.isSet("duration")) {
+    options.durationSeconds = parser.value("duration").toInt(&ok);
+    if (!ok || options.durationSeconds < 0) {
+      *error = "Invalid duration: " + parser.value("duration");
+      return false;
+    }
+  }
+
+  options.statisticsIntervalMs = parser.value("stats-interval").toInt(&ok);
+  if (!ok || options.statisticsIntervalMs <= 0) {
+    *error = "Invalid statistics interval: " + parser.value("stats-interval");
+    return false;
+  }
+
+  if (parser.isSet("bridge")) {
+    const int bridgePort = parser.value("bridge").toInt();
+    if (bridgePort <= 0 || bridgePort >= 65535) {
+      *error = "Invalid bridge port: " + parser.value("bridge");
+      return false;
+    }
+    options.bridgePort = quint16(bridgePort);
+  }
+
+  if (options.portName.isEmpty() || options.baudRate <= 0 ||
+      !parseDataBits(parser.value("data-bits"), options.dataBits) ||
+      !parseStopBits(parser.value("stop-bits"), options.stopBits) ||
+      !parseParity(parser.value("parity"), options.parity)) {
+    *error = "Invalid or missing connection options, see --help";
+    return false;
+  }
+  return true;
+}
+
+int runHeadless(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("SerialFlow");
+  QCoreApplication::setApplicationVersion("1.0");
+  QCoreApplication::setOrganizationName("SerialFlow");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Headless serial port capture");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  HeadlessCapture::addOptions(parser);
+  parser.process(app);
+
+  if (parser.isSet("list")) {
+    QTextStream out(stdout);
+    const auto ports = SerialPortManager().getAvailablePortNames();
+    for (const QString &port : ports) {
+      out << port << Qt::endl;
+    }
+    return 0;
+  }
+
+  HeadlessCapture::Options options;
+  QString error;
+  if (!HeadlessCapture::parseOptions(parser, options, &error)) {
+    err() << error << Qt::endl;
+    return 2;
+  }
+
+  HeadlessCapture capture(options);
+  if (!capture.start()) {
+    return 1;
+  }
+
+  QObject::connect(&capture, &HeadlessCapture::finished, &app,
+                   &QCoreApplication::exit);
+
+  // Ctrl+C stops the capture cleanly so buffered output is not lost
+  std::signal(SIGINT, handleInterrupt);
+  std::signal(SIGTERM, handleInterrupt);
+  QTimer interruptPoll;
+  QObject::connect(&interruptPoll, &QTimer::timeout, &app, []() {
+    if (g_interrupted) {
+      QCoreApplication::exit(0);
+    }
+  });
+  interruptPoll.start(100);
+
+  const int exitCode = app.exec();
+  capture.stop();
+  return exitCode;
+}
@@ -0,0 +1,100 @@
+#ifndef HEADLESSCAPTURE_H
+#define HEADLESSCAPTURE_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QString>
+#include "serialchunk.h"
+#include "statisticsexporter.h"
+
+class QCommandLineParser;
+class QFile;
+class QTimer;
+class LogWriter;
+class PortBridge;
+class ScriptEngine;
+class TriggerCapture;
+class SerialPortManager;
+
+// GUI-less capture used by "SerialFlow --headless". Opens one port through
+// SerialPortManager and streams everything it receives to stdout or a file,
+// either as raw bytes or as a binary .sfcap capture. With a script, the
+// capture ends when the script does and its result is the exit code. The
+// port can also be shared with network clients while it is captured, and a
+// trigger can save the traffic around rare events to files of their own.
+class HeadlessCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum OutputFormat {
+        RawOutput,
+        CaptureOutput
+    };
+
+    struct Options
+    {
+        QString portName;
+        qint32 baudRate = 115200;
+        QSerialPort::DataBits dataBits = QSerialPort::Data8;
+        QSerialPort::StopBits stopBits = QSerialPort::OneStop;
+        QSerialPort::Parity parity = QSerialPort::NoParity;
+        QString outputPath;            // Empty or "-" for stdout
+        OutputFormat format = RawOutput;
+        bool threadedIo = true;
+        bool reconnect = false;        // Reopen the port after a reset
+        int durationSeconds = 0;       // 0 = until interrupted
+        QString statisticsPath;        // Empty for no statistics export
+        int statisticsIntervalMs = 1000;
+        QString scriptPath;            // Run once connected, exit with result
+        quint16 bridgePort = 0;        // Raw TCP and UDP here, RFC 2217 +1
+        QString bridgeAddress = "127.0.0.1";
+        QString triggerSpec;           // TriggerCapture options, or empty
+    };
+
+    explicit HeadlessCapture(const Options &options, QObject *parent = nullptr);
+    ~HeadlessCapture();
+
+    bool start();
+    void stop();
+    quint64 bytesCaptured() const;   // Reached the output
+
+    // Command line handling shared by runHeadless() and the tests
+    static void addOptions(QCommandLineParser &parser);
+    static bool parseOptions(const QCommandLineParser &parser,
+                             Options &options, QString *error);
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void onChunkReceived(const SerialChunk &chunk);
+    void onErrorOccurred(const QString &error);
+    void onConnectionStatusChanged(bool connected);
+
+private:
+    bool openOutput();
+    bool openStatistics();
+    bool startBridge();
+    bool startTrigger();
+    void failOutput();
+
+    Options m_options;
+    SerialPortManager *m_serialPortManager;
+    LogWriter *m_logWriter;
+    ScriptEngine *m_scriptEngine;
+    PortBridge *m_bridge;
+    TriggerCapture *m_trigger;
+    QFile *m_output;
+    QTimer *m_flushTimer;
+    StatisticsExporter m_statisticsExporter;
+    quint64 m_bytesCaptured;
+    bool m_started;
+    bool m_stopping;
+    bool m_outputFailed;
+};
+
+// Entry point for --headless; owns its QCoreApplication
+int runHeadless(int argc, char *argv[]);
+
+#endif // HEADLESSCAPTURE_H
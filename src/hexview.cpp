@@ -0,0 +1,353 @@
+#include "hexview.h"
+#include "byteformatter.h"
+#include <QClipboard>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSignalBlocker>
+#include <QStringList>
+#include <limits>
+
+namespace {
+
+const int BytesPerRow = ByteFormatter::DumpBytesPerRow;
+
+} // namespace
+
+HexView::HexView(QWidget *parent)
+    : QAbstractScrollArea(parent), m_source(nullptr), m_autoScroll(true),
+      m_topRow(0), m_followTail(true), m_selectionAnchor(-1),
+      m_selectionEnd(-1), m_rowBytes(BytesPerRow, Qt::Uninitialized),
+      m_rowText(ByteFormatter::DumpRowLength, Qt::Uninitialized) {
+  setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  setFocusPolicy(Qt::StrongFocus);
+
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &HexView::onVerticalScroll);
+  connect(horizontalScrollBar(), &QScrollBar::valueChanged, viewport(),
+          QOverload<>::of(&QWidget::update));
+}
+
+void HexView::setSource(ConsoleSource *source) {
+  m_source = source;
+  m_topRow = firstRow();
+  m_followTail = true;
+  clearSelection();
+  refresh();
+}
+
+ConsoleSource *HexView::source() const { return m_source; }
+
+void HexView::setAutoScroll(bool enabled) { m_autoScroll = enabled; }
+
+bool HexView::autoScroll() const { return m_autoScroll; }
+
+void HexView::refresh() {
+  const qint64 first = firstRow();
+  const qint64 maxTop = qMax(first, endRow() - visibleRowCount());
+  if (m_autoScroll && m_followTail) {
+    m_topRow = maxTop;
+  }
+  m_topRow = qBound(first, m_topRow, maxTop);
+
+  updateScrollBars();
+  viewport()->update();
+}
+
+void HexView::scrollToBottom() {
+  m_followTail = true;
+  m_topRow = endRow();
+  refresh();
+}
+
+void HexView::showOffset(quint64 offset) {
+  const qint64 row = qint64(offset / BytesPerRow);
+  if (row >= m_topRow && row < m_topRow + visibleRowCount()) {
+    return;
+  }
+  m_followTail = false;
+  m_topRow = row - visibleRowCount() / 2;
+  refresh();
+}
+
+void HexView::copy() {
+  if (m_selectionAnchor < 0) {
+    return;
+  }
+
+  const qint64 first =
+      qMax(qMin(m_selectionAnchor, m_selectionEnd), firstRow());
+  const qint64 last =
+      qMin(qMax(m_selectionAnchor, m_selectionEnd), endRow() - 1);
+
+  QStringList lines;
+  quint64 from;
+  quint64 to;
+  for (qint64 row = first; row <= last; ++row) {
+    formatRow(row, from, to);
+    lines.append(QString::fromLatin1(m_rowText));
+  }
+  QGuiApplication::clipboard()->setText(lines.join('\n'));
+}
+
+void HexView::selectAll() {
+  if (endRow() > firstRow()) {
+    m_selectionAnchor = firstRow();
+    m_selectionEnd = endRow() - 1;
+    viewport()->update();
+  }
+}
+
+void HexView::clearSelection() {
+  m_selectionAnchor = -1;
+  m_selectionEnd = -1;
+  viewport()->update();
+}
+
+void HexView::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+  QPainter painter(viewport());
+  if (!m_source) {
+    return;
+  }
+
+  const QFontMetrics metrics = fontMetrics();
+  const int charWidth = metrics.horizontalAdvance('0');
+  const int height = lineHeight();
+  const int ascent = metrics.ascent();
+  const int x = 4 - horizontalScrollBar()->value();
+  const qint64 first = qMax(m_topRow, firstRow());
+  const qint64 end = qMin(endRow(), first + visibleRowCount() + 1);
+  const qint64 selectionFirst = qMin(m_selectionAnchor, m_selectionEnd);
+  const qint64 selectionLast = qMax(m_selectionAnchor, m_selectionEnd);
+  const QColor textColor = palette().text().color();
+
+  // Columns [from, to) of m_rowText in one colour
+  auto drawColumns = [&](int y, int from, int to) {
+    painter.drawText(x + from * charWidth, y + ascent,
+                     QString::fromLatin1(m_rowText.constData() + from,
+                                         to - from));
+  };
+
+  int y = 0;
+  quint64 from;
+  quint64 to;
+  for (qint64 row = first; row < end; ++row, y += height) {
+    formatRow(row, from, to);
+
+    if (m_selectionAnchor >= 0 && row >= selectionFirst &&
+        row <= selectionLast) {
+      painter.fillRect(0, y, viewport()->width(), height,
+                       palette().highlight());
+      painter.setPen(palette().highlightedText().color());
+      drawColumns(y, 0, ByteFormatter::DumpRowLength);
+      continue;
+    }
+
+    painter.setPen(textColor);
+    drawColumns(y, 0, ByteFormatter::DumpOffsetDigits);
+    drawColumns(y, ByteFormatter::dumpAsciiColumn(0) - 1,
+                ByteFormatter::dumpAsciiColumn(0));
+    drawColumns(y, ByteFormatter::DumpRowLength - 1,
+                ByteFormatter::DumpRowLength);
+
+    // Bytes in runs that share a record, and so a colour
+    const quint64 rowStart = quint64(row) * BytesPerRow;
+    qint64 id = recordAt(from);
+    for (quint64 offset = from; offset < to; ++id) {
+      quint64 runEnd = to;
+      if (id < m_source->endRecord()) {
+        const ConsoleSource::Record record = m_source->record(id);
+        runEnd = qBound(offset + 1, record.offset + record.length, to);
+        painter.setPen(byteColor(record.direction));
+      }
+      const int firstByte = int(offset - rowStart);
+      const int lastByte = int(runEnd - rowStart) - 1;
+      drawColumns(y, ByteFormatter::dumpHexColumn(firstByte),
+                  ByteFormatter::dumpHexColumn(lastByte) + 2);
+      drawColumns(y, ByteFormatter::dumpAsciiColumn(firstByte),
+                  ByteFormatter::dumpAsciiColumn(lastByte) + 1);
+      offset = runEnd;
+    }
+  }
+}
+
+void HexView::resizeEvent(QResizeEvent *event) {
+  QAbstractScrollArea::resizeEvent(event);
+  refresh();
+}
+
+void HexView::keyPressEvent(QKeyEvent *event) {
+  if (event->matches(QKeySequence::Copy)) {
+    copy();
+    return;
+  }
+  if (event->matches(QKeySequence::SelectAll)) {
+    selectAll();
+    return;
+  }
+
+  QScrollBar *bar = verticalScrollBar();
+  switch (event->key()) {
+  case Qt::Key_Up:
+    bar->triggerAction(QAbstractSlider::SliderSingleStepSub);
+    break;
+  case Qt::Key_Down:
+    bar->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+    break;
+  case Qt::Key_PageUp:
+    bar->triggerAction(QAbstractSlider::SliderPageStepSub);
+    break;
+  case Qt::Key_PageDown:
+    bar->triggerAction(QAbstractSlider::SliderPageStepAdd);
+    break;
+  case Qt::Key_Home:
+    bar->triggerAction(QAbstractSlider::SliderToMinimum);
+    break;
+  case Qt::Key_End:
+    bar->triggerAction(QAbstractSlider::SliderToMaximum);
+    break;
+  default:
+    QAbstractScrollArea::keyPressEvent(event);
+    return;
+  }
+}
+
+void HexView::mousePressEvent(QMouseEvent *event) {
+  if (event->button() == Qt::LeftButton) {
+    m_selectionAnchor = rowAt(event->position().toPoint().y());
+    m_selectionEnd = m_selectionAnchor;
+    viewport()->update();
+  }
+  QAbstractScrollArea::mousePressEvent(event);
+}
+
+void HexView::mouseMoveEvent(QMouseEvent *event) {
+  if ((event->buttons() & Qt::LeftButton) && m_selectionAnchor >= 0) {
+    m_selectionEnd = rowAt(event->position().toPoint().y());
+    viewport()->update();
+  }
+  QAbstractScrollArea::mouseMoveEvent(event);
+}
+
+void HexView::changeEvent(QEvent *event) {
+  QAbstractScrollArea::changeEvent(event);
+  if (event->type() == QEvent::FontChange) {
+    refresh();
+  }
+}
+
+void HexView::onVerticalScroll(int value) {
+  m_topRow = firstRow() + value;
+  m_followTail = value >= verticalScrollBar()->maximum();
+  viewport()->update();
+}
+
+bool HexView::byteRange(quint64 &first, quint64 &end) const {
+  if (!m_source || m_source->recordCount() == 0) {
+    return false;
+  }
+  const ConsoleSource::Record last =
+      m_source->record(m_source->endRecord() - 1);
+  first = m_source->record(m_source->firstRecord()).offset;
+  end = last.offset + last.length;
+  return end > first;
+}
+
+qint64 HexView::firstRow() const {
+  quint64 first;
+  quint64 end;
+  return byteRange(first, end) ? qint64(first / BytesPerRow) : 0;
+}
+
+qint64 HexView::endRow() const {
+  quint64 first;
+  quint64 end;
+  return byteRange(first, end) ? qint64((end - 1) / BytesPerRow + 1) : 0;
+}
+
+qint64 HexView::recordAt(quint64 offset) const {
+  // Records are stored in byte order
+  qint64 low = m_source->firstRecord();
+  qint64 high = m_source->endRecord() - 1;
+  while (low < high) {
+    const qint64 middle = low + (high - low + 1) / 2;
+    if (m_source->record(middle).offset <= offset) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return low;
+}
+
+void HexView::formatRow(qint64 row, quint64 &from, quint64 &to) const {
+  const quint64 rowStart = quint64(row) * BytesPerRow;
+  quint64 first = 0;
+  quint64 end = 0;
+  byteRange(first, end);
+  from = qBound(first, rowStart, end);
+  to = qBound(from, rowStart + BytesPerRow, end);
+
+  const qsizetype length =
+      from < to ? m_source->copyBytes(from, m_rowBytes.data(), to - from) : 0;
+  to = from + length;
+  ByteFormatter::formatDumpRow(rowStart, m_rowBytes.constData(),
+                               int(from - rowStart), int(length),
+                               m_rowText.data());
+}
+
+QColor HexView::byteColor(ConsoleSource::Direction direction) const {
+  // As in ConsoleView, with console messages set apart from traffic
+  switch (direction) {
+  case ConsoleSource::Tx:
+    return QColor("#2563eb");
+  case ConsoleSource::Error:
+    return QColor(Qt::red);
+  case ConsoleSource::Info:
+    return palette().color(QPalette::Disabled, QPalette::Text);
+  case ConsoleSource::Rx:
+    break;
+  }
+  return QColor("#16a34a");
+}
+
+int HexView::lineHeight() const { return qMax(1, fontMetrics().lineSpacing()); }
+
+int HexView::visibleRowCount() const {
+  return qMax(1, viewport()->height() / lineHeight());
+}
+
+qint64 HexView::rowAt(int y) const {
+  const qint64 first = firstRow();
+  const qint64 end = endRow();
+  if (end <= first) {
+    return -1;
+  }
+  return qBound(first, m_topRow + qMax(0, y) / lineHeight(), end - 1);
+}
+
+void HexView::updateScrollBars() {
+  const qint64 count = endRow() - firstRow();
+  const int rows = visibleRowCount();
+
+  QScrollBar *vertical = verticalScrollBar();
+  {
+    const QSignalBlocker blocker(vertical);
+    vertical->setRange(
+        0, static_cast<int>(qBound<qint64>(0, count - rows,
+                                           std::numeric_limits<int>::max())));
+    vertical->setPageStep(rows);
+    vertical->setValue(static_cast<int>(m_topRow - firstRow()));
+  }
+
+  const int charWidth = qMax(1, fontMetrics().horizontalAdvance('0'));
+  const int width = ByteFormatter::DumpRowLength * charWidth + 8;
+  QScrollBar *horizontal = horizontalScrollBar();
+  horizontal->setRange(0, qMax(0, width - viewport()->width()));
+  horizontal->setPageStep(viewport()->width());
+  horizontal->setSingleStep(charWidth);
+}
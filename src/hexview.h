@@ -0,0 +1,76 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QColor>
+#include "consolesource.h"
+
+// Hex inspector over the raw byte stream of a ConsoleSource: offset, sixteen
+// hex bytes and their ASCII, coloured by the direction of the record each
+// byte belongs to. Like ConsoleView, only the visible rows are formatted,
+// straight from the source's bytes, so the cost of a repaint does not depend
+// on how much history there is.
+class HexView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit HexView(QWidget *parent = nullptr);
+
+    void setSource(ConsoleSource *source);
+    ConsoleSource *source() const;
+
+    void setAutoScroll(bool enabled);
+    bool autoScroll() const;
+
+public slots:
+    // Call after the source changed
+    void refresh();
+    void scrollToBottom();
+    // Scrolls the row holding the absolute byte offset into view
+    void showOffset(quint64 offset);
+    void copy();
+    void selectAll();
+    void clearSelection();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private slots:
+    void onVerticalScroll(int value);
+
+private:
+    // Absolute byte range held by the source; false when it is empty
+    bool byteRange(quint64 &first, quint64 &end) const;
+    qint64 firstRow() const;
+    qint64 endRow() const;
+    // Id of the record holding offset
+    qint64 recordAt(quint64 offset) const;
+    // Formats row into m_rowText; returns the byte range it shows
+    void formatRow(qint64 row, quint64 &from, quint64 &to) const;
+    QColor byteColor(ConsoleSource::Direction direction) const;
+    int lineHeight() const;
+    int visibleRowCount() const;
+    qint64 rowAt(int y) const;
+    void updateScrollBars();
+
+    ConsoleSource *m_source;
+    bool m_autoScroll;
+
+    qint64 m_topRow;      // Absolute row (offset / 16) shown first
+    bool m_followTail;
+    qint64 m_selectionAnchor;
+    qint64 m_selectionEnd;
+
+    // Scratch space for formatting rows
+    mutable QByteArray m_rowBytes;
+    mutable QByteArray m_rowText;
+};
+
+#endif // HEXVIEW_H
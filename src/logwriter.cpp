@@ -0,0 +1,293 @@
+#include "logwriter.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtEndian>
+
+namespace {
+
+qint64 currentTimeNs() { return QDateTime::currentMSecsSinceEpoch() * 1000000; }
+
+// Runs on the global thread pool so neither the UI nor the writer waits on it
+bool compressFile(const QString &path) {
+  QFile input(path);
+  QFile output(path + CaptureFormat::CompressedSuffix);
+  if (!input.open(QIODevice::ReadOnly) ||
+      !output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+
+  while (!input.atEnd()) {
+    const QByteArray block =
+        qCompress(input.read(CaptureFormat::CompressedBlockSize));
+    uchar length[4];
+    qToLittleEndian<quint32>(static_cast<quint32>(block.size()), length);
+    if (output.write(reinterpret_cast<const char *>(length), 4) != 4 ||
+        output.write(block) != block.size()) {
+      output.remove();
+      return false;
+    }
+  }
+
+  output.close();
+  input.close();
+  return input.remove();
+}
+
+} // namespace
+
+LogWriter::LogWriter(QObject *parent)
+    : QObject(parent), m_thread(nullptr), m_stopping(true), m_failed(false),
+      m_file(nullptr), m_segmentIndex(0), m_segmentBytes(0),
+      m_segmentOpenedMs(0), m_segmentRecords(0), m_longestRecord(0),
+      m_bytesWritten(0), m_droppedBytes(0) {}
+
+LogWriter::~LogWriter() { stop(); }
+
+bool LogWriter::start(const Options &options) {
+  stop();
+
+  m_options = options;
+  m_segmentIndex = 0;
+  m_bytesWritten = 0;
+  m_droppedBytes = 0;
+  m_pending.clear();
+  m_pending.reserve(m_options.batchBytes * 2);
+  {
+    QMutexLocker locker(&m_mutex);
+    m_failed = false;
+    m_errorString.clear();
+  }
+
+  // The first segment is opened here so a bad path is reported to the caller
+  if (!openSegment()) {
+    emit errorOccurred(errorString());
+    return false;
+  }
+
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = false;
+  }
+  m_thread = QThread::create([this]() { run(); });
+  m_thread->setObjectName("LogWriter");
+  m_thread->start(QThread::LowPriority);
+  return true;
+}
+
+void LogWriter::stop() {
+  if (!m_thread) {
+    return;
+  }
+
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_wake.wakeOne();
+  }
+
+  // Waits for the final batch only; compression happens on the thread pool
+  m_thread->wait();
+  delete m_thread;
+  m_thread = nullptr;
+}
+
+bool LogWriter::isRunning() const { return m_thread != nullptr; }
+
+void LogWriter::write(CaptureFormat::Direction direction, qint64 timestampNs,
+                      const QByteArray &data) {
+  QMutexLocker locker(&m_mutex);
+  if (m_stopping) {
+    if (m_failed) {
+      m_droppedBytes.fetch_add(data.size(), std::memory_order_relaxed);
+    }
+    return;
+  }
+
+  if (m_pending.size() + data.size() > m_options.maxPendingBytes) {
+    m_droppedBytes.fetch_add(data.size(), std::memory_order_relaxed);
+    return;
+  }
+
+  CaptureFormat::appendRecord(m_pending, direction, timestampNs,
+                              data.constData(), data.size());
+  if (m_pending.size() >= m_options.batchBytes) {
+    m_wake.wakeOne();
+  }
+}
+
+quint64 LogWriter::bytesWritten() const {
+  return m_bytesWritten.load(std::memory_order_relaxed);
+}
+
+quint64 LogWriter::droppedBytes() const {
+  return m_droppedBytes.load(std::memory_order_relaxed);
+}
+
+bool LogWriter::hasFailed() const {
+  QMutexLocker locker(&m_mutex);
+  return m_failed;
+}
+
+QString LogWriter::errorString() const {
+  QMutexLocker locker(&m_mutex);
+  return m_errorString;
+}
+
+QString LogWriter::currentSegment() const {
+  QMutexLocker locker(&m_mutex);
+  return m_segmentPath;
+}
+
+void LogWriter::run() {
+  // Double-buffered: the producer fills m_pending while this thread writes
+  // the previous batch, and the two buffers trade places without
+  // reallocating.
+  QByteArray batch;
+  batch.reserve(m_options.batchBytes * 2);
+
+  bool stopping = false;
+  while (!stopping) {
+    {
+      QMutexLocker locker(&m_mutex);
+      if (!m_stopping && m_pending.size() < m_options.batchBytes) {
+        m_wake.wait(&m_mutex, m_options.flushIntervalMs);
+      }
+      m_pending.swap(batch);
+      stopping = m_stopping;
+    }
+
+    // Segments holding nothing but a header are never rotated away
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const bool sizeLimit =
+        m_options.maxSegmentBytes > 0 &&
+        m_segmentBytes + batch.size() > m_options.maxSegmentBytes;
+    const bool timeLimit =
+        m_options.maxSegmentSeconds > 0 &&
+        now - m_segmentOpenedMs >= m_options.maxSegmentSeconds * 1000LL;
+    if (m_segmentBytes > CaptureFormat::FileHeaderSize +
+                             m_options.metadata.size() &&
+        (sizeLimit || timeLimit)) {
+      closeSegment();
+      if (!openSegment()) {
+        m_droppedBytes.fetch_add(batch.size(), std::memory_order_relaxed);
+        fail(errorString());
+        break;
+      }
+    }
+
+    if (!batch.isEmpty()) {
+      // Batches only ever hold whole records, so rotation never splits one.
+      // Only what reached the file is indexed and counted.
+      const qint64 written = qMax<qint64>(0, m_file->write(batch));
+      indexBatch(batch, written);
+      m_segmentBytes += written;
+      m_bytesWritten.fetch_add(quint64(written), std::memory_order_relaxed);
+      if (written != batch.size()) {
+        m_droppedBytes.fetch_add(quint64(batch.size() - written),
+                                 std::memory_order_relaxed);
+        fail("Failed to write log: " + m_file->errorString());
+        break;
+      }
+    }
+    batch.resize(0);
+  }
+
+  closeSegment();
+}
+
+void LogWriter::fail(const QString &error) {
+  // Reported once: the thread ends and write() drops everything after it
+  {
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_failed = true;
+    m_errorString = error;
+    m_droppedBytes.fetch_add(m_pending.size(), std::memory_order_relaxed);
+    m_pending.clear();
+  }
+  emit errorOccurred(error);
+}
+
+void LogWriter::indexBatch(const QByteArray &batch, qsizetype written) {
+  const uchar *data = reinterpret_cast<const uchar *>(batch.constData());
+  qsizetype pos = 0;
+  while (pos + CaptureFormat::RecordHeaderSize <= written) {
+    const quint32 length = qFromLittleEndian<quint32>(data + pos);
+    if (pos + CaptureFormat::RecordHeaderSize + length > written) {
+      break;
+    }
+    if (m_segmentRecords % CaptureFormat::IndexInterval == 0) {
+      m_index.append({static_cast<quint64>(m_segmentBytes + pos),
+                      qFromLittleEndian<qint64>(data + pos + 8),
+                      m_segmentRecords});
+    }
+    ++m_segmentRecords;
+    m_longestRecord = qMax(m_longestRecord, length);
+    pos += CaptureFormat::RecordHeaderSize + length;
+  }
+}
+
+bool LogWriter::openSegment() {
+  const QString path = segmentPath(m_segmentIndex++);
+  // Unbuffered, so a write() that returns reports what is on disk
+  QFile *file = new QFile(path);
+  const QByteArray header =
+      CaptureFormat::fileHeader(currentTimeNs(), m_options.metadata);
+  if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate |
+                  QIODevice::Unbuffered) ||
+      file->write(header) != header.size()) {
+    QMutexLocker locker(&m_mutex);
+    m_errorString =
+        "Failed to open log file " + path + ": " + file->errorString();
+    delete file;
+    return false;
+  }
+
+  m_file = file;
+  m_segmentBytes = header.size();
+  m_segmentOpenedMs = QDateTime::currentMSecsSinceEpoch();
+  m_index.clear();
+  m_segmentRecords = 0;
+  m_longestRecord = 0;
+
+  QMutexLocker locker(&m_mutex);
+  m_segmentPath = path;
+  return true;
+}
+
+void LogWriter::closeSegment() {
+  if (!m_file) {
+    return;
+  }
+
+  const QString path = m_file->fileName();
+  m_file->write(CaptureFormat::indexRecord(m_index, m_segmentRecords,
+                                           m_longestRecord));
+  m_file->close();
+  delete m_file;
+  m_file = nullptr;
+  emit segmentClosed(path);
+
+  if (m_options.compressSegments) {
+    QThreadPool::globalInstance()->start([path]() { compressFile(path); });
+  }
+}
+
+QString LogWriter::segmentPath(int index) const {
+  if (m_options.maxSegmentBytes <= 0 && m_options.maxSegmentSeconds <= 0) {
+    return m_options.path;
+  }
+
+  // name.sfcap -> name_000.sfcap, name_001.sfcap, ...
+  const QFileInfo info(m_options.path);
+  QString name = info.completeBaseName() +
+                 QString("_%1").arg(index, 3, 10, QChar('0'));
+  if (!info.suffix().isEmpty()) {
+    name += "." + info.suffix();
+  }
+  return info.dir().filePath(name);
+}
@@ -0,0 +1,96 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <atomic>
+#include "captureformat.h"
+
+class QFile;
+class QThread;
+
+// Background log sink. write() only appends a framed record to an in-memory
+// batch; a dedicated thread writes batches to disk, rotates segments by size
+// or age and optionally compresses segments once they are closed. Each
+// segment ends with a sparse index so CaptureReader can seek in it. The
+// calling thread never waits on disk I/O.
+class LogWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        QString path;                          // First segment / base name
+        qint64 maxSegmentBytes = 0;            // 0 = no size rotation
+        int maxSegmentSeconds = 0;             // 0 = no time rotation
+        bool compressSegments = false;         // Compress closed segments
+        qsizetype batchBytes = 256 * 1024;     // Write once this much queued
+        int flushIntervalMs = 500;             // ...or this often
+        qsizetype maxPendingBytes = 64 * 1024 * 1024; // Drop beyond this
+        QByteArray metadata;                   // Stored in every header
+    };
+
+    explicit LogWriter(QObject *parent = nullptr);
+    ~LogWriter();
+
+    bool start(const Options &options);
+    void stop();
+    bool isRunning() const;
+
+    // Thread-safe, never blocks on disk
+    void write(CaptureFormat::Direction direction, qint64 timestampNs,
+               const QByteArray &data);
+
+    quint64 bytesWritten() const;   // Reached the disk
+    quint64 droppedBytes() const;
+    QString currentSegment() const;
+    // True once a write or a new segment failed; the writer has then stopped
+    // writing and drops further data until stop() and another start()
+    bool hasFailed() const;
+    QString errorString() const;
+
+signals:
+    // Emitted once per start(), from the writer thread unless start() itself
+    // fails
+    void errorOccurred(const QString &error);
+    void segmentClosed(const QString &path);
+
+private:
+    void run();
+    bool openSegment();
+    void fail(const QString &error);
+    // Indexes the records within the first written bytes of batch
+    void indexBatch(const QByteArray &batch, qsizetype written);
+    void closeSegment();
+    QString segmentPath(int index) const;
+
+    Options m_options;
+    QThread *m_thread;
+
+    // Shared with the writer thread, guarded by m_mutex
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QByteArray m_pending;
+    bool m_stopping;
+    bool m_failed;
+    QString m_errorString;
+    QString m_segmentPath;
+
+    // Writer thread only
+    QFile *m_file;
+    int m_segmentIndex;
+    qint64 m_segmentBytes;
+    qint64 m_segmentOpenedMs;
+    QVector<CaptureFormat::IndexEntry> m_index;
+    quint64 m_segmentRecords;
+    quint32 m_longestRecord;
+
+    std::atomic<quint64> m_bytesWritten;
+    std::atomic<quint64> m_droppedBytes;
+};
+
+#endif // LOGWRITER_H
@@ -1,9 +1,17 @@
+#include "headlesscapture.h"
 #include "mainwindow.h"
 #include <QApplication>
 #include <QFile>
 #include <QTextStream>
 
 int main(int argc, char *argv[]) {
+  // Headless capture must decide before any QApplication exists
+  for (int i = 1; i < argc; ++i) {
+    if (qstrcmp(argv[i], "--headless") == 0) {
+      return runHeadless(argc, argv);
+    }
+  }
+
   QApplication app(argc, argv);
 
   // Set application metadata
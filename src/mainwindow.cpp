@@ -1,29 +1,94 @@
 #include "mainwindow.h"
+#include "capturewindow.h"
+#include "filetransfer.h"
+#include "hexview.h"
+#include "multiportwindow.h"
+#include "packetview.h"
+#include "plotterwindow.h"
+#include "portbridge.h"
+#include "portwatcher.h"
+#include "scriptengine.h"
+#include "searchbar.h"
+#include "serialclock.h"
+#include "serialtransport.h"
 #include "settingsdialog.h"
+#include "statisticspanel.h"
+#include "triggercapture.h"
 #include "ui_mainwindow.h"
 #include <QAction>
 #include <QActionGroup>
 #include <QDateTime>
+#include <QDir>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QGroupBox>
+#include <QFileInfo>
 #include <QHBoxLayout>
+#include <QInputDialog>
 #include <QKeySequence>
 #include <QMenuBar>
 #include <QMessageBox>
-#include <QScrollBar>
+#include <QProgressDialog>
 #include <QSettings>
+#include <QSignalBlocker>
 #include <QStatusBar>
 #include <QVBoxLayout>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow),
-      m_serialPortManager(new SerialPortManager(this)), m_hexDisplay(false),
-      m_autoScroll(true), m_showTimestamp(true), m_isLogging(false),
+      m_serialPortManager(new SerialPortManager(this)),
+      m_rxCoalescer(new RxCoalescer(this)), m_reportedFrameErrors(0),
+      m_hexDisplay(false), m_autoScroll(true), m_showTimestamp(true),
+      m_refreshRate(RxCoalescer::DefaultFlushRate), m_isLogging(false),
       m_lineEnding("LF") // Default to LF (Line Feed)
       ,
-      m_logFile(nullptr), m_logStream(nullptr), m_dataBits(QSerialPort::Data8),
-      m_stopBits(QSerialPort::OneStop), m_parity(QSerialPort::NoParity) {
+      m_logSegmentMegabytes(0), m_logSegmentMinutes(0), m_logCompress(false),
+      m_logWriter(new LogWriter(this)), m_dataBits(QSerialPort::Data8),
+      m_stopBits(QSerialPort::OneStop), m_parity(QSerialPort::NoParity),
+      m_threadedIo(false), m_autoReconnect(true),
+      m_portWatcher(new PortWatcher(this)), m_multiPortWindow(nullptr),
+      m_plotterWindow(nullptr),
+      m_fileTransfer(new FileTransfer(m_serialPortManager, this)),
+      m_scriptEngine(new ScriptEngine(m_serialPortManager, this)),
+      m_portBridge(new PortBridge(m_serialPortManager, this)),
+      m_triggerCapture(new TriggerCapture(this)) {
   ui->setupUi(this);
+  ui->portComboBox->setEditable(true);
+  ui->outputView->setSource(&m_consoleBuffer);
+  ui->searchBar->setView(ui->outputView, &m_consoleBuffer);
+
+  // Port statistics, docked on the right when opened from the Tools menu
+  m_statisticsDock = new QDockWidget("Port Statistics", this);
+  m_statisticsDock->setObjectName("statisticsDock");
+  m_statisticsDock->setWidget(
+      new StatisticsPanel(m_serialPortManager, m_statisticsDock));
+  addDockWidget(Qt::RightDockWidgetArea, m_statisticsDock);
+  m_statisticsDock->hide();
+  m_serialPortManager->setStatisticsInterval(StatisticsIntervalMs);
+
+  // Hex inspector over the console history, rendered only while visible
+  m_hexInspectorDock = new QDockWidget("Hex Inspector", this);
+  m_hexInspectorDock->setObjectName("hexInspectorDock");
+  m_hexView = new HexView(m_hexInspectorDock);
+  m_hexView->setSource(&m_consoleBuffer);
+  m_hexInspectorDock->setWidget(m_hexView);
+  addDockWidget(Qt::BottomDockWidgetArea, m_hexInspectorDock);
+  m_hexInspectorDock->hide();
+  connect(m_hexInspectorDock, &QDockWidget::visibilityChanged, m_hexView,
+          [this](bool visible) {
+            if (visible) {
+              m_hexView->refresh();
+            }
+          });
+
+  // Packet dissector, fed only while open and once a layout is loaded
+  m_packetDock = new QDockWidget("Packets", this);
+  m_packetDock->setObjectName("packetDock");
+  m_packetView = new PacketView(m_packetDock);
+  m_packetDock->setWidget(m_packetView);
+  addDockWidget(Qt::RightDockWidgetArea, m_packetDock);
+  m_packetDock->hide();
+
   createMenuBar();
   createStatusBar();
 
@@ -48,15 +113,86 @@ MainWindow::MainWindow(QWidget *parent)
 
   loadSettings();
   updateLineEndingMenu(); // Update menu to reflect loaded settings
+  applyDisplaySettings();
+  applyFraming();
   applyShortcuts();
+  m_serialPortManager->setTxOptions(m_txOptions);
+  m_serialPortManager->setAutoReconnect(m_autoReconnect);
+
+  // The port list follows devices as they are plugged in and removed
+  connect(m_portWatcher, &PortWatcher::portsChanged, this,
+          &MainWindow::refreshPorts);
 
   // Connect signals
-  connect(m_serialPortManager, &SerialPortManager::dataReceived, this,
-          &MainWindow::onDataReceived);
+  connect(m_serialPortManager, &SerialPortManager::chunkReceived, this,
+          &MainWindow::onChunkReceived);
+  connect(m_serialPortManager, &SerialPortManager::chunkReceived,
+          m_rxCoalescer, &RxCoalescer::addChunk);
+  connect(m_logWriter, &LogWriter::errorOccurred, this,
+          [this](const QString &error) {
+            // The writer has given up; leave the logging state with it
+            if (m_isLogging && m_logWriter->hasFailed()) {
+              m_logWriter->stop();
+              m_isLogging = false;
+              QMessageBox::critical(this, "Logging Error",
+                                    error + "\n\nLogging has stopped.");
+            }
+          });
+  connect(m_rxCoalescer, &RxCoalescer::chunksReady, this,
+          &MainWindow::onChunksReceived);
+  connect(m_rxCoalescer, &RxCoalescer::flushed, this,
+          &MainWindow::onRxFlushed);
   connect(m_serialPortManager, &SerialPortManager::connectionStatusChanged,
           this, &MainWindow::onConnectionStatusChanged);
   connect(m_serialPortManager, &SerialPortManager::errorOccurred, this,
           &MainWindow::onErrorOccurred);
+  connect(m_serialPortManager, &SerialPortManager::rxOverrun, this,
+          &MainWindow::onRxOverrun);
+  connect(m_serialPortManager, &SerialPortManager::txQueueChanged, this,
+          &MainWindow::onTxQueueChanged);
+  connect(m_serialPortManager, &SerialPortManager::statisticsUpdated, this,
+          &MainWindow::onStatisticsUpdated);
+  connect(m_serialPortManager, &SerialPortManager::reconnectStateChanged,
+          this, &MainWindow::onReconnectStateChanged);
+  connect(m_serialPortManager, &SerialPortManager::reconnected, this,
+          &MainWindow::onReconnected);
+  connect(m_scriptEngine, &ScriptEngine::message, this,
+          [this](const QString &text) {
+            appendToConsole(ConsoleBuffer::Info, text.toUtf8());
+          });
+  connect(m_scriptEngine, &ScriptEngine::finished, this,
+          [this](bool success, const QString &message) {
+            Q_UNUSED(success);
+            m_stopScriptAction->setEnabled(false);
+            appendToConsole(ConsoleBuffer::Info,
+                            QString("Script: %1").arg(message).toUtf8());
+            statusBar()->showMessage("Script: " + message, 5000);
+          });
+  connect(m_portBridge, &PortBridge::clientsChanged, this, [this](int count) {
+    statusBar()->showMessage(QString("Network clients: %1").arg(count), 3000);
+  });
+  connect(m_serialPortManager, &SerialPortManager::errorOccurred,
+          m_triggerCapture, &TriggerCapture::reportError);
+  connect(m_triggerCapture, &TriggerCapture::triggered, this,
+          [this](const QString &reason) {
+            m_rxCoalescer->flush();
+            appendToConsole(ConsoleBuffer::Info,
+                            ("Trigger: " + reason).toUtf8());
+          });
+  connect(m_triggerCapture, &TriggerCapture::captureSaved, this,
+          [this](const QString &path) {
+            appendToConsole(ConsoleBuffer::Info,
+                            ("Trigger capture saved to " + path).toUtf8());
+            // The last of a limited number of captures disarms the trigger
+            if (!m_triggerCapture->isArmed()) {
+              const QSignalBlocker blocker(m_triggerAction);
+              m_triggerAction->setChecked(false);
+            }
+          });
+  connect(m_triggerCapture, &TriggerCapture::errorOccurred, this,
+          [this](const QString &error) {
+            statusBar()->showMessage(error, 5000);
+          });
 
   // Initial port refresh
   refreshPorts();
@@ -83,6 +219,11 @@ void MainWindow::createMenuBar() {
           &MainWindow::toggleLogging);
   fileMenu->addAction(startLoggingAction);
 
+  QAction *openCaptureAction = new QAction("&Open Capture...", this);
+  connect(openCaptureAction, &QAction::triggered, this,
+          &MainWindow::openCapture);
+  fileMenu->addAction(openCaptureAction);
+
   fileMenu->addSeparator();
 
   // Line Ending submenu
@@ -138,6 +279,27 @@ void MainWindow::createMenuBar() {
   connect(exitAction, &QAction::triggered, this, &QWidget::close);
   fileMenu->addAction(exitAction);
 
+  // Edit menu
+  QMenu *editMenu = menuBar->addMenu("&Edit");
+
+  QAction *findAction = new QAction("&Find...", this);
+  findAction->setShortcut(QKeySequence::Find);
+  connect(findAction, &QAction::triggered, ui->searchBar,
+          &SearchBar::focusSearch);
+  editMenu->addAction(findAction);
+
+  QAction *findNextAction = new QAction("Find &Next", this);
+  findNextAction->setShortcut(QKeySequence::FindNext);
+  connect(findNextAction, &QAction::triggered, ui->searchBar,
+          &SearchBar::findNext);
+  editMenu->addAction(findNextAction);
+
+  QAction *findPreviousAction = new QAction("Find &Previous", this);
+  findPreviousAction->setShortcut(QKeySequence::FindPrevious);
+  connect(findPreviousAction, &QAction::triggered, ui->searchBar,
+          &SearchBar::findPrevious);
+  editMenu->addAction(findPreviousAction);
+
   // Tools menu
   QMenu *toolsMenu = menuBar->addMenu("&Tools");
 
@@ -146,6 +308,67 @@ void MainWindow::createMenuBar() {
   connect(settingsAction, &QAction::triggered, this, &MainWindow::openSettings);
   toolsMenu->addAction(settingsAction);
 
+  QAction *multiPortAction = new QAction("&Multi-Port Monitor...", this);
+  connect(multiPortAction, &QAction::triggered, this, [this]() {
+    if (!m_multiPortWindow) {
+      m_multiPortWindow = new MultiPortWindow(this);
+    }
+    m_multiPortWindow->setConnectionSettings(m_dataBits, m_stopBits,
+                                             m_parity);
+    m_multiPortWindow->show();
+    m_multiPortWindow->raise();
+    m_multiPortWindow->activateWindow();
+  });
+  toolsMenu->addAction(multiPortAction);
+
+  QAction *plotterAction = new QAction("&Plotter...", this);
+  connect(plotterAction, &QAction::triggered, this, [this]() {
+    if (!m_plotterWindow) {
+      m_plotterWindow = new PlotterWindow(this);
+    }
+    m_plotterWindow->show();
+    m_plotterWindow->raise();
+    m_plotterWindow->activateWindow();
+  });
+  toolsMenu->addAction(plotterAction);
+
+  QAction *sendFileAction = new QAction("Send &File...", this);
+  connect(sendFileAction, &QAction::triggered, this, &MainWindow::sendFile);
+  toolsMenu->addAction(sendFileAction);
+
+  QAction *runScriptAction = new QAction("Run S&cript...", this);
+  connect(runScriptAction, &QAction::triggered, this, &MainWindow::runScript);
+  toolsMenu->addAction(runScriptAction);
+
+  m_stopScriptAction = new QAction("S&top Script", this);
+  m_stopScriptAction->setEnabled(false);
+  connect(m_stopScriptAction, &QAction::triggered, m_scriptEngine,
+          &ScriptEngine::stop);
+  toolsMenu->addAction(m_stopScriptAction);
+
+  m_shareAction = new QAction("Share Port on &Network...", this);
+  m_shareAction->setCheckable(true);
+  connect(m_shareAction, &QAction::toggled, this, &MainWindow::toggleSharing);
+  toolsMenu->addAction(m_shareAction);
+
+  m_triggerAction = new QAction("T&rigger Capture...", this);
+  m_triggerAction->setCheckable(true);
+  connect(m_triggerAction, &QAction::toggled, this,
+          &MainWindow::toggleTriggerCapture);
+  toolsMenu->addAction(m_triggerAction);
+
+  QAction *statisticsAction = m_statisticsDock->toggleViewAction();
+  statisticsAction->setText("Port &Statistics");
+  toolsMenu->addAction(statisticsAction);
+
+  QAction *hexInspectorAction = m_hexInspectorDock->toggleViewAction();
+  hexInspectorAction->setText("&Hex Inspector");
+  toolsMenu->addAction(hexInspectorAction);
+
+  QAction *packetAction = m_packetDock->toggleViewAction();
+  packetAction->setText("P&acket Dissector");
+  toolsMenu->addAction(packetAction);
+
   // Help menu
   QMenu *helpMenu = menuBar->addMenu("&Help");
 
@@ -175,6 +398,23 @@ void MainWindow::createStatusBar() {
   m_connectionStatusIcon->setFixedSize(16, 16);
   statusBar->addPermanentWidget(m_connectionStatusIcon);
 
+  // Chunks merged into the last display update
+  m_rxBatchLabel = new QLabel(this);
+  m_rxBatchLabel->setToolTip("RX chunks merged into the last display update");
+  statusBar->addPermanentWidget(m_rxBatchLabel);
+
+  // Bytes waiting to be sent; hidden while the queue is empty
+  m_txQueueLabel = new QLabel(this);
+  m_txQueueLabel->setToolTip("Bytes queued for transmission");
+  m_txQueueLabel->hide();
+  statusBar->addPermanentWidget(m_txQueueLabel);
+
+  // Throughput over the last statistics interval
+  m_rateLabel = new QLabel(this);
+  m_rateLabel->setToolTip("Tools > Port Statistics for details");
+  m_rateLabel->hide();
+  statusBar->addPermanentWidget(m_rateLabel);
+
   // Status label
   m_statusLabel = new QLabel("Disconnected", this);
   statusBar->addPermanentWidget(m_statusLabel);
@@ -184,20 +424,19 @@ void MainWindow::refreshPorts() {
   QString currentPort = ui->portComboBox->currentText();
   ui->portComboBox->clear();
 
+  // The simulated device is always there, so the app can be tried and
+  // load-tested without hardware; options are typed after "sim:"
   QStringList ports = m_serialPortManager->getAvailablePortNames();
+  ports.append("sim");
+  ui->portComboBox->addItems(ports);
+  ui->connectButton->setEnabled(true);
 
-  if (ports.isEmpty()) {
-    ui->portComboBox->addItem("No ports available");
-    ui->connectButton->setEnabled(false);
-  } else {
-    ui->portComboBox->addItems(ports);
-    ui->connectButton->setEnabled(true);
-
-    // Try to restore previous selection
-    int index = ui->portComboBox->findText(currentPort);
-    if (index >= 0) {
-      ui->portComboBox->setCurrentIndex(index);
-    }
+  // Try to restore previous selection
+  int index = ui->portComboBox->findText(currentPort);
+  if (index >= 0) {
+    ui->portComboBox->setCurrentIndex(index);
+  } else if (SerialTransport::isSimulated(currentPort)) {
+    ui->portComboBox->setEditText(currentPort);
   }
 }
 
@@ -208,15 +447,16 @@ void MainWindow::toggleConnection() {
     QString portName = ui->portComboBox->currentText();
     qint32 baudRate = ui->baudRateComboBox->currentText().toInt();
 
+    // A new connection starts a new stream
+    applyFraming();
+    m_serialPortManager->setThreadedIo(m_threadedIo);
     if (m_serialPortManager->openPort(portName, baudRate, m_dataBits,
                                       m_stopBits, m_parity)) {
-      // Use green color for successful connection
-      ui->outputTextEdit->append(
-          QString("<span style='color: #16a34a;'>[%1] Connected to %2 at %3 "
-                  "baud</span>")
-              .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
-              .arg(portName)
-              .arg(baudRate));
+      appendToConsole(ConsoleBuffer::Info,
+                      QString("Connected to %1 at %2 baud")
+                          .arg(portName)
+                          .arg(baudRate)
+                          .toUtf8());
     }
   }
 }
@@ -245,57 +485,261 @@ void MainWindow::sendData() {
 
   if (m_serialPortManager->sendText(text)) {
     ui->inputLineEdit->clear();
+    const QByteArray data = text.toUtf8();
+    const qint64 timestamp = SerialClock::toEpochNs(SerialClock::nowNs());
+    m_consoleBuffer.append(ConsoleBuffer::Tx, data, timestamp);
+    refreshOutput();
+    logData(CaptureFormat::Tx, timestamp, data);
+  }
+}
 
-    // Use blue color for TX
-    if (m_showTimestamp) {
-      ui->outputTextEdit->append(
-          QString("<span style='color: #2563eb;'>[%1] TX: %2</span>")
-              .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
-              .arg(text.trimmed()));
-    } else {
-      ui->outputTextEdit->append(
-          QString("<span style='color: #2563eb;'>TX: %1</span>")
-              .arg(text.trimmed()));
-    }
+void MainWindow::sendFile() {
+  if (!m_serialPortManager->isOpen()) {
+    QMessageBox::warning(this, "Not Connected",
+                         "Please connect to a serial port first.");
+    return;
+  }
+  if (m_fileTransfer->isActive()) {
+    QMessageBox::information(this, "Send File",
+                             "A file transfer is already in progress.");
+    return;
   }
+
+  const QString path = QFileDialog::getOpenFileName(this, "Send File");
+  if (path.isEmpty()) {
+    return;
+  }
+
+  const QStringList protocols = {
+      FileTransfer::protocolName(FileTransfer::Raw),
+      FileTransfer::protocolName(FileTransfer::Xmodem1k),
+      FileTransfer::protocolName(FileTransfer::Ymodem)};
+  bool ok = false;
+  const QString choice = QInputDialog::getItem(
+      this, "Send File", "Protocol:", protocols, 0, false, &ok);
+  if (!ok) {
+    return;
+  }
+  const auto protocol =
+      static_cast<FileTransfer::Protocol>(protocols.indexOf(choice));
+
+  // Non-modal so the console keeps showing what the device answers
+  const QString fileName = QFileInfo(path).fileName();
+  QProgressDialog *progress =
+      new QProgressDialog(fileName, "Cancel", 0, 1000, this);
+  progress->setWindowTitle("Send File");
+  progress->setAttribute(Qt::WA_DeleteOnClose);
+  progress->setAutoClose(false);
+  progress->setAutoReset(false);
+  progress->setMinimumDuration(0);
+  connect(progress, &QProgressDialog::canceled, m_fileTransfer,
+          &FileTransfer::cancel);
+  connect(m_fileTransfer, &FileTransfer::progress, progress,
+          [progress, fileName](qint64 done, qint64 total, double rate) {
+            progress->setValue(total > 0 ? int(done * 1000 / total) : 1000);
+            progress->setLabelText(QString("%1: %2 of %3 KB at %4 KB/s")
+                                       .arg(fileName)
+                                       .arg(done / 1024)
+                                       .arg(total / 1024)
+                                       .arg(rate / 1024, 0, 'f', 1));
+          });
+  connect(m_fileTransfer, &FileTransfer::finished, progress,
+          [this, progress, fileName](bool success, const QString &message) {
+            appendToConsole(ConsoleBuffer::Info,
+                            QString("File transfer %1: %2")
+                                .arg(fileName, message)
+                                .toUtf8());
+            if (!success) {
+              statusBar()->showMessage(message, 5000);
+            }
+            progress->close();
+          });
+  progress->show();
+
+  appendToConsole(ConsoleBuffer::Info,
+                  QString("Sending %1 (%2)")
+                      .arg(fileName, FileTransfer::protocolName(protocol))
+                      .toUtf8());
+  m_fileTransfer->start(path, protocol);
 }
 
-void MainWindow::onDataReceived(const QByteArray &data) {
-  QString formattedData = formatData(data);
+void MainWindow::runScript() {
+  if (!m_serialPortManager->isOpen()) {
+    QMessageBox::warning(this, "Not Connected",
+                         "Please connect to a serial port first.");
+    return;
+  }
+  if (m_scriptEngine->isRunning()) {
+    QMessageBox::information(this, "Run Script",
+                             "A script is already running.");
+    return;
+  }
 
-  // Replace newlines with <br> for HTML display
-  formattedData.replace("\r\n", "<br>");
-  formattedData.replace("\n", "<br>");
-  formattedData.replace("\r", "<br>");
+  const QString path = QFileDialog::getOpenFileName(
+      this, "Run Script", QString(), "Scripts (*.txt *.sfs);;All Files (*)");
+  if (path.isEmpty()) {
+    return;
+  }
+  if (!m_scriptEngine->loadFile(path)) {
+    QMessageBox::warning(this, "Run Script", m_scriptEngine->errorString());
+    return;
+  }
 
-  // Use green color for RX
-  if (m_showTimestamp) {
-    QString timestamp = QDateTime::currentDateTime().toString("HH:mm:ss");
-    formattedData = QString("<span style='color: #16a34a;'>[%1] RX: %2</span>")
-                        .arg(timestamp)
-                        .arg(formattedData);
-  } else {
-    formattedData = QString("<span style='color: #16a34a;'>RX: %1</span>")
-                        .arg(formattedData);
+  appendToConsole(ConsoleBuffer::Info,
+                  QString("Running script %1")
+                      .arg(QFileInfo(path).fileName())
+                      .toUtf8());
+  if (!m_scriptEngine->start()) {
+    QMessageBox::warning(this, "Run Script", m_scriptEngine->errorString());
+    return;
   }
+  m_stopScriptAction->setEnabled(m_scriptEngine->isRunning());
+}
 
-  // Smart Autoscroll Logic
-  QScrollBar *scrollBar = ui->outputTextEdit->verticalScrollBar();
-  bool atBottom = (scrollBar->value() == scrollBar->maximum());
+void MainWindow::toggleSharing(bool enabled) {
+  if (!enabled) {
+    m_portBridge->stop();
+    statusBar()->showMessage("Stopped sharing the port", 3000);
+    return;
+  }
 
-  ui->outputTextEdit->append(formattedData);
+  bool ok = false;
+  const int port = QInputDialog::getInt(
+      this, "Share Port on Network",
+      "TCP/UDP port on localhost (RFC 2217 uses the next one):", 7000, 1,
+      65534, 1, &ok);
+  const QHostAddress address(QHostAddress::LocalHost);
+  if (!ok || !m_portBridge->listenTcp(PortBridge::RawTcp, address, port) ||
+      !m_portBridge->listenTcp(PortBridge::Rfc2217, address, port + 1) ||
+      !m_portBridge->listenUdp(address, port)) {
+    if (ok) {
+      QMessageBox::warning(this, "Share Port on Network",
+                           m_portBridge->errorString());
+    }
+    m_portBridge->stop();
+    const QSignalBlocker blocker(m_shareAction);
+    m_shareAction->setChecked(false);
+    return;
+  }
 
-  if (m_autoScroll && atBottom) {
-    scrollBar->setValue(scrollBar->maximum());
+  appendToConsole(ConsoleBuffer::Info,
+                  QString("Sharing port on localhost: raw TCP and UDP %1, "
+                          "RFC 2217 %2")
+                      .arg(port)
+                      .arg(port + 1)
+                      .toUtf8());
+}
+
+void MainWindow::toggleTriggerCapture(bool enabled) {
+  if (!enabled) {
+    m_triggerCapture->stop();
+    statusBar()->showMessage("Trigger capture stopped", 3000);
+    return;
   }
 
-  if (m_isLogging) {
-    logData(formattedData);
+  bool ok = false;
+  const QString spec = QInputDialog::getText(
+      this, "Trigger Capture",
+      "Trigger (pattern=HEX, regex=EXPR, silence=MS or error) and window\n"
+      "(before=SIZE, after=SIZE as 64K or 10s; dir=PATH, count=N):",
+      QLineEdit::Normal, m_triggerSpec, &ok);
+  TriggerCapture::Options options;
+  QString error;
+  if (ok && TriggerCapture::parseOptions(spec, options, error)) {
+    // Next to the log unless a directory is given
+    if (options.directory == TriggerCapture::Options().directory) {
+      options.directory = QFileInfo(m_logFilePath).path();
+    }
+    options.metadata = captureMetadata();
+    if (!m_triggerCapture->start(options)) {
+      error = m_triggerCapture->errorString();
+    }
+  }
+  if (!ok || !error.isEmpty()) {
+    if (ok) {
+      QMessageBox::warning(this, "Trigger Capture", error);
+    }
+    const QSignalBlocker blocker(m_triggerAction);
+    m_triggerAction->setChecked(false);
+    return;
+  }
+
+  m_triggerSpec = spec;
+  appendToConsole(ConsoleBuffer::Info,
+                  QString("Trigger armed, captures go to %1")
+                      .arg(QDir::toNativeSeparators(
+                          QDir(options.directory).absolutePath()))
+                      .toUtf8());
+}
+
+void MainWindow::onChunkReceived(const SerialChunk &chunk) {
+  // Logged as it arrives; display goes through the coalescer
+  logData(CaptureFormat::Rx, SerialClock::toEpochNs(chunk.timestamp),
+          chunk.data);
+}
+
+void MainWindow::onChunksReceived(const QList<SerialChunk> &chunks) {
+  // The view keeps raw bytes and formats only what is on screen, so the
+  // whole batch costs a single repaint. Rows keep the time each chunk was
+  // read, not the time of the batch.
+  if (m_plotterWindow) {
+    m_plotterWindow->addChunks(chunks);
+  }
+  m_packetView->addChunks(chunks);
+  if (!m_frameDecoder) {
+    for (const SerialChunk &chunk : chunks) {
+      m_consoleBuffer.append(ConsoleBuffer::Rx, chunk.data,
+                             SerialClock::toEpochNs(chunk.timestamp));
+    }
+    refreshOutput();
+    reportDisplayed(chunks);
+    return;
+  }
+
+  // One row per complete frame, however the driver split the bytes. A
+  // frame is stamped with the read that completed it.
+  QList<FrameDecoder::Frame> frames;
+  for (const SerialChunk &chunk : chunks) {
+    m_frameDecoder->feed(chunk.data, frames);
+    const qint64 timestamp = SerialClock::toEpochNs(chunk.timestamp);
+    for (const FrameDecoder::Frame &frame : std::as_const(frames)) {
+      m_consoleBuffer.appendFrame(ConsoleBuffer::Rx, frame.payload, timestamp);
+    }
+    frames.clear();
+  }
+  refreshOutput();
+  reportDisplayed(chunks);
+
+  const quint64 errors = m_frameDecoder->errorCount();
+  if (errors != m_reportedFrameErrors) {
+    m_reportedFrameErrors = errors;
+    statusBar()->showMessage(
+        QString("Frame decoder: %1 malformed frame(s) dropped").arg(errors),
+        3000);
+  }
+}
+
+void MainWindow::reportDisplayed(const QList<SerialChunk> &chunks) {
+  for (const SerialChunk &chunk : chunks) {
+    m_serialPortManager->reportDisplayed(chunk.timestamp);
   }
 }
 
+void MainWindow::onRxFlushed(int mergedChunks) {
+  m_rxBatchLabel->setText(
+      QString("RX batch: %1 (max %2)")
+          .arg(mergedChunks)
+          .arg(m_rxCoalescer->maxMergeCount()));
+}
+
 void MainWindow::onConnectionStatusChanged(bool connected) {
+  // Keep status lines in order with data still waiting for the next frame
+  m_rxCoalescer->flush();
   updateConnectionStatus();
+  if (m_plotterWindow) {
+    m_plotterWindow->resetLine();
+  }
+  m_packetView->resetStream();
 
   // Update dynamic property for styling
   ui->connectButton->setProperty("connected", connected);
@@ -320,35 +764,101 @@ void MainWindow::onConnectionStatusChanged(bool connected) {
     ui->inputLineEdit->setEnabled(false);
     ui->sendButton->setEnabled(false);
 
-    ui->outputTextEdit->append(
-        QString("<span style='color: red;'>[%1] Disconnected</span>")
-            .arg(QDateTime::currentDateTime().toString("HH:mm:ss")));
+    appendToConsole(ConsoleBuffer::Error, "Disconnected");
   }
 }
 
 void MainWindow::onErrorOccurred(const QString &error) {
-  ui->outputTextEdit->append(
-      QString("<span style='color: red;'>[%1] Error: %2</span>")
-          .arg(QDateTime::currentDateTime().toString("HH:mm:ss"))
-          .arg(error));
+  m_rxCoalescer->flush();
+  appendToConsole(ConsoleBuffer::Error, ("Error: " + error).toUtf8());
 
+  // A device that resets will be reopened; do not stop for a dialog
+  if (m_serialPortManager->isOpen() && m_serialPortManager->autoReconnect()) {
+    statusBar()->showMessage(error, 5000);
+    return;
+  }
   QMessageBox::critical(this, "Serial Port Error", error);
 }
 
-void MainWindow::clearOutput() { ui->outputTextEdit->clear(); }
+void MainWindow::onReconnectStateChanged(bool reconnecting) {
+  updateConnectionStatus();
+  if (reconnecting) {
+    // Whatever the device sent before it went away will not be completed
+    applyFraming();
+    appendToConsole(ConsoleBuffer::Info,
+                    QString("Waiting for %1 to come back")
+                        .arg(m_serialPortManager->getCurrentPortName())
+                        .toUtf8());
+  }
+}
+
+void MainWindow::onReconnected(qint64 downtimeMs) {
+  appendToConsole(ConsoleBuffer::Info,
+                  QString("Reconnected to %1 after %2 ms")
+                      .arg(m_serialPortManager->getCurrentPortName())
+                      .arg(downtimeMs)
+                      .toUtf8());
+}
+
+void MainWindow::onRxOverrun(quint64 totalDroppedBytes) {
+  statusBar()->showMessage(
+      QString("RX overrun: %1 bytes dropped").arg(totalDroppedBytes), 3000);
+  m_triggerCapture->reportError(
+      QString("RX overrun, %1 bytes dropped").arg(totalDroppedBytes));
+}
+
+void MainWindow::onStatisticsUpdated(const PortStatistics &stats) {
+  m_rateLabel->setText(
+      QString("RX %1  TX %2")
+          .arg(StatisticsPanel::formatRate(stats.rxBytesPerSecond))
+          .arg(StatisticsPanel::formatRate(stats.txBytesPerSecond)));
+  m_rateLabel->setVisible(m_serialPortManager->isOpen());
+}
+
+void MainWindow::onTxQueueChanged(qint64 queuedBytes) {
+  m_txQueueLabel->setText(QString("TX queued: %1 bytes").arg(queuedBytes));
+  m_txQueueLabel->setVisible(queuedBytes > 0);
+}
+
+void MainWindow::clearOutput() {
+  m_consoleBuffer.clear();
+  ui->outputView->clearSelection();
+  m_hexView->clearSelection();
+  refreshOutput();
+}
+
+void MainWindow::appendToConsole(ConsoleBuffer::Direction direction,
+                                 const QByteArray &data) {
+  m_consoleBuffer.append(direction, data,
+                         SerialClock::toEpochNs(SerialClock::nowNs()));
+  refreshOutput();
+}
+
+void MainWindow::refreshOutput() {
+  // Indexes the new records for search, then repaints
+  ui->searchBar->sourceChanged();
+  if (m_hexInspectorDock->isVisible()) {
+    m_hexView->refresh();
+  }
+}
+
+void MainWindow::applyDisplaySettings() {
+  ui->outputView->setHexMode(m_hexDisplay);
+  ui->outputView->setAutoScroll(m_autoScroll);
+  m_hexView->setAutoScroll(m_autoScroll);
+  ui->outputView->setShowTimestamp(m_showTimestamp);
+  m_rxCoalescer->setFlushRate(m_refreshRate);
+}
+
+void MainWindow::applyFraming() {
+  m_frameDecoder = FrameDecoder::create(m_framing);
+  m_reportedFrameErrors = 0;
+}
 
 void MainWindow::toggleLogging() {
   if (m_isLogging) {
     // Stop logging
-    if (m_logStream) {
-      delete m_logStream;
-      m_logStream = nullptr;
-    }
-    if (m_logFile) {
-      m_logFile->close();
-      delete m_logFile;
-      m_logFile = nullptr;
-    }
+    m_logWriter->stop();
     m_isLogging = false;
     statusBar()->showMessage("Logging stopped", 3000);
   } else {
@@ -356,33 +866,57 @@ void MainWindow::toggleLogging() {
     QString fileName = QFileDialog::getSaveFileName(
         this, "Select Log File",
         QDateTime::currentDateTime().toString(
-            "'SerialFlow_'yyyyMMdd_HHmmss'.log'"),
-        "Log Files (*.log);;Text Files (*.txt);;All Files (*)");
+            "'SerialFlow_'yyyyMMdd_HHmmss'.sfcap'"),
+        "SerialFlow Captures (*.sfcap);;All Files (*)");
 
     if (!fileName.isEmpty()) {
-      m_logFile = new QFile(fileName);
-      if (m_logFile->open(QIODevice::WriteOnly | QIODevice::Append |
-                          QIODevice::Text)) {
-        m_logStream = new QTextStream(m_logFile);
+      LogWriter::Options options;
+      options.path = fileName;
+      options.maxSegmentBytes = m_logSegmentMegabytes * 1024LL * 1024LL;
+      options.maxSegmentSeconds = m_logSegmentMinutes * 60;
+      options.compressSegments = m_logCompress;
+      options.metadata = CaptureFormat::encodeMetadata(captureMetadata());
+
+      if (m_logWriter->start(options)) {
         m_logFilePath = fileName;
         m_isLogging = true;
         statusBar()->showMessage("Logging to: " + fileName, 3000);
-
-        m_logStream->operator<<(
-            "=== SerialFlow Log Started: " +
-            QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") +
-            " ===\n");
-        m_logStream->flush();
       } else {
         QMessageBox::critical(this, "Logging Error",
-                              "Failed to open log file for writing.");
-        delete m_logFile;
-        m_logFile = nullptr;
+                              m_logWriter->errorString());
       }
     }
   }
 }
 
+void MainWindow::openCapture() {
+  QString fileName = QFileDialog::getOpenFileName(
+      this, "Open Capture", QFileInfo(m_logFilePath).path(),
+      "SerialFlow Captures (*.sfcap *.sfcap.qz);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+
+  CaptureWindow *window = new CaptureWindow(m_serialPortManager, this);
+  window->setAttribute(Qt::WA_DeleteOnClose);
+  if (!window->open(fileName)) {
+    QMessageBox::critical(this, "Capture Error", window->errorString());
+    delete window;
+    return;
+  }
+
+  // A replay into the console goes through the same path as live data
+  connect(window, &CaptureWindow::recordReplayed, this,
+          [this](ConsoleSource::Direction direction, const QByteArray &data) {
+            if (direction == ConsoleSource::Rx) {
+              m_rxCoalescer->addChunk(SerialChunk{data, SerialClock::nowNs()});
+            } else {
+              appendToConsole(ConsoleBuffer::Tx, data);
+            }
+          });
+  window->show();
+}
+
 void MainWindow::openSettings() {
   SettingsDialog dialog(this);
 
@@ -390,9 +924,17 @@ void MainWindow::openSettings() {
   dialog.setHexDisplay(m_hexDisplay);
   dialog.setAutoScroll(m_autoScroll);
   dialog.setShowTimestamp(m_showTimestamp);
+  dialog.setRefreshRate(m_refreshRate);
   dialog.setDataBits(m_dataBits);
   dialog.setStopBits(m_stopBits);
   dialog.setParity(m_parity);
+  dialog.setThreadedIo(m_threadedIo);
+  dialog.setAutoReconnect(m_autoReconnect);
+  dialog.setTxOptions(m_txOptions);
+  dialog.setLogSegmentMegabytes(m_logSegmentMegabytes);
+  dialog.setLogSegmentMinutes(m_logSegmentMinutes);
+  dialog.setLogCompress(m_logCompress);
+  dialog.setFraming(m_framing);
   dialog.setShortcuts(m_shortcuts);
 
   if (dialog.exec() == QDialog::Accepted) {
@@ -400,12 +942,26 @@ void MainWindow::openSettings() {
     m_hexDisplay = dialog.hexDisplay();
     m_autoScroll = dialog.autoScroll();
     m_showTimestamp = dialog.showTimestamp();
+    m_refreshRate = dialog.refreshRate();
     m_dataBits = dialog.dataBits();
     m_stopBits = dialog.stopBits();
     m_parity = dialog.parity();
+    m_threadedIo = dialog.threadedIo();
+    m_autoReconnect = dialog.autoReconnect();
+    m_txOptions = dialog.txOptions();
+    m_logSegmentMegabytes = dialog.logSegmentMegabytes();
+    m_logSegmentMinutes = dialog.logSegmentMinutes();
+    m_logCompress = dialog.logCompress();
+    m_framing = dialog.framing();
     m_shortcuts = dialog.shortcuts();
 
+    // Flush first so data already received is shown with the old framing
+    m_rxCoalescer->flush();
+    applyDisplaySettings();
+    applyFraming();
     applyShortcuts();
+    m_serialPortManager->setTxOptions(m_txOptions);
+    m_serialPortManager->setAutoReconnect(m_autoReconnect);
     saveSettings();
   }
 }
@@ -415,26 +971,34 @@ void MainWindow::updateConnectionStatus() {
     m_statusLabel->setText("Connected: " +
                            m_serialPortManager->getCurrentPortName());
     m_connectionStatusIcon->setToolTip("Connected");
+  } else if (m_serialPortManager->isReconnecting()) {
+    m_statusLabel->setText("Reconnecting: " +
+                           m_serialPortManager->getCurrentPortName());
+    m_connectionStatusIcon->setToolTip("Waiting for the device");
   } else {
     m_statusLabel->setText("Disconnected");
     m_connectionStatusIcon->setToolTip("Disconnected");
   }
 }
 
-QString MainWindow::formatData(const QByteArray &data) {
-  if (m_hexDisplay) {
-    QString hex = data.toHex(' ').toUpper();
-    return hex;
-  } else {
-    return QString::fromUtf8(data);
+void MainWindow::logData(CaptureFormat::Direction direction,
+                         qint64 timestampNs, const QByteArray &data) {
+  if (m_isLogging) {
+    m_logWriter->write(direction, timestampNs, data);
+  }
+  if (m_triggerCapture->isArmed()) {
+    m_triggerCapture->addData(direction, timestampNs, data);
   }
 }
 
-void MainWindow::logData(const QString &data) {
-  if (m_isLogging && m_logStream) {
-    m_logStream->operator<<(data + "\n");
-    m_logStream->flush();
-  }
+QMap<QString, QString> MainWindow::captureMetadata() const {
+  return {{"port", m_serialPortManager->isOpen()
+                       ? m_serialPortManager->getCurrentPortName()
+                       : ui->portComboBox->currentText()},
+          {"baud", ui->baudRateComboBox->currentText()},
+          {"dataBits", QString::number(int(m_dataBits))},
+          {"stopBits", QString::number(int(m_stopBits))},
+          {"parity", QString::number(int(m_parity))}};
 }
 
 void MainWindow::loadSettings() {
@@ -443,6 +1007,10 @@ void MainWindow::loadSettings() {
   m_hexDisplay = settings.value("display/hexMode", false).toBool();
   m_autoScroll = settings.value("display/autoScroll", true).toBool();
   m_showTimestamp = settings.value("display/showTimestamp", true).toBool();
+  m_refreshRate = settings
+                      .value("display/refreshRate",
+                             RxCoalescer::DefaultFlushRate)
+                      .toInt();
   m_lineEnding = settings.value("connection/lineEnding", "LF").toString();
 
   m_dataBits = static_cast<QSerialPort::DataBits>(
@@ -451,6 +1019,41 @@ void MainWindow::loadSettings() {
       settings.value("connection/stopBits", QSerialPort::OneStop).toInt());
   m_parity = static_cast<QSerialPort::Parity>(
       settings.value("connection/parity", QSerialPort::NoParity).toInt());
+  m_threadedIo = settings.value("connection/threadedIo", false).toBool();
+  m_autoReconnect =
+      settings.value("connection/autoReconnect", true).toBool();
+  m_txOptions.interByteDelayMs =
+      settings.value("transmit/interByteDelayMs", 0).toInt();
+  m_txOptions.interFrameDelayMs =
+      settings.value("transmit/interFrameDelayMs", 0).toInt();
+  m_txOptions.rateLimit = settings.value("transmit/rateLimit", 0).toInt();
+
+  m_logSegmentMegabytes = settings.value("logging/segmentMegabytes", 0).toInt();
+  m_logSegmentMinutes = settings.value("logging/segmentMinutes", 0).toInt();
+  m_logCompress = settings.value("logging/compress", false).toBool();
+
+  m_framing.type = static_cast<FrameDecoder::Type>(
+      settings.value("framing/type", FrameDecoder::NoFraming).toInt());
+  m_framing.delimiter =
+      settings.value("framing/delimiter", QByteArray("\n")).toByteArray();
+  m_framing.includeDelimiter =
+      settings.value("framing/includeDelimiter", false).toBool();
+  m_framing.frameLength = settings.value("framing/frameLength", 16).toInt();
+  m_framing.lengthFieldSize =
+      settings.value("framing/lengthFieldSize", 2).toInt();
+  m_framing.lengthBigEndian =
+      settings.value("framing/lengthBigEndian", true).toBool();
+  m_framing.lengthIncludesHeader =
+      settings.value("framing/lengthIncludesHeader", false).toBool();
+
+  m_triggerSpec =
+      settings.value("trigger/spec", "pattern=DEADBEEF,before=64K,after=10s")
+          .toString();
+
+  const QString layoutPath = settings.value("dissector/layoutPath").toString();
+  if (!layoutPath.isEmpty()) {
+    m_packetView->loadLayout(layoutPath);
+  }
 
   // Load shortcuts
   settings.beginGroup("shortcuts");
@@ -470,6 +1073,7 @@ void MainWindow::loadSettings() {
 
   // Restore window geometry
   restoreGeometry(settings.value("window/geometry").toByteArray());
+  restoreState(settings.value("window/state").toByteArray());
 }
 
 void MainWindow::saveSettings() {
@@ -478,11 +1082,33 @@ void MainWindow::saveSettings() {
   settings.setValue("display/hexMode", m_hexDisplay);
   settings.setValue("display/autoScroll", m_autoScroll);
   settings.setValue("display/showTimestamp", m_showTimestamp);
+  settings.setValue("display/refreshRate", m_refreshRate);
   settings.setValue("connection/lineEnding", m_lineEnding);
 
   settings.setValue("connection/dataBits", static_cast<int>(m_dataBits));
   settings.setValue("connection/stopBits", static_cast<int>(m_stopBits));
   settings.setValue("connection/parity", static_cast<int>(m_parity));
+  settings.setValue("connection/threadedIo", m_threadedIo);
+  settings.setValue("connection/autoReconnect", m_autoReconnect);
+  settings.setValue("transmit/interByteDelayMs", m_txOptions.interByteDelayMs);
+  settings.setValue("transmit/interFrameDelayMs",
+                    m_txOptions.interFrameDelayMs);
+  settings.setValue("transmit/rateLimit", m_txOptions.rateLimit);
+
+  settings.setValue("logging/segmentMegabytes", m_logSegmentMegabytes);
+  settings.setValue("logging/segmentMinutes", m_logSegmentMinutes);
+  settings.setValue("logging/compress", m_logCompress);
+
+  settings.setValue("framing/type", static_cast<int>(m_framing.type));
+  settings.setValue("framing/delimiter", m_framing.delimiter);
+  settings.setValue("framing/includeDelimiter", m_framing.includeDelimiter);
+  settings.setValue("framing/frameLength", m_framing.frameLength);
+  settings.setValue("framing/lengthFieldSize", m_framing.lengthFieldSize);
+  settings.setValue("framing/lengthBigEndian", m_framing.lengthBigEndian);
+  settings.setValue("framing/lengthIncludesHeader",
+                    m_framing.lengthIncludesHeader);
+  settings.setValue("dissector/layoutPath", m_packetView->layoutPath());
+  settings.setValue("trigger/spec", m_triggerSpec);
 
   // Save shortcuts
   settings.beginGroup("shortcuts");
@@ -493,6 +1119,7 @@ void MainWindow::saveSettings() {
 
   // Save window geometry
   settings.setValue("window/geometry", saveGeometry());
+  settings.setValue("window/state", saveState());
 }
 
 void MainWindow::applyShortcuts() {
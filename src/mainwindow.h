@@ -2,15 +2,28 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QFile>
-#include <QTextStream>
+#include "consolebuffer.h"
+#include "framedecoder.h"
+#include "logwriter.h"
+#include "rxcoalescer.h"
 #include "serialportmanager.h"
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
 QT_END_NAMESPACE
 
+class FileTransfer;
+class HexView;
+class MultiPortWindow;
+class PacketView;
+class PlotterWindow;
+class PortBridge;
+class PortWatcher;
+class ScriptEngine;
+class TriggerCapture;
 class QAction;
+class QDockWidget;
 class QLabel;
 
 class MainWindow : public QMainWindow
@@ -26,13 +39,25 @@ private slots:
     void refreshPorts();
     void toggleConnection();
     void sendData();
-    void onDataReceived(const QByteArray &data);
+    void sendFile();
+    void runScript();
+    void toggleSharing(bool enabled);
+    void toggleTriggerCapture(bool enabled);
+    void onChunkReceived(const SerialChunk &chunk);
+    void onChunksReceived(const QList<SerialChunk> &chunks);
+    void onRxFlushed(int mergedChunks);
     void onConnectionStatusChanged(bool connected);
     void onErrorOccurred(const QString &error);
+    void onRxOverrun(quint64 totalDroppedBytes);
+    void onTxQueueChanged(qint64 queuedBytes);
+    void onStatisticsUpdated(const PortStatistics &stats);
+    void onReconnectStateChanged(bool reconnecting);
+    void onReconnected(qint64 downtimeMs);
     
     // UI actions
     void clearOutput();
     void toggleLogging();
+    void openCapture();
     void openSettings();
     void updateConnectionStatus();
 
@@ -42,34 +67,96 @@ private:
     void loadSettings();
     void saveSettings();
     void applyShortcuts();
+    void applyDisplaySettings();
+    void applyFraming();
     void updateLineEndingMenu();
     
-    QString formatData(const QByteArray &data);
-    void logData(const QString &data);
+    void appendToConsole(ConsoleBuffer::Direction direction,
+                         const QByteArray &data);
+    void refreshOutput();
+    void reportDisplayed(const QList<SerialChunk> &chunks);
+    void logData(CaptureFormat::Direction direction, qint64 timestampNs,
+                 const QByteArray &data);
+    // Port settings stored in the header of captures
+    QMap<QString, QString> captureMetadata() const;
     
     Ui::MainWindow *ui;
     
     // Serial port manager
     SerialPortManager *m_serialPortManager;
+
+    // Batches RX chunks so the view is updated at most once per frame
+    RxCoalescer *m_rxCoalescer;
+
+    // RX/TX history shown by ui->outputView
+    ConsoleBuffer m_consoleBuffer;
+
+    // Optional reassembly of RX data into frames; null when unframed
+    FrameDecoder::Options m_framing;
+    std::unique_ptr<FrameDecoder> m_frameDecoder;
+    quint64 m_reportedFrameErrors;
     
     // Status indicators
     QLabel *m_statusLabel;
     QLabel *m_connectionStatusIcon;
+    QLabel *m_rxBatchLabel;
+    QLabel *m_txQueueLabel;
+    QLabel *m_rateLabel;
     
     // Settings
     bool m_hexDisplay;
     bool m_autoScroll;
     bool m_showTimestamp;
+    int m_refreshRate;
     bool m_isLogging;
     QString m_lineEnding; // Line ending: "LF", "CR", "CRLF", or "None"
     QString m_logFilePath;
-    QFile *m_logFile;
-    QTextStream *m_logStream;
+    int m_logSegmentMegabytes;  // 0 = no size rotation
+    int m_logSegmentMinutes;    // 0 = no time rotation
+    bool m_logCompress;
+
+    // Background writer for the binary capture log
+    LogWriter *m_logWriter;
     
     // Connection settings
     QSerialPort::DataBits m_dataBits;
     QSerialPort::StopBits m_stopBits;
     QSerialPort::Parity m_parity;
+    bool m_threadedIo;
+    bool m_autoReconnect;
+    TxOptions m_txOptions;
+    PortWatcher *m_portWatcher;
+
+    // Created on first use from the Tools menu
+    MultiPortWindow *m_multiPortWindow;
+    PlotterWindow *m_plotterWindow;
+
+    // File/firmware upload over the connected port
+    FileTransfer *m_fileTransfer;
+
+    // Request/response automation over the connected port
+    ScriptEngine *m_scriptEngine;
+    QAction *m_stopScriptAction;
+
+    // Shares the connected port with TCP/UDP clients on localhost
+    PortBridge *m_portBridge;
+    QAction *m_shareAction;
+
+    // Saves the traffic around rare events, armed from the Tools menu
+    TriggerCapture *m_triggerCapture;
+    QAction *m_triggerAction;
+    QString m_triggerSpec;
+
+    static constexpr int StatisticsIntervalMs = 1000;
+    QDockWidget *m_statisticsDock;
+
+    // Offset/hex/ASCII view of the same history as the console
+    QDockWidget *m_hexInspectorDock;
+    HexView *m_hexView;
+
+    // Binary protocol packets decoded from the RX stream
+    QDockWidget *m_packetDock;
+    PacketView *m_packetView;
     
     // Shortcuts (stored as strings in settings)
     QMap<QString, QString> m_shortcuts;
@@ -0,0 +1,304 @@
+#include "multiportwindow.h"
+#include "consoleview.h"
+#include "portsessionmanager.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSerialPortInfo>
+#include <QSplitter>
+#include <QStackedWidget>
+#include <QTimer>
+#include <QToolButton>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+// Per-port history is smaller than the main console's; the merged view
+// holds the full default amount.
+constexpr qsizetype PaneByteCapacity = 4 * 1024 * 1024;
+constexpr qsizetype PaneRecordCapacity = 64 * 1024;
+constexpr int FlushIntervalMs = 16;
+
+} // namespace
+
+MultiPortWindow::MultiPortWindow(QWidget *parent)
+    : QWidget(parent, Qt::Window), m_sessions(new PortSessionManager(this)),
+      m_flushTimer(new QTimer(this)), m_dataBits(QSerialPort::Data8),
+      m_stopBits(QSerialPort::OneStop), m_parity(QSerialPort::NoParity) {
+  setWindowTitle("Multi-Port Monitor");
+  resize(1000, 600);
+
+  QFont consoleFont("Courier", 10);
+
+  // Connection row
+  m_portComboBox = new QComboBox(this);
+  m_portComboBox->setMinimumWidth(150);
+  QPushButton *refreshButton = new QPushButton("Refresh", this);
+
+  m_baudComboBox = new QComboBox(this);
+  m_baudComboBox->setEditable(true);
+  for (int rate : {9600, 19200, 38400, 57600, 115200, 230400, 460800,
+                   921600}) {
+    m_baudComboBox->addItem(QString::number(rate));
+  }
+  m_baudComboBox->setCurrentText("115200");
+
+  m_policyComboBox = new QComboBox(this);
+  m_policyComboBox->addItem("Thread per port",
+                            PortSessionManager::ThreadPerPort);
+  m_policyComboBox->addItem("Shared I/O pool",
+                            PortSessionManager::SharedPool);
+  m_policyComboBox->setToolTip("Applies to ports opened afterwards");
+
+  QPushButton *openButton = new QPushButton("Open", this);
+  QPushButton *closeAllButton = new QPushButton("Close All", this);
+
+  m_layoutComboBox = new QComboBox(this);
+  m_layoutComboBox->addItems({"Side by side", "Merged"});
+
+  QHBoxLayout *controls = new QHBoxLayout;
+  controls->addWidget(new QLabel("Port:", this));
+  controls->addWidget(m_portComboBox);
+  controls->addWidget(refreshButton);
+  controls->addWidget(new QLabel("Baud:", this));
+  controls->addWidget(m_baudComboBox);
+  controls->addWidget(new QLabel("Threads:", this));
+  controls->addWidget(m_policyComboBox);
+  controls->addWidget(openButton);
+  controls->addWidget(closeAllButton);
+  controls->addStretch();
+  controls->addWidget(new QLabel("View:", this));
+  controls->addWidget(m_layoutComboBox);
+
+  // Views
+  m_splitter = new QSplitter(Qt::Horizontal, this);
+  m_mergedView = new ConsoleView(this);
+  m_mergedView->setFont(consoleFont);
+  m_mergedView->setSource(&m_mergedBuffer);
+
+  m_stack = new QStackedWidget(this);
+  m_stack->addWidget(m_splitter);
+  m_stack->addWidget(m_mergedView);
+
+  m_statusLabel = new QLabel(this);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addLayout(controls);
+  layout->addWidget(m_stack, 1);
+  layout->addWidget(m_statusLabel);
+
+  connect(refreshButton, &QPushButton::clicked, this,
+          &MultiPortWindow::refreshPorts);
+  connect(openButton, &QPushButton::clicked, this,
+          &MultiPortWindow::openSession);
+  connect(closeAllButton, &QPushButton::clicked, this,
+          &MultiPortWindow::closeAll);
+  connect(m_layoutComboBox,
+          QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          [this](int index) {
+            // Hidden views were not repainted while data arrived
+            m_stack->setCurrentIndex(index);
+            m_mergedView->refresh();
+            for (const Pane &pane : std::as_const(m_panes)) {
+              pane.view->refresh();
+            }
+          });
+
+  connect(m_sessions, &PortSessionManager::dataReceived, this,
+          &MultiPortWindow::onDataReceived);
+  connect(m_sessions, &PortSessionManager::errorOccurred, this,
+          &MultiPortWindow::onErrorOccurred);
+  connect(m_sessions, &PortSessionManager::sessionClosed, this,
+          &MultiPortWindow::onSessionClosed);
+
+  m_flushTimer->setInterval(FlushIntervalMs);
+  m_flushTimer->setTimerType(Qt::PreciseTimer);
+  connect(m_flushTimer, &QTimer::timeout, this,
+          &MultiPortWindow::flushPending);
+
+  refreshPorts();
+  updateStatus();
+}
+
+MultiPortWindow::~MultiPortWindow() {
+  m_sessions->closeAll();
+  for (const Pane &pane : std::as_const(m_panes)) {
+    delete pane.buffer;
+  }
+}
+
+void MultiPortWindow::setConnectionSettings(QSerialPort::DataBits dataBits,
+                                            QSerialPort::StopBits stopBits,
+                                            QSerialPort::Parity parity) {
+  m_dataBits = dataBits;
+  m_stopBits = stopBits;
+  m_parity = parity;
+}
+
+void MultiPortWindow::refreshPorts() {
+  const QString current = m_portComboBox->currentText();
+  m_portComboBox->clear();
+  for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts()) {
+    m_portComboBox->addItem(info.portName());
+  }
+  m_portComboBox->setCurrentText(current);
+}
+
+void MultiPortWindow::openSession() {
+  const QString portName = m_portComboBox->currentText();
+  bool ok = false;
+  const qint32 baudRate = m_baudComboBox->currentText().toInt(&ok);
+  if (portName.isEmpty() || !ok || baudRate <= 0) {
+    m_statusLabel->setText("Select a port and a valid baud rate");
+    return;
+  }
+
+  m_sessions->setThreadPolicy(static_cast<PortSessionManager::ThreadPolicy>(
+      m_policyComboBox->currentData().toInt()));
+
+  QString error;
+  QMetaObject::Connection errorConnection =
+      connect(m_sessions, &PortSessionManager::errorOccurred, this,
+              [&error](int, const QString &message) { error = message; });
+  const int id = m_sessions->openSession(portName, baudRate, m_dataBits,
+                                         m_stopBits, m_parity);
+  disconnect(errorConnection);
+  if (id < 0) {
+    m_statusLabel->setText(
+        QString("Failed to open %1: %2").arg(portName, error));
+    return;
+  }
+
+  Pane pane;
+  pane.buffer = new ConsoleBuffer(PaneByteCapacity, PaneRecordCapacity);
+  pane.container = new QWidget(m_splitter);
+  pane.view = new ConsoleView(pane.container);
+  pane.view->setFont(m_mergedView->font());
+  pane.view->setSource(pane.buffer);
+
+  QToolButton *closeButton = new QToolButton(pane.container);
+  closeButton->setText("Close");
+  connect(closeButton, &QToolButton::clicked, this,
+          [this, id]() { closeSession(id); });
+
+  QHBoxLayout *header = new QHBoxLayout;
+  header->addWidget(new QLabel(
+      QString("<b>%1</b> @ %2").arg(portName).arg(baudRate), pane.container));
+  header->addStretch();
+  header->addWidget(closeButton);
+
+  QVBoxLayout *paneLayout = new QVBoxLayout(pane.container);
+  paneLayout->setContentsMargins(0, 0, 0, 0);
+  paneLayout->addLayout(header);
+  paneLayout->addWidget(pane.view);
+  m_splitter->addWidget(pane.container);
+  m_panes.insert(id, pane);
+
+  while (m_sourceNames.size() <= id) {
+    m_sourceNames.append(QString());
+  }
+  m_sourceNames[id] = portName;
+  m_mergedView->setSourceNames(m_sourceNames);
+
+  appendMessage(
+      id, ConsoleBuffer::Info,
+      QString("Connected to %1 at %2 baud").arg(portName).arg(baudRate));
+  m_flushTimer->start();
+  updateStatus();
+}
+
+void MultiPortWindow::closeAll() {
+  const QList<int> ids = m_panes.keys();
+  for (int id : ids) {
+    closeSession(id);
+  }
+}
+
+void MultiPortWindow::onDataReceived(int id, qint64 timestamp,
+                                     const QByteArray &data) {
+  m_pending.append({timestamp, id, ConsoleBuffer::Rx, data});
+}
+
+void MultiPortWindow::onErrorOccurred(int id, const QString &error) {
+  if (m_panes.contains(id)) {
+    appendMessage(id, ConsoleBuffer::Error, "Error: " + error);
+  }
+}
+
+void MultiPortWindow::onSessionClosed(int id) {
+  appendMessage(id, ConsoleBuffer::Info, "Disconnected");
+  updateStatus();
+}
+
+void MultiPortWindow::flushPending() {
+  if (m_pending.isEmpty()) {
+    if (m_panes.isEmpty()) {
+      m_flushTimer->stop();
+    }
+    return;
+  }
+
+  // Ports are drained one after another, so chunks from a frame arrive
+  // grouped by port; order them by read time before interleaving.
+  std::stable_sort(m_pending.begin(), m_pending.end(),
+                   [](const PendingChunk &a, const PendingChunk &b) {
+                     return a.timestamp < b.timestamp;
+                   });
+
+  QVector<ConsoleView *> touched;
+  for (const PendingChunk &chunk : std::as_const(m_pending)) {
+    m_mergedBuffer.append(chunk.direction, chunk.data, chunk.timestamp,
+                          static_cast<quint16>(chunk.id));
+    auto pane = m_panes.constFind(chunk.id);
+    if (pane != m_panes.constEnd()) {
+      pane->buffer->append(chunk.direction, chunk.data, chunk.timestamp);
+      if (!touched.contains(pane->view)) {
+        touched.append(pane->view);
+      }
+    }
+  }
+  m_pending.clear();
+
+  // Only the visible layout needs repainting now
+  if (m_stack->currentWidget() == m_mergedView) {
+    m_mergedView->refresh();
+  } else {
+    for (ConsoleView *view : std::as_const(touched)) {
+      view->refresh();
+    }
+  }
+}
+
+void MultiPortWindow::closeSession(int id) {
+  flushPending();
+  m_sessions->closeSession(id);
+
+  auto it = m_panes.find(id);
+  if (it == m_panes.end()) {
+    return;
+  }
+  delete it->container;
+  delete it->buffer;
+  m_panes.erase(it);
+  updateStatus();
+}
+
+void MultiPortWindow::appendMessage(int id, ConsoleBuffer::Direction direction,
+                                   const QString &text) {
+  m_pending.append({SerialClock::toEpochNs(SerialClock::nowNs()), id,
+                    direction, text.toUtf8()});
+}
+
+void MultiPortWindow::updateStatus() {
+  int open = 0;
+  for (int id : m_sessions->sessionIds()) {
+    if (m_sessions->manager(id)->isOpen()) {
+      ++open;
+    }
+  }
+  m_statusLabel->setText(QString("%1 port(s) open").arg(open));
+}
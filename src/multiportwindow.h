@@ -0,0 +1,92 @@
+#ifndef MULTIPORTWINDOW_H
+#define MULTIPORTWINDOW_H
+
+#include <QWidget>
+#include <QByteArray>
+#include <QMap>
+#include <QSerialPort>
+#include <QStringList>
+#include <QVector>
+#include "consolebuffer.h"
+
+class ConsoleView;
+class PortSessionManager;
+class QComboBox;
+class QLabel;
+class QSplitter;
+class QStackedWidget;
+class QTimer;
+
+// Monitors several ports at once through a PortSessionManager. Each session
+// gets its own pane in a splitter; the merged view interleaves all of them
+// in timestamp order, labelled by port.
+class MultiPortWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MultiPortWindow(QWidget *parent = nullptr);
+    ~MultiPortWindow();
+
+    // Frame format used for ports opened from now on
+    void setConnectionSettings(QSerialPort::DataBits dataBits,
+                               QSerialPort::StopBits stopBits,
+                               QSerialPort::Parity parity);
+
+public slots:
+    void refreshPorts();
+    void openSession();
+    void closeAll();
+
+private slots:
+    void onDataReceived(int id, qint64 timestamp, const QByteArray &data);
+    void onErrorOccurred(int id, const QString &error);
+    void onSessionClosed(int id);
+    void flushPending();
+
+private:
+    struct Pane
+    {
+        ConsoleBuffer *buffer;
+        ConsoleView *view;
+        QWidget *container;
+    };
+
+    struct PendingChunk
+    {
+        qint64 timestamp; // Nanoseconds since epoch
+        int id;
+        ConsoleBuffer::Direction direction;
+        QByteArray data;
+    };
+
+    void closeSession(int id);
+    void appendMessage(int id, ConsoleBuffer::Direction direction,
+                       const QString &text);
+    void updateStatus();
+
+    PortSessionManager *m_sessions;
+    QMap<int, Pane> m_panes;
+
+    // Received chunks waiting for the next display flush
+    QVector<PendingChunk> m_pending;
+    QTimer *m_flushTimer;
+
+    ConsoleBuffer m_mergedBuffer;
+    ConsoleView *m_mergedView;
+    QStringList m_sourceNames;  // Indexed by session id
+
+    QComboBox *m_portComboBox;
+    QComboBox *m_baudComboBox;
+    QComboBox *m_policyComboBox;
+    QComboBox *m_layoutComboBox;
+    QStackedWidget *m_stack;
+    QSplitter *m_splitter;
+    QLabel *m_statusLabel;
+
+    QSerialPort::DataBits m_dataBits;
+    QSerialPort::StopBits m_stopBits;
+    QSerialPort::Parity m_parity;
+};
+
+#endif // MULTIPORTWINDOW_H
@@ -0,0 +1,561 @@
+#include "packetdissector.h"
+#include <QFile>
+#include <QRegularExpression>
+#include <cstring>
+
+namespace {
+
+const int MaxFieldsPerPacket = 1024;
+
+struct ChecksumTables {
+  quint8 crc8[256];
+  quint16 crc16[256];
+  quint16 crc16Ccitt[256];
+  quint32 crc32[256];
+
+  ChecksumTables() {
+    for (int i = 0; i < 256; ++i) {
+      quint8 c8 = quint8(i);
+      quint16 c16 = quint16(i);
+      quint16 ccitt = quint16(i << 8);
+      quint32 c32 = quint32(i);
+      for (int bit = 0; bit < 8; ++bit) {
+        c8 = quint8(c8 & 0x80 ? (c8 << 1) ^ 0x07 : c8 << 1);
+        c16 = quint16(c16 & 1 ? (c16 >> 1) ^ 0xA001 : c16 >> 1);
+        ccitt = quint16(ccitt & 0x8000 ? (ccitt << 1) ^ 0x1021 : ccitt << 1);
+        c32 = c32 & 1 ? (c32 >> 1) ^ 0xEDB88320u : c32 >> 1;
+      }
+      crc8[i] = c8;
+      crc16[i] = c16;
+      crc16Ccitt[i] = ccitt;
+      crc32[i] = c32;
+    }
+  }
+};
+
+const ChecksumTables &checksumTables() {
+  static const ChecksumTables tables;
+  return tables;
+}
+
+int checksumSize(PacketDissector::ChecksumType type) {
+  switch (type) {
+  case PacketDissector::Crc16:
+  case PacketDissector::Crc16Ccitt:
+    return 2;
+  case PacketDissector::Crc32:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+quint64 computeChecksum(PacketDissector::ChecksumType type, const char *data,
+                        qsizetype length) {
+  const ChecksumTables &tables = checksumTables();
+  const quint8 *bytes = reinterpret_cast<const quint8 *>(data);
+  const quint8 *end = bytes + length;
+  switch (type) {
+  case PacketDissector::Sum8: {
+    quint8 sum = 0;
+    for (; bytes != end; ++bytes) {
+      sum = quint8(sum + *bytes);
+    }
+    return sum;
+  }
+  case PacketDissector::Xor8: {
+    quint8 sum = 0;
+    for (; bytes != end; ++bytes) {
+      sum ^= *bytes;
+    }
+    return sum;
+  }
+  case PacketDissector::Crc8: {
+    quint8 crc = 0;
+    for (; bytes != end; ++bytes) {
+      crc = tables.crc8[crc ^ *bytes];
+    }
+    return crc;
+  }
+  case PacketDissector::Crc16: {
+    quint16 crc = 0xFFFF;
+    for (; bytes != end; ++bytes) {
+      crc = quint16((crc >> 8) ^ tables.crc16[(crc ^ *bytes) & 0xFF]);
+    }
+    return crc;
+  }
+  case PacketDissector::Crc16Ccitt: {
+    quint16 crc = 0xFFFF;
+    for (; bytes != end; ++bytes) {
+      crc = quint16((crc << 8) ^
+                    tables.crc16Ccitt[((crc >> 8) ^ *bytes) & 0xFF]);
+    }
+    return crc;
+  }
+  case PacketDissector::Crc32: {
+    quint32 crc = 0xFFFFFFFFu;
+    for (; bytes != end; ++bytes) {
+      crc = (crc >> 8) ^ tables.crc32[(crc ^ *bytes) & 0xFF];
+    }
+    return ~crc;
+  }
+  }
+  return 0;
+}
+
+quint64 readRaw(const char *data, int size, bool bigEndian) {
+  quint64 value = 0;
+  for (int i = 0; i < size; ++i) {
+    value = value << 8 | quint8(data[bigEndian ? i : size - 1 - i]);
+  }
+  return value;
+}
+
+QString hexNumber(quint64 value, int size) {
+  return "0x" +
+         QString::number(value, 16).toUpper().rightJustified(size * 2, '0');
+}
+
+quint64 sizeMask(int size) {
+  return size >= 8 ? ~quint64(0) : (quint64(1) << (size * 8)) - 1;
+}
+
+} // namespace
+
+PacketDissector::PacketDissector()
+    : m_maxPacketSize(DefaultMaxPacketSize), m_bufferOffset(0),
+      m_skippedBytes(0), m_checksumErrors(0) {}
+
+bool PacketDissector::load(const QString &text) {
+  QVector<Field> fields;
+  QStringList names;
+  QVector<Layout> layouts;
+  QVector<Field> header;
+  QStringList headerNames;
+  QByteArray sync;
+  bool bigEndian = false;
+  int maxPacketSize = DefaultMaxPacketSize;
+
+  static const QRegularExpression numberType("^([ui])(8|16|32|64)(le|be)?$");
+  static const QRegularExpression floatType("^f(32|64)(le|be)?$");
+  static const QRegularExpression lengthSpec(
+      "^([A-Za-z_]\\w*)?([+-]?\\d+)?$");
+  static const QRegularExpression whitespace("\\s+");
+
+  const QStringList lines = text.split('\n');
+  for (int i = 0; i < lines.size(); ++i) {
+    auto fail = [&](const QString &message) {
+      m_errorString = QString("Line %1: %2").arg(i + 1).arg(message);
+      return false;
+    };
+
+    const QString line = lines.at(i).section('#', 0, 0).trimmed();
+    const QStringList tokens = line.split(whitespace, Qt::SkipEmptyParts);
+    if (tokens.isEmpty()) {
+      continue;
+    }
+
+    // Fields go to the packet being described, or to the shared header
+    QVector<Field> &target = layouts.isEmpty() ? header : fields;
+    QStringList &targetNames = layouts.isEmpty() ? headerNames : names;
+    const int first = layouts.isEmpty() ? 0 : layouts.last().firstField;
+    auto findField = [&](const QString &name) {
+      for (int f = first; f < targetNames.size(); ++f) {
+        if (targetNames.at(f) == name) {
+          return f - first;
+        }
+      }
+      return -1;
+    };
+
+    const QString keyword = tokens.at(0).toLower();
+    if (keyword == "endian") {
+      if (tokens.size() != 2 ||
+          (tokens.at(1) != "big" && tokens.at(1) != "little")) {
+        return fail("expected 'endian big' or 'endian little'");
+      }
+      bigEndian = tokens.at(1) == "big";
+    } else if (keyword == "maxsize") {
+      bool ok = false;
+      maxPacketSize = tokens.value(1).toInt(&ok);
+      if (tokens.size() != 2 || !ok || maxPacketSize <= 0) {
+        return fail("expected a size in bytes");
+      }
+    } else if (keyword == "sync") {
+      if (!layouts.isEmpty() || !header.isEmpty() || !sync.isEmpty()) {
+        return fail("sync must come first, once");
+      }
+      sync = QByteArray::fromHex(tokens.mid(1).join("").toLatin1());
+      if (sync.isEmpty()) {
+        return fail("expected the sync bytes in hex");
+      }
+      Field field = {};
+      field.type = Sync;
+      field.lengthField = -1;
+      header.append(field);
+      headerNames.append("sync");
+    } else if (keyword == "packet") {
+      if (tokens.size() != 2) {
+        return fail("expected a packet name");
+      }
+      layouts.append(Layout{tokens.at(1), int(fields.size()),
+                            int(header.size())});
+      fields += header;
+      names += headerNames;
+    } else if (keyword == "field" || keyword == "checksum") {
+      if (tokens.size() < 3) {
+        return fail("expected a name and a type");
+      }
+      const QString name = tokens.at(1);
+      if (findField(name) >= 0) {
+        return fail("duplicate field '" + name + "'");
+      }
+      if (targetNames.size() - first >= MaxFieldsPerPacket) {
+        return fail("too many fields");
+      }
+
+      Field field = {};
+      field.bigEndian = bigEndian;
+      field.lengthField = -1;
+      const QString type = tokens.at(2).toLower();
+      QStringList rest = tokens.mid(3);
+      QRegularExpressionMatch match;
+
+      if (keyword == "checksum") {
+        static const QStringList algorithms = {
+            "sum8", "xor8", "crc8", "crc16", "crc16-ccitt", "crc32"};
+        const int algorithm = int(algorithms.indexOf(type));
+        if (algorithm < 0) {
+          return fail("unknown checksum '" + type + "'");
+        }
+        field.type = Checksum;
+        field.checksum = ChecksumType(algorithm);
+        field.size = quint8(checksumSize(field.checksum));
+        field.checksumFrom = qint32(sync.size());
+        if (!rest.isEmpty() && (rest.first() == "le" || rest.first() == "be")) {
+          field.bigEndian = rest.takeFirst() == "be";
+        }
+        if (rest.size() == 2 && rest.first() == "from") {
+          bool ok = false;
+          field.checksumFrom = rest.at(1).toInt(&ok, 0);
+          if (!ok || field.checksumFrom < 0) {
+            return fail("expected an offset after 'from'");
+          }
+          rest.clear();
+        }
+        if (!rest.isEmpty()) {
+          return fail("expected [le|be] [from N] after the checksum type");
+        }
+      } else if (type == "bytes") {
+        field.type = Bytes;
+        match = lengthSpec.match(rest.join(""));
+        if (rest.isEmpty() || !match.hasMatch()) {
+          return fail("expected a length or a length field");
+        }
+        if (!match.captured(1).isEmpty()) {
+          const int index = findField(match.captured(1));
+          if (index < 0 || target[first + index].type != Unsigned) {
+            return fail("'" + match.captured(1) +
+                        "' is not an earlier unsigned field");
+          }
+          field.lengthField = qint16(index);
+        }
+        field.length = match.captured(2).toInt();
+        if (field.lengthField < 0 && field.length <= 0) {
+          return fail("expected a positive length");
+        }
+      } else if ((match = numberType.match(type)).hasMatch() ||
+                 (match = floatType.match(type)).hasMatch()) {
+        const bool isFloat = type.startsWith('f');
+        if (isFloat) {
+          field.type = Float;
+        } else {
+          field.type = match.captured(1) == "i" ? Signed : Unsigned;
+        }
+        field.size = quint8(match.captured(isFloat ? 1 : 2).toInt() / 8);
+        const QString order = match.captured(isFloat ? 2 : 3);
+        if (!order.isEmpty()) {
+          field.bigEndian = order == "be";
+        }
+        if (!rest.isEmpty()) {
+          bool ok = rest.size() == 2 && rest.first() == "=" && !isFloat;
+          const qint64 value = ok ? rest.at(1).toLongLong(&ok, 0) : 0;
+          if (!ok) {
+            return fail("expected '= VALUE' after an integer type");
+          }
+          field.hasMatch = true;
+          field.match = quint64(value) & sizeMask(field.size);
+        }
+      } else {
+        return fail("unknown type '" + type + "'");
+      }
+
+      target.append(field);
+      targetNames.append(name);
+      if (!layouts.isEmpty()) {
+        ++layouts.last().fieldCount;
+      }
+    } else {
+      return fail("unknown statement '" + tokens.at(0) + "'");
+    }
+  }
+
+  // A packet without fields of its own would match wherever its header does
+  for (const Layout &layout : std::as_const(layouts)) {
+    if (layout.fieldCount == header.size()) {
+      m_errorString = "Packet '" + layout.name + "' has no fields";
+      return false;
+    }
+  }
+
+  // A file without packet statements describes a single packet type
+  if (layouts.isEmpty()) {
+    if (header.isEmpty()) {
+      m_errorString = "No fields defined";
+      return false;
+    }
+    layouts.append(Layout{"Packet", 0, int(header.size())});
+    fields = header;
+    names = headerNames;
+  }
+
+  int widest = 0;
+  for (const Layout &layout : std::as_const(layouts)) {
+    widest = qMax(widest, layout.fieldCount);
+  }
+
+  m_fields = fields;
+  m_names = names;
+  m_layouts = layouts;
+  m_sync = sync;
+  m_maxPacketSize = maxPacketSize;
+  m_scratch.resize(widest);
+  m_errorString.clear();
+  reset();
+  return true;
+}
+
+bool PacketDissector::loadFile(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    m_errorString = "Cannot open " + path + ": " + file.errorString();
+    return false;
+  }
+  return load(QString::fromUtf8(file.readAll()));
+}
+
+QString PacketDissector::errorString() const { return m_errorString; }
+
+bool PacketDissector::isLoaded() const { return !m_layouts.isEmpty(); }
+
+void PacketDissector::feed(const char *data, qsizetype length,
+                           qint64 timestamp, QVector<Packet> &packets,
+                           QVector<Value> &values) {
+  if (m_layouts.isEmpty()) {
+    return;
+  }
+
+  m_buffer.append(data, length);
+  const char *bytes = m_buffer.constData();
+  const qsizetype size = m_buffer.size();
+  qsizetype pos = 0;
+  while (pos < size) {
+    if (!m_sync.isEmpty()) {
+      // Garbage up to the next sync is skipped; the start of a sync at the
+      // end is kept for the next call
+      const qsizetype next = m_buffer.indexOf(m_sync, pos);
+      if (next < 0) {
+        const qsizetype keep = qMin(size - pos, m_sync.size() - 1);
+        m_skippedBytes += quint64(size - keep - pos);
+        pos = size - keep;
+        break;
+      }
+      m_skippedBytes += quint64(next - pos);
+      pos = next;
+    }
+
+    // A layout that needs more data only holds the stream up when no other
+    // layout matches here
+    int layout = 0;
+    qsizetype packetSize = NoMatch;
+    bool needMore = false;
+    for (; layout < m_layouts.size(); ++layout) {
+      packetSize = dissect(m_layouts[layout], bytes + pos, size - pos,
+                           m_scratch.data());
+      if (packetSize == NeedMore) {
+        needMore = true;
+      } else if (packetSize != NoMatch) {
+        break;
+      }
+    }
+    if (layout == m_layouts.size()) {
+      if (needMore && size - pos < m_maxPacketSize) {
+        break;
+      }
+      packetSize = NoMatch;
+    }
+    if (packetSize == NoMatch) {
+      ++m_skippedBytes;
+      ++pos;
+      continue;
+    }
+
+    Packet packet;
+    packet.layout = layout;
+    packet.streamOffset = m_bufferOffset + quint64(pos);
+    packet.timestamp = timestamp;
+    packet.data = QByteArray(bytes + pos, packetSize);
+    packet.firstValue = int(values.size());
+    packet.valid = true;
+    const int count = m_layouts[layout].fieldCount;
+    for (int i = 0; i < count; ++i) {
+      const Value &value = m_scratch[i];
+      packet.valid = packet.valid && value.raw == value.expected;
+      values.append(value);
+    }
+    if (!packet.valid) {
+      ++m_checksumErrors;
+    }
+    packets.append(packet);
+    pos += packetSize;
+  }
+
+  m_buffer.remove(0, pos);
+  m_bufferOffset += quint64(pos);
+}
+
+void PacketDissector::reset() {
+  m_bufferOffset += quint64(m_buffer.size());
+  m_buffer.clear();
+}
+
+void PacketDissector::skip(qsizetype length) {
+  reset();
+  m_bufferOffset += quint64(length);
+}
+
+const QVector<PacketDissector::Layout> &PacketDissector::layouts() const {
+  return m_layouts;
+}
+
+const PacketDissector::Field &PacketDissector::field(int index) const {
+  return m_fields[index];
+}
+
+QString PacketDissector::fieldName(int index) const {
+  return m_names.value(index);
+}
+
+QString PacketDissector::formatValue(int index, const Value &value,
+                                     const QByteArray &packet) const {
+  const Field &f = m_fields[index];
+  const QString hex = hexNumber(value.raw, f.size);
+  switch (f.type) {
+  case Unsigned:
+    return QString("%1 (%2)").arg(value.raw).arg(hex);
+  case Signed: {
+    const int shift = 64 - f.size * 8;
+    return QString("%1 (%2)")
+        .arg(qint64(value.raw << shift) >> shift)
+        .arg(hex);
+  }
+  case Float:
+    if (f.size == 4) {
+      const quint32 bits = quint32(value.raw);
+      float number;
+      std::memcpy(&number, &bits, sizeof(number));
+      return QString::number(number, 'g', 9);
+    } else {
+      double number;
+      std::memcpy(&number, &value.raw, sizeof(number));
+      return QString::number(number, 'g', 17);
+    }
+  case Checksum:
+    if (value.raw != value.expected) {
+      return hex + ", expected " + hexNumber(value.expected, f.size);
+    }
+    return hex;
+  case Sync:
+  case Bytes:
+    break;
+  }
+
+  // Long byte fields are cut short; the bytes column has them all
+  const int shown = int(qMin<quint32>(value.length, 32));
+  QString text =
+      QString::fromLatin1(packet.mid(value.offset, shown).toHex(' '))
+          .toUpper();
+  if (value.length > quint32(shown)) {
+    text += QString(" ... (%1 bytes)").arg(value.length);
+  }
+  return text;
+}
+
+quint64 PacketDissector::skippedBytes() const { return m_skippedBytes; }
+
+quint64 PacketDissector::checksumErrors() const { return m_checksumErrors; }
+
+void PacketDissector::clearStatistics() {
+  m_skippedBytes = 0;
+  m_checksumErrors = 0;
+}
+
+qsizetype PacketDissector::dissect(const Layout &layout, const char *data,
+                                   qsizetype available, Value *values) const {
+  const Field *fields = m_fields.constData() + layout.firstField;
+  qsizetype offset = 0;
+  for (int i = 0; i < layout.fieldCount; ++i) {
+    const Field &f = fields[i];
+    qsizetype size = f.size;
+    if (f.type == Sync) {
+      size = m_sync.size();
+    } else if (f.type == Bytes) {
+      qint64 length = f.length;
+      if (f.lengthField >= 0) {
+        length += qint64(qMin<quint64>(values[f.lengthField].raw,
+                                       quint64(m_maxPacketSize)));
+      }
+      if (length < 0 || offset + length > m_maxPacketSize) {
+        return NoMatch;
+      }
+      size = qsizetype(length);
+    }
+    if (offset + size > available) {
+      return NeedMore;
+    }
+
+    Value &value = values[i];
+    value.offset = quint32(offset);
+    value.length = quint32(size);
+    value.raw = 0;
+    const char *bytes = data + offset;
+    switch (f.type) {
+    case Sync:
+      if (std::memcmp(bytes, m_sync.constData(), size) != 0) {
+        return NoMatch;
+      }
+      break;
+    case Unsigned:
+    case Signed:
+    case Float:
+      value.raw = readRaw(bytes, f.size, f.bigEndian);
+      if (f.hasMatch && value.raw != f.match) {
+        return NoMatch;
+      }
+      break;
+    case Checksum: {
+      value.raw = readRaw(bytes, f.size, f.bigEndian);
+      const qsizetype from = qMin<qsizetype>(f.checksumFrom, offset);
+      value.expected = computeChecksum(f.checksum, data + from, offset - from);
+      offset += size;
+      continue;
+    }
+    case Bytes:
+      break;
+    }
+    value.expected = value.raw;
+    offset += size;
+  }
+  // An empty packet would never move the stream on
+  return offset > 0 ? offset : qsizetype(NoMatch);
+}
@@ -0,0 +1,154 @@
+#ifndef PACKETDISSECTOR_H
+#define PACKETDISSECTOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+// Splits a byte stream into the packets of a binary protocol and decodes
+// their fields, as described by a layout file. The layout is compiled once
+// into a flat table of field descriptors; dissecting a packet is a loop over
+// that table that allocates nothing per field, and decoded values only point
+// at the packet's bytes.
+//
+// Layout files have one statement per line; '#' starts a comment:
+//
+//   endian big|little           byte order from here on (default little)
+//   sync HEX...                 packets start with these bytes; the stream
+//                               is searched for them after garbage
+//   field NAME TYPE [= VALUE]   u8, u16, u32, u64, i8 ... i64, f32 or f64,
+//                               with an le/be suffix to override the byte
+//                               order. With a value, the packet type only
+//                               applies when the field holds it.
+//   field NAME bytes N|FIELD[+N|-N]
+//                               N bytes, or as many as an earlier field says
+//   checksum NAME ALGO [le|be] [from N]
+//                               sum8, xor8, crc8, crc16 (Modbus),
+//                               crc16-ccitt or crc32 of the packet's bytes
+//                               from offset N (default: after the sync) up
+//                               to the checksum
+//   packet NAME                 starts a packet type; fields before the
+//                               first one are a header shared by all types
+//   maxsize N                   longest packet to wait for (default 4096)
+//
+// Packet types are tried in file order and the first that matches wins. A
+// packet whose checksum is wrong is still reported, marked invalid.
+class PacketDissector
+{
+public:
+    enum FieldType : quint8 {
+        Sync,
+        Unsigned,
+        Signed,
+        Float,
+        Bytes,
+        Checksum
+    };
+
+    enum ChecksumType : quint8 {
+        Sum8,
+        Xor8,
+        Crc8,
+        Crc16,
+        Crc16Ccitt,
+        Crc32
+    };
+
+    struct Field
+    {
+        FieldType type;
+        ChecksumType checksum;
+        bool bigEndian;
+        bool hasMatch;
+        quint8 size;          // Numbers and checksums
+        qint16 lengthField;   // Bytes: earlier field holding the length, or -1
+        qint32 length;        // Bytes: fixed length, or added to the field's
+        qint32 checksumFrom;  // Checksum: first byte covered
+        quint64 match;
+    };
+
+    struct Layout
+    {
+        QString name;
+        int firstField;       // Into the field table
+        int fieldCount;
+    };
+
+    // Where a field lies in its packet and, for numbers and checksums, the
+    // bits read from it
+    struct Value
+    {
+        quint32 offset;
+        quint32 length;
+        quint64 raw;
+        quint64 expected;     // What a checksum should be; raw for the rest
+    };
+
+    struct Packet
+    {
+        int layout;
+        quint64 streamOffset; // Of its first byte
+        qint64 timestamp;     // Of the data that completed it
+        QByteArray data;
+        int firstValue;       // Its layout's fieldCount values start here
+        bool valid;           // Every checksum matched
+    };
+
+    static constexpr int DefaultMaxPacketSize = 4096;
+
+    PacketDissector();
+
+    // On failure the previous layout is kept; errorString() tells why
+    bool load(const QString &text);
+    bool loadFile(const QString &path);
+    QString errorString() const;
+    bool isLoaded() const;
+
+    // Appends the packets completed by data, and their values, to packets
+    // and values; Packet::firstValue indexes values
+    void feed(const char *data, qsizetype length, qint64 timestamp,
+              QVector<Packet> &packets, QVector<Value> &values);
+    // Drops a partially received packet, e.g. after reconnecting
+    void reset();
+    // Drops a partial packet too, and counts length bytes of the stream as
+    // passed without being fed
+    void skip(qsizetype length);
+
+    const QVector<Layout> &layouts() const;
+    const Field &field(int index) const;
+    QString fieldName(int index) const;
+    // Numbers in decimal and hex, bytes in hex
+    QString formatValue(int index, const Value &value,
+                        const QByteArray &packet) const;
+
+    quint64 skippedBytes() const;   // Not part of any packet
+    quint64 checksumErrors() const;
+    void clearStatistics();
+
+private:
+    enum Result {
+        NoMatch = -1,
+        NeedMore = -2
+    };
+
+    // Size of the packet of layout at data, or a Result
+    qsizetype dissect(const Layout &layout, const char *data,
+                      qsizetype available, Value *values) const;
+
+    QVector<Field> m_fields;
+    QStringList m_names;
+    QVector<Layout> m_layouts;
+    QByteArray m_sync;
+    int m_maxPacketSize;
+    QString m_errorString;
+
+    QByteArray m_buffer;          // Received bytes not yet dissected
+    quint64 m_bufferOffset;       // Stream offset of m_buffer's first byte
+    QVector<Value> m_scratch;
+    quint64 m_skippedBytes;
+    quint64 m_checksumErrors;
+};
+
+#endif // PACKETDISSECTOR_H
@@ -0,0 +1,312 @@
+#include "packetview.h"
+#include "serialclock.h"
+#include <QAbstractItemModel>
+#include <QColor>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QTreeView>
+#include <QVBoxLayout>
+
+namespace {
+
+enum Column {
+  NameColumn,
+  TimeColumn,
+  OffsetColumn,
+  ValueColumn,
+  BytesColumn,
+  ColumnCount
+};
+
+// Longer packets and fields are cut short in the bytes column
+const int MaxShownBytes = 64;
+
+QString hexBytes(const QByteArray &data, qsizetype offset, qsizetype length) {
+  const QByteArray shown =
+      data.mid(offset, qMin<qsizetype>(length, MaxShownBytes));
+  QString text = QString::fromLatin1(shown.toHex(' ')).toUpper();
+  if (length > MaxShownBytes) {
+    text += " ...";
+  }
+  return text;
+}
+
+} // namespace
+
+// The packets kept by PacketView. Packet rows have an internal id of 0 and
+// field rows the absolute number of their packet plus one, which stays
+// valid as the oldest packets are dropped. Text is formatted only for the
+// rows the tree asks for.
+class PacketModel : public QAbstractItemModel {
+public:
+  PacketModel(const PacketDissector *dissector, QObject *parent)
+      : QAbstractItemModel(parent), m_dissector(dissector),
+        m_firstPacket(0) {}
+
+  // Takes packets as returned by PacketDissector::feed() together with
+  // their values
+  void addPackets(const QVector<PacketDissector::Packet> &packets,
+                  const QVector<PacketDissector::Value> &values) {
+    if (packets.isEmpty()) {
+      return;
+    }
+
+    // Dropped a quarter at a time, so that is not done for every batch
+    const int excess =
+        int(m_packets.size() + packets.size()) - PacketView::MaxPackets;
+    if (excess > 0 && !m_packets.isEmpty()) {
+      const int count = qMin(int(m_packets.size()),
+                             qMax(excess, PacketView::MaxPackets / 4));
+      const int valueCount = count < m_packets.size()
+                                 ? m_packets[count].firstValue
+                                 : int(m_values.size());
+      beginRemoveRows(QModelIndex(), 0, count - 1);
+      m_packets.remove(0, count);
+      m_values.remove(0, valueCount);
+      for (PacketDissector::Packet &packet : m_packets) {
+        packet.firstValue -= valueCount;
+      }
+      m_firstPacket += quint64(count);
+      endRemoveRows();
+    }
+
+    const int first = int(m_packets.size());
+    const int base = int(m_values.size());
+    beginInsertRows(QModelIndex(), first, first + int(packets.size()) - 1);
+    m_values += values;
+    for (PacketDissector::Packet packet : packets) {
+      packet.firstValue += base;
+      m_packets.append(packet);
+    }
+    endInsertRows();
+  }
+
+  void clear() {
+    beginResetModel();
+    m_packets.clear();
+    m_values.clear();
+    m_firstPacket = 0;
+    endResetModel();
+  }
+
+  int packetCount() const { return int(m_packets.size()); }
+
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent) const override {
+    if (row < 0 || column < 0 || column >= ColumnCount) {
+      return QModelIndex();
+    }
+    if (!parent.isValid()) {
+      return row < m_packets.size() ? createIndex(row, column, quintptr(0))
+                                    : QModelIndex();
+    }
+    if (parent.internalId() != 0 || row >= fieldCount(parent.row())) {
+      return QModelIndex();
+    }
+    return createIndex(row, column,
+                       quintptr(m_firstPacket + quint64(parent.row()) + 1));
+  }
+
+  QModelIndex parent(const QModelIndex &child) const override {
+    if (!child.isValid() || child.internalId() == 0) {
+      return QModelIndex();
+    }
+    return createIndex(packetRow(child), 0, quintptr(0));
+  }
+
+  int rowCount(const QModelIndex &parent) const override {
+    if (!parent.isValid()) {
+      return int(m_packets.size());
+    }
+    if (parent.internalId() != 0 || parent.column() != NameColumn) {
+      return 0;
+    }
+    return fieldCount(parent.row());
+  }
+
+  int columnCount(const QModelIndex &) const override { return ColumnCount; }
+
+  QVariant data(const QModelIndex &index, int role) const override {
+    if (!index.isValid() ||
+        (role != Qt::DisplayRole && role != Qt::ForegroundRole)) {
+      return QVariant();
+    }
+
+    if (index.internalId() == 0) {
+      const PacketDissector::Packet &packet = m_packets[index.row()];
+      if (role == Qt::ForegroundRole) {
+        return packet.valid ? QVariant() : QColor(Qt::red);
+      }
+      switch (index.column()) {
+      case NameColumn:
+        return m_dissector->layouts().at(packet.layout).name;
+      case TimeColumn:
+        return m_timestampFormatter.format(packet.timestamp);
+      case OffsetColumn:
+        return QString::number(packet.streamOffset);
+      case ValueColumn:
+        return packet.valid ? QString("%1 bytes").arg(packet.data.size())
+                            : QString("Checksum error");
+      case BytesColumn:
+        return hexBytes(packet.data, 0, packet.data.size());
+      }
+      return QVariant();
+    }
+
+    const PacketDissector::Packet &packet = m_packets[packetRow(index)];
+    const PacketDissector::Value &value =
+        m_values[packet.firstValue + index.row()];
+    const int field =
+        m_dissector->layouts().at(packet.layout).firstField + index.row();
+    if (role == Qt::ForegroundRole) {
+      return value.raw == value.expected ? QVariant() : QColor(Qt::red);
+    }
+    switch (index.column()) {
+    case NameColumn:
+      return m_dissector->fieldName(field);
+    case OffsetColumn:
+      return QString::number(value.offset);
+    case ValueColumn:
+      return m_dissector->formatValue(field, value, packet.data);
+    case BytesColumn:
+      return hexBytes(packet.data, value.offset, value.length);
+    }
+    return QVariant();
+  }
+
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role) const override {
+    static const char *const titles[ColumnCount] = {"Name", "Time", "Offset",
+                                                    "Value", "Bytes"};
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole ||
+        section < 0 || section >= ColumnCount) {
+      return QVariant();
+    }
+    return QString(titles[section]);
+  }
+
+private:
+  int fieldCount(int row) const {
+    return m_dissector->layouts().at(m_packets[row].layout).fieldCount;
+  }
+
+  int packetRow(const QModelIndex &field) const {
+    return int(quint64(field.internalId()) - 1 - m_firstPacket);
+  }
+
+  const PacketDissector *m_dissector;
+  QVector<PacketDissector::Packet> m_packets;
+  QVector<PacketDissector::Value> m_values;
+  quint64 m_firstPacket; // Absolute number of m_packets[0]
+  mutable TimestampFormatter m_timestampFormatter;
+};
+
+PacketView::PacketView(QWidget *parent)
+    : QWidget(parent), m_model(new PacketModel(&m_dissector, this)) {
+  QPushButton *loadButton = new QPushButton("Load Layout...", this);
+  QPushButton *clearButton = new QPushButton("Clear", this);
+  m_infoLabel = new QLabel(this);
+
+  m_treeView = new QTreeView(this);
+  m_treeView->setModel(m_model);
+  m_treeView->setUniformRowHeights(true);
+  m_treeView->setAlternatingRowColors(true);
+  m_treeView->header()->setStretchLastSection(true);
+
+  QHBoxLayout *controls = new QHBoxLayout;
+  controls->addWidget(loadButton);
+  controls->addWidget(clearButton);
+  controls->addWidget(m_infoLabel, 1);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addLayout(controls);
+  layout->addWidget(m_treeView, 1);
+
+  connect(loadButton, &QPushButton::clicked, this, &PacketView::chooseLayout);
+  connect(clearButton, &QPushButton::clicked, this, &PacketView::clear);
+
+  updateInfo();
+}
+
+bool PacketView::loadLayout(const QString &path) {
+  if (!m_dissector.loadFile(path)) {
+    return false;
+  }
+  m_layoutPath = path;
+  clear();
+  return true;
+}
+
+QString PacketView::layoutPath() const { return m_layoutPath; }
+
+QString PacketView::errorString() const { return m_dissector.errorString(); }
+
+void PacketView::addChunks(const QList<SerialChunk> &chunks) {
+  if (!m_dissector.isLoaded()) {
+    return;
+  }
+  // Nothing to keep up with while the dock is closed, but a packet cut
+  // short by the gap must not be completed by later bytes
+  if (!isVisible()) {
+    for (const SerialChunk &chunk : chunks) {
+      m_dissector.skip(chunk.data.size());
+    }
+    return;
+  }
+
+  QVector<PacketDissector::Packet> packets;
+  QVector<PacketDissector::Value> values;
+  for (const SerialChunk &chunk : chunks) {
+    m_dissector.feed(chunk.data.constData(), chunk.data.size(),
+                     SerialClock::toEpochNs(chunk.timestamp), packets,
+                     values);
+  }
+  if (!packets.isEmpty()) {
+    // Follow new packets unless the user scrolled up
+    QScrollBar *scrollBar = m_treeView->verticalScrollBar();
+    const bool atBottom = scrollBar->value() == scrollBar->maximum();
+    m_model->addPackets(packets, values);
+    if (atBottom) {
+      m_treeView->scrollToBottom();
+    }
+  }
+  updateInfo();
+}
+
+void PacketView::resetStream() { m_dissector.reset(); }
+
+void PacketView::clear() {
+  m_dissector.reset();
+  m_dissector.clearStatistics();
+  m_model->clear();
+  updateInfo();
+}
+
+void PacketView::chooseLayout() {
+  const QString path = QFileDialog::getOpenFileName(
+      this, "Load Packet Layout", m_layoutPath,
+      "Packet Layouts (*.txt *.layout);;All Files (*)");
+  if (path.isEmpty()) {
+    return;
+  }
+  if (!loadLayout(path)) {
+    QMessageBox::warning(this, "Load Packet Layout", errorString());
+  }
+}
+
+void PacketView::updateInfo() {
+  if (!m_dissector.isLoaded()) {
+    m_infoLabel->setText("No layout loaded");
+    return;
+  }
+  m_infoLabel->setText(QString("%1 packets, %2 checksum errors, %3 bytes "
+                               "skipped")
+                           .arg(m_model->packetCount())
+                           .arg(m_dissector.checksumErrors())
+                           .arg(m_dissector.skippedBytes()));
+}
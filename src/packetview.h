@@ -0,0 +1,52 @@
+#ifndef PACKETVIEW_H
+#define PACKETVIEW_H
+
+#include <QList>
+#include <QWidget>
+#include "packetdissector.h"
+#include "serialchunk.h"
+
+class PacketModel;
+class QLabel;
+class QTreeView;
+
+// Received packets of a binary protocol as a tree: one row per packet, its
+// decoded fields beneath. The layout comes from a file (see
+// PacketDissector); packets are cut out of the RX stream on their own,
+// whatever framing the console uses. Packets with a wrong checksum, and the
+// checksum itself, are shown in red.
+class PacketView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // Oldest packets are dropped past this many
+    static constexpr int MaxPackets = 50000;
+
+    explicit PacketView(QWidget *parent = nullptr);
+
+    bool loadLayout(const QString &path);
+    QString layoutPath() const;
+    QString errorString() const;
+
+    void addChunks(const QList<SerialChunk> &chunks);
+    // Drops a partially received packet, e.g. after reconnecting
+    void resetStream();
+
+public slots:
+    void clear();
+
+private slots:
+    void chooseLayout();
+
+private:
+    void updateInfo();
+
+    PacketDissector m_dissector;
+    QString m_layoutPath;
+    PacketModel *m_model;
+    QTreeView *m_treeView;
+    QLabel *m_infoLabel;
+};
+
+#endif // PACKETVIEW_H
@@ -0,0 +1,115 @@
+#include "plotterwindow.h"
+#include "plotview.h"
+#include <QCheckBox>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+namespace {
+
+const int MaxLineLength = 4096;
+
+} // namespace
+
+PlotterWindow::PlotterWindow(QWidget *parent)
+    : QWidget(parent, Qt::Window), m_skippedLines(0), m_dirty(false),
+      m_refreshTimer(new QTimer(this)) {
+  setWindowTitle("Plotter - SerialFlow");
+  resize(900, 500);
+
+  FrameDecoder::Options options;
+  options.type = FrameDecoder::Delimiter;
+  options.delimiter = "\n";
+  options.maxFrameSize = MaxLineLength;
+  m_lineDecoder = FrameDecoder::create(options);
+
+  m_view = new PlotView(this);
+  m_view->setStore(&m_store);
+
+  m_windowComboBox = new QComboBox(this);
+  m_windowComboBox->addItem("1 s", 1000000000LL);
+  m_windowComboBox->addItem("10 s", 10000000000LL);
+  m_windowComboBox->addItem("1 min", 60000000000LL);
+  m_windowComboBox->addItem("10 min", 600000000000LL);
+  m_windowComboBox->setCurrentIndex(1);
+
+  m_pauseCheckBox = new QCheckBox("Pause", this);
+  QPushButton *clearButton = new QPushButton("Clear", this);
+  m_infoLabel = new QLabel(this);
+
+  QHBoxLayout *controls = new QHBoxLayout;
+  controls->addWidget(new QLabel("Window:", this));
+  controls->addWidget(m_windowComboBox);
+  controls->addWidget(m_pauseCheckBox);
+  controls->addWidget(clearButton);
+  controls->addWidget(m_infoLabel, 1);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addLayout(controls);
+  layout->addWidget(m_view, 1);
+
+  connect(m_windowComboBox,
+          QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          [this]() {
+            m_view->setWindow(m_windowComboBox->currentData().toLongLong());
+          });
+  connect(m_pauseCheckBox, &QCheckBox::toggled, m_view, &PlotView::setPaused);
+  connect(clearButton, &QPushButton::clicked, this, &PlotterWindow::clear);
+  connect(m_refreshTimer, &QTimer::timeout, this, &PlotterWindow::refresh);
+
+  m_view->setWindow(m_windowComboBox->currentData().toLongLong());
+  m_refreshTimer->start(RefreshIntervalMs);
+  updateInfo();
+}
+
+void PlotterWindow::addChunks(const QList<SerialChunk> &chunks) {
+  // Nothing to keep up with while the window is closed
+  if (!isVisible()) {
+    return;
+  }
+
+  // Rows are stamped with the read that completed their line
+  for (const SerialChunk &chunk : chunks) {
+    m_lineDecoder->feed(chunk.data, m_lines);
+    for (const FrameDecoder::Frame &line : std::as_const(m_lines)) {
+      if (!m_store.appendLine(line.payload, chunk.timestamp)) {
+        ++m_skippedLines;
+      }
+    }
+    m_lines.clear();
+  }
+  m_dirty = true;
+}
+
+void PlotterWindow::resetLine() { m_lineDecoder->reset(); }
+
+void PlotterWindow::clear() {
+  m_store.clear();
+  m_skippedLines = 0;
+  m_view->update();
+  updateInfo();
+}
+
+void PlotterWindow::refresh() {
+  if (!m_dirty) {
+    return;
+  }
+  m_dirty = false;
+  if (!m_view->isPaused()) {
+    m_view->update();
+  }
+  updateInfo();
+}
+
+void PlotterWindow::updateInfo() {
+  QString info = QString("%1 channel(s), %2 sample(s)")
+                     .arg(m_store.channelCount())
+                     .arg(m_store.end() - m_store.begin());
+  if (m_skippedLines > 0) {
+    info += QString(", %1 line(s) without numbers").arg(m_skippedLines);
+  }
+  m_infoLabel->setText(info);
+}
@@ -0,0 +1,54 @@
+#ifndef PLOTTERWINDOW_H
+#define PLOTTERWINDOW_H
+
+#include <QList>
+#include <QWidget>
+#include <memory>
+#include "framedecoder.h"
+#include "serialchunk.h"
+#include "telemetrystore.h"
+
+class PlotView;
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QTimer;
+
+// Plots the numeric fields of every received line, e.g. a device printing
+// "12.5,-3.1,880" at 1 kHz. Lines are split out of the RX stream on their
+// own, whatever framing the console uses, and the plot is repainted at
+// most once per display frame however fast they arrive.
+class PlotterWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RefreshIntervalMs = 16;
+
+    explicit PlotterWindow(QWidget *parent = nullptr);
+
+    void addChunks(const QList<SerialChunk> &chunks);
+    // Drops a partially received line, e.g. after reconnecting
+    void resetLine();
+
+private slots:
+    void clear();
+    void refresh();
+
+private:
+    void updateInfo();
+
+    TelemetryStore m_store;
+    std::unique_ptr<FrameDecoder> m_lineDecoder;
+    QList<FrameDecoder::Frame> m_lines;
+    quint64 m_skippedLines; // lines without a number
+    bool m_dirty;
+
+    PlotView *m_view;
+    QComboBox *m_windowComboBox;
+    QCheckBox *m_pauseCheckBox;
+    QLabel *m_infoLabel;
+    QTimer *m_refreshTimer;
+};
+
+#endif // PLOTTERWINDOW_H
@@ -0,0 +1,203 @@
+#include "plotview.h"
+#include "telemetrystore.h"
+#include <QLineF>
+#include <QPainter>
+#include <iterator>
+
+namespace {
+
+const QColor ChannelColors[] = {
+    QColor("#2563eb"), QColor("#dc2626"), QColor("#16a34a"),
+    QColor("#d97706"), QColor("#7c3aed"), QColor("#0891b2"),
+    QColor("#db2777"), QColor("#65a30d")};
+
+const int GridLines = 4;
+
+QString formatValue(double value) { return QString::number(value, 'g', 5); }
+
+} // namespace
+
+PlotView::PlotView(QWidget *parent)
+    : QWidget(parent), m_store(nullptr), m_windowNs(10000000000LL),
+      m_paused(false), m_pausedEdge(0) {
+  setMinimumSize(200, 120);
+  setBackgroundRole(QPalette::Base);
+  setAutoFillBackground(true);
+}
+
+void PlotView::setStore(const TelemetryStore *store) {
+  m_store = store;
+  update();
+}
+
+void PlotView::setWindow(qint64 windowNs) {
+  m_windowNs = qMax<qint64>(1, windowNs);
+  update();
+}
+
+qint64 PlotView::window() const { return m_windowNs; }
+
+void PlotView::setPaused(bool paused) {
+  if (paused && !m_paused) {
+    m_pausedEdge = rightEdge();
+  }
+  m_paused = paused;
+  update();
+}
+
+bool PlotView::isPaused() const { return m_paused; }
+
+qint64 PlotView::rightEdge() const {
+  if (m_paused) {
+    return m_pausedEdge;
+  }
+  if (!m_store || m_store->end() == m_store->begin()) {
+    return 0;
+  }
+  return m_store->timestamp(m_store->end() - 1);
+}
+
+void PlotView::paintEvent(QPaintEvent *event) {
+  Q_UNUSED(event);
+  QPainter painter(this);
+  const QFontMetrics metrics = fontMetrics();
+  const QColor gridColor = palette().mid().color();
+  const QColor textColor = palette().text().color();
+
+  const int labelWidth = metrics.horizontalAdvance("-0.0000e+00");
+  const QRect plot = rect().adjusted(labelWidth + 8, 4, -4,
+                                     -metrics.height() - 4);
+  if (plot.width() <= 0 || plot.height() <= 0) {
+    return;
+  }
+  painter.setPen(gridColor);
+  painter.drawRect(plot.adjusted(0, 0, -1, -1));
+
+  // Time axis: seconds before the right edge
+  for (int i = 0; i <= GridLines; ++i) {
+    const int x = plot.left() + plot.width() * i / GridLines;
+    const double seconds = m_windowNs / 1e9 * (GridLines - i) / GridLines;
+    QRect label(x - 40, plot.bottom() + 2, 80, metrics.height());
+    Qt::Alignment align = Qt::AlignHCenter;
+    if (i == 0) {
+      label.moveLeft(x);
+      align = Qt::AlignLeft;
+    } else if (i == GridLines) {
+      label.moveRight(x);
+      align = Qt::AlignRight;
+    } else {
+      painter.setPen(gridColor);
+      painter.drawLine(x, plot.top(), x, plot.bottom());
+    }
+    painter.setPen(textColor);
+    painter.drawText(label, align,
+                     seconds > 0 ? "-" + formatValue(seconds) + " s" : "0 s");
+  }
+
+  if (!m_store || m_store->channelCount() == 0) {
+    painter.drawText(plot, Qt::AlignCenter,
+                     "Waiting for lines with numeric fields");
+    return;
+  }
+
+  // Rows falling into each pixel column; timestamps only ever increase
+  const int columns = plot.width();
+  const qint64 right = rightEdge();
+  const qint64 left = right - m_windowNs;
+  m_columnRows.resize(columns + 1);
+  for (int x = 0; x <= columns; ++x) {
+    const qint64 time = left + qint64(double(m_windowNs) * x / columns);
+    m_columnRows[x] = m_store->findRow(x == columns ? right + 1 : time);
+  }
+
+  const int channels = m_store->channelCount();
+  m_columns.resize(qsizetype(channels) * columns);
+  float low = 0;
+  float high = 0;
+  bool any = false;
+  for (int c = 0; c < channels; ++c) {
+    const TelemetryChannel &channel = m_store->channel(c);
+    Column *column = m_columns.data() + qsizetype(c) * columns;
+    for (int x = 0; x < columns; ++x, ++column) {
+      column->valid = channel.minMax(m_columnRows[x], m_columnRows[x + 1],
+                                     column->min, column->max);
+      if (column->valid) {
+        low = any ? qMin(low, column->min) : column->min;
+        high = any ? qMax(high, column->max) : column->max;
+        any = true;
+      }
+    }
+  }
+  if (!any) {
+    painter.drawText(plot, Qt::AlignCenter, "No samples in this window");
+    return;
+  }
+
+  // Autoscale with a little headroom
+  const float span = high > low ? high - low : qMax(1.0f, qAbs(high));
+  low -= span * 0.05f;
+  high += span * 0.05f;
+  const double scale = plot.height() / double(high - low);
+  auto yFor = [&](float value) {
+    return plot.bottom() - (value - low) * scale;
+  };
+
+  for (int i = 0; i <= GridLines; ++i) {
+    const int y = plot.bottom() - plot.height() * i / GridLines;
+    painter.setPen(gridColor);
+    painter.drawLine(plot.left(), y, plot.right(), y);
+    painter.setPen(textColor);
+    painter.drawText(QRect(0, y - metrics.height() / 2, labelWidth + 4,
+                           metrics.height()),
+                     Qt::AlignRight | Qt::AlignVCenter,
+                     formatValue(low + (high - low) * i / GridLines));
+  }
+
+  // One vertical stroke per column, joined to the previous column with data
+  // at the closest values of the two ranges
+  QVector<QLineF> lines;
+  painter.setClipRect(plot);
+  for (int c = 0; c < channels; ++c) {
+    const Column *column = m_columns.constData() + qsizetype(c) * columns;
+    const Column *previous = nullptr;
+    int previousX = 0;
+    lines.clear();
+    for (int x = 0; x < columns; ++x, ++column) {
+      if (!column->valid) {
+        continue;
+      }
+      const double px = plot.left() + x + 0.5;
+      lines.append(QLineF(px, yFor(column->min), px, yFor(column->max)));
+      if (previous) {
+        const double from = plot.left() + previousX + 0.5;
+        if (column->min > previous->max) {
+          lines.append(QLineF(from, yFor(previous->max), px,
+                              yFor(column->min)));
+        } else if (column->max < previous->min) {
+          lines.append(QLineF(from, yFor(previous->min), px,
+                              yFor(column->max)));
+        } else {
+          const double y = yFor(qMax(previous->min, column->min));
+          lines.append(QLineF(from, y, px, y));
+        }
+      }
+      previous = column;
+      previousX = x;
+    }
+    painter.setPen(QPen(ChannelColors[c % std::size(ChannelColors)], 1));
+    painter.drawLines(lines);
+  }
+  painter.setClipping(false);
+
+  // Legend
+  int x = plot.left() + 6;
+  const int y = plot.top() + 4;
+  for (int c = 0; c < channels; ++c) {
+    const QString name = m_store->channelName(c);
+    painter.fillRect(x, y + metrics.height() / 2 - 1, 12, 3,
+                     ChannelColors[c % std::size(ChannelColors)]);
+    painter.setPen(textColor);
+    painter.drawText(x + 16, y + metrics.ascent(), name);
+    x += 16 + metrics.horizontalAdvance(name) + 12;
+  }
+}
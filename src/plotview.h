@@ -0,0 +1,52 @@
+#ifndef PLOTVIEW_H
+#define PLOTVIEW_H
+
+#include <QVector>
+#include <QWidget>
+
+class TelemetryStore;
+
+// Scrolling time plot of a TelemetryStore. Every pixel column is drawn as
+// the min/max of the samples that fall into it, taken from the channels'
+// pyramids, so painting costs the same for a second or ten minutes of data
+// and no spike is ever lost to decimation. The y axis follows the visible
+// data.
+class PlotView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PlotView(QWidget *parent = nullptr);
+
+    void setStore(const TelemetryStore *store);
+    void setWindow(qint64 windowNs);
+    qint64 window() const;
+
+    // While paused the right edge stays put and new samples are not shown
+    void setPaused(bool paused);
+    bool isPaused() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    struct Column
+    {
+        float min;
+        float max;
+        bool valid;
+    };
+
+    qint64 rightEdge() const;
+
+    const TelemetryStore *m_store;
+    qint64 m_windowNs;
+    bool m_paused;
+    qint64 m_pausedEdge;
+
+    // Scratch space reused by every paint
+    QVector<quint64> m_columnRows; // first row of each column, plus the end
+    QVector<Column> m_columns;     // channel after channel
+};
+
+#endif // PLOTVIEW_H
@@ -0,0 +1,463 @@
+#include "portbridge.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+#include <QNetworkDatagram>
+#include <QScopedValueRollback>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QtEndian>
+#include <algorithm>
+
+namespace {
+
+// Telnet (RFC 854) commands and the options we take part in
+constexpr quint8 Se = 240;
+constexpr quint8 Sb = 250;
+constexpr quint8 Will = 251;
+constexpr quint8 Wont = 252;
+constexpr quint8 Do = 253;
+constexpr quint8 Dont = 254;
+constexpr quint8 Iac = 255;
+
+constexpr quint8 BinaryOption = 0;
+constexpr quint8 SuppressGoAheadOption = 3;
+constexpr quint8 ComPortOption = 44;
+
+// RFC 2217 client commands; the server answers with the command plus 100
+constexpr quint8 SetBaudRate = 1;
+constexpr quint8 SetDataSize = 2;
+constexpr quint8 SetParity = 3;
+constexpr quint8 SetStopSize = 4;
+constexpr quint8 ServerOffset = 100;
+
+// Kernel buffer for a client's input; reading pauses while the port's TX
+// queue is full, and this bounds what piles up on our side meanwhile
+constexpr qint64 ClientReadBufferBytes = 64 * 1024;
+
+bool supportedOption(quint8 option) {
+  return option == BinaryOption || option == SuppressGoAheadOption ||
+         option == ComPortOption;
+}
+
+quint8 parityCode(QSerialPort::Parity parity) {
+  switch (parity) {
+  case QSerialPort::OddParity:
+    return 2;
+  case QSerialPort::EvenParity:
+    return 3;
+  case QSerialPort::MarkParity:
+    return 4;
+  case QSerialPort::SpaceParity:
+    return 5;
+  default:
+    return 1;
+  }
+}
+
+quint8 stopSizeCode(QSerialPort::StopBits stopBits) {
+  switch (stopBits) {
+  case QSerialPort::TwoStop:
+    return 2;
+  case QSerialPort::OneAndHalfStop:
+    return 3;
+  default:
+    return 1;
+  }
+}
+
+// Appends data with every IAC doubled, as the telnet data stream requires
+void appendEscaped(QByteArray &out, const char *data, qsizetype length) {
+  const char *end = data + length;
+  while (data != end) {
+    const char *iac = std::find(data, end, char(Iac));
+    out.append(data, iac - data);
+    if (iac == end) {
+      break;
+    }
+    out.append(char(Iac)).append(char(Iac));
+    data = iac + 1;
+  }
+}
+
+} // namespace
+
+PortBridge::PortBridge(SerialPortManager *port, QObject *parent)
+    : QObject(parent), m_port(port), m_servers{nullptr, nullptr},
+      m_udpSocket(nullptr), m_droppedBytes(0), m_readingClient(false) {
+  connect(m_port, &SerialPortManager::dataReceived, this,
+          &PortBridge::onDataReceived);
+  connect(m_port, &SerialPortManager::txQueueChanged, this,
+          &PortBridge::onTxQueueChanged);
+}
+
+PortBridge::~PortBridge() { stop(); }
+
+bool PortBridge::listenTcp(Protocol protocol, const QHostAddress &address,
+                           quint16 port) {
+  QTcpServer *&server = m_servers[protocol];
+  delete server;
+  server = new QTcpServer(this);
+  if (!server->listen(address, port)) {
+    m_errorString = server->errorString();
+    delete server;
+    server = nullptr;
+    return false;
+  }
+  connect(server, &QTcpServer::newConnection, this,
+          &PortBridge::onNewConnection);
+  return true;
+}
+
+bool PortBridge::listenUdp(const QHostAddress &address, quint16 port) {
+  delete m_udpSocket;
+  m_udpPeers.clear();
+  m_udpSocket = new QUdpSocket(this);
+  if (!m_udpSocket->bind(address, port)) {
+    m_errorString = m_udpSocket->errorString();
+    delete m_udpSocket;
+    m_udpSocket = nullptr;
+    return false;
+  }
+  connect(m_udpSocket, &QUdpSocket::readyRead, this,
+          &PortBridge::onUdpReadyRead);
+  return true;
+}
+
+void PortBridge::stop() {
+  const bool hadClients = clientCount() > 0;
+  for (QTcpServer *&server : m_servers) {
+    delete server;
+    server = nullptr;
+  }
+  delete m_udpSocket;
+  m_udpSocket = nullptr;
+  m_udpPeers.clear();
+
+  // Detach first so the disconnected() signal does not come back to us
+  for (const std::unique_ptr<Client> &client : m_clients) {
+    client->socket->disconnect(this);
+    client->socket->abort();
+    client->socket->deleteLater();
+  }
+  m_clients.clear();
+  if (hadClients) {
+    emit clientsChanged(0);
+  }
+}
+
+bool PortBridge::isListening() const {
+  return m_servers[RawTcp] || m_servers[Rfc2217] || m_udpSocket;
+}
+
+quint16 PortBridge::tcpPort(Protocol protocol) const {
+  return m_servers[protocol] ? m_servers[protocol]->serverPort() : 0;
+}
+
+quint16 PortBridge::udpPort() const {
+  return m_udpSocket ? m_udpSocket->localPort() : 0;
+}
+
+QString PortBridge::errorString() const { return m_errorString; }
+
+int PortBridge::clientCount() const {
+  return int(m_clients.size()) + int(m_udpPeers.size());
+}
+
+quint64 PortBridge::droppedBytes() const { return m_droppedBytes; }
+
+void PortBridge::onNewConnection() {
+  auto *server = qobject_cast<QTcpServer *>(sender());
+  while (QTcpSocket *socket = server->nextPendingConnection()) {
+    auto client = std::make_unique<Client>();
+    client->socket = socket;
+    client->protocol = server == m_servers[Rfc2217] ? Rfc2217 : RawTcp;
+    socket->setParent(this);
+    socket->setReadBufferSize(ClientReadBufferBytes);
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    Client *raw = client.get();
+    connect(socket, &QTcpSocket::readyRead, this,
+            [this, raw]() { readClient(*raw); });
+    connect(socket, &QTcpSocket::disconnected, this,
+            [this, socket]() { removeClient(socket); });
+    m_clients.push_back(std::move(client));
+
+    if (raw->protocol == Rfc2217) {
+      // Offer what a serial client needs up front; the client normally
+      // announces COM-PORT-OPTION itself
+      negotiate(*raw, Will, BinaryOption);
+      negotiate(*raw, Do, BinaryOption);
+      negotiate(*raw, Will, SuppressGoAheadOption);
+      negotiate(*raw, Will, ComPortOption);
+    }
+    emit clientsChanged(clientCount());
+  }
+}
+
+void PortBridge::onDataReceived(const QByteArray &data) {
+  if (data.isEmpty()) {
+    return;
+  }
+
+  bool escaped = false;
+  for (const std::unique_ptr<Client> &client : m_clients) {
+    const QByteArray *payload = &data;
+    if (client->protocol == Rfc2217) {
+      if (!escaped) {
+        m_escaped.clear();
+        appendEscaped(m_escaped, data.constData(), data.size());
+        escaped = true;
+      }
+      payload = &m_escaped;
+    }
+
+    // A client that cannot keep up loses this chunk; it must not hold up
+    // the port or grow without bound
+    QTcpSocket *socket = client->socket;
+    if (socket->bytesToWrite() + payload->size() > ClientQueueBytes) {
+      m_droppedBytes += quint64(data.size());
+      continue;
+    }
+    socket->write(*payload);
+  }
+
+  if (m_udpSocket && !m_udpPeers.isEmpty()) {
+    expireUdpPeers();
+    for (const UdpPeer &peer : std::as_const(m_udpPeers)) {
+      for (qsizetype offset = 0; offset < data.size();
+           offset += MaxDatagramSize) {
+        const qsizetype length =
+            qMin<qsizetype>(MaxDatagramSize, data.size() - offset);
+        // A full socket buffer drops the datagram, which is what UDP means
+        if (m_udpSocket->writeDatagram(data.constData() + offset, length,
+                                       peer.address, peer.port) < 0) {
+          m_droppedBytes += quint64(length);
+        }
+      }
+    }
+  }
+}
+
+void PortBridge::onTxQueueChanged(qint64 queuedBytes) {
+  // readClient() checks the queue itself between reads
+  if (queuedBytes >= TxBacklogBytes || m_readingClient) {
+    return;
+  }
+  // Input left unread while the queue was full
+  for (const std::unique_ptr<Client> &client : m_clients) {
+    if (client->socket->bytesAvailable() > 0) {
+      readClient(*client);
+    }
+  }
+}
+
+void PortBridge::onUdpReadyRead() {
+  bool peersChanged = false;
+  while (m_udpSocket->hasPendingDatagrams()) {
+    const QNetworkDatagram datagram = m_udpSocket->receiveDatagram();
+    if (!datagram.isValid()) {
+      break;
+    }
+
+    const qint64 now = SerialClock::nowNs();
+    auto it = std::find_if(m_udpPeers.begin(), m_udpPeers.end(),
+                           [&datagram](const UdpPeer &peer) {
+                             return peer.port == datagram.senderPort() &&
+                                    peer.address == datagram.senderAddress();
+                           });
+    if (it != m_udpPeers.end()) {
+      it->lastSeenNs = now;
+    } else {
+      m_udpPeers.append(
+          UdpPeer{datagram.senderAddress(), quint16(datagram.senderPort()),
+                  now});
+      peersChanged = true;
+    }
+
+    const QByteArray data = datagram.data();
+    if (!data.isEmpty() && m_port->isOpen()) {
+      m_port->sendData(data);
+    }
+  }
+  if (peersChanged) {
+    emit clientsChanged(clientCount());
+  }
+}
+
+void PortBridge::readClient(Client &client) {
+  QTcpSocket *socket = client.socket;
+  QByteArray data;
+  const QScopedValueRollback<bool> guard(m_readingClient, true);
+  while (socket->bytesAvailable() > 0) {
+    // Leave the rest in the socket so TCP slows the sender down
+    if (m_port->txQueuedBytes() >= TxBacklogBytes) {
+      break;
+    }
+    const QByteArray input = socket->read(ClientReadBufferBytes);
+    data.clear();
+    if (client.protocol == Rfc2217) {
+      decodeTelnet(client, input, data);
+    } else {
+      data = input;
+    }
+    if (data.isEmpty()) {
+      continue;
+    }
+    if (!m_port->isOpen()) {
+      // Nowhere to send it; discard rather than let it queue up
+      continue;
+    }
+    m_port->sendData(data);
+  }
+}
+
+void PortBridge::removeClient(QTcpSocket *socket) {
+  auto it = std::find_if(m_clients.begin(), m_clients.end(),
+                         [socket](const std::unique_ptr<Client> &client) {
+                           return client->socket == socket;
+                         });
+  if (it == m_clients.end()) {
+    return;
+  }
+  socket->disconnect(this);
+  m_clients.erase(it);
+  socket->deleteLater();
+  emit clientsChanged(clientCount());
+}
+
+void PortBridge::decodeTelnet(Client &client, const QByteArray &input,
+                              QByteArray &data) {
+  data.reserve(input.size());
+  for (const char ch : input) {
+    const quint8 byte = quint8(ch);
+    switch (client.state) {
+    case TelnetData:
+      if (byte == Iac) {
+        client.state = TelnetIac;
+      } else {
+        data.append(ch);
+      }
+      break;
+    case TelnetIac:
+      if (byte == Iac) {
+        data.append(ch);
+        client.state = TelnetData;
+      } else if (byte >= Will && byte <= Dont) {
+        client.command = byte;
+        client.state = TelnetOption;
+      } else if (byte == Sb) {
+        client.subnegotiation.clear();
+        client.state = TelnetSub;
+      } else {
+        // NOP, go-ahead and the like carry nothing for the port
+        client.state = TelnetData;
+      }
+      break;
+    case TelnetOption:
+      // Agree to the options we support and refuse the rest; an option
+      // already in the requested state gets no answer, which keeps the
+      // negotiation from looping
+      if (client.command == Do) {
+        negotiate(client, supportedOption(byte) ? Will : Wont, byte);
+      } else if (client.command == Will) {
+        negotiate(client, supportedOption(byte) ? Do : Dont, byte);
+      } else if (client.command == Dont) {
+        negotiate(client, Wont, byte);
+      } else {
+        negotiate(client, Dont, byte);
+      }
+      client.state = TelnetData;
+      break;
+    case TelnetSub:
+      if (byte == Iac) {
+        client.state = TelnetSubIac;
+      } else {
+        client.subnegotiation.append(ch);
+      }
+      break;
+    case TelnetSubIac:
+      if (byte == Iac) {
+        client.subnegotiation.append(ch);
+        client.state = TelnetSub;
+      } else {
+        if (byte == Se) {
+          handleSubnegotiation(client);
+        }
+        client.state = TelnetData;
+      }
+      break;
+    }
+  }
+}
+
+void PortBridge::negotiate(Client &client, quint8 command, quint8 option) {
+  // WILL and WONT describe one state, as do DO and DONT
+  const int key = (command == Will || command == Wont) ? 0 : 1;
+  const int agreed = command == Will || command == Do;
+  const int entry = (key << 9) | (agreed << 8) | option;
+  const int opposite = entry ^ (1 << 8);
+  if (client.negotiated.contains(entry)) {
+    return;
+  }
+  client.negotiated.remove(opposite);
+  client.negotiated.insert(entry);
+
+  const char reply[] = {char(Iac), char(command), char(option)};
+  client.socket->write(reply, sizeof(reply));
+}
+
+void PortBridge::handleSubnegotiation(Client &client) {
+  const QByteArray &sub = client.subnegotiation;
+  if (sub.size() < 2 || quint8(sub[0]) != ComPortOption) {
+    return;
+  }
+
+  // The port belongs to whoever opened it, so every request is answered
+  // with the settings in effect; a value of 0 is a plain query anyway
+  const quint8 command = quint8(sub[1]);
+  QByteArray value;
+  switch (command) {
+  case SetBaudRate: {
+    char baud[4];
+    qToBigEndian(quint32(m_port->baudRate()), baud);
+    value = QByteArray(baud, sizeof(baud));
+    break;
+  }
+  case SetDataSize:
+    value = QByteArray(1, char(m_port->dataBits()));
+    break;
+  case SetParity:
+    value = QByteArray(1, char(parityCode(m_port->parity())));
+    break;
+  case SetStopSize:
+    value = QByteArray(1, char(stopSizeCode(m_port->stopBits())));
+    break;
+  default:
+    // Flow control, line state masks, purges: acknowledge as requested
+    if (command >= ServerOffset) {
+      return;
+    }
+    value = sub.mid(2);
+    break;
+  }
+
+  QByteArray reply;
+  reply.append(char(Iac)).append(char(Sb)).append(char(ComPortOption));
+  reply.append(char(command + ServerOffset));
+  appendEscaped(reply, value.constData(), value.size());
+  reply.append(char(Iac)).append(char(Se));
+  client.socket->write(reply);
+}
+
+void PortBridge::expireUdpPeers() {
+  const qint64 cutoff =
+      SerialClock::nowNs() - qint64(UdpPeerTimeoutMs) * 1000000;
+  const qsizetype removed =
+      m_udpPeers.removeIf([cutoff](const UdpPeer &peer) {
+        return peer.lastSeenNs < cutoff;
+      });
+  if (removed > 0) {
+    emit clientsChanged(clientCount());
+  }
+}
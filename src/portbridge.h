@@ -0,0 +1,120 @@
+#ifndef PORTBRIDGE_H
+#define PORTBRIDGE_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <memory>
+#include <vector>
+
+class QTcpServer;
+class QTcpSocket;
+class QUdpSocket;
+class SerialPortManager;
+
+// Shares an open port with network clients: raw TCP, telnet with the RFC
+// 2217 COM port option, and UDP, all at the same time. Received data fans
+// out to every client; what clients send is merged into the port's TX
+// queue.
+//
+// A slow client never holds up the port or the other clients: each TCP
+// client has a bounded queue, and received data that does not fit is
+// dropped for that client alone and counted. In the other direction, client
+// input is left unread while the port's TX queue is over its backlog, so
+// TCP flow control pushes back on whoever is sending too fast.
+//
+// RFC 2217 clients can query the line settings but not change them; the
+// port is configured by whoever opened it.
+class PortBridge : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Protocol {
+        RawTcp,
+        Rfc2217
+    };
+
+    static constexpr qint64 ClientQueueBytes = 256 * 1024; // per TCP client
+    static constexpr qint64 TxBacklogBytes = 64 * 1024;     // then pause input
+    static constexpr int MaxDatagramSize = 1472;
+    static constexpr int UdpPeerTimeoutMs = 60000;          // without traffic
+
+    explicit PortBridge(SerialPortManager *port, QObject *parent = nullptr);
+    ~PortBridge();
+
+    // Port 0 picks a free one; see tcpPort()
+    bool listenTcp(Protocol protocol, const QHostAddress &address,
+                   quint16 port);
+    // Any datagram, even an empty one, subscribes its sender to received
+    // data for UdpPeerTimeoutMs
+    bool listenUdp(const QHostAddress &address, quint16 port);
+    void stop();
+    bool isListening() const;
+    quint16 tcpPort(Protocol protocol) const;
+    quint16 udpPort() const;
+    QString errorString() const;
+
+    // TCP connections and UDP peers heard from recently
+    int clientCount() const;
+    // Received bytes not delivered to slow clients, summed over clients
+    quint64 droppedBytes() const;
+
+signals:
+    void clientsChanged(int count);
+
+private slots:
+    void onNewConnection();
+    void onDataReceived(const QByteArray &data);
+    void onTxQueueChanged(qint64 queuedBytes);
+    void onUdpReadyRead();
+
+private:
+    enum TelnetState {
+        TelnetData,
+        TelnetIac,
+        TelnetOption,
+        TelnetSub,
+        TelnetSubIac
+    };
+
+    struct Client
+    {
+        QTcpSocket *socket = nullptr;
+        Protocol protocol = RawTcp;
+        TelnetState state = TelnetData;
+        quint8 command = 0;     // WILL, WONT, DO or DONT awaiting an option
+        QByteArray subnegotiation;
+        QSet<int> negotiated;   // option states last sent, see negotiate()
+    };
+
+    struct UdpPeer
+    {
+        QHostAddress address;
+        quint16 port = 0;
+        qint64 lastSeenNs = 0;
+    };
+
+    void readClient(Client &client);
+    void removeClient(QTcpSocket *socket);
+    void decodeTelnet(Client &client, const QByteArray &input,
+                      QByteArray &data);
+    void negotiate(Client &client, quint8 command, quint8 option);
+    void handleSubnegotiation(Client &client);
+    void expireUdpPeers();
+
+    SerialPortManager *m_port;
+    QTcpServer *m_servers[2];
+    QUdpSocket *m_udpSocket;
+    std::vector<std::unique_ptr<Client>> m_clients;
+    QList<UdpPeer> m_udpPeers;
+    QString m_errorString;
+    quint64 m_droppedBytes;
+    QByteArray m_escaped; // RX with IAC doubled, for RFC 2217 clients
+    bool m_readingClient;
+};
+
+#endif // PORTBRIDGE_H
@@ -0,0 +1,117 @@
+#include "portsessionmanager.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+#include <QThread>
+
+PortSessionManager::PortSessionManager(QObject *parent)
+    : QObject(parent), m_nextId(0), m_policy(ThreadPerPort),
+      m_poolSize(QThread::idealThreadCount()), m_nextPoolThread(0) {}
+
+PortSessionManager::~PortSessionManager() {
+  // Managers hand their workers back through the pool threads, so they have
+  // to go before the threads are stopped.
+  closeAll();
+  for (QThread *thread : std::as_const(m_pool)) {
+    thread->quit();
+    thread->wait();
+    delete thread;
+  }
+}
+
+void PortSessionManager::setThreadPolicy(ThreadPolicy policy, int poolSize) {
+  m_policy = policy;
+  if (poolSize > 0) {
+    m_poolSize = poolSize;
+  }
+}
+
+PortSessionManager::ThreadPolicy PortSessionManager::threadPolicy() const {
+  return m_policy;
+}
+
+int PortSessionManager::openSession(const QString &portName,
+                                    qint32 baudRate,
+                                    QSerialPort::DataBits dataBits,
+                                    QSerialPort::StopBits stopBits,
+                                    QSerialPort::Parity parity) {
+  const int id = m_nextId;
+  SerialPortManager *manager = new SerialPortManager(this);
+  if (m_policy == SharedPool) {
+    manager->setIoThread(poolThread());
+  } else {
+    manager->setThreadedIo(true);
+  }
+
+  connect(manager, &SerialPortManager::chunkReceived, this,
+          [this, id](const SerialChunk &chunk) {
+            emit dataReceived(id, SerialClock::toEpochNs(chunk.timestamp),
+                              chunk.data);
+          });
+  connect(manager, &SerialPortManager::errorOccurred, this,
+          [this, id](const QString &error) { emit errorOccurred(id, error); });
+
+  if (!manager->openPort(portName, baudRate, dataBits, stopBits, parity)) {
+    delete manager;
+    return -1;
+  }
+
+  // Connected after opening so a failed open is not reported as a close
+  connect(manager, &SerialPortManager::connectionStatusChanged, this,
+          [this, id](bool connected) {
+            if (!connected) {
+              emit sessionClosed(id);
+            }
+          });
+
+  m_sessions.insert(id, {manager, portName});
+  ++m_nextId;
+  return id;
+}
+
+void PortSessionManager::closeSession(int id) {
+  auto it = m_sessions.find(id);
+  if (it == m_sessions.end()) {
+    return;
+  }
+
+  SerialPortManager *manager = it->manager;
+  m_sessions.erase(it);
+  manager->closePort();
+  delete manager;
+}
+
+void PortSessionManager::closeAll() {
+  const QList<int> ids = m_sessions.keys();
+  for (int id : ids) {
+    closeSession(id);
+  }
+}
+
+QList<int> PortSessionManager::sessionIds() const { return m_sessions.keys(); }
+
+SerialPortManager *PortSessionManager::manager(int id) const {
+  return m_sessions.value(id).manager;
+}
+
+QString PortSessionManager::portName(int id) const {
+  return m_sessions.value(id).portName;
+}
+
+bool PortSessionManager::sendData(int id, const QByteArray &data) {
+  SerialPortManager *target = manager(id);
+  return target && target->sendData(data);
+}
+
+QThread *PortSessionManager::poolThread() {
+  if (m_pool.size() < m_poolSize) {
+    QThread *thread = new QThread;
+    thread->setObjectName(QString("SerialPortIO-%1").arg(m_pool.size()));
+    thread->start(QThread::HighestPriority);
+    m_pool.append(thread);
+    return thread;
+  }
+
+  QThread *thread = m_pool.at(m_nextPoolThread);
+  m_nextPoolThread = (m_nextPoolThread + 1) % m_pool.size();
+  return thread;
+}
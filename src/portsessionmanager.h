@@ -0,0 +1,73 @@
+#ifndef PORTSESSIONMANAGER_H
+#define PORTSESSIONMANAGER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QSerialPort>
+#include <QString>
+
+class QThread;
+class SerialPortManager;
+
+// Runs several SerialPortManager instances at once. Every port is serviced
+// off the GUI thread, either by a thread of its own or by a fixed pool of
+// I/O threads shared round-robin between sessions, so reading scales with
+// cores instead of being serialized on one event loop.
+class PortSessionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ThreadPolicy {
+        ThreadPerPort,
+        SharedPool
+    };
+
+    explicit PortSessionManager(QObject *parent = nullptr);
+    ~PortSessionManager();
+
+    // Applies to sessions opened afterwards
+    void setThreadPolicy(ThreadPolicy policy, int poolSize = 0);
+    ThreadPolicy threadPolicy() const;
+
+    // Returns the new session id, or -1 if the port could not be opened
+    int openSession(const QString &portName,
+                    qint32 baudRate,
+                    QSerialPort::DataBits dataBits = QSerialPort::Data8,
+                    QSerialPort::StopBits stopBits = QSerialPort::OneStop,
+                    QSerialPort::Parity parity = QSerialPort::NoParity);
+    void closeSession(int id);
+    void closeAll();
+
+    QList<int> sessionIds() const;
+    SerialPortManager *manager(int id) const;
+    QString portName(int id) const;
+    bool sendData(int id, const QByteArray &data);
+
+signals:
+    // timestamp is nanoseconds since epoch, taken when the session's I/O
+    // thread read the chunk, so chunks from different ports can be ordered
+    void dataReceived(int id, qint64 timestamp, const QByteArray &data);
+    void errorOccurred(int id, const QString &error);
+    void sessionClosed(int id);
+
+private:
+    QThread *poolThread();
+
+    struct Session
+    {
+        SerialPortManager *manager;
+        QString portName;
+    };
+
+    QMap<int, Session> m_sessions;
+    int m_nextId;
+    ThreadPolicy m_policy;
+    int m_poolSize;
+    QList<QThread *> m_pool;
+    int m_nextPoolThread;
+};
+
+#endif // PORTSESSIONMANAGER_H
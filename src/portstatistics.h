@@ -0,0 +1,84 @@
+#ifndef PORTSTATISTICS_H
+#define PORTSTATISTICS_H
+
+#include <QMetaType>
+#include <QtGlobal>
+
+// Snapshot of one port's instrumentation, taken by SerialPortManager.
+// Totals count from when the port was opened; rates, latencies and peaks
+// cover the interval since the previous snapshot.
+struct PortStatistics
+{
+    // Power-of-two read sizes: 1, 2-3, 4-7, ... and 32 KiB or more
+    static constexpr int HistogramBuckets = 16;
+
+    struct Latency
+    {
+        qint64 minNs = 0;
+        qint64 maxNs = 0;
+        qint64 totalNs = 0;
+        quint64 samples = 0;
+
+        void add(qint64 ns)
+        {
+            minNs = samples ? qMin(minNs, ns) : ns;
+            maxNs = samples ? qMax(maxNs, ns) : ns;
+            totalNs += ns;
+            ++samples;
+        }
+        qint64 averageNs() const
+        {
+            return samples ? totalNs / qint64(samples) : 0;
+        }
+    };
+
+    static int bucketFor(qint64 size)
+    {
+        int bucket = 0;
+        while (size > 1 && bucket < HistogramBuckets - 1) {
+            size >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    qint64 timestamp = 0;  // ns since epoch
+    qint64 intervalNs = 0; // since the previous snapshot
+
+    // Traffic
+    quint64 rxBytes = 0;
+    quint64 rxChunks = 0;
+    quint64 txBytes = 0; // handed to the driver
+    double rxBytesPerSecond = 0;
+    double txBytesPerSecond = 0;
+    quint64 chunkSizes[HistogramBuckets] = {}; // reads, by size
+
+    // From the read to delivery in the manager's thread, and to display
+    // for chunks the UI reports through SerialPortManager::reportDisplayed()
+    Latency deliveryLatency;
+    Latency displayLatency;
+
+    // Fill levels
+    qint64 driverRxPeak = 0;   // most bytes waiting in the driver at a read
+    qint64 driverTxBytes = 0;  // buffered by the port for writing
+    qint64 txQueuedBytes = 0;  // queued by sendData(), not yet written
+    int rxQueuePeak = 0;       // chunks waiting for the consumer
+    int rxQueueCapacity = 0;
+
+    // Losses
+    quint64 droppedChunks = 0;
+    quint64 droppedBytes = 0;
+
+    // Line errors counted by the driver; only Linux serial drivers report
+    // them, PTYs and USB CDC devices usually do not
+    bool lineErrorsAvailable = false;
+    quint64 parityErrors = 0;
+    quint64 framingErrors = 0;
+    quint64 overrunErrors = 0;  // UART FIFO overruns
+    quint64 bufferOverruns = 0; // driver buffer overruns
+    quint64 breaks = 0;
+};
+
+Q_DECLARE_METATYPE(PortStatistics)
+
+#endif // PORTSTATISTICS_H
@@ -0,0 +1,65 @@
+#include "portwatcher.h"
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QSerialPortInfo>
+#include <QTimer>
+
+namespace {
+
+QStringList scanPorts() {
+  QStringList names;
+  const auto ports = QSerialPortInfo::availablePorts();
+  for (const QSerialPortInfo &info : ports) {
+    names.append(info.portName());
+  }
+  names.sort();
+  return names;
+}
+
+} // namespace
+
+PortWatcher::PortWatcher(QObject *parent)
+    : QObject(parent), m_watcher(new QFileSystemWatcher(this)),
+      m_rescanTimer(new QTimer(this)), m_ports(scanPorts()) {
+  connect(m_rescanTimer, &QTimer::timeout, this, &PortWatcher::rescan);
+
+#ifdef Q_OS_UNIX
+  // Serial device nodes are created and removed directly in /dev
+  if (QDir("/dev").exists() && m_watcher->addPath("/dev")) {
+    m_rescanTimer->setSingleShot(true);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this,
+            [this]() {
+              if (!m_rescanTimer->isActive()) {
+                m_rescanTimer->start(SettleDelayMs);
+              }
+            });
+    return;
+  }
+#endif
+  m_rescanTimer->start(PollIntervalMs);
+}
+
+QStringList PortWatcher::ports() const { return m_ports; }
+
+void PortWatcher::rescan() {
+  emit devicesChanged();
+  const QStringList ports = scanPorts();
+  if (ports == m_ports) {
+    return;
+  }
+
+  QStringList added;
+  QStringList removed;
+  for (const QString &port : ports) {
+    if (!m_ports.contains(port)) {
+      added.append(port);
+    }
+  }
+  for (const QString &port : std::as_const(m_ports)) {
+    if (!ports.contains(port)) {
+      removed.append(port);
+    }
+  }
+  m_ports = ports;
+  emit portsChanged(added, removed);
+}
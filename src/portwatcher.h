@@ -0,0 +1,43 @@
+#ifndef PORTWATCHER_H
+#define PORTWATCHER_H
+
+#include <QObject>
+#include <QStringList>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Reports serial ports appearing and disappearing. On Unix the device
+// directory is watched through QFileSystemWatcher (inotify on Linux), so a
+// port that udev creates is noticed within milliseconds and the port list
+// is only rescanned when /dev actually changed. Other platforms fall back
+// to rescanning on a timer.
+class PortWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int SettleDelayMs = 5;     // lets a burst of changes land
+    static constexpr int PollIntervalMs = 1000; // without a device directory
+
+    explicit PortWatcher(QObject *parent = nullptr);
+
+    // Port names as reported by QSerialPortInfo, sorted
+    QStringList ports() const;
+
+signals:
+    // Something changed in the device directory, even if the port list did
+    // not, as when udev fixes up the permissions of a new node
+    void devicesChanged();
+    void portsChanged(const QStringList &added, const QStringList &removed);
+
+private slots:
+    void rescan();
+
+private:
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_rescanTimer;
+    QStringList m_ports;
+};
+
+#endif // PORTWATCHER_H
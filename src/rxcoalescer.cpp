@@ -0,0 +1,50 @@
+#include "rxcoalescer.h"
+#include <QTimer>
+
+RxCoalescer::RxCoalescer(QObject *parent)
+    : QObject(parent), m_timer(new QTimer(this)),
+      m_flushRate(DefaultFlushRate), m_lastMergeCount(0), m_maxMergeCount(0),
+      m_flushCount(0) {
+  m_timer->setSingleShot(true);
+  m_timer->setTimerType(Qt::PreciseTimer);
+  connect(m_timer, &QTimer::timeout, this, &RxCoalescer::flush);
+  m_sinceFlush.start();
+}
+
+void RxCoalescer::setFlushRate(int hz) { m_flushRate = qBound(1, hz, 1000); }
+
+int RxCoalescer::flushRate() const { return m_flushRate; }
+
+int RxCoalescer::lastMergeCount() const { return m_lastMergeCount; }
+
+int RxCoalescer::maxMergeCount() const { return m_maxMergeCount; }
+
+quint64 RxCoalescer::flushCount() const { return m_flushCount; }
+
+void RxCoalescer::addChunk(const SerialChunk &chunk) {
+  m_pending.append(chunk);
+
+  if (!m_timer->isActive()) {
+    const qint64 period = 1000 / m_flushRate;
+    const qint64 remaining = period - m_sinceFlush.elapsed();
+    m_timer->start(static_cast<int>(qMax<qint64>(0, remaining)));
+  }
+}
+
+void RxCoalescer::flush() {
+  m_timer->stop();
+  if (m_pending.isEmpty()) {
+    return;
+  }
+
+  QList<SerialChunk> chunks;
+  chunks.swap(m_pending);
+  m_sinceFlush.restart();
+
+  m_lastMergeCount = chunks.size();
+  m_maxMergeCount = qMax(m_maxMergeCount, m_lastMergeCount);
+  ++m_flushCount;
+
+  emit chunksReady(chunks);
+  emit flushed(m_lastMergeCount);
+}
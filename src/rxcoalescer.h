@@ -0,0 +1,49 @@
+#ifndef RXCOALESCER_H
+#define RXCOALESCER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include "serialchunk.h"
+
+class QTimer;
+
+// Collects received chunks and hands them on in batches, at most once per
+// display frame. Sparse traffic is flushed as soon as the previous frame's
+// interval has elapsed, so coalescing only adds latency under load.
+class RxCoalescer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultFlushRate = 60; // Hz
+
+    explicit RxCoalescer(QObject *parent = nullptr);
+
+    void setFlushRate(int hz);
+    int flushRate() const;
+
+    // Statistics
+    int lastMergeCount() const;
+    int maxMergeCount() const;
+    quint64 flushCount() const;
+
+public slots:
+    void addChunk(const SerialChunk &chunk);
+    void flush();
+
+signals:
+    void chunksReady(const QList<SerialChunk> &chunks);
+    void flushed(int mergedChunks);
+
+private:
+    QTimer *m_timer;
+    QElapsedTimer m_sinceFlush;
+    QList<SerialChunk> m_pending;
+    int m_flushRate;
+    int m_lastMergeCount;
+    int m_maxMergeCount;
+    quint64 m_flushCount;
+};
+
+#endif // RXCOALESCER_H
@@ -0,0 +1,538 @@
+#include "scriptengine.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+#include <QFile>
+#include <QTimer>
+
+namespace {
+
+// Splits a statement into words; "quoted strings" and /regexes/flags stay
+// single tokens with their delimiters. Stops at a '#' outside of those.
+bool tokenize(const QString &line, QStringList &tokens, QString &error) {
+  tokens.clear();
+  qsizetype i = 0;
+  while (i < line.size()) {
+    const QChar c = line.at(i);
+    if (c.isSpace()) {
+      ++i;
+      continue;
+    }
+    if (c == '#') {
+      break;
+    }
+
+    const qsizetype start = i;
+    if (c == '"' || c == '/') {
+      ++i;
+      while (i < line.size() && line.at(i) != c) {
+        i += line.at(i) == '\\' ? 2 : 1;
+      }
+      if (i >= line.size()) {
+        error = c == '"' ? "unterminated string" : "unterminated regex";
+        return false;
+      }
+      ++i;
+      // Regex flags
+      while (c == '/' && i < line.size() && line.at(i).isLetter()) {
+        ++i;
+      }
+    } else {
+      while (i < line.size() && !line.at(i).isSpace()) {
+        ++i;
+      }
+    }
+    tokens.append(line.mid(start, i - start));
+  }
+  return true;
+}
+
+int hexValue(QChar c) {
+  if (c >= '0' && c <= '9') {
+    return c.unicode() - '0';
+  }
+  const QChar lower = c.toLower();
+  if (lower >= 'a' && lower <= 'f') {
+    return lower.unicode() - 'a' + 10;
+  }
+  return -1;
+}
+
+// Contents of a "quoted" token with its escapes resolved
+bool unquote(const QString &token, QByteArray &data, QString &error) {
+  if (token.size() < 2 || !token.startsWith('"')) {
+    error = "expected a quoted string";
+    return false;
+  }
+  data.clear();
+  const QString text = token.mid(1, token.size() - 2);
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    if (text.at(i) != '\\') {
+      data += QString(text.at(i)).toUtf8();
+      continue;
+    }
+    if (++i >= text.size()) {
+      break;
+    }
+    switch (text.at(i).unicode()) {
+    case 'n':
+      data += '\n';
+      break;
+    case 'r':
+      data += '\r';
+      break;
+    case 't':
+      data += '\t';
+      break;
+    case '0':
+      data += '\0';
+      break;
+    case 'x': {
+      const int high = i + 1 < text.size() ? hexValue(text.at(i + 1)) : -1;
+      const int low = i + 2 < text.size() ? hexValue(text.at(i + 2)) : -1;
+      if (high < 0 || low < 0) {
+        error = "\\x needs two hex digits";
+        return false;
+      }
+      data += char(high << 4 | low);
+      i += 2;
+      break;
+    }
+    default:
+      data += QString(text.at(i)).toUtf8();
+      break;
+    }
+  }
+  return true;
+}
+
+bool parseHexBytes(const QStringList &tokens, qsizetype from, QByteArray &data,
+                   QString &error) {
+  data.clear();
+  const QString digits = tokens.mid(from).join(QString()).remove(' ');
+  if (digits.isEmpty() || digits.size() % 2) {
+    error = "expected hex bytes";
+    return false;
+  }
+  for (qsizetype i = 0; i < digits.size(); i += 2) {
+    const int high = hexValue(digits.at(i));
+    const int low = hexValue(digits.at(i + 1));
+    if (high < 0 || low < 0) {
+      error = "expected hex bytes";
+      return false;
+    }
+    data += char(high << 4 | low);
+  }
+  return true;
+}
+
+bool parseNumber(const QStringList &tokens, qsizetype index, int &value) {
+  bool ok = false;
+  value = index < tokens.size() ? tokens.at(index).toInt(&ok) : -1;
+  return ok && value >= 0;
+}
+
+} // namespace
+
+ScriptEngine::ScriptEngine(SerialPortManager *port, QObject *parent)
+    : QObject(parent), m_port(port), m_timer(new QTimer(this)),
+      m_running(false), m_waiting(false), m_pc(0),
+      m_timeoutMs(DefaultTimeoutMs), m_searched(0), m_lastSendNs(0),
+      m_commandsSent(0), m_responsesMatched(0) {
+  m_timer->setSingleShot(true);
+  m_timer->setTimerType(Qt::PreciseTimer);
+  connect(m_timer, &QTimer::timeout, this, &ScriptEngine::onTimeout);
+  connect(m_port, &SerialPortManager::dataReceived, this,
+          &ScriptEngine::onDataReceived);
+  connect(m_port, &SerialPortManager::connectionStatusChanged, this,
+          [this](bool connected) {
+            if (!connected && m_running) {
+              finish(false, "Port closed while the script was running");
+            }
+          });
+}
+
+bool ScriptEngine::load(const QString &script) {
+  stop();
+  m_program.clear();
+  m_errorString.clear();
+
+  QVector<Instruction> program;
+  QHash<QString, int> labels;
+  const QStringList lines = script.split('\n');
+  for (int i = 0; i < lines.size(); ++i) {
+    if (!parseLine(lines.at(i), i + 1, program, labels)) {
+      return false;
+    }
+  }
+
+  // Resolve jump targets now that every label is known
+  for (Instruction &instruction : program) {
+    if (instruction.op != Goto && instruction.op != Loop &&
+        instruction.op != Expect) {
+      continue;
+    }
+    if (instruction.op == Expect && instruction.text.isEmpty()) {
+      continue;
+    }
+    if (!labels.contains(instruction.text)) {
+      m_errorString = QString("Line %1: unknown label '%2'")
+                          .arg(instruction.line)
+                          .arg(instruction.text);
+      return false;
+    }
+    instruction.target = labels.value(instruction.text);
+  }
+
+  m_program = program;
+  return true;
+}
+
+bool ScriptEngine::loadFile(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    m_errorString = "Cannot open " + path + ": " + file.errorString();
+    return false;
+  }
+  return load(QString::fromUtf8(file.readAll()));
+}
+
+QString ScriptEngine::errorString() const { return m_errorString; }
+
+bool ScriptEngine::start() {
+  if (m_running) {
+    return false;
+  }
+  if (m_program.isEmpty()) {
+    m_errorString = "No script loaded";
+    return false;
+  }
+  if (!m_port->isOpen()) {
+    m_errorString = "Port is not open";
+    return false;
+  }
+
+  m_running = true;
+  m_waiting = false;
+  m_pc = 0;
+  m_timeoutMs = DefaultTimeoutMs;
+  m_loopCounts.fill(0, m_program.size());
+  m_window.clear();
+  m_searched = 0;
+  m_commandsSent = 0;
+  m_responsesMatched = 0;
+  m_responseLatency = PortStatistics::Latency();
+  m_lastSendNs = SerialClock::nowNs();
+  run();
+  return true;
+}
+
+void ScriptEngine::stop() {
+  if (m_running) {
+    finish(false, "Stopped");
+  }
+}
+
+bool ScriptEngine::isRunning() const { return m_running; }
+
+quint64 ScriptEngine::commandsSent() const { return m_commandsSent; }
+
+quint64 ScriptEngine::responsesMatched() const { return m_responsesMatched; }
+
+PortStatistics::Latency ScriptEngine::responseLatency() const {
+  return m_responseLatency;
+}
+
+void ScriptEngine::onDataReceived(const QByteArray &data) {
+  if (!m_running) {
+    return;
+  }
+
+  m_window += data;
+  if (m_window.size() > MaxWindow) {
+    const qsizetype excess = m_window.size() - MaxWindow;
+    m_window.remove(0, excess);
+    m_searched = qMax<qsizetype>(0, m_searched - excess);
+  }
+
+  if (m_waiting && match(m_program.at(m_pc))) {
+    m_waiting = false;
+    m_timer->stop();
+    ++m_pc;
+    run();
+  }
+}
+
+void ScriptEngine::onTimeout() {
+  if (!m_running) {
+    return;
+  }
+  if (!m_waiting) {
+    run(); // end of a delay, or a yield
+    return;
+  }
+
+  m_waiting = false;
+  const Instruction &expect = m_program.at(m_pc);
+  if (expect.target < 0) {
+    finish(false, QString("Line %1: no response within %2 ms")
+                      .arg(expect.line)
+                      .arg(expect.value >= 0 ? expect.value : m_timeoutMs));
+    return;
+  }
+  m_pc = expect.target;
+  run();
+}
+
+void ScriptEngine::run() {
+  for (int steps = 0; m_running; ++steps) {
+    if (steps == MaxStepsPerSlice) {
+      // A loop without expects or delays must not freeze the event loop
+      m_timer->start(0);
+      return;
+    }
+    if (m_pc >= m_program.size()) {
+      finish(true, "Script complete");
+      return;
+    }
+
+    const Instruction &instruction = m_program.at(m_pc);
+    switch (instruction.op) {
+    case Send:
+      if (!m_port->sendData(instruction.data)) {
+        finish(false, QString("Line %1: send failed").arg(instruction.line));
+        return;
+      }
+      m_lastSendNs = SerialClock::nowNs();
+      ++m_commandsSent;
+      ++m_pc;
+      break;
+    case Expect:
+      m_searched = 0;
+      if (match(instruction)) {
+        ++m_pc;
+        break;
+      }
+      m_waiting = true;
+      m_timer->start(instruction.value >= 0 ? instruction.value : m_timeoutMs);
+      return;
+    case Delay:
+      ++m_pc;
+      m_timer->start(instruction.value);
+      return;
+    case Goto:
+      m_pc = instruction.target;
+      break;
+    case Loop:
+      if (++m_loopCounts[m_pc] < instruction.value) {
+        m_pc = instruction.target;
+      } else {
+        m_loopCounts[m_pc] = 0; // ready for the next pass of an outer loop
+        ++m_pc;
+      }
+      break;
+    case SetTimeout:
+      m_timeoutMs = instruction.value;
+      ++m_pc;
+      break;
+    case Print:
+      emit message(instruction.text);
+      ++m_pc;
+      break;
+    case Flush:
+      m_window.clear();
+      ++m_pc;
+      break;
+    case Fail:
+      finish(false, instruction.text);
+      return;
+    case End:
+      finish(true, "Script complete");
+      return;
+    }
+  }
+}
+
+bool ScriptEngine::parseLine(const QString &line, int lineNumber,
+                             QVector<Instruction> &program,
+                             QHash<QString, int> &labels) {
+  QStringList tokens;
+  QString error;
+  auto fail = [&](const QString &reason) {
+    m_errorString = QString("Line %1: %2").arg(lineNumber).arg(reason);
+    return false;
+  };
+  if (!tokenize(line, tokens, error)) {
+    return fail(error);
+  }
+  if (tokens.isEmpty()) {
+    return true;
+  }
+
+  const QString command = tokens.first().toLower();
+  Instruction instruction;
+  instruction.line = lineNumber;
+
+  if (command == "label") {
+    if (tokens.size() != 2 || labels.contains(tokens.at(1))) {
+      return fail("label needs a new, unique name");
+    }
+    labels.insert(tokens.at(1), program.size());
+    return true;
+  } else if (command == "send") {
+    instruction.op = Send;
+    if (tokens.size() != 2 || !unquote(tokens.at(1), instruction.data, error)) {
+      return fail(error.isEmpty() ? "send needs one quoted string" : error);
+    }
+  } else if (command == "sendhex") {
+    instruction.op = Send;
+    if (!parseHexBytes(tokens, 1, instruction.data, error)) {
+      return fail(error);
+    }
+  } else if (command == "expect" || command == "expecthex") {
+    instruction.op = Expect;
+    qsizetype next = 2;
+    if (command == "expecthex") {
+      // Hex bytes run up to the optional timeout and else clause
+      next = 1;
+      while (next < tokens.size() && tokens.at(next).size() == 2 &&
+             hexValue(tokens.at(next).at(0)) >= 0 &&
+             hexValue(tokens.at(next).at(1)) >= 0) {
+        ++next;
+      }
+      if (!parseHexBytes(tokens.mid(0, next), 1, instruction.data, error)) {
+        return fail(error);
+      }
+    } else if (tokens.size() > 1 && tokens.at(1).startsWith('/')) {
+      const QString token = tokens.at(1);
+      const qsizetype end = token.lastIndexOf('/');
+      QRegularExpression::PatternOptions options =
+          QRegularExpression::NoPatternOption;
+      for (QChar flag : token.mid(end + 1)) {
+        if (flag == 'i') {
+          options |= QRegularExpression::CaseInsensitiveOption;
+        } else if (flag == 's') {
+          options |= QRegularExpression::DotMatchesEverythingOption;
+        } else {
+          return fail(QString("unknown regex flag '%1'").arg(flag));
+        }
+      }
+      instruction.regex = QRegularExpression(token.mid(1, end - 1), options);
+      if (!instruction.regex.isValid()) {
+        return fail("invalid regex: " + instruction.regex.errorString());
+      }
+      instruction.regex.optimize();
+      instruction.useRegex = true;
+    } else if (tokens.size() < 2 ||
+               !unquote(tokens.at(1), instruction.data, error)) {
+      return fail(error.isEmpty() ? "expect needs a pattern" : error);
+    }
+    if (!instruction.useRegex) {
+      if (instruction.data.isEmpty()) {
+        return fail("empty pattern");
+      }
+      instruction.matcher.setPattern(instruction.data);
+    }
+
+    // [MS] [else LABEL]
+    if (next < tokens.size() && tokens.at(next).toLower() != "else") {
+      if (!parseNumber(tokens, next, instruction.value)) {
+        return fail("expected a timeout in ms");
+      }
+      ++next;
+    }
+    if (next < tokens.size()) {
+      if (tokens.at(next).toLower() != "else" || next + 2 != tokens.size()) {
+        return fail("expected 'else LABEL'");
+      }
+      instruction.text = tokens.at(next + 1);
+    }
+  } else if (command == "timeout" || command == "delay") {
+    instruction.op = command == "timeout" ? SetTimeout : Delay;
+    if (tokens.size() != 2 || !parseNumber(tokens, 1, instruction.value)) {
+      return fail(command + " needs a time in ms");
+    }
+  } else if (command == "goto") {
+    instruction.op = Goto;
+    if (tokens.size() != 2) {
+      return fail("goto needs a label");
+    }
+    instruction.text = tokens.at(1);
+  } else if (command == "loop") {
+    instruction.op = Loop;
+    if (tokens.size() != 3 || !parseNumber(tokens, 1, instruction.value) ||
+        instruction.value < 1) {
+      return fail("loop needs a count and a label");
+    }
+    instruction.text = tokens.at(2);
+  } else if (command == "print" || command == "fail") {
+    instruction.op = command == "print" ? Print : Fail;
+    QByteArray text;
+    if (tokens.size() == 2 && !unquote(tokens.at(1), text, error)) {
+      return fail(error);
+    } else if (tokens.size() > 2) {
+      return fail(command + " takes one quoted string");
+    }
+    instruction.text = tokens.size() == 2 ? QString::fromUtf8(text)
+                                          : QString("Script failed");
+  } else if (command == "flush" || command == "end") {
+    instruction.op = command == "flush" ? Flush : End;
+    if (tokens.size() != 1) {
+      return fail(command + " takes no arguments");
+    }
+  } else {
+    return fail("unknown command '" + tokens.first() + "'");
+  }
+
+  program.append(instruction);
+  return true;
+}
+
+bool ScriptEngine::match(const Instruction &instruction) {
+  qsizetype end = -1;
+  if (instruction.useRegex) {
+    const QRegularExpressionMatch found =
+        instruction.regex.match(QString::fromLatin1(m_window));
+    if (found.hasMatch()) {
+      end = found.capturedEnd();
+    }
+  } else {
+    // Only the bytes that arrived since the last attempt can complete it
+    const qsizetype from = m_searched;
+    const qsizetype index = instruction.matcher.indexIn(m_window, from);
+    if (index >= 0) {
+      end = index + instruction.data.size();
+    } else {
+      m_searched = qMax<qsizetype>(
+          0, m_window.size() - instruction.data.size() + 1);
+    }
+  }
+  if (end < 0) {
+    return false;
+  }
+
+  m_window.remove(0, end);
+  m_searched = 0;
+  ++m_responsesMatched;
+  m_responseLatency.add(SerialClock::nowNs() - m_lastSendNs);
+  return true;
+}
+
+void ScriptEngine::finish(bool success, const QString &message) {
+  m_timer->stop();
+  m_running = false;
+  m_waiting = false;
+
+  QString summary = message;
+  if (m_commandsSent > 0 || m_responsesMatched > 0) {
+    summary += QString(" (%1 sent, %2 matched")
+                   .arg(m_commandsSent)
+                   .arg(m_responsesMatched);
+    if (m_responseLatency.samples > 0) {
+      summary += QString(", response avg %1 ms, max %2 ms")
+                     .arg(m_responseLatency.averageNs() / 1e6, 0, 'f', 3)
+                     .arg(m_responseLatency.maxNs / 1e6, 0, 'f', 3);
+    }
+    summary += ')';
+  }
+  emit finished(success, summary);
+}
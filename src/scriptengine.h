@@ -0,0 +1,123 @@
+#ifndef SCRIPTENGINE_H
+#define SCRIPTENGINE_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QHash>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+#include "portstatistics.h"
+
+class QTimer;
+class SerialPortManager;
+
+// Runs request/response scripts against a SerialPortManager, one statement
+// per line ('#' starts a comment):
+//
+//   label NAME             jump target
+//   send "AT\r\n"          C escapes and \xHH; sendhex 41 54 0d for bytes
+//   expect "OK" [MS] [else NAME]
+//   expect /OK|ERROR/i     regex over the received bytes as Latin-1
+//   expecthex 06 0d        raw bytes; timeouts here need 3+ digits
+//   timeout MS             default for expect (1000 ms)
+//   delay MS
+//   goto NAME
+//   loop N NAME            jump back until this line ran N times
+//   flush                  forget bytes received but not yet matched
+//   print "text"
+//   fail "text" / end
+//
+// An expect that times out jumps to its else label, or fails the script.
+// Responses are matched as each chunk is delivered by the manager, ahead of
+// any display work, and the next command goes out from the same call, so a
+// request/response round costs the device's latency and little else.
+// Unmatched bytes carry over to the next expect, so a fast reply is not
+// lost to the time between a send and its expect.
+class ScriptEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultTimeoutMs = 1000;
+    static constexpr qsizetype MaxWindow = 64 * 1024; // unmatched RX kept
+    static constexpr int MaxStepsPerSlice = 10000;    // then yield
+
+    explicit ScriptEngine(SerialPortManager *port, QObject *parent = nullptr);
+
+    bool load(const QString &script);
+    bool loadFile(const QString &path);
+    QString errorString() const;
+
+    // Returns false if no script is loaded or the port is not open
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    quint64 commandsSent() const;
+    quint64 responsesMatched() const;
+    // From the last send before an expect to its match
+    PortStatistics::Latency responseLatency() const;
+
+signals:
+    void message(const QString &text);
+    void finished(bool success, const QString &message);
+
+private slots:
+    void onDataReceived(const QByteArray &data);
+    void onTimeout();
+    void run();
+
+private:
+    enum Op {
+        Send,
+        Expect,
+        Delay,
+        Goto,
+        Loop,
+        SetTimeout,
+        Print,
+        Flush,
+        Fail,
+        End
+    };
+
+    struct Instruction
+    {
+        Op op = End;
+        int line = 0;
+        QByteArray data;               // Send, literal Expect
+        QByteArrayMatcher matcher;     // literal Expect
+        QRegularExpression regex;      // regex Expect
+        bool useRegex = false;
+        int value = -1;                // timeout, delay or loop count
+        QString text;                  // Print, Fail; label before linking
+        int target = -1;               // Goto, Loop, Expect's else
+    };
+
+    bool parseLine(const QString &line, int lineNumber,
+                   QVector<Instruction> &program,
+                   QHash<QString, int> &labels);
+    bool match(const Instruction &instruction);
+    void finish(bool success, const QString &message);
+
+    SerialPortManager *m_port;
+    QTimer *m_timer;
+    QVector<Instruction> m_program;
+    QString m_errorString;
+
+    bool m_running;
+    bool m_waiting;             // for the expect at m_pc
+    int m_pc;
+    int m_timeoutMs;
+    QVector<int> m_loopCounts;
+    QByteArray m_window;        // received, not yet matched
+    qsizetype m_searched;       // window bytes a literal cannot start in
+    qint64 m_lastSendNs;
+    quint64 m_commandsSent;
+    quint64 m_responsesMatched;
+    PortStatistics::Latency m_responseLatency;
+};
+
+#endif // SCRIPTENGINE_H
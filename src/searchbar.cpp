@@ -0,0 +1,206 @@
+#include "searchbar.h"
+#include "consoleview.h"
+#include <QCheckBox>
+#include <QComboBox>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QStringList>
+
+SearchBar::SearchBar(QWidget *parent)
+    : QWidget(parent), m_filter(&m_search), m_view(nullptr),
+      m_source(nullptr) {
+  m_patternEdit = new QLineEdit(this);
+  m_patternEdit->setPlaceholderText("Search history...");
+  m_patternEdit->setClearButtonEnabled(true);
+  m_patternEdit->installEventFilter(this);
+
+  m_modeComboBox = new QComboBox(this);
+  m_modeComboBox->addItem("Text", ConsoleSearch::Text);
+  m_modeComboBox->addItem("Hex", ConsoleSearch::Hex);
+  m_modeComboBox->addItem("Regex", ConsoleSearch::Regex);
+
+  m_caseCheckBox = new QCheckBox("Match case", this);
+  m_filterCheckBox = new QCheckBox("Only matching", this);
+  m_filterCheckBox->setToolTip("Show only the lines that match");
+
+  QPushButton *previousButton = new QPushButton("Previous", this);
+  QPushButton *nextButton = new QPushButton("Next", this);
+  m_statusLabel = new QLabel(this);
+
+  QHBoxLayout *layout = new QHBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(new QLabel("Find:", this));
+  layout->addWidget(m_patternEdit, 1);
+  layout->addWidget(m_modeComboBox);
+  layout->addWidget(m_caseCheckBox);
+  layout->addWidget(m_filterCheckBox);
+  layout->addWidget(previousButton);
+  layout->addWidget(nextButton);
+  layout->addWidget(m_statusLabel);
+
+  connect(m_patternEdit, &QLineEdit::textChanged, this,
+          &SearchBar::applyPattern);
+  connect(m_patternEdit, &QLineEdit::returnPressed, this,
+          &SearchBar::findNext);
+  connect(m_modeComboBox,
+          QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+          &SearchBar::applyPattern);
+  connect(m_caseCheckBox, &QCheckBox::toggled, this,
+          &SearchBar::applyPattern);
+  connect(m_filterCheckBox, &QCheckBox::toggled, this,
+          &SearchBar::setFilterEnabled);
+  connect(previousButton, &QPushButton::clicked, this,
+          &SearchBar::findPrevious);
+  connect(nextButton, &QPushButton::clicked, this, &SearchBar::findNext);
+}
+
+void SearchBar::setView(ConsoleView *view, ConsoleSource *source) {
+  m_view = view;
+  m_source = source;
+  m_search.setSource(source);
+  m_current = ConsoleSearch::Match();
+  {
+    const QSignalBlocker blocker(m_filterCheckBox);
+    m_filterCheckBox->setChecked(false);
+  }
+  m_filter.rebuild();
+  m_view->setSearch(&m_search);
+}
+
+void SearchBar::sourceChanged() {
+  if (!m_view) {
+    return;
+  }
+  m_search.update();
+  if (m_view->source() == &m_filter) {
+    m_filter.update();
+  }
+  m_view->refresh();
+}
+
+void SearchBar::findNext() { find(true); }
+
+void SearchBar::findPrevious() { find(false); }
+
+void SearchBar::focusSearch() {
+  m_patternEdit->setFocus();
+  m_patternEdit->selectAll();
+}
+
+void SearchBar::applyPattern() {
+  if (!m_view) {
+    return;
+  }
+
+  const bool valid = m_search.setPattern(
+      m_patternEdit->text(),
+      static_cast<ConsoleSearch::Mode>(m_modeComboBox->currentData().toInt()),
+      m_caseCheckBox->isChecked());
+  m_current = ConsoleSearch::Match();
+  m_view->setCurrentMatch(0, 0);
+  m_statusLabel->setStyleSheet(valid ? QString() : "color: red;");
+  m_statusLabel->setText(m_search.errorString());
+
+  setFilterEnabled(m_filterCheckBox->isChecked());
+  // Search as you type, from the start of the history
+  if (m_search.isActive()) {
+    find(true);
+  }
+}
+
+void SearchBar::setFilterEnabled(bool enabled) {
+  if (!m_view) {
+    return;
+  }
+
+  if (enabled && m_search.isActive()) {
+    m_search.update();
+    m_filter.rebuild();
+    m_view->setSource(&m_filter);
+    setStatus(QString());
+  } else if (m_view->source() != m_source) {
+    m_view->setSource(m_source);
+  }
+  if (m_current.isValid()) {
+    showMatch(m_current);
+  }
+}
+
+bool SearchBar::eventFilter(QObject *watched, QEvent *event) {
+  if (watched == m_patternEdit && event->type() == QEvent::KeyPress) {
+    const QKeyEvent *key = static_cast<QKeyEvent *>(event);
+    if ((key->key() == Qt::Key_Return || key->key() == Qt::Key_Enter) &&
+        (key->modifiers() & Qt::ShiftModifier)) {
+      findPrevious();
+      return true;
+    }
+    if (key->key() == Qt::Key_Escape) {
+      m_patternEdit->clear();
+      return true;
+    }
+  }
+  return QWidget::eventFilter(watched, event);
+}
+
+void SearchBar::find(bool forward) {
+  if (!m_view || !m_source || !m_search.isActive()) {
+    return;
+  }
+  m_search.update();
+  if (m_view->source() == &m_filter) {
+    m_filter.update();
+  }
+
+  const qint64 first = m_source->firstRecord();
+  const qint64 end = m_source->endRecord();
+  ConsoleSearch::Match match;
+  if (m_current.isValid()) {
+    match = forward
+                ? m_search.findNext(m_current.record, m_current.start + 1)
+                : m_search.findPrevious(m_current.record, m_current.start);
+  }
+  const bool wrapped = m_current.isValid() && !match.isValid();
+  if (!match.isValid()) {
+    match = forward ? m_search.findNext(first, 0)
+                    : m_search.findPrevious(end, 0);
+  }
+
+  if (!match.isValid()) {
+    m_current = ConsoleSearch::Match();
+    m_view->setCurrentMatch(0, 0);
+    setStatus("Not found");
+    return;
+  }
+  setStatus(wrapped ? "Wrapped" : QString());
+  showMatch(match);
+}
+
+void SearchBar::setStatus(const QString &text) {
+  QStringList parts;
+  if (m_view->source() == &m_filter) {
+    parts << QString("%1 matching lines").arg(m_filter.recordCount());
+  }
+  if (!text.isEmpty()) {
+    parts << text;
+  }
+  m_statusLabel->setText(parts.join(", "));
+}
+
+void SearchBar::showMatch(const ConsoleSearch::Match &match) {
+  if (match.record < m_source->firstRecord()) {
+    return; // Evicted since it was found
+  }
+  m_current = match;
+  const ConsoleSource::Record record = m_source->record(match.record);
+  m_view->setCurrentMatch(record.offset + quint64(match.start), match.length);
+
+  const qint64 row = m_view->source() == &m_filter
+                         ? m_filter.filteredId(match.record)
+                         : match.record;
+  if (row >= 0) {
+    m_view->showRecord(row);
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef SEARCHBAR_H
+#define SEARCHBAR_H
+
+#include <QWidget>
+#include "consolefilter.h"
+#include "consolesearch.h"
+
+class ConsoleView;
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+
+// Find bar for a ConsoleView: searches the raw bytes of the view's source
+// as text, hex or regex, highlights the matches, steps through them and can
+// narrow the view down to matching rows.
+class SearchBar : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SearchBar(QWidget *parent = nullptr);
+
+    void setView(ConsoleView *view, ConsoleSource *source);
+
+public slots:
+    // Call after records were appended to or cleared from the source; also
+    // refreshes the view
+    void sourceChanged();
+    void findNext();
+    void findPrevious();
+    void focusSearch();
+
+private slots:
+    void applyPattern();
+    void setFilterEnabled(bool enabled);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void find(bool forward);
+    // Prefixed with the number of matching lines while filtering
+    void setStatus(const QString &text);
+    void showMatch(const ConsoleSearch::Match &match);
+
+    ConsoleSearch m_search;
+    ConsoleFilter m_filter;
+    ConsoleView *m_view;
+    ConsoleSource *m_source;
+    ConsoleSearch::Match m_current;
+
+    QLineEdit *m_patternEdit;
+    QComboBox *m_modeComboBox;
+    QCheckBox *m_caseCheckBox;
+    QCheckBox *m_filterCheckBox;
+    QLabel *m_statusLabel;
+};
+
+#endif // SEARCHBAR_H
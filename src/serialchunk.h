@@ -0,0 +1,16 @@
+#ifndef SERIALCHUNK_H
+#define SERIALCHUNK_H
+
+#include <QByteArray>
+#include <QMetaType>
+
+// The bytes returned by one read from the port
+struct SerialChunk
+{
+    QByteArray data;
+    qint64 timestamp = 0; // SerialClock::nowNs() right after the read
+};
+
+Q_DECLARE_METATYPE(SerialChunk)
+
+#endif // SERIALCHUNK_H
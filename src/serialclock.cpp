@@ -0,0 +1,51 @@
+#include "serialclock.h"
+#include <QDateTime>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Wall-clock minus monotonic time, sampled once per process
+qint64 epochOffsetNs() {
+  static const qint64 offset = []() {
+    const qint64 wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    return wall - SerialClock::nowNs();
+  }();
+  return offset;
+}
+
+} // namespace
+
+namespace SerialClock {
+
+qint64 nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+qint64 toEpochNs(qint64 monotonicNs) { return monotonicNs + epochOffsetNs(); }
+
+} // namespace SerialClock
+
+TimestampFormatter::TimestampFormatter()
+    : m_second(std::numeric_limits<qint64>::min()) {}
+
+const QString &TimestampFormatter::format(qint64 epochNs) {
+  const qint64 epochMs = epochNs / 1000000;
+  const qint64 second = epochMs / 1000;
+  if (second != m_second) {
+    m_second = second;
+    m_text = QDateTime::fromSecsSinceEpoch(second).toString("HH:mm:ss") +
+             ".000";
+  }
+
+  const int millis = static_cast<int>(epochMs % 1000);
+  QChar *digits = m_text.data() + m_text.size() - 3;
+  digits[0] = QChar('0' + millis / 100);
+  digits[1] = QChar('0' + millis / 10 % 10);
+  digits[2] = QChar('0' + millis % 10);
+  return m_text;
+}
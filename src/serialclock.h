@@ -0,0 +1,37 @@
+#ifndef SERIALCLOCK_H
+#define SERIALCLOCK_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Timestamps for serial traffic. Chunks are stamped with a monotonic
+// nanosecond clock at the I/O layer; wall-clock time is derived from it only
+// for display and logs, so ordering and intervals are immune to clock
+// adjustments.
+namespace SerialClock {
+
+// Monotonic nanoseconds, comparable across threads
+qint64 nowNs();
+
+// Nanoseconds since the Unix epoch for a nowNs() value
+qint64 toEpochNs(qint64 monotonicNs);
+
+} // namespace SerialClock
+
+// Formats epoch timestamps as local "HH:mm:ss.zzz". The date conversion is
+// redone only when the second changes; otherwise just the millisecond digits
+// are rewritten in place.
+class TimestampFormatter
+{
+public:
+    TimestampFormatter();
+
+    // The returned string stays valid until the next call
+    const QString &format(qint64 epochNs);
+
+private:
+    qint64 m_second;
+    QString m_text;
+};
+
+#endif // SERIALCLOCK_H
@@ -1,18 +1,76 @@
 #include "serialportmanager.h"
+#include "portwatcher.h"
+#include "serialclock.h"
+#include "serialportworker.h"
 #include <QDebug>
+#include <QThread>
+#include <QTimer>
+
+template <typename Fn> void SerialPortManager::runOnWorker(Fn &&fn) const {
+  if (m_ioThread) {
+    QMetaObject::invokeMethod(m_worker, std::forward<Fn>(fn),
+                              Qt::BlockingQueuedConnection);
+  } else {
+    fn();
+  }
+}
 
 SerialPortManager::SerialPortManager(QObject *parent)
-    : QObject(parent), m_serialPort(new QSerialPort(this)) {
-  connect(m_serialPort, &QSerialPort::readyRead, this,
-          &SerialPortManager::handleReadyRead);
-  connect(m_serialPort, &QSerialPort::errorOccurred, this,
-          &SerialPortManager::handleError);
+    : QObject(parent), m_worker(new SerialPortWorker), m_ioThread(nullptr),
+      m_ownsIoThread(false), m_baudRate(0), m_dataBits(QSerialPort::Data8),
+      m_stopBits(QSerialPort::OneStop), m_parity(QSerialPort::NoParity),
+      m_open(false), m_reportedOverrunBytes(0),
+      m_statisticsTimer(new QTimer(this)),
+      m_sampleStartNs(SerialClock::nowNs()), m_sampleRxBytes(0),
+      m_sampleTxBytes(0), m_autoReconnect(false), m_reconnecting(false),
+      m_reconnectDelayMs(ReconnectInitialDelayMs), m_lostAtNs(0),
+      m_reconnectTimer(new QTimer(this)), m_portWatcher(nullptr) {
+  // Auto connections: direct while the worker shares our thread, queued once
+  // it has been moved to the I/O thread.
+  connect(m_worker, &SerialPortWorker::chunksAvailable, this,
+          &SerialPortManager::drainReceived);
+  connect(m_worker, &SerialPortWorker::errorOccurred, this,
+          &SerialPortManager::handleWorkerError);
+  connect(m_worker, &SerialPortWorker::portClosed, this,
+          &SerialPortManager::handlePortClosed);
+  connect(m_worker, &SerialPortWorker::txQueueChanged, this,
+          &SerialPortManager::txQueueChanged);
+  // Nothing to sample while closed, and no reason to block on the I/O
+  // thread for it
+  connect(m_statisticsTimer, &QTimer::timeout, this, [this]() {
+    if (m_open) {
+      emit statisticsUpdated(statistics());
+    }
+  });
+
+  m_reconnectTimer->setSingleShot(true);
+  connect(m_reconnectTimer, &QTimer::timeout, this,
+          &SerialPortManager::tryReconnect);
 }
 
 SerialPortManager::~SerialPortManager() {
-  if (m_serialPort->isOpen()) {
-    m_serialPort->close();
+  runOnWorker([this]() { m_worker->close(); });
+  stopIoThread();
+  delete m_worker;
+}
+
+void SerialPortManager::stopIoThread() {
+  if (!m_ioThread) {
+    return;
   }
+
+  // moveToThread() has to be called from the thread the worker lives in
+  QThread *home = thread();
+  QMetaObject::invokeMethod(
+      m_worker, [this, home]() { m_worker->moveToThread(home); },
+      Qt::BlockingQueuedConnection);
+  if (m_ownsIoThread) {
+    m_ioThread->quit();
+    m_ioThread->wait();
+    delete m_ioThread;
+  }
+  m_ioThread = nullptr;
+  m_ownsIoThread = false;
 }
 
 QList<QSerialPortInfo> SerialPortManager::getAvailablePorts() {
@@ -28,52 +86,83 @@ QStringList SerialPortManager::getAvailablePortNames() {
   return portNames;
 }
 
+void SerialPortManager::setThreadedIo(bool enabled) {
+  if (m_open || enabled == isThreadedIo()) {
+    return;
+  }
+
+  if (enabled) {
+    m_ioThread = new QThread(this);
+    m_ioThread->setObjectName("SerialPortIO");
+    m_ownsIoThread = true;
+    m_worker->moveToThread(m_ioThread);
+    m_ioThread->start(QThread::HighestPriority);
+  } else {
+    stopIoThread();
+  }
+}
+
+bool SerialPortManager::isThreadedIo() const { return m_ioThread != nullptr; }
+
+void SerialPortManager::setIoThread(QThread *thread) {
+  if (m_open || thread == m_ioThread) {
+    return;
+  }
+
+  stopIoThread();
+  if (thread && thread != this->thread()) {
+    m_ioThread = thread;
+    m_worker->moveToThread(thread);
+  }
+}
+
+QThread *SerialPortManager::ioThread() const { return m_ioThread; }
+
 bool SerialPortManager::openPort(const QString &portName, qint32 baudRate,
                                  QSerialPort::DataBits dataBits,
                                  QSerialPort::StopBits stopBits,
                                  QSerialPort::Parity parity) {
-  if (m_serialPort->isOpen()) {
-    m_serialPort->close();
-  }
+  stopReconnect();
+  m_portName = portName;
+  m_baudRate = baudRate;
+  m_dataBits = dataBits;
+  m_stopBits = stopBits;
+  m_parity = parity;
 
-  m_serialPort->setPortName(portName);
-  m_serialPort->setBaudRate(baudRate);
-  m_serialPort->setDataBits(dataBits);
-  m_serialPort->setStopBits(stopBits);
-  m_serialPort->setParity(parity);
-  m_serialPort->setFlowControl(QSerialPort::NoFlowControl);
+  const bool opened = reopen();
+  emit connectionStatusChanged(opened);
+  return opened;
+}
 
-  if (m_serialPort->open(QIODevice::ReadWrite)) {
-    emit connectionStatusChanged(true);
-    return true;
-  } else {
+void SerialPortManager::closePort() {
+  stopReconnect();
+  if (m_open) {
+    runOnWorker([this]() { m_worker->close(); });
+    m_open = false;
     emit connectionStatusChanged(false);
-    return false;
   }
 }
 
-void SerialPortManager::closePort() {
-  if (m_serialPort->isOpen()) {
-    m_serialPort->close();
-    emit connectionStatusChanged(false);
+bool SerialPortManager::isOpen() const { return m_open; }
+
+void SerialPortManager::setAutoReconnect(bool enabled) {
+  m_autoReconnect = enabled;
+  if (!enabled) {
+    stopReconnect();
   }
 }
 
-bool SerialPortManager::isOpen() const { return m_serialPort->isOpen(); }
+bool SerialPortManager::autoReconnect() const { return m_autoReconnect; }
+
+bool SerialPortManager::isReconnecting() const { return m_reconnecting; }
 
 bool SerialPortManager::sendData(const QByteArray &data) {
-  if (!m_serialPort->isOpen()) {
+  if (!m_open) {
     emit errorOccurred("Port is not open");
     return false;
   }
 
-  qint64 bytesWritten = m_serialPort->write(data);
-  if (bytesWritten == -1) {
-    emit errorOccurred("Failed to write data: " + m_serialPort->errorString());
-    return false;
-  }
-
-  m_serialPort->flush();
+  m_worker->queueWrite(data);
   return true;
 }
 
@@ -81,26 +170,188 @@ bool SerialPortManager::sendText(const QString &text) {
   return sendData(text.toUtf8());
 }
 
-QString SerialPortManager::getCurrentPortName() const {
-  return m_serialPort->portName();
+void SerialPortManager::setTxOptions(const TxOptions &options) {
+  m_txOptions = options;
+  runOnWorker([this]() { m_worker->setTxOptions(m_txOptions); });
+}
+
+TxOptions SerialPortManager::txOptions() const { return m_txOptions; }
+
+qint64 SerialPortManager::txQueuedBytes() const {
+  return m_worker->txQueuedBytes();
 }
 
+void SerialPortManager::clearTx() {
+  // Queued behind the writes sendData() has already queued, with or without
+  // the I/O thread, so it discards exactly those
+  QMetaObject::invokeMethod(
+      m_worker, [this]() { m_worker->clearTx(); }, Qt::QueuedConnection);
+}
+
+QString SerialPortManager::getCurrentPortName() const { return m_portName; }
+
+qint32 SerialPortManager::baudRate() const { return m_baudRate; }
+
+QSerialPort::DataBits SerialPortManager::dataBits() const { return m_dataBits; }
+
+QSerialPort::StopBits SerialPortManager::stopBits() const { return m_stopBits; }
+
+QSerialPort::Parity SerialPortManager::parity() const { return m_parity; }
+
 QString SerialPortManager::getErrorString() const {
-  return m_serialPort->errorString();
+  QString error;
+  runOnWorker([&]() { error = m_worker->errorString(); });
+  return error;
+}
+
+quint64 SerialPortManager::rxOverrunChunks() const {
+  return m_worker->droppedChunks();
+}
+
+quint64 SerialPortManager::rxOverrunBytes() const {
+  return m_worker->droppedBytes();
+}
+
+ChunkPool::Stats SerialPortManager::rxBufferStats() const {
+  return m_worker->poolStats();
+}
+
+PortStatistics SerialPortManager::statistics() {
+  PortStatistics stats;
+  runOnWorker([&]() { m_worker->sampleStatistics(stats); });
+
+  const qint64 now = SerialClock::nowNs();
+  stats.timestamp = SerialClock::toEpochNs(now);
+  stats.intervalNs = now - m_sampleStartNs;
+  if (stats.intervalNs > 0) {
+    stats.rxBytesPerSecond =
+        (stats.rxBytes - m_sampleRxBytes) * 1e9 / stats.intervalNs;
+    stats.txBytesPerSecond =
+        (stats.txBytes - m_sampleTxBytes) * 1e9 / stats.intervalNs;
+  }
+  stats.deliveryLatency = m_deliveryLatency;
+  stats.displayLatency = m_displayLatency;
+
+  m_deliveryLatency = PortStatistics::Latency();
+  m_displayLatency = PortStatistics::Latency();
+  m_sampleStartNs = now;
+  m_sampleRxBytes = stats.rxBytes;
+  m_sampleTxBytes = stats.txBytes;
+  return stats;
 }
 
-void SerialPortManager::handleReadyRead() {
-  QByteArray data = m_serialPort->readAll();
-  if (!data.isEmpty()) {
-    emit dataReceived(data);
+void SerialPortManager::setStatisticsInterval(int ms) {
+  if (ms > 0) {
+    m_statisticsTimer->start(ms);
+  } else {
+    m_statisticsTimer->stop();
   }
 }
 
-void SerialPortManager::handleError(QSerialPort::SerialPortError error) {
-  if (error != QSerialPort::NoError && error != QSerialPort::TimeoutError) {
-    emit errorOccurred(m_serialPort->errorString());
-    if (error == QSerialPort::ResourceError) {
-      closePort();
+int SerialPortManager::statisticsInterval() const {
+  return m_statisticsTimer->isActive() ? m_statisticsTimer->interval() : 0;
+}
+
+void SerialPortManager::reportDisplayed(qint64 readTimestamp) {
+  m_displayLatency.add(SerialClock::nowNs() - readTimestamp);
+}
+
+void SerialPortManager::drainReceived() {
+  m_worker->rearmNotification();
+
+  SerialChunk chunk;
+  const qint64 now = SerialClock::nowNs();
+  while (m_worker->takeChunk(chunk)) {
+    m_deliveryLatency.add(now - chunk.timestamp);
+    emit chunkReceived(chunk);
+    emit dataReceived(chunk.data);
+  }
+
+  const quint64 dropped = m_worker->droppedBytes();
+  if (dropped != m_reportedOverrunBytes) {
+    m_reportedOverrunBytes = dropped;
+    emit rxOverrun(dropped);
+  }
+}
+
+void SerialPortManager::handleWorkerError(const QString &error) {
+  // Failed reconnect attempts are expected until the device is back
+  if (!m_reconnecting) {
+    emit errorOccurred(error);
+  }
+}
+
+void SerialPortManager::handlePortClosed() {
+  if (!m_open) {
+    return;
+  }
+  m_open = false;
+
+  // Decided before announcing the loss, so listeners can tell a device
+  // that will be reopened from a connection that is gone
+  if (m_autoReconnect) {
+    if (!m_portWatcher) {
+      m_portWatcher = new PortWatcher(this);
+      connect(m_portWatcher, &PortWatcher::devicesChanged, this, [this]() {
+        // The device may be back: try now and restart the backoff
+        if (m_reconnecting) {
+          m_reconnectDelayMs = ReconnectInitialDelayMs;
+          tryReconnect();
+        }
+      });
     }
+    m_reconnecting = true;
+    m_reconnectDelayMs = ReconnectInitialDelayMs;
+    m_lostAtNs = SerialClock::nowNs();
+    m_reconnectTimer->start(m_reconnectDelayMs);
+  }
+
+  emit connectionStatusChanged(false);
+  if (m_reconnecting) {
+    emit reconnectStateChanged(true);
+  }
+}
+
+void SerialPortManager::tryReconnect() {
+  if (!m_reconnecting) {
+    return;
+  }
+
+  if (!reopen()) {
+    m_reconnectDelayMs = qMin(m_reconnectDelayMs * 2, ReconnectMaxDelayMs);
+    m_reconnectTimer->start(m_reconnectDelayMs);
+    return;
+  }
+
+  const qint64 downtimeMs = (SerialClock::nowNs() - m_lostAtNs) / 1000000;
+  stopReconnect();
+  emit connectionStatusChanged(true);
+  emit reconnected(downtimeMs);
+}
+
+bool SerialPortManager::reopen() {
+  bool opened = false;
+  runOnWorker([&]() {
+    opened = m_worker->open(m_portName, m_baudRate, m_dataBits, m_stopBits,
+                            m_parity);
+  });
+
+  m_open = opened;
+  if (opened) {
+    // The worker's counters restart at open
+    m_deliveryLatency = PortStatistics::Latency();
+    m_displayLatency = PortStatistics::Latency();
+    m_sampleStartNs = SerialClock::nowNs();
+    m_sampleRxBytes = 0;
+    m_sampleTxBytes = 0;
+  }
+  return opened;
+}
+
+void SerialPortManager::stopReconnect() {
+  if (m_reconnecting) {
+    m_reconnecting = false;
+    m_reconnectTimer->stop();
+    emit reconnectStateChanged(false);
   }
 }
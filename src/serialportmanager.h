@@ -6,12 +6,24 @@
 #include <QSerialPortInfo>
 #include <QString>
 #include <QList>
+#include "chunkpool.h"
+#include "portstatistics.h"
+#include "serialchunk.h"
+#include "txoptions.h"
+
+class PortWatcher;
+class QThread;
+class QTimer;
+class SerialPortWorker;
 
 class SerialPortManager : public QObject
 {
     Q_OBJECT
 
 public:
+    static constexpr int ReconnectInitialDelayMs = 10; // doubled per attempt
+    static constexpr int ReconnectMaxDelayMs = 2000;
+
     explicit SerialPortManager(QObject *parent = nullptr);
     ~SerialPortManager();
 
@@ -19,34 +31,127 @@ public:
     QList<QSerialPortInfo> getAvailablePorts();
     QStringList getAvailablePortNames();
 
+    // Threading: when enabled the port is serviced by a dedicated I/O thread
+    // and received chunks are queued for this object's thread. Only takes
+    // effect while the port is closed.
+    void setThreadedIo(bool enabled);
+    bool isThreadedIo() const;
+
+    // Like setThreadedIo(true), but services the port from a running thread
+    // owned by the caller, which may be shared with other managers. nullptr
+    // returns the port to this object's thread.
+    void setIoThread(QThread *thread);
+    QThread *ioThread() const;
+
     // Connection management
-    bool openPort(const QString &portName, 
+    bool openPort(const QString &portName,
                   qint32 baudRate,
                   QSerialPort::DataBits dataBits = QSerialPort::Data8,
                   QSerialPort::StopBits stopBits = QSerialPort::OneStop,
                   QSerialPort::Parity parity = QSerialPort::NoParity);
+    // Also cancels a pending reconnect
     void closePort();
     bool isOpen() const;
 
-    // Data transmission
+    // When the device goes away (a reset or an unplug), reopen the same
+    // port with the same settings as soon as it is back: immediately when
+    // the device directory changes, and with exponential backoff otherwise.
+    // openPort() and closePort() cancel a pending reconnect.
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const;
+    bool isReconnecting() const;
+
+    // Data transmission. Data is queued and written as the port drains, so
+    // these never block; write failures arrive through errorOccurred().
     bool sendData(const QByteArray &data);
     bool sendText(const QString &text);
+    void setTxOptions(const TxOptions &options);
+    TxOptions txOptions() const;
+    qint64 txQueuedBytes() const;
+    // Discards what earlier sendData() calls left queued; data sent after it
+    // is written as usual
+    void clearTx();
 
-    // Port information
+    // Port information; the settings are those of the last openPort()
     QString getCurrentPortName() const;
     QString getErrorString() const;
+    qint32 baudRate() const;
+    QSerialPort::DataBits dataBits() const;
+    QSerialPort::StopBits stopBits() const;
+    QSerialPort::Parity parity() const;
+
+    // Chunks dropped because the consumer fell behind the I/O thread
+    quint64 rxOverrunChunks() const;
+    quint64 rxOverrunBytes() const;
+
+    // Receive buffer recycling; allocations stop growing once streaming
+    // reaches a steady state
+    ChunkPool::Stats rxBufferStats() const;
+
+    // Instrumentation. statistics() takes a snapshot and starts a new
+    // interval; with an interval set, snapshots are also taken on a timer
+    // while the port is open and emitted through statisticsUpdated(). 0
+    // turns the timer off.
+    PortStatistics statistics();
+    void setStatisticsInterval(int ms);
+    int statisticsInterval() const;
+    // Called by the display once it has shown a chunk, with the chunk's
+    // read timestamp, to measure read-to-display latency
+    void reportDisplayed(qint64 readTimestamp);
 
 signals:
+    // chunkReceived carries the read timestamp; dataReceived follows it with
+    // the same bytes for consumers that only need the data
+    void chunkReceived(const SerialChunk &chunk);
     void dataReceived(const QByteArray &data);
     void errorOccurred(const QString &error);
     void connectionStatusChanged(bool connected);
+    void rxOverrun(quint64 totalDroppedBytes);
+    void txQueueChanged(qint64 queuedBytes);
+    void statisticsUpdated(const PortStatistics &statistics);
+    void reconnectStateChanged(bool reconnecting);
+    // The port is open again; downtimeMs is how long it was lost
+    void reconnected(qint64 downtimeMs);
 
 private slots:
-    void handleReadyRead();
-    void handleError(QSerialPort::SerialPortError error);
+    void drainReceived();
+    void handleWorkerError(const QString &error);
+    void handlePortClosed();
+    void tryReconnect();
 
 private:
-    QSerialPort *m_serialPort;
+    template <typename Fn> void runOnWorker(Fn &&fn) const;
+    void stopIoThread();
+    bool reopen();
+    void stopReconnect();
+
+    SerialPortWorker *m_worker;
+    QThread *m_ioThread;
+    bool m_ownsIoThread;
+    QString m_portName;
+    qint32 m_baudRate;
+    QSerialPort::DataBits m_dataBits;
+    QSerialPort::StopBits m_stopBits;
+    QSerialPort::Parity m_parity;
+    TxOptions m_txOptions;
+    bool m_open;
+    quint64 m_reportedOverrunBytes;
+
+    // Statistics interval state
+    QTimer *m_statisticsTimer;
+    PortStatistics::Latency m_deliveryLatency;
+    PortStatistics::Latency m_displayLatency;
+    qint64 m_sampleStartNs;
+    quint64 m_sampleRxBytes;
+    quint64 m_sampleTxBytes;
+
+    // Reconnect state
+    bool m_autoReconnect;
+    bool m_reconnecting;
+    int m_reconnectDelayMs;
+    qint64 m_lostAtNs;
+    QTimer *m_reconnectTimer;
+    PortWatcher *m_portWatcher; // created with the first reconnect
 };
 
 #endif // SERIALPORTMANAGER_H
@@ -0,0 +1,292 @@
+#include "serialportworker.h"
+#include "serialclock.h"
+#include "serialtransport.h"
+#include <QTimer>
+#include <algorithm>
+
+SerialPortWorker::SerialPortWorker(QObject *parent)
+    : QObject(parent), m_transport(nullptr),
+      m_rxQueue(RxQueueCapacity), m_notifyPending(false), m_droppedChunks(0),
+      m_droppedBytes(0), m_txOffset(0), m_txQueuedBytes(0),
+      m_txReportedBytes(0), m_txTimer(new QTimer(this)), m_txNotBeforeNs(0) {
+  resetStatistics();
+  m_txTimer->setSingleShot(true);
+  m_txTimer->setTimerType(Qt::PreciseTimer);
+  connect(m_txTimer, &QTimer::timeout, this, &SerialPortWorker::pumpTx);
+}
+
+SerialPortWorker::~SerialPortWorker() { close(); }
+
+bool SerialPortWorker::open(const QString &portName, qint32 baudRate,
+                            QSerialPort::DataBits dataBits,
+                            QSerialPort::StopBits stopBits,
+                            QSerialPort::Parity parity) {
+  // The previous transport may be the one whose signal got us here
+  close();
+  if (m_transport) {
+    m_transport->disconnect(this);
+    m_transport->deleteLater();
+  }
+  m_transport = SerialTransport::create(portName, this);
+  connect(m_transport, &SerialTransport::readyRead, this,
+          &SerialPortWorker::handleReadyRead);
+  connect(m_transport, &SerialTransport::bytesWritten, this,
+          &SerialPortWorker::pumpTx);
+  connect(m_transport, &SerialTransport::errorOccurred, this,
+          &SerialPortWorker::handleError);
+
+  SerialTransport::Settings settings;
+  settings.baudRate = baudRate;
+  settings.dataBits = dataBits;
+  settings.stopBits = stopBits;
+  settings.parity = parity;
+  if (!m_transport->open(portName, settings)) {
+    return false;
+  }
+  resetStatistics();
+  return true;
+}
+
+void SerialPortWorker::close() {
+  clearTx();
+  if (m_transport) {
+    m_transport->close();
+  }
+}
+
+bool SerialPortWorker::isOpen() const {
+  return m_transport && m_transport->isOpen();
+}
+
+QString SerialPortWorker::errorString() const {
+  return m_transport ? m_transport->errorString() : QString();
+}
+
+void SerialPortWorker::setTxOptions(const TxOptions &options) {
+  m_txOptions = options;
+  m_txNotBeforeNs = 0;
+  pumpTx();
+}
+
+void SerialPortWorker::queueWrite(const QByteArray &data) {
+  if (data.isEmpty()) {
+    return;
+  }
+
+  // Counted before it crosses threads so txQueuedBytes() includes it at once.
+  // Queued even without an I/O thread, so errors never reach the caller
+  // from inside sendData().
+  m_txQueuedBytes.fetch_add(data.size(), std::memory_order_relaxed);
+  QMetaObject::invokeMethod(
+      this,
+      [this, data]() {
+        if (!isOpen()) {
+          m_txQueuedBytes.fetch_sub(data.size(), std::memory_order_relaxed);
+          emit errorOccurred("Port is not open");
+          return;
+        }
+        m_txQueue.enqueue(data);
+        pumpTx();
+      },
+      Qt::QueuedConnection);
+}
+
+qint64 SerialPortWorker::txQueuedBytes() const {
+  return m_txQueuedBytes.load(std::memory_order_relaxed);
+}
+
+void SerialPortWorker::rearmNotification() {
+  // Pairs with the exchange in handleReadyRead() so every chunk pushed before
+  // a suppressed notification is visible to the following takeChunk() calls.
+  m_notifyPending.exchange(false, std::memory_order_acq_rel);
+}
+
+bool SerialPortWorker::takeChunk(SerialChunk &chunk) {
+  return m_rxQueue.tryPop(chunk);
+}
+
+quint64 SerialPortWorker::droppedChunks() const {
+  return m_droppedChunks.load(std::memory_order_relaxed);
+}
+
+quint64 SerialPortWorker::droppedBytes() const {
+  return m_droppedBytes.load(std::memory_order_relaxed);
+}
+
+ChunkPool::Stats SerialPortWorker::poolStats() const { return m_pool.stats(); }
+
+void SerialPortWorker::sampleStatistics(PortStatistics &stats) {
+  stats.rxBytes = m_rxBytes;
+  stats.rxChunks = m_rxChunks;
+  stats.txBytes = m_txBytes;
+  std::copy(std::begin(m_chunkSizes), std::end(m_chunkSizes),
+            std::begin(stats.chunkSizes));
+  stats.driverRxPeak = m_driverRxPeak;
+  stats.driverTxBytes = isOpen() ? m_transport->bytesToWrite() : 0;
+  stats.txQueuedBytes = txQueuedBytes();
+  stats.rxQueuePeak = qMax(m_rxQueuePeak, int(m_rxQueue.size()));
+  stats.rxQueueCapacity = int(m_rxQueue.capacity());
+  stats.droppedChunks = droppedChunks();
+  stats.droppedBytes = droppedBytes();
+
+  if (readLineErrors(stats)) {
+    stats.parityErrors -= m_lineErrorBase.parityErrors;
+    stats.framingErrors -= m_lineErrorBase.framingErrors;
+    stats.overrunErrors -= m_lineErrorBase.overrunErrors;
+    stats.bufferOverruns -= m_lineErrorBase.bufferOverruns;
+    stats.breaks -= m_lineErrorBase.breaks;
+  }
+
+  m_driverRxPeak = 0;
+  m_rxQueuePeak = 0;
+}
+
+void SerialPortWorker::resetStatistics() {
+  m_rxBytes = 0;
+  m_rxChunks = 0;
+  m_txBytes = 0;
+  std::fill(std::begin(m_chunkSizes), std::end(m_chunkSizes), 0);
+  m_driverRxPeak = 0;
+  m_rxQueuePeak = 0;
+  m_lineErrorBase = PortStatistics();
+  readLineErrors(m_lineErrorBase);
+}
+
+bool SerialPortWorker::readLineErrors(PortStatistics &stats) const {
+  return isOpen() && m_transport->lineErrors(stats);
+}
+
+void SerialPortWorker::handleReadyRead() {
+  // Read straight into pooled buffers instead of letting readAll() allocate;
+  // a burst larger than one chunk is split across several.
+  bool received = false;
+  qint64 available;
+  while (isOpen() && (available = m_transport->bytesAvailable()) > 0) {
+    m_driverRxPeak = qMax(m_driverRxPeak, available);
+    char *buffer = m_pool.acquire();
+    const qint64 bytesRead = m_transport->read(
+        buffer, qMin<qint64>(available, m_pool.chunkSize()));
+
+    SerialChunk chunk;
+    chunk.timestamp = SerialClock::nowNs();
+    chunk.data = m_pool.commit(qMax<qint64>(0, bytesRead));
+    if (chunk.data.isEmpty()) {
+      break;
+    }
+    received = true;
+
+    // Drain the driver unconditionally; if the consumer has fallen behind the
+    // chunk is dropped here and counted instead of backing up into the kernel.
+    const qsizetype size = chunk.data.size();
+    m_rxBytes += size;
+    ++m_rxChunks;
+    ++m_chunkSizes[PortStatistics::bucketFor(size)];
+    if (!m_rxQueue.tryPush(std::move(chunk))) {
+      m_droppedChunks.fetch_add(1, std::memory_order_relaxed);
+      m_droppedBytes.fetch_add(static_cast<quint64>(size),
+                               std::memory_order_relaxed);
+    }
+    m_rxQueuePeak = qMax(m_rxQueuePeak, int(m_rxQueue.size()));
+  }
+
+  if (received && !m_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+    emit chunksAvailable();
+  }
+}
+
+void SerialPortWorker::pumpTx() {
+  const bool paced =
+      m_txOptions.interByteDelayMs > 0 || m_txOptions.interFrameDelayMs > 0;
+  const qint64 rate = m_txOptions.rateLimit;
+
+  // Everything that fits below the high-water mark is written in one pass;
+  // QSerialPort hands it to the driver in a single write on the next event
+  // loop iteration, which coalesces small payloads.
+  while (!m_txQueue.isEmpty() && isOpen()) {
+    const qint64 now = SerialClock::nowNs();
+    if (now < m_txNotBeforeNs) {
+      m_txTimer->start(int((m_txNotBeforeNs - now + 999999) / 1000000));
+      break;
+    }
+
+    // Delays only mean something once the previous bytes have left the
+    // port's buffer; bytesWritten() brings us back here.
+    const qint64 buffered = m_transport->bytesToWrite();
+    if ((paced && buffered > 0) || buffered >= TxHighWater) {
+      break;
+    }
+
+    const QByteArray &payload = m_txQueue.head();
+    qint64 length = qMin<qint64>(payload.size() - m_txOffset,
+                                 TxHighWater - buffered);
+    if (m_txOptions.interByteDelayMs > 0) {
+      length = 1;
+    }
+    if (rate > 0) {
+      length = qMin(length, qMax<qint64>(1, rate * TxSliceMs / 1000));
+    }
+
+    const qint64 written =
+        m_transport->write(payload.constData() + m_txOffset, length);
+    if (written < 0) {
+      emit errorOccurred("Failed to write data: " +
+                         m_transport->errorString());
+      clearTx();
+      return;
+    }
+    m_txOffset += written;
+    m_txBytes += written;
+    m_txQueuedBytes.fetch_sub(written, std::memory_order_relaxed);
+
+    if (rate > 0) {
+      // Credit of up to one slice carries over so timer lateness does not
+      // lower the average rate
+      const qint64 sliceNs = qint64(TxSliceMs) * 1000000;
+      m_txNotBeforeNs = qMax(m_txNotBeforeNs, now - sliceNs) +
+                        written * 1000000000LL / rate;
+    }
+    if (m_txOptions.interByteDelayMs > 0) {
+      m_txNotBeforeNs = qMax(m_txNotBeforeNs,
+                             now + m_txOptions.interByteDelayMs * 1000000LL);
+    }
+    if (m_txOffset == payload.size()) {
+      m_txQueue.dequeue();
+      m_txOffset = 0;
+      if (m_txOptions.interFrameDelayMs > 0) {
+        m_txNotBeforeNs = qMax(m_txNotBeforeNs,
+                               now + m_txOptions.interFrameDelayMs * 1000000LL);
+      }
+    }
+  }
+
+  reportTxQueue();
+}
+
+void SerialPortWorker::clearTx() {
+  m_txTimer->stop();
+  qint64 pending = 0;
+  for (const QByteArray &payload : std::as_const(m_txQueue)) {
+    pending += payload.size();
+  }
+  m_txQueuedBytes.fetch_sub(pending - m_txOffset, std::memory_order_relaxed);
+  m_txQueue.clear();
+  m_txOffset = 0;
+  m_txNotBeforeNs = 0;
+  reportTxQueue();
+}
+
+void SerialPortWorker::reportTxQueue() {
+  const qint64 queued = m_txQueuedBytes.load(std::memory_order_relaxed);
+  if (queued != m_txReportedBytes) {
+    m_txReportedBytes = queued;
+    emit txQueueChanged(queued);
+  }
+}
+
+void SerialPortWorker::handleError(const QString &error, bool fatal) {
+  emit errorOccurred(error);
+  if (fatal) {
+    close();
+    emit portClosed();
+  }
+}
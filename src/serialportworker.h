@@ -0,0 +1,111 @@
+#ifndef SERIALPORTWORKER_H
+#define SERIALPORTWORKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QQueue>
+#include <QSerialPort>
+#include <QString>
+#include <atomic>
+#include "chunkpool.h"
+#include "portstatistics.h"
+#include "serialchunk.h"
+#include "spscringbuffer.h"
+#include "txoptions.h"
+
+class QTimer;
+class SerialTransport;
+
+// Owns the port's SerialTransport (a QSerialPort, or a simulated device for
+// "sim:" names) on behalf of SerialPortManager. The worker either lives in
+// the manager's thread or is moved to a dedicated I/O thread; all port
+// access happens in whichever thread it lives in. Received chunks are
+// read into recycled ChunkPool buffers and handed to the consumer through a
+// lock-free SPSC queue. Data to send is queued and written as the port
+// drains, optionally paced by TxOptions, so no call blocks on the line.
+class SerialPortWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int RxQueueCapacity = 4096; // chunks
+    static constexpr qint64 TxHighWater = 4096;  // bytes buffered in the port
+    static constexpr int TxSliceMs = 10;         // rate limit granularity
+
+    explicit SerialPortWorker(QObject *parent = nullptr);
+    ~SerialPortWorker();
+
+    // Port access, worker thread only
+    bool open(const QString &portName,
+              qint32 baudRate,
+              QSerialPort::DataBits dataBits,
+              QSerialPort::StopBits stopBits,
+              QSerialPort::Parity parity);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+    void setTxOptions(const TxOptions &options);
+    // Drops whatever is queued but not yet handed to the driver
+    void clearTx();
+
+    // Transmit side, any thread. Failures are reported via errorOccurred().
+    void queueWrite(const QByteArray &data);
+    qint64 txQueuedBytes() const;
+
+    // Consumer side, any single thread
+    void rearmNotification();
+    bool takeChunk(SerialChunk &chunk);
+
+    // Overrun counters, any thread
+    quint64 droppedChunks() const;
+    quint64 droppedBytes() const;
+    ChunkPool::Stats poolStats() const;
+
+    // Worker thread only. Fills the port side of a snapshot and starts a new
+    // interval for the peaks.
+    void sampleStatistics(PortStatistics &stats);
+
+signals:
+    // Emitted once per batch of chunks; rearmNotification() re-enables it
+    void chunksAvailable();
+    void errorOccurred(const QString &error);
+    void portClosed();
+    // Bytes queued but not yet handed to the driver
+    void txQueueChanged(qint64 queuedBytes);
+
+private slots:
+    void handleReadyRead();
+    void handleError(const QString &error, bool fatal);
+    void pumpTx();
+
+private:
+    void reportTxQueue();
+    void resetStatistics();
+    bool readLineErrors(PortStatistics &stats) const;
+
+    SerialTransport *m_transport; // replaced on every open()
+    ChunkPool m_pool;
+    SpscRingBuffer<SerialChunk> m_rxQueue;
+    std::atomic<bool> m_notifyPending;
+    std::atomic<quint64> m_droppedChunks;
+    std::atomic<quint64> m_droppedBytes;
+
+    QQueue<QByteArray> m_txQueue; // payloads in sendData() order
+    qsizetype m_txOffset;         // bytes of the head already written
+    std::atomic<qint64> m_txQueuedBytes;
+    qint64 m_txReportedBytes;
+    TxOptions m_txOptions;
+    QTimer *m_txTimer;
+    qint64 m_txNotBeforeNs; // SerialClock time the next write may start
+
+    // Statistics since open(), worker thread only
+    quint64 m_rxBytes;
+    quint64 m_rxChunks;
+    quint64 m_txBytes;
+    quint64 m_chunkSizes[PortStatistics::HistogramBuckets];
+    qint64 m_driverRxPeak;
+    int m_rxQueuePeak;
+    PortStatistics m_lineErrorBase; // driver counters at open()
+};
+
+#endif // SERIALPORTWORKER_H
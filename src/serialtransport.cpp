@@ -0,0 +1,101 @@
+#include "serialtransport.h"
+#include "simulatedtransport.h"
+
+#ifdef Q_OS_LINUX
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace {
+
+// A QSerialPort behind the transport interface
+class SerialPortTransport : public SerialTransport {
+public:
+  explicit SerialPortTransport(QObject *parent)
+      : SerialTransport(parent), m_port(new QSerialPort(this)) {
+    connect(m_port, &QSerialPort::readyRead, this,
+            &SerialTransport::readyRead);
+    connect(m_port, &QSerialPort::bytesWritten, this,
+            &SerialTransport::bytesWritten);
+    connect(m_port, &QSerialPort::errorOccurred, this,
+            [this](QSerialPort::SerialPortError error) {
+              if (error != QSerialPort::NoError &&
+                  error != QSerialPort::TimeoutError) {
+                emit errorOccurred(m_port->errorString(),
+                                   error == QSerialPort::ResourceError);
+              }
+            });
+  }
+
+  bool open(const QString &portName, const Settings &settings) override {
+    m_port->setPortName(portName);
+    m_port->setBaudRate(settings.baudRate);
+    m_port->setDataBits(settings.dataBits);
+    m_port->setStopBits(settings.stopBits);
+    m_port->setParity(settings.parity);
+    m_port->setFlowControl(QSerialPort::NoFlowControl);
+    return m_port->open(QIODevice::ReadWrite);
+  }
+
+  void close() override {
+    if (m_port->isOpen()) {
+      m_port->close();
+    }
+  }
+
+  bool isOpen() const override { return m_port->isOpen(); }
+  QString errorString() const override { return m_port->errorString(); }
+
+  qint64 bytesAvailable() const override { return m_port->bytesAvailable(); }
+  qint64 read(char *data, qint64 maxSize) override {
+    return m_port->read(data, maxSize);
+  }
+  qint64 write(const char *data, qint64 size) override {
+    return m_port->write(data, size);
+  }
+  qint64 bytesToWrite() const override { return m_port->bytesToWrite(); }
+
+  bool lineErrors(PortStatistics &stats) const override {
+    if (!m_port->isOpen()) {
+      return false;
+    }
+#ifdef Q_OS_LINUX
+    // Cumulative since the driver was loaded; fails on PTYs
+    serial_icounter_struct counters = {};
+    if (::ioctl(int(m_port->handle()), TIOCGICOUNT, &counters) == 0) {
+      stats.lineErrorsAvailable = true;
+      stats.parityErrors = quint64(counters.parity);
+      stats.framingErrors = quint64(counters.frame);
+      stats.overrunErrors = quint64(counters.overrun);
+      stats.bufferOverruns = quint64(counters.buf_overrun);
+      stats.breaks = quint64(counters.brk);
+      return true;
+    }
+#endif
+    return false;
+  }
+
+private:
+  QSerialPort *m_port;
+};
+
+} // namespace
+
+bool SerialTransport::isSimulated(const QString &portName) {
+  return portName == "sim" || portName.startsWith("sim:");
+}
+
+SerialTransport *SerialTransport::create(const QString &portName,
+                                         QObject *parent) {
+  if (isSimulated(portName)) {
+    return new SimulatedTransport(parent);
+  }
+  return new SerialPortTransport(parent);
+}
+
+SerialTransport::SerialTransport(QObject *parent) : QObject(parent) {}
+
+bool SerialTransport::lineErrors(PortStatistics &stats) const {
+  Q_UNUSED(stats);
+  return false;
+}
@@ -0,0 +1,55 @@
+#ifndef SERIALTRANSPORT_H
+#define SERIALTRANSPORT_H
+
+#include <QObject>
+#include <QSerialPort>
+#include <QString>
+#include "portstatistics.h"
+
+// Byte stream serviced by SerialPortWorker. A real serial port is one
+// backend; SimulatedTransport is another, so everything above the worker
+// (threading, pooling, statistics, reconnect, the UI) runs unchanged against
+// a simulated device. Calls are made from the thread the transport lives in.
+class SerialTransport : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Settings
+    {
+        qint32 baudRate = 115200;
+        QSerialPort::DataBits dataBits = QSerialPort::Data8;
+        QSerialPort::StopBits stopBits = QSerialPort::OneStop;
+        QSerialPort::Parity parity = QSerialPort::NoParity;
+    };
+
+    // "sim" and "sim:options" open a SimulatedTransport, anything else a
+    // serial port
+    static bool isSimulated(const QString &portName);
+    static SerialTransport *create(const QString &portName,
+                                   QObject *parent = nullptr);
+
+    explicit SerialTransport(QObject *parent = nullptr);
+
+    virtual bool open(const QString &portName, const Settings &settings) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual QString errorString() const = 0;
+
+    virtual qint64 bytesAvailable() const = 0;
+    virtual qint64 read(char *data, qint64 maxSize) = 0;
+    // Buffers data for writing; bytesWritten() reports progress
+    virtual qint64 write(const char *data, qint64 size) = 0;
+    virtual qint64 bytesToWrite() const = 0;
+
+    // Cumulative line error counters, when the backend has them
+    virtual bool lineErrors(PortStatistics &stats) const;
+
+signals:
+    void readyRead();
+    void bytesWritten(qint64 bytes);
+    // fatal: the device went away and the transport has to be reopened
+    void errorOccurred(const QString &error, bool fatal);
+};
+
+#endif // SERIALTRANSPORT_H
@@ -8,6 +8,74 @@
 #include <QFormLayout>
 #include <QTabWidget>
 
+namespace {
+
+// Delimiters are edited as text with C-style escapes
+QString escapeBytes(const QByteArray &bytes)
+{
+    QString text;
+    for (char c : bytes) {
+        switch (c) {
+        case '\n':
+            text += "\\n";
+            break;
+        case '\r':
+            text += "\\r";
+            break;
+        case '\t':
+            text += "\\t";
+            break;
+        case '\\':
+            text += "\\\\";
+            break;
+        default:
+            if (c >= 0x20 && c < 0x7F) {
+                text += QLatin1Char(c);
+            } else {
+                text += QString("\\x%1").arg(static_cast<quint8>(c), 2, 16,
+                                              QLatin1Char('0'));
+            }
+        }
+    }
+    return text;
+}
+
+QByteArray unescapeBytes(const QString &text)
+{
+    const QByteArray input = text.toUtf8();
+    QByteArray bytes;
+    for (qsizetype i = 0; i < input.size(); ++i) {
+        if (input[i] != '\\' || i + 1 == input.size()) {
+            bytes += input[i];
+            continue;
+        }
+        const char escape = input[++i];
+        if (escape == 'n') {
+            bytes += '\n';
+        } else if (escape == 'r') {
+            bytes += '\r';
+        } else if (escape == 't') {
+            bytes += '\t';
+        } else if (escape == 'x' && i + 2 < input.size()) {
+            bool ok = false;
+            const int value = input.mid(i + 1, 2).toInt(&ok, 16);
+            if (ok) {
+                bytes += static_cast<char>(value);
+                i += 2;
+            } else {
+                bytes += escape;
+            }
+        } else {
+            bytes += escape;
+        }
+    }
+    return bytes;
+}
+
+const int LengthFieldSizes[] = {1, 2, 4};
+
+} // namespace
+
 SettingsDialog::SettingsDialog(QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::SettingsDialog)
@@ -31,6 +99,12 @@ SettingsDialog::SettingsDialog(QWidget *parent)
     ui->parityComboBox->setItemData(2, QSerialPort::OddParity);
     ui->parityComboBox->setItemData(3, QSerialPort::SpaceParity);
     ui->parityComboBox->setItemData(4, QSerialPort::MarkParity);
+
+    // Only the controls for the selected framing are enabled
+    connect(ui->framingTypeComboBox,
+            QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            &SettingsDialog::updateFramingControls);
+    setFraming(FrameDecoder::Options());
 }
 
 SettingsDialog::~SettingsDialog()
@@ -53,6 +127,11 @@ bool SettingsDialog::showTimestamp() const
     return ui->showTimestampCheckBox->isChecked();
 }
 
+int SettingsDialog::refreshRate() const
+{
+    return ui->refreshRateSpinBox->value();
+}
+
 void SettingsDialog::setHexDisplay(bool enabled)
 {
     ui->hexDisplayCheckBox->setChecked(enabled);
@@ -68,6 +147,11 @@ void SettingsDialog::setShowTimestamp(bool enabled)
     ui->showTimestampCheckBox->setChecked(enabled);
 }
 
+void SettingsDialog::setRefreshRate(int hz)
+{
+    ui->refreshRateSpinBox->setValue(hz);
+}
+
 QSerialPort::DataBits SettingsDialog::dataBits() const
 {
     return static_cast<QSerialPort::DataBits>(
@@ -116,6 +200,115 @@ void SettingsDialog::setParity(QSerialPort::Parity parity)
     }
 }
 
+bool SettingsDialog::threadedIo() const
+{
+    return ui->threadedIoCheckBox->isChecked();
+}
+
+void SettingsDialog::setThreadedIo(bool enabled)
+{
+    ui->threadedIoCheckBox->setChecked(enabled);
+}
+
+bool SettingsDialog::autoReconnect() const
+{
+    return ui->autoReconnectCheckBox->isChecked();
+}
+
+void SettingsDialog::setAutoReconnect(bool enabled)
+{
+    ui->autoReconnectCheckBox->setChecked(enabled);
+}
+
+TxOptions SettingsDialog::txOptions() const
+{
+    TxOptions options;
+    options.interByteDelayMs = ui->interByteDelaySpinBox->value();
+    options.interFrameDelayMs = ui->interFrameDelaySpinBox->value();
+    options.rateLimit = ui->txRateLimitSpinBox->value();
+    return options;
+}
+
+void SettingsDialog::setTxOptions(const TxOptions &options)
+{
+    ui->interByteDelaySpinBox->setValue(options.interByteDelayMs);
+    ui->interFrameDelaySpinBox->setValue(options.interFrameDelayMs);
+    ui->txRateLimitSpinBox->setValue(options.rateLimit);
+}
+
+int SettingsDialog::logSegmentMegabytes() const
+{
+    return ui->segmentSizeSpinBox->value();
+}
+
+int SettingsDialog::logSegmentMinutes() const
+{
+    return ui->segmentTimeSpinBox->value();
+}
+
+bool SettingsDialog::logCompress() const
+{
+    return ui->compressCheckBox->isChecked();
+}
+
+void SettingsDialog::setLogSegmentMegabytes(int megabytes)
+{
+    ui->segmentSizeSpinBox->setValue(megabytes);
+}
+
+void SettingsDialog::setLogSegmentMinutes(int minutes)
+{
+    ui->segmentTimeSpinBox->setValue(minutes);
+}
+
+void SettingsDialog::setLogCompress(bool enabled)
+{
+    ui->compressCheckBox->setChecked(enabled);
+}
+
+FrameDecoder::Options SettingsDialog::framing() const
+{
+    FrameDecoder::Options options;
+    options.type = static_cast<FrameDecoder::Type>(
+        ui->framingTypeComboBox->currentIndex());
+    options.delimiter = unescapeBytes(ui->delimiterLineEdit->text());
+    options.includeDelimiter = ui->includeDelimiterCheckBox->isChecked();
+    options.frameLength = ui->frameLengthSpinBox->value();
+    options.lengthFieldSize =
+        LengthFieldSizes[qMax(0, ui->lengthFieldSizeComboBox->currentIndex())];
+    options.lengthBigEndian = ui->lengthBigEndianCheckBox->isChecked();
+    options.lengthIncludesHeader = ui->lengthIncludesHeaderCheckBox->isChecked();
+    return options;
+}
+
+void SettingsDialog::setFraming(const FrameDecoder::Options &options)
+{
+    ui->framingTypeComboBox->setCurrentIndex(options.type);
+    ui->delimiterLineEdit->setText(escapeBytes(options.delimiter));
+    ui->includeDelimiterCheckBox->setChecked(options.includeDelimiter);
+    ui->frameLengthSpinBox->setValue(options.frameLength);
+    ui->lengthFieldSizeComboBox->setCurrentIndex(
+        options.lengthFieldSize == 4 ? 2 : options.lengthFieldSize == 1 ? 0 : 1);
+    ui->lengthBigEndianCheckBox->setChecked(options.lengthBigEndian);
+    ui->lengthIncludesHeaderCheckBox->setChecked(options.lengthIncludesHeader);
+    updateFramingControls();
+}
+
+void SettingsDialog::updateFramingControls()
+{
+    const int type = ui->framingTypeComboBox->currentIndex();
+    const bool delimiter = type == FrameDecoder::Delimiter;
+    const bool fixedLength = type == FrameDecoder::FixedLength;
+    const bool lengthPrefix = type == FrameDecoder::LengthPrefix;
+
+    ui->delimiterLineEdit->setEnabled(delimiter);
+    ui->includeDelimiterCheckBox->setEnabled(delimiter);
+    ui->frameLengthSpinBox->setEnabled(fixedLength);
+    ui->lengthFieldSizeComboBox->setEnabled(lengthPrefix);
+    ui->lengthBigEndianCheckBox->setEnabled(lengthPrefix);
+    ui->lengthIncludesHeaderCheckBox->setEnabled(lengthPrefix);
+}
+
 void SettingsDialog::setShortcuts(const QMap<QString, QString> &shortcuts)
 {
     m_shortcuts = shortcuts;
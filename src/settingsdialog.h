@@ -4,6 +4,8 @@
 #include <QDialog>
 #include <QSerialPort>
 #include <QMap>
+#include "framedecoder.h"
+#include "txoptions.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class SettingsDialog; }
@@ -21,22 +23,39 @@ public:
     bool hexDisplay() const;
     bool autoScroll() const;
     bool showTimestamp() const;
+    int refreshRate() const;
     QSerialPort::DataBits dataBits() const;
     QSerialPort::StopBits stopBits() const;
     QSerialPort::Parity parity() const;
+    bool threadedIo() const;
+    bool autoReconnect() const;
+    TxOptions txOptions() const;
+    int logSegmentMegabytes() const;
+    int logSegmentMinutes() const;
+    bool logCompress() const;
+    FrameDecoder::Options framing() const;
     QMap<QString, QString> shortcuts() const;
 
     // Setters
     void setHexDisplay(bool enabled);
     void setAutoScroll(bool enabled);
     void setShowTimestamp(bool enabled);
+    void setRefreshRate(int hz);
     void setDataBits(QSerialPort::DataBits dataBits);
     void setStopBits(QSerialPort::StopBits stopBits);
     void setParity(QSerialPort::Parity parity);
+    void setThreadedIo(bool enabled);
+    void setAutoReconnect(bool enabled);
+    void setTxOptions(const TxOptions &options);
+    void setLogSegmentMegabytes(int megabytes);
+    void setLogSegmentMinutes(int minutes);
+    void setLogCompress(bool enabled);
+    void setFraming(const FrameDecoder::Options &options);
     void setShortcuts(const QMap<QString, QString> &shortcuts);
 
 private:
     void loadShortcuts();
+    void updateFramingControls();
 
     Ui::SettingsDialog *ui;
     QMap<QString, QString> m_shortcuts;
@@ -0,0 +1,384 @@
+#include "simulatedtransport.h"
+#include "capturereader.h"
+#include "serialclock.h"
+#include <QStringList>
+#include <QTimer>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Delivered bytes are moved to the front of the buffer once this many have
+// been read, so it does not grow while the reader keeps up
+const qsizetype CompactThreshold = 64 * 1024;
+
+const double Pi = 3.14159265358979323846;
+
+bool isFlag(const QString &value, bool &flag) {
+  flag = value.isEmpty() || value == "1" || value == "on";
+  return flag || value == "0" || value == "off";
+}
+
+} // namespace
+
+bool SimulatedTransport::parseOptions(const QString &portName,
+                                      Options &options, QString &error) {
+  options = Options();
+  if (!isSimulated(portName)) {
+    error = "Not a simulated port: " + portName;
+    return false;
+  }
+
+  const QStringList items = portName.mid(4).split(',', Qt::SkipEmptyParts);
+  for (const QString &item : items) {
+    const qsizetype equals = item.indexOf('=');
+    const QString key = item.left(equals).trimmed().toLower();
+    const QString value =
+        equals < 0 ? QString() : item.mid(equals + 1).trimmed();
+
+    bool ok = true;
+    if (key == "data") {
+      if (value == "lines") {
+        options.pattern = Lines;
+      } else if (value == "counter") {
+        options.pattern = Counter;
+      } else if (value == "none") {
+        options.pattern = Silent;
+      } else {
+        ok = false;
+      }
+    } else if (key == "rate") {
+      options.rate = value.toLongLong(&ok);
+      ok = ok && options.rate > 0;
+    } else if (key == "burst") {
+      options.burst = value.toInt(&ok);
+      ok = ok && options.burst > 0 && options.burst <= DriverBufferSize;
+    } else if (key == "jitter") {
+      options.jitter = value.toDouble(&ok);
+      ok = ok && options.jitter >= 0.0 && options.jitter <= 1.0;
+    } else if (key == "errors") {
+      options.errorRate = value.toDouble(&ok);
+      ok = ok && options.errorRate >= 0.0 && options.errorRate < 1.0;
+    } else if (key == "seed") {
+      options.seed = value.toUInt(&ok);
+    } else if (key == "echo") {
+      ok = isFlag(value, options.echo);
+    } else if (key == "replay") {
+      options.replayPath = value;
+      ok = !value.isEmpty();
+    } else if (key == "speed") {
+      options.speed = value.toDouble(&ok);
+      ok = ok && options.speed > 0.0;
+    } else if (key == "repeat") {
+      ok = isFlag(value, options.repeat);
+    } else if (key == "disconnect") {
+      options.disconnectMs = value.toInt(&ok);
+      ok = ok && options.disconnectMs > 0;
+    } else {
+      error = "Unknown simulator option: " + key;
+      return false;
+    }
+
+    if (!ok) {
+      error = "Invalid simulator option: " + item;
+      return false;
+    }
+  }
+  return true;
+}
+
+SimulatedTransport::SimulatedTransport(QObject *parent)
+    : SerialTransport(parent), m_open(false), m_timer(new QTimer(this)),
+      m_rxOffset(0), m_openedNs(0), m_burstIntervalNs(0), m_nextBurstNs(-1),
+      m_patternPosition(0), m_lineOffset(0), m_received(0), m_nextError(0),
+      m_corruptedBytes(0), m_overruns(0), m_replayRecord(0),
+      m_replayFirstTimestamp(0), m_replayStartNs(0) {
+  m_timer->setSingleShot(true);
+  m_timer->setTimerType(Qt::PreciseTimer);
+  connect(m_timer, &QTimer::timeout, this, &SimulatedTransport::generate);
+}
+
+SimulatedTransport::~SimulatedTransport() { close(); }
+
+bool SimulatedTransport::open(const QString &portName,
+                              const Settings &settings) {
+  close();
+  m_errorString.clear();
+  if (!parseOptions(portName, m_options, m_errorString)) {
+    return false;
+  }
+
+  if (!m_options.replayPath.isEmpty()) {
+    m_capture = std::make_unique<CaptureReader>();
+    if (!m_capture->open(m_options.replayPath)) {
+      m_errorString = m_capture->errorString();
+      m_capture.reset();
+      return false;
+    }
+  }
+
+  // 8N1 framing: ten bits on the line per byte
+  const qint64 rate =
+      m_options.rate > 0 ? m_options.rate : qMax(1, settings.baudRate / 10);
+  m_burstIntervalNs = qMax<qint64>(1, m_options.burst * 1000000000LL / rate);
+  m_openedNs = SerialClock::nowNs();
+  m_nextBurstNs = m_openedNs + m_burstIntervalNs;
+  m_timingRandom.seed(m_options.seed);
+  m_errorRandom.seed(m_options.seed ^ 0x5eed);
+  m_patternPosition = 0;
+  m_line.clear();
+  m_lineOffset = 0;
+  m_received = 0;
+  m_nextError = 0;
+  m_corruptedBytes = 0;
+  m_overruns = 0;
+  scheduleNextError();
+
+  if (m_capture) {
+    m_replayRecord = m_capture->firstRecord();
+    m_replayFirstTimestamp = m_capture->recordCount() > 0
+                                 ? m_capture->record(m_replayRecord).timestamp
+                                 : 0;
+    m_replayStartNs = m_openedNs;
+  }
+
+  m_open = true;
+  m_timer->start(0);
+  return true;
+}
+
+void SimulatedTransport::close() {
+  m_timer->stop();
+  m_open = false;
+  m_rxBuffer.clear();
+  m_rxOffset = 0;
+  m_capture.reset();
+}
+
+bool SimulatedTransport::isOpen() const { return m_open; }
+
+QString SimulatedTransport::errorString() const { return m_errorString; }
+
+qint64 SimulatedTransport::bytesAvailable() const {
+  return m_rxBuffer.size() - m_rxOffset;
+}
+
+qint64 SimulatedTransport::read(char *data, qint64 maxSize) {
+  const qint64 length = qMin(maxSize, bytesAvailable());
+  if (length <= 0) {
+    return 0;
+  }
+  std::memcpy(data, m_rxBuffer.constData() + m_rxOffset, size_t(length));
+  m_rxOffset += length;
+
+  if (m_rxOffset == m_rxBuffer.size()) {
+    m_rxBuffer.clear();
+    m_rxOffset = 0;
+  } else if (m_rxOffset >= CompactThreshold) {
+    m_rxBuffer.remove(0, m_rxOffset);
+    m_rxOffset = 0;
+  }
+  return length;
+}
+
+qint64 SimulatedTransport::write(const char *data, qint64 size) {
+  if (!m_open) {
+    m_errorString = "Port is not open";
+    return -1;
+  }
+
+  // The device takes everything at once; completion is reported from the
+  // event loop, as a driver would
+  if (m_options.echo && size > 0) {
+    receive(data, size);
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+          if (m_open && bytesAvailable() > 0) {
+            emit readyRead();
+          }
+        },
+        Qt::QueuedConnection);
+  }
+  QMetaObject::invokeMethod(
+      this,
+      [this, size]() {
+        if (m_open) {
+          emit bytesWritten(size);
+        }
+      },
+      Qt::QueuedConnection);
+  return size;
+}
+
+qint64 SimulatedTransport::bytesToWrite() const { return 0; }
+
+bool SimulatedTransport::lineErrors(PortStatistics &stats) const {
+  if (!m_open) {
+    return false;
+  }
+  // Corrupted bytes stand in for framing errors
+  stats.lineErrorsAvailable = true;
+  stats.framingErrors = m_corruptedBytes;
+  stats.bufferOverruns = m_overruns;
+  return true;
+}
+
+void SimulatedTransport::generate() {
+  if (!m_open) {
+    return;
+  }
+
+  const qint64 now = SerialClock::nowNs();
+  const qint64 disconnectNs =
+      m_options.disconnectMs > 0
+          ? m_openedNs + m_options.disconnectMs * 1000000LL
+          : std::numeric_limits<qint64>::max();
+  if (now >= disconnectNs) {
+    close();
+    m_errorString = "Simulated device disconnected";
+    emit errorOccurred(m_errorString, true);
+    return;
+  }
+
+  const qint64 before = bytesAvailable();
+  if (m_capture) {
+    replayRecords(now);
+  } else {
+    generateBursts(now);
+  }
+
+  const qint64 wakeNs = m_nextBurstNs < 0 ? disconnectNs
+                                          : qMin(m_nextBurstNs, disconnectNs);
+  if (wakeNs != std::numeric_limits<qint64>::max()) {
+    m_timer->start(int(qMax<qint64>(0, (wakeNs - now + 999999) / 1000000)));
+  }
+
+  // Last, as the reader may close the port from here
+  if (bytesAvailable() != before) {
+    emit readyRead();
+  }
+}
+
+void SimulatedTransport::generateBursts(qint64 now) {
+  if (m_options.pattern == Silent) {
+    m_nextBurstNs = -1;
+    return;
+  }
+
+  QByteArray burst(m_options.burst, Qt::Uninitialized);
+  qint64 generated = 0;
+  while (m_nextBurstNs <= now) {
+    fillPattern(burst.data(), burst.size());
+    receive(burst.constData(), burst.size());
+    generated += burst.size();
+
+    const double spread =
+        m_options.jitter * (m_timingRandom.generateDouble() * 2.0 - 1.0);
+    m_nextBurstNs +=
+        qMax<qint64>(1, qint64(double(m_burstIntervalNs) * (1.0 + spread)));
+
+    // After a stall of the event loop, catch up with one buffer's worth
+    // only; the driver would have dropped the rest anyway
+    if (generated >= DriverBufferSize) {
+      m_nextBurstNs = qMax(m_nextBurstNs, now + m_burstIntervalNs);
+      break;
+    }
+  }
+}
+
+void SimulatedTransport::replayRecords(qint64 now) {
+  qint64 replayed = 0;
+  for (;;) {
+    if (m_replayRecord >= m_capture->endRecord()) {
+      if (!m_options.repeat || m_capture->recordCount() == 0) {
+        m_nextBurstNs = -1;
+        return;
+      }
+      m_replayRecord = m_capture->firstRecord();
+      m_replayStartNs = now;
+    }
+
+    const ConsoleSource::Record record = m_capture->record(m_replayRecord);
+    const qint64 dueNs =
+        m_replayStartNs +
+        qint64(double(record.timestamp - m_replayFirstTimestamp) /
+               m_options.speed);
+    if (dueNs > now || replayed >= DriverBufferSize) {
+      m_nextBurstNs = qMax(dueNs, now);
+      return;
+    }
+
+    if (record.direction == ConsoleSource::Rx) {
+      const QByteArray data = m_capture->recordData(m_replayRecord);
+      receive(data.constData(), data.size());
+      replayed += data.size();
+    }
+    ++m_replayRecord;
+  }
+}
+
+void SimulatedTransport::fillPattern(char *data, qsizetype length) {
+  if (m_options.pattern == Counter) {
+    for (qsizetype i = 0; i < length; ++i) {
+      data[i] = char(m_patternPosition + quint64(i));
+    }
+    m_patternPosition += quint64(length);
+    return;
+  }
+
+  // Lines: a sequence number, a sine and a ramp, one sample per line
+  qsizetype filled = 0;
+  while (filled < length) {
+    if (m_lineOffset == m_line.size()) {
+      const quint64 n = m_patternPosition++;
+      const double phase = 2.0 * Pi * double(n % 250) / 250.0;
+      const int sine = qRound(1000.0 * std::sin(phase));
+      m_line = "seq:" + QByteArray::number(n) + " sine:" +
+               QByteArray::number(sine) + " ramp:" +
+               QByteArray::number(n % 100) + '\n';
+      m_lineOffset = 0;
+    }
+    const qsizetype count =
+        qMin(length - filled, m_line.size() - m_lineOffset);
+    std::memcpy(data + filled, m_line.constData() + m_lineOffset,
+                size_t(count));
+    filled += count;
+    m_lineOffset += count;
+  }
+}
+
+void SimulatedTransport::receive(const char *data, qsizetype length) {
+  const qsizetype start = m_rxBuffer.size();
+  const qsizetype kept =
+      qBound<qsizetype>(0, DriverBufferSize - bytesAvailable(), length);
+  if (kept < length) {
+    ++m_overruns;
+  }
+  m_rxBuffer.append(data, kept);
+
+  // Error positions count dropped bytes too, so they do not depend on how
+  // fast the reader is
+  while (m_nextError < m_received + quint64(length)) {
+    const quint64 index = m_nextError - m_received;
+    if (index < quint64(kept)) {
+      m_rxBuffer[start + qsizetype(index)] ^=
+          char(1 << m_errorRandom.bounded(8));
+      ++m_corruptedBytes;
+    }
+    ++m_nextError;
+    scheduleNextError();
+  }
+  m_received += quint64(length);
+}
+
+void SimulatedTransport::scheduleNextError() {
+  if (m_options.errorRate <= 0.0) {
+    m_nextError = std::numeric_limits<quint64>::max();
+    return;
+  }
+  // Gap to the next corrupted byte, geometrically distributed
+  const double u = m_errorRandom.generateDouble();
+  m_nextError += quint64(std::log1p(-u) / std::log1p(-m_options.errorRate));
+}
@@ -0,0 +1,118 @@
+#ifndef SIMULATEDTRANSPORT_H
+#define SIMULATEDTRANSPORT_H
+
+#include <QByteArray>
+#include <QRandomGenerator>
+#include <QString>
+#include <memory>
+#include "serialtransport.h"
+
+class CaptureReader;
+class QTimer;
+
+// In-process stand-in for a serial device, opened through a port name of the
+// form "sim:key=value,key,...":
+//
+//   data=lines|counter|none  generated traffic (default lines): telemetry
+//                            lines the plotter understands, or bytes
+//                            counting 00..FF so gaps and corruption show
+//   rate=N                   bytes per second (default baud / 10); may be
+//                            far beyond what a UART can do
+//   burst=N                  bytes per delivery (default 64)
+//   jitter=F                 0-1, spread of the time between bursts
+//   errors=P                 probability that a byte is corrupted
+//   seed=N                   random seed (default 1)
+//   echo                     TX is looped back to RX
+//   replay=PATH              replay the RX records of a .sfcap capture
+//   speed=F                  replay speed (default 1)
+//   repeat                   start the replay over when it ends
+//   disconnect=MS            fail as an unplugged device after MS
+//
+// The data and the positions of corrupted bytes depend only on the options,
+// so runs are reproducible; only the delivery times follow the clock.
+class SimulatedTransport : public SerialTransport
+{
+    Q_OBJECT
+
+public:
+    // Received bytes beyond this are dropped and counted as buffer overruns,
+    // as a driver would when nobody reads
+    static constexpr qint64 DriverBufferSize = 1024 * 1024;
+
+    enum Pattern {
+        Lines,
+        Counter,
+        Silent
+    };
+
+    struct Options
+    {
+        Pattern pattern = Lines;
+        qint64 rate = 0;           // 0 = baud rate / 10
+        int burst = 64;
+        double jitter = 0.0;
+        double errorRate = 0.0;
+        quint32 seed = 1;
+        bool echo = false;
+        QString replayPath;
+        double speed = 1.0;
+        bool repeat = false;
+        int disconnectMs = 0;      // 0 = never
+    };
+
+    static bool parseOptions(const QString &portName, Options &options,
+                             QString &error);
+
+    explicit SimulatedTransport(QObject *parent = nullptr);
+    ~SimulatedTransport();
+
+    // SerialTransport
+    bool open(const QString &portName, const Settings &settings) override;
+    void close() override;
+    bool isOpen() const override;
+    QString errorString() const override;
+    qint64 bytesAvailable() const override;
+    qint64 read(char *data, qint64 maxSize) override;
+    qint64 write(const char *data, qint64 size) override;
+    qint64 bytesToWrite() const override;
+    bool lineErrors(PortStatistics &stats) const override;
+
+private slots:
+    void generate();
+
+private:
+    void generateBursts(qint64 now);
+    void replayRecords(qint64 now);
+    void fillPattern(char *data, qsizetype length);
+    void receive(const char *data, qsizetype length);
+    void scheduleNextError();
+
+    Options m_options;
+    bool m_open;
+    QString m_errorString;
+    QTimer *m_timer;
+
+    QByteArray m_rxBuffer;
+    qsizetype m_rxOffset;         // bytes of m_rxBuffer already read
+
+    qint64 m_openedNs;
+    qint64 m_burstIntervalNs;
+    qint64 m_nextBurstNs;
+    QRandomGenerator m_timingRandom;
+    quint64 m_patternPosition;    // Counter: bytes, Lines: lines so far
+    QByteArray m_line;            // Lines: the line being sent
+    qsizetype m_lineOffset;
+
+    QRandomGenerator m_errorRandom;
+    quint64 m_received;           // bytes through receive()
+    quint64 m_nextError;          // index of the next byte to corrupt
+    quint64 m_corruptedBytes;
+    quint64 m_overruns;
+
+    std::unique_ptr<CaptureReader> m_capture;
+    qint64 m_replayRecord;
+    qint64 m_replayFirstTimestamp;
+    qint64 m_replayStartNs;       // clock time of the capture's first record
+};
+
+#endif // SIMULATEDTRANSPORT_H
@@ -0,0 +1,120 @@
+#include "statisticsexporter.h"
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+
+namespace {
+
+QJsonValue lineError(const PortStatistics &stats, quint64 count) {
+  return stats.lineErrorsAvailable ? QJsonValue(double(count)) : QJsonValue();
+}
+
+double microseconds(qint64 ns) { return ns / 1000.0; }
+
+} // namespace
+
+StatisticsExporter::Format StatisticsExporter::formatFor(const QString &path) {
+  return path.endsWith(".json", Qt::CaseInsensitive) ||
+                 path.endsWith(".jsonl", Qt::CaseInsensitive)
+             ? JsonLines
+             : Csv;
+}
+
+bool StatisticsExporter::open(const QString &path) {
+  close();
+  m_format = formatFor(path);
+  m_headerWritten = false;
+  m_file.setFileName(path);
+  return m_file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                     QIODevice::Text);
+}
+
+void StatisticsExporter::close() {
+  if (m_file.isOpen()) {
+    m_file.close();
+  }
+}
+
+bool StatisticsExporter::isOpen() const { return m_file.isOpen(); }
+
+QString StatisticsExporter::fileName() const { return m_file.fileName(); }
+
+QString StatisticsExporter::errorString() const { return m_file.errorString(); }
+
+bool StatisticsExporter::write(const PortStatistics &stats) {
+  if (!m_file.isOpen()) {
+    return false;
+  }
+
+  const QList<QPair<QString, QJsonValue>> values = fields(stats);
+  QByteArray row;
+  if (m_format == JsonLines) {
+    QJsonObject object;
+    for (const auto &field : values) {
+      object.insert(field.first, field.second);
+    }
+    row = QJsonDocument(object).toJson(QJsonDocument::Compact);
+  } else {
+    QStringList columns;
+    if (!m_headerWritten) {
+      for (const auto &field : values) {
+        columns << field.first;
+      }
+      row = columns.join(',').toUtf8() + '\n';
+      columns.clear();
+      m_headerWritten = true;
+    }
+    for (const auto &field : values) {
+      const QJsonValue &value = field.second;
+      if (value.isString()) {
+        columns << value.toString();
+      } else if (value.isDouble()) {
+        columns << QString::number(value.toDouble(), 'g', 15);
+      } else {
+        columns << QString();
+      }
+    }
+    row += columns.join(',').toUtf8();
+  }
+  row += '\n';
+
+  return m_file.write(row) == row.size() && m_file.flush();
+}
+
+QList<QPair<QString, QJsonValue>>
+StatisticsExporter::fields(const PortStatistics &stats) {
+  const QDateTime time =
+      QDateTime::fromMSecsSinceEpoch(stats.timestamp / 1000000).toUTC();
+  QList<QPair<QString, QJsonValue>> values = {
+      {"timestamp", time.toString(Qt::ISODateWithMs)},
+      {"intervalMs", stats.intervalNs / 1e6},
+      {"rxBytes", double(stats.rxBytes)},
+      {"txBytes", double(stats.txBytes)},
+      {"rxChunks", double(stats.rxChunks)},
+      {"rxBytesPerSecond", stats.rxBytesPerSecond},
+      {"txBytesPerSecond", stats.txBytesPerSecond},
+      {"deliveryAvgUs", microseconds(stats.deliveryLatency.averageNs())},
+      {"deliveryMaxUs", microseconds(stats.deliveryLatency.maxNs)},
+      {"displayAvgUs", microseconds(stats.displayLatency.averageNs())},
+      {"displayMaxUs", microseconds(stats.displayLatency.maxNs)},
+      {"driverRxPeak", double(stats.driverRxPeak)},
+      {"driverTxBytes", double(stats.driverTxBytes)},
+      {"txQueuedBytes", double(stats.txQueuedBytes)},
+      {"rxQueuePeak", stats.rxQueuePeak},
+      {"rxQueueCapacity", stats.rxQueueCapacity},
+      {"droppedChunks", double(stats.droppedChunks)},
+      {"droppedBytes", double(stats.droppedBytes)},
+      {"parityErrors", lineError(stats, stats.parityErrors)},
+      {"framingErrors", lineError(stats, stats.framingErrors)},
+      {"overrunErrors", lineError(stats, stats.overrunErrors)},
+      {"bufferOverruns", lineError(stats, stats.bufferOverruns)},
+      {"breaks", lineError(stats, stats.breaks)},
+  };
+  // Histogram columns are named by the smallest read size they count
+  for (int i = 0; i < PortStatistics::HistogramBuckets; ++i) {
+    values.append({QString("chunks%1").arg(qint64(1) << i),
+                   double(stats.chunkSizes[i])});
+  }
+  return values;
+}
@@ -0,0 +1,42 @@
+#ifndef STATISTICSEXPORTER_H
+#define STATISTICSEXPORTER_H
+
+#include <QFile>
+#include <QJsonValue>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include "portstatistics.h"
+
+// Appends PortStatistics snapshots to a file, one row per snapshot, for
+// soak tests: CSV with a header row, or JSON Lines when the file name ends
+// in ".json" or ".jsonl". Every row is flushed so a crash loses nothing.
+class StatisticsExporter
+{
+public:
+    enum Format {
+        Csv,
+        JsonLines
+    };
+
+    static Format formatFor(const QString &path);
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    bool write(const PortStatistics &stats);
+
+    // Named values of a snapshot, in column order; null where unavailable
+    static QList<QPair<QString, QJsonValue>>
+    fields(const PortStatistics &stats);
+
+private:
+    QFile m_file;
+    Format m_format = Csv;
+    bool m_headerWritten = false;
+};
+
+#endif // STATISTICSEXPORTER_H
@@ -0,0 +1,187 @@
+#include "statisticspanel.h"
+#include "serialportmanager.h"
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPainter>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+// Read sizes since the port was opened, one bar per power of two
+class ChunkHistogram : public QWidget {
+public:
+  explicit ChunkHistogram(QWidget *parent) : QWidget(parent), m_counts() {
+    setMinimumHeight(90);
+  }
+
+  void setCounts(const quint64 *counts) {
+    std::copy(counts, counts + PortStatistics::HistogramBuckets, m_counts);
+    update();
+  }
+
+protected:
+  void paintEvent(QPaintEvent *) override {
+    QPainter painter(this);
+    const int labelHeight = fontMetrics().height();
+    const int barArea = height() - labelHeight - 2;
+    const int slot = width() / PortStatistics::HistogramBuckets;
+    const quint64 largest = *std::max_element(
+        m_counts, m_counts + PortStatistics::HistogramBuckets);
+
+    for (int i = 0; i < PortStatistics::HistogramBuckets; ++i) {
+      const int x = i * slot;
+      if (largest > 0 && m_counts[i] > 0) {
+        const int bar = qMax(1, int(barArea * m_counts[i] / largest));
+        painter.fillRect(x + 1, barArea - bar, slot - 2, bar,
+                         QColor("#16a34a"));
+      }
+      if (i % 2 == 0) {
+        painter.setPen(palette().text().color());
+        painter.drawText(QRect(x, barArea + 2, slot * 2, labelHeight),
+                         Qt::AlignLeft,
+                         StatisticsPanel::formatBytes(qint64(1) << i));
+      }
+    }
+  }
+
+private:
+  quint64 m_counts[PortStatistics::HistogramBuckets];
+};
+
+QString formatLatency(const PortStatistics::Latency &latency) {
+  if (latency.samples == 0) {
+    return "-";
+  }
+  return QString("avg %1 ms, max %2 ms")
+      .arg(latency.averageNs() / 1e6, 0, 'f', 2)
+      .arg(latency.maxNs / 1e6, 0, 'f', 2);
+}
+
+} // namespace
+
+StatisticsPanel::StatisticsPanel(SerialPortManager *manager, QWidget *parent)
+    : QWidget(parent), m_manager(manager) {
+  QFormLayout *form = new QFormLayout;
+  auto addRow = [&](const QString &name) {
+    QLabel *label = new QLabel("-", this);
+    label->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    form->addRow(name, label);
+    return label;
+  };
+  m_rxRateLabel = addRow("RX rate:");
+  m_txRateLabel = addRow("TX rate:");
+  m_totalsLabel = addRow("Totals:");
+  m_deliveryLabel = addRow("Read to delivery:");
+  m_displayLabel = addRow("Read to display:");
+  m_driverLabel = addRow("Port buffers:");
+  m_queueLabel = addRow("RX queue peak:");
+  m_droppedLabel = addRow("Dropped:");
+  m_lineErrorsLabel = addRow("Line errors:");
+
+  m_histogram = new ChunkHistogram(this);
+
+  m_exportButton = new QPushButton("Export...", this);
+  m_exportButton->setToolTip("Append every snapshot to a CSV or JSON file");
+  m_exportLabel = new QLabel(this);
+  m_exportLabel->setWordWrap(true);
+
+  QHBoxLayout *exportRow = new QHBoxLayout;
+  exportRow->addWidget(m_exportButton);
+  exportRow->addWidget(m_exportLabel, 1);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->addLayout(form);
+  layout->addWidget(new QLabel("Read sizes (bytes):", this));
+  layout->addWidget(m_histogram);
+  layout->addLayout(exportRow);
+  layout->addStretch();
+
+  connect(m_manager, &SerialPortManager::statisticsUpdated, this,
+          &StatisticsPanel::updateStatistics);
+  connect(m_exportButton, &QPushButton::clicked, this,
+          &StatisticsPanel::toggleExport);
+}
+
+QString StatisticsPanel::formatBytes(double bytes) {
+  static const char *const units[] = {"B", "K", "M", "G", "T"};
+  int unit = 0;
+  while (bytes >= 1024 && unit < 4) {
+    bytes /= 1024;
+    ++unit;
+  }
+  return unit == 0 ? QString::number(qint64(bytes)) + units[unit]
+                   : QString::number(bytes, 'f', bytes < 10 ? 1 : 0) +
+                         units[unit];
+}
+
+QString StatisticsPanel::formatRate(double bytesPerSecond) {
+  return formatBytes(bytesPerSecond) + "/s";
+}
+
+void StatisticsPanel::updateStatistics(const PortStatistics &stats) {
+  m_rxRateLabel->setText(formatRate(stats.rxBytesPerSecond));
+  m_txRateLabel->setText(formatRate(stats.txBytesPerSecond));
+  m_totalsLabel->setText(QString("RX %1 in %2 reads, TX %3")
+                             .arg(formatBytes(stats.rxBytes))
+                             .arg(stats.rxChunks)
+                             .arg(formatBytes(stats.txBytes)));
+  m_deliveryLabel->setText(formatLatency(stats.deliveryLatency));
+  m_displayLabel->setText(formatLatency(stats.displayLatency));
+  m_driverLabel->setText(QString("RX peak %1, TX %2 + %3 queued")
+                             .arg(formatBytes(stats.driverRxPeak))
+                             .arg(formatBytes(stats.driverTxBytes))
+                             .arg(formatBytes(stats.txQueuedBytes)));
+  m_queueLabel->setText(QString("%1 of %2 chunks")
+                            .arg(stats.rxQueuePeak)
+                            .arg(stats.rxQueueCapacity));
+  m_droppedLabel->setText(QString("%1 chunks, %2")
+                              .arg(stats.droppedChunks)
+                              .arg(formatBytes(stats.droppedBytes)));
+  if (stats.lineErrorsAvailable) {
+    m_lineErrorsLabel->setText(
+        QString("parity %1, framing %2, overrun %3/%4, breaks %5")
+            .arg(stats.parityErrors)
+            .arg(stats.framingErrors)
+            .arg(stats.overrunErrors)
+            .arg(stats.bufferOverruns)
+            .arg(stats.breaks));
+  } else {
+    m_lineErrorsLabel->setText("not reported by this driver");
+  }
+  static_cast<ChunkHistogram *>(m_histogram)->setCounts(stats.chunkSizes);
+
+  if (m_exporter.isOpen() && !m_exporter.write(stats)) {
+    m_exportLabel->setText("Export stopped: " + m_exporter.errorString());
+    m_exporter.close();
+    m_exportButton->setText("Export...");
+  }
+}
+
+void StatisticsPanel::toggleExport() {
+  if (m_exporter.isOpen()) {
+    m_exporter.close();
+    m_exportButton->setText("Export...");
+    m_exportLabel->setText("Saved " + m_exporter.fileName());
+    return;
+  }
+
+  const QString fileName = QFileDialog::getSaveFileName(
+      this, "Export Statistics", "serialflow-stats.csv",
+      "CSV (*.csv);;JSON Lines (*.jsonl *.json)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  if (!m_exporter.open(fileName)) {
+    m_exportLabel->setText("Cannot open " + fileName + ": " +
+                           m_exporter.errorString());
+    return;
+  }
+  m_exportButton->setText("Stop Export");
+  m_exportLabel->setText(QString("Writing a row every %1 ms to %2")
+                             .arg(m_manager->statisticsInterval())
+                             .arg(fileName));
+}
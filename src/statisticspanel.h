@@ -0,0 +1,50 @@
+#ifndef STATISTICSPANEL_H
+#define STATISTICSPANEL_H
+
+#include <QWidget>
+#include "portstatistics.h"
+#include "statisticsexporter.h"
+
+class QLabel;
+class QPushButton;
+class SerialPortManager;
+
+// Live view of a SerialPortManager's statistics: rates, latencies, fill
+// levels, losses, line errors and the read size histogram. Snapshots can
+// also be exported to CSV or JSON Lines as they arrive.
+class StatisticsPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StatisticsPanel(SerialPortManager *manager,
+                             QWidget *parent = nullptr);
+
+    static QString formatBytes(double bytes);
+    static QString formatRate(double bytesPerSecond);
+
+public slots:
+    void updateStatistics(const PortStatistics &stats);
+
+private slots:
+    void toggleExport();
+
+private:
+    SerialPortManager *m_manager;
+    StatisticsExporter m_exporter;
+
+    QLabel *m_rxRateLabel;
+    QLabel *m_txRateLabel;
+    QLabel *m_totalsLabel;
+    QLabel *m_deliveryLabel;
+    QLabel *m_displayLabel;
+    QLabel *m_driverLabel;
+    QLabel *m_queueLabel;
+    QLabel *m_droppedLabel;
+    QLabel *m_lineErrorsLabel;
+    QWidget *m_histogram;
+    QPushButton *m_exportButton;
+    QLabel *m_exportLabel;
+};
+
+#endif // STATISTICSPANEL_H
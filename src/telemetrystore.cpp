@@ -0,0 +1,220 @@
+#include "telemetrystore.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float Infinity = std::numeric_limits<float>::infinity();
+
+qsizetype roundCapacity(qsizetype capacity) {
+  const qsizetype blocks =
+      qMax<qsizetype>(1, (capacity + TelemetryChannel::TopBlock - 1) /
+                             TelemetryChannel::TopBlock);
+  return blocks * TelemetryChannel::TopBlock;
+}
+
+bool isSeparator(char c) {
+  return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+TelemetryChannel::TelemetryChannel(qsizetype capacity, quint64 start)
+    : m_values(roundCapacity(capacity),
+               std::numeric_limits<float>::quiet_NaN()),
+      m_end(start) {
+  for (int level = 0; level < Levels; ++level) {
+    m_levels[level] = QVector<Extremes>(
+        m_values.size() >> (LevelBits * (level + 1)), {Infinity, -Infinity});
+  }
+}
+
+void TelemetryChannel::append(float value) {
+  const quint64 index = m_end++;
+  m_values[index % m_values.size()] = value;
+
+  // Each level's block is restarted by its first sample and widened by the
+  // rest, so the pyramid is always current up to the newest sample
+  const bool finite = std::isfinite(value);
+  for (int level = 0; level < Levels; ++level) {
+    const int shift = LevelBits * (level + 1);
+    QVector<Extremes> &blocks = m_levels[level];
+    Extremes &block = blocks[(index >> shift) % blocks.size()];
+    if ((index & ((quint64(1) << shift) - 1)) == 0) {
+      block = {Infinity, -Infinity};
+    }
+    if (finite) {
+      block.min = qMin(block.min, value);
+      block.max = qMax(block.max, value);
+    }
+  }
+}
+
+quint64 TelemetryChannel::begin() const {
+  const quint64 capacity = m_values.size();
+  return m_end > capacity ? m_end - capacity : 0;
+}
+
+float TelemetryChannel::at(quint64 index) const {
+  Q_ASSERT(index >= begin() && index < m_end);
+  return m_values[index % m_values.size()];
+}
+
+bool TelemetryChannel::minMax(quint64 from, quint64 to, float &min,
+                              float &max) const {
+  from = qMax(from, begin());
+  to = qMin(to, m_end);
+
+  // Walk the range in the largest aligned blocks that fit. A block starting
+  // inside the retained range is the newest one in its slot, so it is never
+  // stale even after the ring wrapped.
+  float low = Infinity;
+  float high = -Infinity;
+  while (from < to) {
+    int level = Levels;
+    quint64 size = 0;
+    for (; level > 0; --level) {
+      size = quint64(1) << (LevelBits * level);
+      if (from % size == 0 && from + size <= to) {
+        break;
+      }
+    }
+
+    if (level == 0) {
+      const float value = m_values[from % m_values.size()];
+      if (std::isfinite(value)) {
+        low = qMin(low, value);
+        high = qMax(high, value);
+      }
+      ++from;
+    } else {
+      const QVector<Extremes> &blocks = m_levels[level - 1];
+      const Extremes &block =
+          blocks[(from >> (LevelBits * level)) % blocks.size()];
+      low = qMin(low, block.min);
+      high = qMax(high, block.max);
+      from += size;
+    }
+  }
+
+  if (low > high) {
+    return false;
+  }
+  min = low;
+  max = high;
+  return true;
+}
+
+TelemetryStore::TelemetryStore(qsizetype capacity)
+    : m_capacity(roundCapacity(capacity)), m_timestamps(m_capacity),
+      m_end(0) {}
+
+bool TelemetryStore::appendLine(const QByteArray &line, qint64 timestamp) {
+  if (!parseLine(line, m_values, m_fieldNames)) {
+    return false;
+  }
+
+  while (m_channels.size() < m_values.size()) {
+    m_channels.append(TelemetryChannel(m_capacity, m_end));
+    m_names.append(QString());
+  }
+  for (int i = 0; i < m_channels.size(); ++i) {
+    if (i < m_values.size()) {
+      m_channels[i].append(m_values[i]);
+      if (!m_fieldNames[i].isEmpty() &&
+          m_names[i] != QLatin1String(m_fieldNames[i])) {
+        m_names[i] = QString::fromLatin1(m_fieldNames[i]);
+      }
+    } else {
+      m_channels[i].append(std::numeric_limits<float>::quiet_NaN());
+    }
+  }
+
+  m_timestamps[m_end % m_capacity] = timestamp;
+  ++m_end;
+  return true;
+}
+
+void TelemetryStore::clear() {
+  m_channels.clear();
+  m_names.clear();
+  m_end = 0;
+}
+
+const TelemetryChannel &TelemetryStore::channel(int index) const {
+  return m_channels.at(index);
+}
+
+QString TelemetryStore::channelName(int index) const {
+  const QString &name = m_names.at(index);
+  return name.isEmpty() ? QString("Ch %1").arg(index + 1) : name;
+}
+
+quint64 TelemetryStore::begin() const {
+  return m_end > quint64(m_capacity) ? m_end - m_capacity : 0;
+}
+
+qint64 TelemetryStore::timestamp(quint64 index) const {
+  Q_ASSERT(index >= begin() && index < m_end);
+  return m_timestamps[index % m_capacity];
+}
+
+quint64 TelemetryStore::findRow(qint64 timestamp) const {
+  quint64 low = begin();
+  quint64 high = m_end;
+  while (low < high) {
+    const quint64 middle = low + (high - low) / 2;
+    if (m_timestamps[middle % m_capacity] < timestamp) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool TelemetryStore::parseLine(const QByteArray &line, QVector<float> &values,
+                               QList<QByteArray> &names) {
+  values.clear();
+  names.clear();
+
+  // A name may also stand alone before its value, as in "temp: 21.5"
+  QByteArray pendingName;
+  const char *p = line.constData();
+  const char *end = p + line.size();
+  while (p < end && values.size() < MaxChannels) {
+    while (p < end && isSeparator(*p)) {
+      ++p;
+    }
+    const char *start = p;
+    while (p < end && !isSeparator(*p)) {
+      ++p;
+    }
+    if (start == p) {
+      break;
+    }
+
+    const QByteArray token = QByteArray::fromRawData(start, p - start);
+    QByteArray name;
+    QByteArray number = token;
+    const qsizetype label =
+        qMax(token.lastIndexOf(':'), token.lastIndexOf('='));
+    if (label >= 0) {
+      name = token.left(label);
+      number = token.mid(label + 1);
+      if (number.isEmpty()) {
+        pendingName = name;
+        continue;
+      }
+    }
+
+    bool ok = false;
+    const float value = number.toFloat(&ok);
+    if (ok && std::isfinite(value)) {
+      values.append(value);
+      names.append(name.isEmpty() ? pendingName : name);
+    }
+    pendingName.clear();
+  }
+  return !values.isEmpty();
+}
@@ -0,0 +1,93 @@
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtGlobal>
+
+// One channel of samples in a fixed-size ring. Alongside the samples it keeps
+// a min/max pyramid (blocks of 16, 256, 4096 and 65536 samples), so the
+// extremes of any range cost a few dozen lookups however long it is. Samples
+// are addressed by their absolute index; the oldest ones are overwritten.
+class TelemetryChannel
+{
+public:
+    static constexpr int LevelBits = 4; // 16 blocks of level n per block n+1
+    static constexpr int Levels = 4;
+    static constexpr qsizetype TopBlock = qsizetype(1) << (LevelBits * Levels);
+
+    // capacity is rounded up to a multiple of TopBlock. A channel added
+    // to a running store starts at the store's current row.
+    explicit TelemetryChannel(qsizetype capacity, quint64 start = 0);
+
+    // Appends at index end(); NaN marks a missing value
+    void append(float value);
+
+    qsizetype capacity() const { return m_values.size(); }
+    quint64 begin() const;
+    quint64 end() const { return m_end; }
+    float at(quint64 index) const;
+
+    // Extremes of the finite samples in [from, to), clamped to what is
+    // retained. Returns false if there are none.
+    bool minMax(quint64 from, quint64 to, float &min, float &max) const;
+
+private:
+    struct Extremes
+    {
+        float min;
+        float max;
+    };
+
+    QVector<float> m_values;
+    QVector<Extremes> m_levels[Levels]; // level n has blocks of 16^(n+1)
+    quint64 m_end;
+};
+
+// Numeric telemetry parsed from text lines. Every line becomes one sample
+// row shared by all channels: the n-th number on a line goes to channel n,
+// and a "name:value" or "name=value" field also names its channel. A row
+// keeps the time its line was read, so the plot can be laid out in time.
+class TelemetryStore
+{
+public:
+    static constexpr qsizetype DefaultCapacity = qsizetype(1) << 20;
+    static constexpr int MaxChannels = 16;
+
+    explicit TelemetryStore(qsizetype capacity = DefaultCapacity);
+
+    // Returns false if the line holds no number
+    bool appendLine(const QByteArray &line, qint64 timestamp);
+    void clear();
+
+    int channelCount() const { return m_channels.size(); }
+    const TelemetryChannel &channel(int index) const;
+    QString channelName(int index) const;
+
+    quint64 begin() const;
+    quint64 end() const { return m_end; }
+    qint64 timestamp(quint64 index) const;
+    // First retained row stamped at or after timestamp
+    quint64 findRow(qint64 timestamp) const;
+
+    // Splits a line into its numeric fields; names[i] is empty when the
+    // value was not labelled
+    static bool parseLine(const QByteArray &line, QVector<float> &values,
+                          QList<QByteArray> &names);
+
+private:
+    qsizetype m_capacity;
+    QVector<qint64> m_timestamps;
+    QList<TelemetryChannel> m_channels;
+    QStringList m_names;
+    quint64 m_end;
+
+    // Scratch space reused by appendLine()
+    QVector<float> m_values;
+    QList<QByteArray> m_fieldNames;
+};
+
+#endif // TELEMETRYSTORE_H
@@ -0,0 +1,389 @@
+#include "terminaldecoder.h"
+#include <QVarLengthArray>
+#include <cstring>
+
+namespace {
+
+constexpr quint8 Bel = 0x07;
+constexpr quint8 Can = 0x18;
+constexpr quint8 Sub = 0x1A;
+constexpr quint8 Esc = 0x1B;
+
+constexpr char32_t ReplacementCharacter = 0xFFFD;
+
+// xterm's default colours 0-15
+const quint32 BasicColors[16] = {
+    0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD,
+    0x00CDCD, 0xE5E5E5, 0x7F7F7F, 0xFF0000, 0x00FF00, 0xFFFF00,
+    0x5C5CFF, 0xFF00FF, 0x00FFFF, 0xFFFFFF};
+
+inline bool isPlain(quint8 byte) {
+  return (byte >= 0x20 && byte < 0x7F) || byte == '\t';
+}
+
+// Length of the sequence a lead byte starts, 0 if it cannot start one
+int utf8Length(quint8 lead) {
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    return 2;
+  }
+  if (lead >= 0xE0 && lead <= 0xEF) {
+    return 3;
+  }
+  if (lead >= 0xF0 && lead <= 0xF4) {
+    return 4;
+  }
+  return 0;
+}
+
+// Whether byte may follow the first index bytes of a sequence; the second
+// byte also rules out overlong forms, surrogates and values past U+10FFFF
+bool continuesUtf8(quint8 lead, int index, quint8 byte) {
+  if (index == 1) {
+    switch (lead) {
+    case 0xE0:
+      return byte >= 0xA0 && byte <= 0xBF;
+    case 0xED:
+      return byte >= 0x80 && byte <= 0x9F;
+    case 0xF0:
+      return byte >= 0x90 && byte <= 0xBF;
+    case 0xF4:
+      return byte >= 0x80 && byte <= 0x8F;
+    default:
+      break;
+    }
+  }
+  return (byte & 0xC0) == 0x80;
+}
+
+char32_t decodeUtf8(const char *bytes, int length) {
+  char32_t codePoint = quint8(bytes[0]) & (0x7F >> length);
+  for (int i = 1; i < length; ++i) {
+    codePoint = (codePoint << 6) | (quint8(bytes[i]) & 0x3F);
+  }
+  return codePoint;
+}
+
+quint32 indexedColor(int index) { return quint32(index & 0xFF) + 1; }
+
+} // namespace
+
+TerminalDecoder::TerminalDecoder(const State &state) : m_state(state) {}
+
+const TerminalDecoder::State &TerminalDecoder::state() const {
+  return m_state;
+}
+
+void TerminalDecoder::reset() { m_state = State(); }
+
+void TerminalDecoder::decode(const char *data, qsizetype length,
+                             QString &text, QVector<Run> &runs) {
+  const char *end = data + length;
+  while (data != end) {
+    if (m_state.mode == Ground) {
+      // Plain ASCII, most of any console output, goes over in one piece
+      const char *plain = data;
+      while (plain != end && isPlain(quint8(*plain))) {
+        ++plain;
+      }
+      if (plain != data) {
+        const int start = int(text.size());
+        text.append(QLatin1String(data, plain - data));
+        addRun(start, int(plain - data), runs);
+        data = plain;
+        continue;
+      }
+    }
+    feed(quint8(*data++), &text, &runs);
+  }
+}
+
+void TerminalDecoder::advance(const char *data, qsizetype length) {
+  const char *end = data + length;
+  while (data != end) {
+    if (m_state.mode == Ground) {
+      const char *escape =
+          static_cast<const char *>(std::memchr(data, Esc, end - data));
+      if (!escape) {
+        // Without escape sequences only a character cut off at the end
+        // carries over
+        const char *tail = end;
+        while (tail != data && end - tail < 4) {
+          --tail;
+          if ((quint8(*tail) & 0xC0) != 0x80) {
+            break;
+          }
+        }
+        for (; tail != end; ++tail) {
+          feed(quint8(*tail), nullptr, nullptr);
+        }
+        return;
+      }
+      data = escape;
+    }
+    feed(quint8(*data++), nullptr, nullptr);
+  }
+}
+
+quint32 TerminalDecoder::rgb(quint32 color) {
+  if (color & RgbColor) {
+    return color & 0xFFFFFF;
+  }
+
+  const int index = int(color) - 1;
+  if (index < 16) {
+    return BasicColors[qMax(0, index)];
+  }
+  if (index < 232) {
+    // 6x6x6 cube
+    auto level = [](int value) { return value ? 55 + value * 40 : 0; };
+    const int cube = index - 16;
+    return quint32(level(cube / 36) << 16 | level(cube / 6 % 6) << 8 |
+                   level(cube % 6));
+  }
+  const int gray = 8 + (index - 232) * 10;
+  return quint32(gray << 16 | gray << 8 | gray);
+}
+
+void TerminalDecoder::feed(quint8 byte, QString *text, QVector<Run> *runs) {
+  State &s = m_state;
+
+  // Inside a control sequence, ESC starts over, CAN and SUB cancel and other
+  // control characters are ignored
+  if (byte < 0x20 && s.mode >= Escape && s.mode <= CsiIgnore) {
+    if (byte == Esc || byte == Can || byte == Sub) {
+      s.mode = byte == Esc ? Escape : Ground;
+      s.pendingLength = 0;
+    }
+    return;
+  }
+
+  switch (s.mode) {
+  case Ground:
+    if (byte == Esc) {
+      s.mode = Escape;
+    } else if (byte < 0x80) {
+      put(isPlain(byte) ? byte : '.', text, runs);
+    } else if (utf8Length(byte) > 0) {
+      s.pending[0] = char(byte);
+      s.pendingLength = 1;
+      s.mode = Utf8;
+    } else {
+      put(ReplacementCharacter, text, runs);
+    }
+    break;
+
+  case Utf8: {
+    const quint8 lead = quint8(s.pending[0]);
+    if (!continuesUtf8(lead, s.pendingLength, byte)) {
+      // What was valid so far shows as one replacement character, and the
+      // byte is taken afresh
+      put(ReplacementCharacter, text, runs);
+      s.mode = Ground;
+      s.pendingLength = 0;
+      feed(byte, text, runs);
+      break;
+    }
+    s.pending[s.pendingLength++] = char(byte);
+    if (s.pendingLength == utf8Length(lead)) {
+      put(decodeUtf8(s.pending, s.pendingLength), text, runs);
+      s.mode = Ground;
+      s.pendingLength = 0;
+    }
+    break;
+  }
+
+  case Escape:
+    if (byte == '[') {
+      s.mode = Csi;
+      s.pendingLength = 0;
+    } else if (byte == ']' || byte == 'P' || byte == 'X' || byte == '^' ||
+               byte == '_') {
+      s.mode = String;
+    } else if (byte >= 0x20 && byte <= 0x2F) {
+      s.mode = EscapeIntermediate;
+    } else {
+      // The final byte of a two-byte sequence such as ESC 7
+      s.mode = Ground;
+    }
+    break;
+
+  case EscapeIntermediate:
+    if (byte >= 0x30) {
+      s.mode = Ground;
+    }
+    break;
+
+  case Csi:
+    if (byte >= 0x40 && byte <= 0x7E) {
+      if (byte == 'm') {
+        applySgr();
+      }
+      s.mode = Ground;
+      s.pendingLength = 0;
+    } else if (byte >= 0x20 && byte <= 0x3F) {
+      if (s.pendingLength == MaxPending) {
+        s.mode = CsiIgnore;
+        s.pendingLength = 0;
+      } else {
+        s.pending[s.pendingLength++] = char(byte);
+      }
+    } else {
+      s.mode = Ground;
+      s.pendingLength = 0;
+    }
+    break;
+
+  case CsiIgnore:
+    if (byte >= 0x40) {
+      s.mode = Ground;
+    }
+    break;
+
+  case String:
+    if (byte == Bel || byte == Can || byte == Sub) {
+      s.mode = Ground;
+    } else if (byte == Esc) {
+      s.mode = StringEscape;
+    }
+    break;
+
+  case StringEscape:
+    if (byte == '\\') {
+      s.mode = Ground;
+    } else {
+      // A new sequence ends the string as well
+      s.mode = Escape;
+      feed(byte, text, runs);
+    }
+    break;
+  }
+}
+
+void TerminalDecoder::put(char32_t codePoint, QString *text,
+                          QVector<Run> *runs) {
+  if (!text) {
+    return;
+  }
+  const int start = int(text->size());
+  if (QChar::requiresSurrogates(codePoint)) {
+    text->append(QChar(QChar::highSurrogate(codePoint)));
+    text->append(QChar(QChar::lowSurrogate(codePoint)));
+  } else {
+    text->append(QChar(char16_t(codePoint)));
+  }
+  addRun(start, int(text->size()) - start, *runs);
+}
+
+void TerminalDecoder::addRun(int start, int length,
+                             QVector<Run> &runs) const {
+  if (!runs.isEmpty()) {
+    Run &last = runs.last();
+    if (last.style == m_state.style && last.start + last.length == start) {
+      last.length += length;
+      return;
+    }
+  }
+  runs.append(Run{start, length, m_state.style});
+}
+
+void TerminalDecoder::applySgr() {
+  // Only plain "ESC [ n ; n ... m"; private or intermediate forms are not SGR
+  QVarLengthArray<int, 16> params;
+  int value = 0;
+  for (int i = 0; i < m_state.pendingLength; ++i) {
+    const char c = m_state.pending[i];
+    if (c >= '0' && c <= '9') {
+      value = qMin(value * 10 + (c - '0'), 0xFFFF);
+    } else if (c == ';' || c == ':') {
+      params.append(value);
+      value = 0;
+    } else {
+      return;
+    }
+  }
+  params.append(value);
+
+  Style &style = m_state.style;
+  for (int i = 0; i < params.size(); ++i) {
+    const int p = params[i];
+    if (p >= 30 && p <= 37) {
+      style.foreground = indexedColor(p - 30);
+    } else if (p >= 40 && p <= 47) {
+      style.background = indexedColor(p - 40);
+    } else if (p >= 90 && p <= 97) {
+      style.foreground = indexedColor(p - 90 + 8);
+    } else if (p >= 100 && p <= 107) {
+      style.background = indexedColor(p - 100 + 8);
+    } else if (p == 38 || p == 48) {
+      // 5;index or 2;r;g;b
+      quint32 color;
+      if (i + 2 < params.size() && params[i + 1] == 5) {
+        color = indexedColor(params[i + 2]);
+        i += 2;
+      } else if (i + 4 < params.size() && params[i + 1] == 2) {
+        color = RgbColor | quint32(qMin(params[i + 2], 255)) << 16 |
+                quint32(qMin(params[i + 3], 255)) << 8 |
+                quint32(qMin(params[i + 4], 255));
+        i += 4;
+      } else {
+        return;
+      }
+      (p == 38 ? style.foreground : style.background) = color;
+    } else {
+      switch (p) {
+      case 0:
+        style = Style();
+        break;
+      case 1:
+        style.attributes |= Bold;
+        break;
+      case 2:
+        style.attributes |= Faint;
+        break;
+      case 3:
+        style.attributes |= Italic;
+        break;
+      case 4:
+      case 21:
+        style.attributes |= Underline;
+        break;
+      case 7:
+        style.attributes |= Inverse;
+        break;
+      case 8:
+        style.attributes |= Conceal;
+        break;
+      case 9:
+        style.attributes |= Strikeout;
+        break;
+      case 22:
+        style.attributes &= ~(Bold | Faint);
+        break;
+      case 23:
+        style.attributes &= ~Italic;
+        break;
+      case 24:
+        style.attributes &= ~Underline;
+        break;
+      case 27:
+        style.attributes &= ~Inverse;
+        break;
+      case 28:
+        style.attributes &= ~Conceal;
+        break;
+      case 29:
+        style.attributes &= ~Strikeout;
+        break;
+      case 39:
+        style.foreground = 0;
+        break;
+      case 49:
+        style.background = 0;
+        break;
+      default:
+        // Blink, fonts and the like are not shown
+        break;
+      }
+    }
+  }
+}
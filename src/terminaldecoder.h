@@ -0,0 +1,110 @@
+#ifndef TERMINALDECODER_H
+#define TERMINALDECODER_H
+
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+// Streaming decoder for what a device console prints: UTF-8 text with
+// VT100/ANSI escape sequences. Select Graphic Rendition (colours, bold,
+// underline, ...) becomes styled runs of text; other sequences are consumed
+// and dropped. A character or sequence cut off at the end of one piece is
+// completed by the next, so the stream can be fed in whatever pieces it
+// arrived in.
+//
+// The whole state fits in State, so decoding can start anywhere the state
+// was saved; ConsoleBuffer keeps it for every record that needs it.
+class TerminalDecoder
+{
+public:
+    enum Attribute : quint8 {
+        Bold = 0x01,
+        Faint = 0x02,
+        Italic = 0x04,
+        Underline = 0x08,
+        Inverse = 0x10,
+        Strikeout = 0x20,
+        Conceal = 0x40
+    };
+
+    enum Mode : quint8 {
+        Ground,
+        Utf8,               // Inside a multibyte character
+        Escape,             // After ESC
+        EscapeIntermediate,
+        Csi,                // Collecting control sequence parameters
+        CsiIgnore,          // Parameters too long to keep
+        String,             // OSC, DCS and the like, up to BEL or ESC '\'
+        StringEscape
+    };
+
+    // Colours are 0 for the default, palette index + 1 for the 256-colour
+    // palette, or RgbColor | 0xRRGGBB
+    static constexpr quint32 RgbColor = 0x01000000;
+    // Longest partial character or control sequence carried between pieces
+    static constexpr int MaxPending = 32;
+
+    struct Style
+    {
+        quint32 foreground = 0;
+        quint32 background = 0;
+        quint8 attributes = 0;
+
+        bool operator==(const Style &other) const
+        {
+            return foreground == other.foreground &&
+                   background == other.background &&
+                   attributes == other.attributes;
+        }
+        bool operator!=(const Style &other) const { return !(*this == other); }
+        bool isDefault() const { return *this == Style(); }
+    };
+
+    // Characters [start, start + length) of the decoded text
+    struct Run
+    {
+        int start;
+        int length;
+        Style style;
+    };
+
+    struct State
+    {
+        Style style;
+        Mode mode = Ground;
+        quint8 pendingLength = 0;  // Bytes of an unfinished sequence
+        char pending[MaxPending];
+
+        bool isInitial() const { return mode == Ground && style.isDefault(); }
+    };
+
+    TerminalDecoder() = default;
+    explicit TerminalDecoder(const State &state);
+
+    const State &state() const;
+    void reset();
+
+    // Appends the printable text of the next piece to text and its styles
+    // to runs, merging a run with the one before when the style is the same.
+    // Control characters other than tab show as '.', malformed UTF-8 as
+    // U+FFFD.
+    void decode(const char *data, qsizetype length, QString &text,
+                QVector<Run> &runs);
+    // The state change of decode() without the text; text between escape
+    // sequences is skipped over, so this is cheap for plain output
+    void advance(const char *data, qsizetype length);
+
+    // 0xRRGGBB of a colour other than the default, using the xterm palette
+    static quint32 rgb(quint32 color);
+
+private:
+    // text and runs are null when only the state is wanted
+    void feed(quint8 byte, QString *text, QVector<Run> *runs);
+    void put(char32_t codePoint, QString *text, QVector<Run> *runs);
+    void addRun(int start, int length, QVector<Run> &runs) const;
+    void applySgr();
+
+    State m_state;
+};
+
+#endif // TERMINALDECODER_H
@@ -0,0 +1,454 @@
+#include "triggercapture.h"
+#include "logwriter.h"
+#include <QDateTime>
+#include <QDir>
+#include <QTimer>
+#include <cstring>
+
+namespace {
+
+// Ring records are this header followed by the payload
+struct RecordHeader {
+  qint64 timestamp;
+  quint32 length;
+  quint8 direction;
+};
+
+constexpr qsizetype RecordHeaderSize = sizeof(RecordHeader);
+
+// "64K", "1M" and "4096" set bytes, "10s" and "500ms" milliseconds
+bool parseLimit(const QString &value, qsizetype &bytes, int &ms) {
+  QString number = value.toLower();
+  bool ok = false;
+  if (number.endsWith("ms")) {
+    number.chop(2);
+    ms = number.toInt(&ok);
+    return ok && ms > 0;
+  }
+  if (number.endsWith('s')) {
+    number.chop(1);
+    const double seconds = number.toDouble(&ok);
+    ms = int(seconds * 1000);
+    return ok && seconds > 0 && seconds < 1e6;
+  }
+
+  qint64 scale = 1;
+  if (number.endsWith('k')) {
+    scale = 1024;
+    number.chop(1);
+  } else if (number.endsWith('m')) {
+    scale = 1024 * 1024;
+    number.chop(1);
+  }
+  const qint64 count = number.toLongLong(&ok);
+  if (!ok || count <= 0 || count > (qint64(1) << 40) / scale) {
+    return false;
+  }
+  bytes = qsizetype(count * scale);
+  return true;
+}
+
+} // namespace
+
+bool TriggerCapture::parseOptions(const QString &spec, Options &options,
+                                  QString &error) {
+  options = Options();
+  int triggers = 0;
+  bool afterGiven = false;
+
+  const QStringList items = spec.split(',', Qt::SkipEmptyParts);
+  for (const QString &item : items) {
+    const qsizetype equals = item.indexOf('=');
+    const QString key = item.left(equals).trimmed().toLower();
+    const QString value =
+        equals < 0 ? QString() : item.mid(equals + 1).trimmed();
+
+    bool ok = true;
+    if (key == "pattern") {
+      options.trigger = PatternTrigger;
+      options.pattern = QByteArray::fromHex(value.toLatin1());
+      ok = !options.pattern.isEmpty() &&
+           options.pattern.toHex() == value.toLatin1().toLower();
+      ++triggers;
+    } else if (key == "regex") {
+      options.trigger = RegexTrigger;
+      options.regex = value;
+      ok = !value.isEmpty() && QRegularExpression(value).isValid();
+      ++triggers;
+    } else if (key == "silence") {
+      options.trigger = SilenceTrigger;
+      options.silenceMs = value.toInt(&ok);
+      ok = ok && options.silenceMs > 0;
+      ++triggers;
+    } else if (key == "error") {
+      options.trigger = ErrorTrigger;
+      ok = value.isEmpty();
+      ++triggers;
+    } else if (key == "before") {
+      ok = parseLimit(value, options.preTriggerBytes, options.preTriggerMs) &&
+           options.preTriggerBytes <= MaxPreTriggerBytes;
+    } else if (key == "after") {
+      // Limits not given for this side do not apply
+      if (!afterGiven) {
+        options.postTriggerBytes = 0;
+        options.postTriggerMs = 0;
+        afterGiven = true;
+      }
+      ok = parseLimit(value, options.postTriggerBytes, options.postTriggerMs);
+    } else if (key == "dir") {
+      options.directory = value;
+      ok = !value.isEmpty();
+    } else if (key == "count") {
+      options.maxCaptures = value.toInt(&ok);
+      ok = ok && options.maxCaptures > 0;
+    } else {
+      error = "Unknown trigger option: " + key;
+      return false;
+    }
+
+    if (!ok) {
+      error = "Invalid trigger option: " + item;
+      return false;
+    }
+  }
+
+  if (triggers != 1) {
+    error = "Expected one of pattern, regex, silence or error";
+    return false;
+  }
+  return true;
+}
+
+TriggerCapture::TriggerCapture(QObject *parent)
+    : QObject(parent), m_armed(false), m_captureCount(0), m_ringStart(0),
+      m_ringUsed(0), m_dataSinceSilence(false),
+      m_silenceTimer(new QTimer(this)), m_writer(nullptr),
+      m_postTriggerBytes(0), m_postTriggerTimer(new QTimer(this)) {
+  connect(m_silenceTimer, &QTimer::timeout, this, [this]() {
+    if (m_dataSinceSilence && m_sinceData.elapsed() >= m_options.silenceMs) {
+      m_dataSinceSilence = false;
+      trigger(QString("No data for %1 ms").arg(m_options.silenceMs));
+    }
+  });
+  m_postTriggerTimer->setSingleShot(true);
+  connect(m_postTriggerTimer, &QTimer::timeout, this,
+          &TriggerCapture::finishCapture);
+}
+
+TriggerCapture::~TriggerCapture() { stop(); }
+
+bool TriggerCapture::start(const Options &options) {
+  stop();
+
+  if (options.preTriggerBytes <= RecordHeaderSize ||
+      options.preTriggerBytes > MaxPreTriggerBytes) {
+    m_errorString = "Invalid pre-trigger size";
+    return false;
+  }
+  if (options.postTriggerBytes <= 0 && options.postTriggerMs <= 0) {
+    m_errorString = "A capture needs a size or time limit after the trigger";
+    return false;
+  }
+  if (!QDir().mkpath(options.directory)) {
+    m_errorString = "Cannot create " + options.directory;
+    return false;
+  }
+
+  switch (options.trigger) {
+  case PatternTrigger:
+    if (options.pattern.isEmpty()) {
+      m_errorString = "Empty trigger pattern";
+      return false;
+    }
+    m_matcher.setPattern(options.pattern);
+    break;
+  case RegexTrigger:
+    m_regex.setPattern(options.regex);
+    if (!m_regex.isValid()) {
+      m_errorString = "Invalid regular expression: " + m_regex.errorString();
+      return false;
+    }
+    break;
+  case SilenceTrigger:
+    if (options.silenceMs <= 0) {
+      m_errorString = "Invalid silence time";
+      return false;
+    }
+    break;
+  case ErrorTrigger:
+    break;
+  }
+
+  m_options = options;
+  m_ring.resize(options.preTriggerBytes);
+  m_ringStart = 0;
+  m_ringUsed = 0;
+  m_seam.clear();
+  m_line.clear();
+  m_captureCount = 0;
+  m_dataSinceSilence = false;
+  m_sinceData.start();
+  if (options.trigger == SilenceTrigger) {
+    m_silenceTimer->start(qBound(10, options.silenceMs / 4, 1000));
+  }
+  m_errorString.clear();
+  m_armed = true;
+  return true;
+}
+
+void TriggerCapture::stop() {
+  if (m_writer) {
+    finishCapture();
+  }
+  m_armed = false;
+  m_silenceTimer->stop();
+  m_ring = QByteArray();
+  m_ringUsed = 0;
+}
+
+bool TriggerCapture::isArmed() const { return m_armed; }
+
+bool TriggerCapture::isCapturing() const { return m_writer != nullptr; }
+
+QString TriggerCapture::errorString() const { return m_errorString; }
+
+int TriggerCapture::captureCount() const { return m_captureCount; }
+
+void TriggerCapture::addData(CaptureFormat::Direction direction,
+                             qint64 timestampNs, const QByteArray &data) {
+  if (!m_armed || data.isEmpty()) {
+    return;
+  }
+  const bool received = direction == CaptureFormat::Rx;
+  if (received) {
+    m_sinceData.restart();
+    m_dataSinceSilence = true;
+  }
+
+  if (m_writer) {
+    writeRecord(direction, timestampNs, data.constData(), data.size());
+    return;
+  }
+
+  // The read that fires the trigger is the last one before it
+  push(direction, timestampNs, data.constData(), data.size());
+  if (!received || !matches(data.constData(), data.size())) {
+    return;
+  }
+  if (m_options.trigger == PatternTrigger) {
+    trigger("Pattern " +
+            QString::fromLatin1(m_options.pattern.toHex(' ')).toUpper());
+  } else {
+    trigger("Line matched " + m_options.regex);
+  }
+}
+
+void TriggerCapture::reportError(const QString &error) {
+  if (m_armed && m_options.trigger == ErrorTrigger) {
+    trigger("Error: " + error);
+  }
+}
+
+void TriggerCapture::trigger(const QString &reason) {
+  if (!m_armed || m_writer) {
+    return;
+  }
+
+  const QDateTime now = QDateTime::currentDateTime();
+  const QString path = QDir(m_options.directory)
+                           .filePath(QString("trigger_%1_%2.sfcap")
+                                         .arg(now.toString("yyyyMMdd_HHmmss"))
+                                         .arg(m_captureCount + 1));
+  QMap<QString, QString> metadata = m_options.metadata;
+  metadata["trigger"] = reason;
+  metadata["triggerTime"] =
+      QString::number(now.toMSecsSinceEpoch() * 1000000);
+
+  LogWriter::Options options;
+  options.path = path;
+  options.metadata = CaptureFormat::encodeMetadata(metadata);
+  m_writer = new LogWriter(this);
+  connect(m_writer, &LogWriter::errorOccurred, this,
+          &TriggerCapture::errorOccurred);
+  if (!m_writer->start(options)) {
+    delete m_writer;
+    m_writer = nullptr;
+    emit errorOccurred("Cannot write trigger capture " + path);
+    return;
+  }
+  m_capturePath = path;
+  ++m_captureCount;
+
+  // The history goes to the writer thread oldest first; the ring is empty
+  // again afterwards
+  QByteArray payload;
+  while (m_ringUsed > 0) {
+    RecordHeader header;
+    ringRead(m_ringStart, &header, RecordHeaderSize);
+    payload.resize(header.length);
+    ringRead(m_ringStart + RecordHeaderSize, payload.data(), header.length);
+    m_writer->write(CaptureFormat::Direction(header.direction),
+                    header.timestamp, payload);
+    dropOldest();
+  }
+  m_ringStart = 0;
+
+  m_postTriggerBytes = 0;
+  if (m_options.postTriggerMs > 0) {
+    m_postTriggerTimer->start(m_options.postTriggerMs);
+  }
+  emit triggered(reason);
+}
+
+bool TriggerCapture::matches(const char *data, qsizetype size) {
+  switch (m_options.trigger) {
+  case PatternTrigger: {
+    bool found = m_matcher.indexIn(data, size) >= 0;
+    const qsizetype keep = m_options.pattern.size() - 1;
+    if (keep == 0) {
+      return found;
+    }
+
+    // A pattern split between reads lies within the seam
+    m_seam.append(data, qMin(size, keep));
+    found = found || m_matcher.indexIn(m_seam) >= 0;
+    if (size >= keep) {
+      m_seam.resize(0);
+      m_seam.append(data + size - keep, keep);
+    } else if (m_seam.size() > keep) {
+      m_seam.remove(0, m_seam.size() - keep);
+    }
+    return found;
+  }
+
+  case RegexTrigger: {
+    bool found = false;
+    const char *end = data + size;
+    while (data != end) {
+      const char *newline =
+          static_cast<const char *>(std::memchr(data, '\n', end - data));
+      const qsizetype take = qMin<qsizetype>((newline ? newline : end) - data,
+                                             MaxLineLength - m_line.size());
+      m_line.append(data, take);
+      data += take;
+      const bool complete = data == newline;
+      if (complete) {
+        ++data;
+        if (m_line.endsWith('\r')) {
+          m_line.chop(1);
+        }
+      }
+      if (complete || m_line.size() >= MaxLineLength) {
+        found = found || m_regex.match(QString::fromUtf8(m_line)).hasMatch();
+        m_line.resize(0);
+      }
+    }
+    return found;
+  }
+
+  case SilenceTrigger:
+  case ErrorTrigger:
+    break;
+  }
+  return false;
+}
+
+void TriggerCapture::push(CaptureFormat::Direction direction,
+                          qint64 timestampNs, const char *data,
+                          qsizetype size) {
+  // Of a read larger than the ring, only its end is kept
+  const qsizetype room = m_ring.size() - RecordHeaderSize;
+  if (size > room) {
+    data += size - room;
+    size = room;
+  }
+  while (m_ringUsed + RecordHeaderSize + size > m_ring.size()) {
+    dropOldest();
+  }
+
+  RecordHeader header = {};
+  header.timestamp = timestampNs;
+  header.length = quint32(size);
+  header.direction = quint8(direction);
+  ringWrite(&header, RecordHeaderSize);
+  ringWrite(data, size);
+
+  if (m_options.preTriggerMs > 0) {
+    const qint64 oldest =
+        timestampNs - qint64(m_options.preTriggerMs) * 1000000;
+    RecordHeader first;
+    while (m_ringUsed > 0) {
+      ringRead(m_ringStart, &first, RecordHeaderSize);
+      if (first.timestamp >= oldest) {
+        break;
+      }
+      dropOldest();
+    }
+  }
+}
+
+void TriggerCapture::dropOldest() {
+  RecordHeader header;
+  ringRead(m_ringStart, &header, RecordHeaderSize);
+  const qsizetype size = RecordHeaderSize + header.length;
+  m_ringStart = (m_ringStart + size) % m_ring.size();
+  m_ringUsed -= size;
+}
+
+void TriggerCapture::ringWrite(const void *data, qsizetype size) {
+  const qsizetype capacity = m_ring.size();
+  const qsizetype position = (m_ringStart + m_ringUsed) % capacity;
+  const qsizetype first = qMin(size, capacity - position);
+  const char *bytes = static_cast<const char *>(data);
+  std::memcpy(m_ring.data() + position, bytes, first);
+  std::memcpy(m_ring.data(), bytes + first, size - first);
+  m_ringUsed += size;
+}
+
+void TriggerCapture::ringRead(qsizetype position, void *data,
+                              qsizetype size) const {
+  const qsizetype capacity = m_ring.size();
+  position %= capacity;
+  const qsizetype first = qMin(size, capacity - position);
+  char *bytes = static_cast<char *>(data);
+  std::memcpy(bytes, m_ring.constData() + position, first);
+  std::memcpy(bytes + first, m_ring.constData(), size - first);
+}
+
+void TriggerCapture::writeRecord(CaptureFormat::Direction direction,
+                                 qint64 timestampNs, const char *data,
+                                 qsizetype size) {
+  // Only received bytes count towards the size after the trigger
+  const qsizetype limit = m_options.postTriggerBytes;
+  if (direction == CaptureFormat::Rx && limit > 0) {
+    size = qMin(size, limit - m_postTriggerBytes);
+    m_postTriggerBytes += size;
+  }
+  m_writer->write(direction, timestampNs, QByteArray::fromRawData(data, size));
+  if (limit > 0 && m_postTriggerBytes >= limit) {
+    finishCapture();
+  }
+}
+
+void TriggerCapture::finishCapture() {
+  if (!m_writer) {
+    return;
+  }
+  m_postTriggerTimer->stop();
+
+  // Waits for the last batch only
+  m_writer->stop();
+  delete m_writer;
+  m_writer = nullptr;
+  emit captureSaved(m_capturePath);
+
+  // Armed again with a fresh history, unless that was the last capture
+  m_seam.resize(0);
+  m_line.resize(0);
+  m_dataSinceSilence = false;
+  if (m_options.maxCaptures > 0 && m_captureCount >= m_options.maxCaptures) {
+    m_armed = false;
+    m_silenceTimer->stop();
+    m_ring = QByteArray();
+  }
+}
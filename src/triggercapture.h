@@ -0,0 +1,133 @@
+#ifndef TRIGGERCAPTURE_H
+#define TRIGGERCAPTURE_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+#include <QRegularExpression>
+#include <QString>
+#include "captureformat.h"
+
+class LogWriter;
+class QTimer;
+
+// Logic-analyzer style capture for rare events. Traffic goes through a
+// fixed-size ring in memory; when the trigger fires, the ring and what
+// follows are written to a new .sfcap file in the background, and the
+// trigger is armed again. Memory use does not grow with the time the
+// trigger waits, and nothing touches the disk until an event.
+//
+// Options come as a string of the form "key=value,key,...":
+//
+//   pattern=HEX       received bytes, found across reads
+//   regex=EXPR        matched against each received line (no commas)
+//   silence=MS        no data for MS after some arrived
+//   error             a port error (see reportError())
+//   before=SIZE       kept from before the trigger (default 256K)
+//   after=SIZE        saved after it (default 256K and 10s)
+//   dir=PATH          where captures go (default the current directory)
+//   count=N           stop after N captures (default: keep going)
+//
+// SIZE is bytes, with an optional K or M, or a time such as 10s or 500ms;
+// giving both a size and a time for one side applies both limits. The
+// history before the trigger always has a size limit, which is the memory
+// the ring takes.
+class TriggerCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Trigger {
+        PatternTrigger,
+        RegexTrigger,
+        SilenceTrigger,
+        ErrorTrigger
+    };
+
+    struct Options
+    {
+        Trigger trigger = PatternTrigger;
+        QByteArray pattern;
+        QString regex;
+        int silenceMs = 0;
+        qsizetype preTriggerBytes = 256 * 1024;
+        int preTriggerMs = 0;          // 0 = no time limit
+        qsizetype postTriggerBytes = 256 * 1024; // 0 = no size limit
+        int postTriggerMs = 10000;     // 0 = no time limit
+        QString directory = ".";
+        int maxCaptures = 0;           // 0 = unlimited
+        QMap<QString, QString> metadata; // Stored in every capture
+    };
+
+    // Each read in the ring also takes a 16-byte header
+    static constexpr qsizetype MaxPreTriggerBytes = 64 * 1024 * 1024;
+    // A longer line is matched as it is and started over
+    static constexpr int MaxLineLength = 4096;
+
+    static bool parseOptions(const QString &spec, Options &options,
+                             QString &error);
+
+    explicit TriggerCapture(QObject *parent = nullptr);
+    ~TriggerCapture();
+
+    bool start(const Options &options);
+    // Finishes a capture in progress
+    void stop();
+    bool isArmed() const;
+    bool isCapturing() const;
+    QString errorString() const;
+    int captureCount() const;
+
+    // Timestamps are nanoseconds since the epoch; only RX is searched
+    void addData(CaptureFormat::Direction direction, qint64 timestampNs,
+                 const QByteArray &data);
+    void reportError(const QString &error);
+
+public slots:
+    // Fires the trigger by hand
+    void trigger(const QString &reason);
+
+signals:
+    void triggered(const QString &reason);
+    void captureSaved(const QString &path);
+    void errorOccurred(const QString &error);
+
+private:
+    bool matches(const char *data, qsizetype size);
+    void push(CaptureFormat::Direction direction, qint64 timestampNs,
+              const char *data, qsizetype size);
+    void dropOldest();
+    void ringWrite(const void *data, qsizetype size);
+    void ringRead(qsizetype position, void *data, qsizetype size) const;
+    void writeRecord(CaptureFormat::Direction direction, qint64 timestampNs,
+                     const char *data, qsizetype size);
+    void finishCapture();
+
+    Options m_options;
+    bool m_armed;
+    QString m_errorString;
+    int m_captureCount;
+
+    // Pre-trigger ring of header + payload records, allocated once
+    QByteArray m_ring;
+    qsizetype m_ringStart;
+    qsizetype m_ringUsed;
+
+    QByteArrayMatcher m_matcher;
+    QByteArray m_seam;       // End of the last read and start of the next
+    QRegularExpression m_regex;
+    QByteArray m_line;
+    QElapsedTimer m_sinceData;
+    bool m_dataSinceSilence;
+    QTimer *m_silenceTimer;
+
+    // While saving what follows a trigger
+    LogWriter *m_writer;
+    QString m_capturePath;
+    qsizetype m_postTriggerBytes;
+    QTimer *m_postTriggerTimer;
+};
+
+#endif // TRIGGERCAPTURE_H
@@ -0,0 +1,13 @@
+#ifndef TXOPTIONS_H
+#define TXOPTIONS_H
+
+// Transmit pacing for devices with small receive FIFOs. Delays are measured
+// from when the bytes are handed to the driver; 0 disables each limit.
+struct TxOptions
+{
+    int interByteDelayMs = 0;  // pause after every byte
+    int interFrameDelayMs = 0; // pause after each sendData() payload
+    int rateLimit = 0;         // bytes per second
+};
+
+#endif // TXOPTIONS_H
@@ -0,0 +1,114 @@
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "byteformatter.h"
+
+// Compares the display formatting kernels with the QByteArray/QString
+// conversions the console used before them. Run with -tickcounter or
+// -iterations N for steadier numbers.
+class BenchByteFormatter : public QObject {
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void hex_data();
+  void hex();
+  void text_data();
+  void text();
+
+private:
+  static QByteArray payload(qsizetype size, bool printable);
+};
+
+void BenchByteFormatter::initTestCase() {
+  qInfo("Kernels: %s", ByteFormatter::implementation());
+}
+
+void BenchByteFormatter::hex_data() {
+  QTest::addColumn<bool>("legacy");
+  QTest::addColumn<QByteArray>("data");
+
+  for (qsizetype size : {16, 256, 4096, 65536}) {
+    const QByteArray data = payload(size, false);
+    QTest::addRow("legacy/%lld", qlonglong(size)) << true << data;
+    QTest::addRow("kernel/%lld", qlonglong(size)) << false << data;
+  }
+}
+
+void BenchByteFormatter::hex() {
+  QFETCH(bool, legacy);
+  QFETCH(QByteArray, data);
+
+  // Both produce the same text
+  QByteArray buffer(ByteFormatter::hexLength(data.size()), Qt::Uninitialized);
+  ByteFormatter::formatHex(data.constData(), data.size(), buffer.data());
+  QCOMPARE(buffer, data.toHex(' ').toUpper());
+
+  if (legacy) {
+    QBENCHMARK {
+      QString text = data.toHex(' ').toUpper();
+      Q_UNUSED(text);
+    }
+  } else {
+    QBENCHMARK {
+      const qsizetype size =
+          ByteFormatter::formatHex(data.constData(), data.size(),
+                                   buffer.data());
+      QString text = QString::fromLatin1(buffer.constData(), size);
+      Q_UNUSED(text);
+    }
+  }
+}
+
+void BenchByteFormatter::text_data() {
+  QTest::addColumn<bool>("legacy");
+  QTest::addColumn<QByteArray>("data");
+
+  for (qsizetype size : {16, 256, 4096, 65536}) {
+    const QByteArray data = payload(size, true);
+    QTest::addRow("legacy/%lld", qlonglong(size)) << true << data;
+    QTest::addRow("kernel/%lld", qlonglong(size)) << false << data;
+  }
+}
+
+void BenchByteFormatter::text() {
+  QFETCH(bool, legacy);
+  QFETCH(QByteArray, data);
+  QByteArray buffer(data.size(), Qt::Uninitialized);
+
+  if (legacy) {
+    // Decode, then one pass per line-ending variant
+    QBENCHMARK {
+      QString text = QString::fromUtf8(data);
+      text.replace("\r\n", " ");
+      text.replace("\n", " ");
+      text.replace("\r", " ");
+    }
+  } else {
+    QBENCHMARK {
+      const qsizetype size = ByteFormatter::formatText(
+          data.constData(), data.size(), buffer.data());
+      QString text = QString::fromUtf8(buffer.constData(), size);
+      Q_UNUSED(text);
+    }
+  }
+}
+
+QByteArray BenchByteFormatter::payload(qsizetype size, bool printable) {
+  // Fixed seed so runs are comparable
+  QRandomGenerator generator(42);
+  QByteArray data(size, Qt::Uninitialized);
+  for (char &c : data) {
+    if (printable) {
+      // Mostly text with the occasional line break
+      const quint32 value = generator.bounded(64);
+      c = value == 0 ? '\n' : value == 1 ? '\r' : char(' ' + value);
+    } else {
+      c = char(generator.bounded(256));
+    }
+  }
+  return data;
+}
+
+QTEST_MAIN(BenchByteFormatter)
+#include "bench_byteformatter.moc"
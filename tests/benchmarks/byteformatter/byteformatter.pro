@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+
+CONFIG += console c++17 release
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += bench_byteformatter.cpp \
+           ../../../src/byteformatter.cpp
+
+HEADERS += ../../../src/byteformatter.h
+
+INCLUDEPATH += ../../../src
+
+TARGET = bench_byteformatter
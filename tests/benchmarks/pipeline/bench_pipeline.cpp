@@ -0,0 +1,250 @@
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <QtTest>
+#include <algorithm>
+#include <ctime>
+
+#include "byteformatter.h"
+#include "consolebuffer.h"
+#include "framedecoder.h"
+#include "logwriter.h"
+#include "rxcoalescer.h"
+#include "serialclock.h"
+#include "serialportmanager.h"
+
+// End-to-end RX benchmark over a socat PTY pair: a paced sender streams
+// timestamped packets at each UI baud rate while the receiver runs the
+// application's pipeline (I/O thread, coalescer, console buffer and row
+// formatting, capture log). Set SERIALFLOW_BENCH_SECONDS to change the
+// duration per baud rate.
+
+namespace {
+
+// Packet layout: i64 send time (ns), u32 sequence, printable filler, '\n'
+constexpr qsizetype PacketSize = 32;
+constexpr int PacerIntervalMs = 5;
+constexpr int VisibleRows = 50; // Rows formatted per display update
+
+int benchmarkSeconds() {
+  const int seconds = qEnvironmentVariableIntValue("SERIALFLOW_BENCH_SECONDS");
+  return seconds > 0 ? seconds : 3;
+}
+
+double percentileMs(const QVector<qint64> &sorted, double fraction) {
+  if (sorted.isEmpty()) {
+    return 0;
+  }
+  const qsizetype index =
+      qMin(sorted.size() - 1, qsizetype(fraction * sorted.size()));
+  return sorted.at(index) / 1e6;
+}
+
+} // namespace
+
+class BenchPipeline : public QObject {
+  Q_OBJECT
+
+public:
+  BenchPipeline();
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+  void pipeline_data();
+  void pipeline();
+
+private:
+  QProcess *m_socatProcess;
+  QString m_port1Name;
+  QString m_port2Name;
+};
+
+BenchPipeline::BenchPipeline() {
+  m_socatProcess = new QProcess(this);
+  // Distinct from the unit tests' pair so both can run at once
+  m_port1Name = "/tmp/ttyBench0";
+  m_port2Name = "/tmp/ttyBench1";
+}
+
+void BenchPipeline::initTestCase() {
+  QStringList args;
+  args << "-d" << "-d"
+       << "pty,raw,echo=0,link=" + m_port1Name
+       << "pty,raw,echo=0,link=" + m_port2Name;
+
+  m_socatProcess->start("socat", args);
+  QVERIFY(m_socatProcess->waitForStarted());
+
+  // Give it a moment to create the links
+  QThread::msleep(500);
+
+  QVERIFY(m_socatProcess->state() == QProcess::Running);
+  QVERIFY(QFile::exists(m_port1Name));
+  QVERIFY(QFile::exists(m_port2Name));
+}
+
+void BenchPipeline::cleanupTestCase() {
+  if (m_socatProcess->state() == QProcess::Running) {
+    m_socatProcess->terminate();
+    m_socatProcess->waitForFinished();
+  }
+}
+
+void BenchPipeline::pipeline_data() {
+  QTest::addColumn<qint32>("baudRate");
+
+  // The rates offered by the main window
+  for (qint32 rate : {9600, 19200, 38400, 57600, 115200, 230400, 460800,
+                      921600}) {
+    QTest::addRow("%d", rate) << rate;
+  }
+}
+
+void BenchPipeline::pipeline() {
+  QFETCH(qint32, baudRate);
+
+  QTemporaryDir logDir;
+  QVERIFY(logDir.isValid());
+
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  sender.setThreadedIo(true);
+  receiver.setThreadedIo(true);
+  QVERIFY(sender.openPort(m_port1Name, baudRate));
+  QVERIFY(receiver.openPort(m_port2Name, baudRate));
+
+  LogWriter logWriter;
+  LogWriter::Options logOptions;
+  logOptions.path = logDir.filePath("bench.sfcap");
+  QVERIFY(logWriter.start(logOptions));
+
+  RxCoalescer coalescer;
+  ConsoleBuffer buffer;
+  FixedLengthFrameDecoder packets(PacketSize);
+  QByteArray formatted;
+
+  QElapsedTimer clock;
+  clock.start();
+  quint64 receivedBytes = 0;
+  qint64 lastReceive = 0;
+  quint64 sequenceGaps = 0;
+  quint32 expectedSequence = 0;
+  QVector<qint64> latencies;
+
+  // RX side: log as it arrives, display once per coalesced batch
+  connect(&receiver, &SerialPortManager::chunkReceived, &coalescer,
+          &RxCoalescer::addChunk);
+  // Records are stamped like the application's: epoch ns of the read
+  connect(&receiver, &SerialPortManager::chunkReceived, &logWriter,
+          [&](const SerialChunk &chunk) {
+            lastReceive = clock.nsecsElapsed();
+            receivedBytes += chunk.data.size();
+            logWriter.write(CaptureFormat::Rx,
+                            SerialClock::toEpochNs(chunk.timestamp),
+                            chunk.data);
+          });
+  connect(&coalescer, &RxCoalescer::chunksReady, &coalescer,
+          [&](const QList<SerialChunk> &chunks) {
+            const qint64 now = clock.nsecsElapsed();
+            QList<FrameDecoder::Frame> frames;
+            for (const SerialChunk &chunk : chunks) {
+              buffer.append(ConsoleBuffer::Rx, chunk.data,
+                            SerialClock::toEpochNs(chunk.timestamp));
+              packets.feed(chunk.data, frames);
+            }
+
+            // What a repaint costs: formatting the rows at the bottom
+            const qint64 end = buffer.endRecord();
+            for (qint64 id = qMax(buffer.firstRecord(), end - VisibleRows);
+                 id < end; ++id) {
+              const QByteArray row = buffer.recordData(id);
+              formatted.resize(ByteFormatter::hexLength(row.size()));
+              ByteFormatter::formatHex(row.constData(), row.size(),
+                                       formatted.data());
+            }
+
+            for (const FrameDecoder::Frame &frame : std::as_const(frames)) {
+              const char *packet = frame.payload.constData();
+              latencies.append(now - qFromLittleEndian<qint64>(packet));
+              const quint32 sequence = qFromLittleEndian<quint32>(packet + 8);
+              if (sequence != expectedSequence) {
+                ++sequenceGaps;
+              }
+              expectedSequence = sequence + 1;
+            }
+          });
+
+  // TX side: whole packets at the rate the line would carry with 8N1
+  const double bytesPerSecond = baudRate / 10.0;
+  quint32 sentPackets = 0;
+  quint64 sentBytes = 0;
+  QTimer pacer;
+  pacer.setTimerType(Qt::PreciseTimer);
+  pacer.setInterval(PacerIntervalMs);
+  connect(&pacer, &QTimer::timeout, &pacer, [&]() {
+    const qint64 now = clock.nsecsElapsed();
+    const quint32 due = quint32(now / 1e9 * bytesPerSecond / PacketSize);
+    QByteArray batch;
+    for (; sentPackets < due; ++sentPackets) {
+      char packet[PacketSize];
+      qToLittleEndian<qint64>(now, packet);
+      qToLittleEndian<quint32>(sentPackets, packet + 8);
+      std::fill(packet + 12, packet + PacketSize - 1,
+                char('A' + sentPackets % 26));
+      packet[PacketSize - 1] = '\n';
+      batch.append(packet, PacketSize);
+    }
+    if (!batch.isEmpty() && sender.sendData(batch)) {
+      sentBytes += batch.size();
+    }
+  });
+
+  const std::clock_t cpuStart = std::clock();
+  pacer.start();
+  QTest::qWait(benchmarkSeconds() * 1000);
+  pacer.stop();
+
+  // Let the tail of the stream through before counting losses
+  QElapsedTimer drain;
+  drain.start();
+  while (receivedBytes < sentBytes && drain.elapsed() < 2000) {
+    QTest::qWait(10);
+  }
+  coalescer.flush();
+  const double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  logWriter.stop();
+
+  sender.closePort();
+  receiver.closePort();
+
+  QVERIFY2(receivedBytes > 0, "Nothing received");
+
+  std::sort(latencies.begin(), latencies.end());
+  const double seconds = lastReceive / 1e9;
+  const double throughput = seconds > 0 ? receivedBytes / seconds : 0;
+  const double megabytes = receivedBytes / 1e6;
+
+  const ChunkPool::Stats rxBuffers = receiver.rxBufferStats();
+  qInfo("%7d baud: %10.0f B/s | lost %llu B, overrun %llu B, log dropped "
+        "%llu B, gaps %llu | latency p50 %.2f p90 %.2f p99 %.2f max %.2f ms "
+        "| CPU %.1f ms/MB | RX buffers %llu allocated for %llu reads",
+        baudRate, throughput,
+        static_cast<unsigned long long>(sentBytes - receivedBytes),
+        static_cast<unsigned long long>(receiver.rxOverrunBytes()),
+        static_cast<unsigned long long>(logWriter.droppedBytes()),
+        static_cast<unsigned long long>(sequenceGaps),
+        percentileMs(latencies, 0.50), percentileMs(latencies, 0.90),
+        percentileMs(latencies, 0.99), percentileMs(latencies, 1.0),
+        megabytes > 0 ? cpuSeconds * 1000 / megabytes : 0.0,
+        static_cast<unsigned long long>(rxBuffers.allocations),
+        static_cast<unsigned long long>(rxBuffers.acquisitions));
+
+  QTest::setBenchmarkResult(throughput, QTest::BytesPerSecond);
+}
+
+QTEST_MAIN(BenchPipeline)
+#include "bench_pipeline.moc"
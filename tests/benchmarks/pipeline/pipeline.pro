@@ -0,0 +1,49 @@
+QT += testlib serialport
+QT -= gui
+
+CONFIG += console c++17 release
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += bench_pipeline.cpp \
+           ../../../src/byteformatter.cpp \
+           ../../../src/captureformat.cpp \
+           ../../../src/capturereader.cpp \
+           ../../../src/chunkpool.cpp \
+           ../../../src/consolebuffer.cpp \
+           ../../../src/framedecoder.cpp \
+           ../../../src/logwriter.cpp \
+           ../../../src/portwatcher.cpp \
+           ../../../src/rxcoalescer.cpp \
+           ../../../src/serialclock.cpp \
+           ../../../src/serialportmanager.cpp \
+           ../../../src/serialportworker.cpp \
+           ../../../src/serialtransport.cpp \
+           ../../../src/simulatedtransport.cpp \
+           ../../../src/terminaldecoder.cpp
+
+HEADERS += ../../../src/byteformatter.h \
+           ../../../src/captureformat.h \
+           ../../../src/capturereader.h \
+           ../../../src/chunkpool.h \
+           ../../../src/consolebuffer.h \
+           ../../../src/consolesource.h \
+           ../../../src/framedecoder.h \
+           ../../../src/logwriter.h \
+           ../../../src/portstatistics.h \
+           ../../../src/portwatcher.h \
+           ../../../src/rxcoalescer.h \
+           ../../../src/serialchunk.h \
+           ../../../src/serialclock.h \
+           ../../../src/serialportmanager.h \
+           ../../../src/serialportworker.h \
+           ../../../src/serialtransport.h \
+           ../../../src/simulatedtransport.h \
+           ../../../src/spscringbuffer.h \
+           ../../../src/terminaldecoder.h \
+           ../../../src/txoptions.h
+
+INCLUDEPATH += ../../../src
+
+TARGET = bench_pipeline
@@ -1,4 +1,4 @@
-QT += testlib serialport
+QT += testlib serialport network
 QT -= gui
 
 CONFIG += console
@@ -7,9 +7,60 @@ CONFIG -= app_bundle
 TEMPLATE = app
 
 SOURCES += tst_serialportmanager.cpp \
-           ../src/serialportmanager.cpp
+           ../src/byteformatter.cpp \
+           ../src/captureformat.cpp \
+           ../src/capturereader.cpp \
+           ../src/chunkpool.cpp \
+           ../src/consolebuffer.cpp \
+           ../src/consolefilter.cpp \
+           ../src/consolesearch.cpp \
+           ../src/filetransfer.cpp \
+           ../src/framedecoder.cpp \
+           ../src/headlesscapture.cpp \
+           ../src/logwriter.cpp \
+           ../src/packetdissector.cpp \
+           ../src/portbridge.cpp \
+           ../src/portwatcher.cpp \
+           ../src/scriptengine.cpp \
+           ../src/serialclock.cpp \
+           ../src/serialportmanager.cpp \
+           ../src/serialportworker.cpp \
+           ../src/serialtransport.cpp \
+           ../src/simulatedtransport.cpp \
+           ../src/statisticsexporter.cpp \
+           ../src/telemetrystore.cpp \
+           ../src/terminaldecoder.cpp \
+           ../src/triggercapture.cpp
 
-HEADERS += ../src/serialportmanager.h
+HEADERS += ../src/byteformatter.h \
+           ../src/captureformat.h \
+           ../src/capturereader.h \
+           ../src/chunkpool.h \
+           ../src/consolebuffer.h \
+           ../src/consolefilter.h \
+           ../src/consolesearch.h \
+           ../src/consolesource.h \
+           ../src/filetransfer.h \
+           ../src/framedecoder.h \
+           ../src/headlesscapture.h \
+           ../src/logwriter.h \
+           ../src/packetdissector.h \
+           ../src/portbridge.h \
+           ../src/portstatistics.h \
+           ../src/portwatcher.h \
+           ../src/scriptengine.h \
+           ../src/serialchunk.h \
+           ../src/serialclock.h \
+           ../src/serialportmanager.h \
+           ../src/serialportworker.h \
+           ../src/serialtransport.h \
+           ../src/simulatedtransport.h \
+           ../src/spscringbuffer.h \
+           ../src/statisticsexporter.h \
+           ../src/telemetrystore.h \
+           ../src/terminaldecoder.h \
+           ../src/triggercapture.h \
+           ../src/txoptions.h
 
 INCLUDEPATH += ../src
 
@@ -1,10 +1,35 @@
+#include <QCommandLineParser>
 #include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QProcess>
+#include <QTemporaryDir>
+#include <QTcpSocket>
+#include <QTemporaryFile>
 #include <QThread>
+#include <QUdpSocket>
 #include <QtTest>
 
 // Include the class under test
+#include "byteformatter.h"
+#include "capturereader.h"
+#include "consolebuffer.h"
+#include "consolefilter.h"
+#include "consolesearch.h"
+#include "filetransfer.h"
+#include "framedecoder.h"
+#include "headlesscapture.h"
+#include "logwriter.h"
+#include "packetdissector.h"
+#include "portbridge.h"
+#include "scriptengine.h"
+#include "serialclock.h"
 #include "serialportmanager.h"
+#include "simulatedtransport.h"
+#include "statisticsexporter.h"
+#include "telemetrystore.h"
+#include "terminaldecoder.h"
+#include "triggercapture.h"
 
 class TestSerialPortManager : public QObject {
   Q_OBJECT
@@ -18,9 +43,32 @@ private slots:
   void cleanupTestCase();
   void testOpenClose();
   void testSendReceive();
+  void testThreadedSendReceive();
+  void testSharedIoThread();
+  void testChunkTimestamps();
+  void testRxBufferReuse();
+  void testTxQueue();
+  void testStatistics();
+  void testAutoReconnect();
+  void testSimulatedTransport();
+  void testPortBridge();
+  void testFileTransfer();
+  void testScriptEngine();
+  void testLogWriter();
+  void testCaptureReader();
+  void testConsoleSearch();
+  void testHexDumpRow();
+  void testFrameDecoder();
+  void testTerminalDecoder();
+  void testPacketDissector();
+  void testTriggerCapture();
+  void testTelemetryStore();
+  void testHeadlessCapture();
   void testErrorHandling();
 
 private:
+  bool startSocat();
+
   QProcess *m_socatProcess;
   QString m_port1Name;
   QString m_port2Name;
@@ -35,7 +83,7 @@ TestSerialPortManager::TestSerialPortManager() {
 
 TestSerialPortManager::~TestSerialPortManager() {}
 
-void TestSerialPortManager::initTestCase() {
+bool TestSerialPortManager::startSocat() {
   // Start socat to create virtual pairs
   // socat -d -d pty,raw,echo=0,link=/tmp/ttyV0 pty,raw,echo=0,link=/tmp/ttyV1
   QStringList args;
@@ -46,17 +94,20 @@ void TestSerialPortManager::initTestCase() {
   m_socatProcess->start("socat", args);
 
   // Wait for socat to start
-  QVERIFY(m_socatProcess->waitForStarted());
+  if (!m_socatProcess->waitForStarted()) {
+    return false;
+  }
 
   // Give it a moment to create the links
   QThread::msleep(500); // Simple wait
 
   // Check if socat is running and ports exist
-  QVERIFY(m_socatProcess->state() == QProcess::Running);
-  QVERIFY(QFile::exists(m_port1Name));
-  QVERIFY(QFile::exists(m_port2Name));
+  return m_socatProcess->state() == QProcess::Running &&
+         QFile::exists(m_port1Name) && QFile::exists(m_port2Name);
 }
 
+void TestSerialPortManager::initTestCase() { QVERIFY(startSocat()); }
+
 void TestSerialPortManager::cleanupTestCase() {
   if (m_socatProcess->state() == QProcess::Running) {
     m_socatProcess->terminate();
@@ -115,6 +166,1358 @@ void TestSerialPortManager::testSendReceive() {
   receiver.closePort();
 }
 
+void TestSerialPortManager::testThreadedSendReceive() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  receiver.setThreadedIo(true);
+  QVERIFY(receiver.isThreadedIo());
+
+  QVERIFY(sender.openPort(m_port1Name, 9600));
+  QVERIFY(receiver.openPort(m_port2Name, 9600));
+
+  QSignalSpy receiveSpy(&receiver, &SerialPortManager::dataReceived);
+
+  QByteArray testMessage = "Hello Threaded Test";
+  QVERIFY(sender.sendData(testMessage));
+
+  // Chunk boundaries are up to the driver, so reassemble before comparing
+  QByteArray receivedData;
+  while (receivedData.size() < testMessage.size() && receiveSpy.wait(1000)) {
+    while (!receiveSpy.isEmpty()) {
+      receivedData += receiveSpy.takeFirst().at(0).toByteArray();
+    }
+  }
+  QCOMPARE(receivedData, testMessage);
+  QCOMPARE(receiver.rxOverrunChunks(), quint64(0));
+
+  sender.closePort();
+  receiver.closePort();
+  QVERIFY(!receiver.isOpen());
+
+  // Switching back is allowed once the port is closed
+  receiver.setThreadedIo(false);
+  QVERIFY(!receiver.isThreadedIo());
+}
+
+void TestSerialPortManager::testSharedIoThread() {
+  // Both ends of the pair serviced by one caller-owned thread
+  QThread ioThread;
+  ioThread.start();
+
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  sender.setIoThread(&ioThread);
+  receiver.setIoThread(&ioThread);
+  QCOMPARE(sender.ioThread(), &ioThread);
+  QCOMPARE(receiver.ioThread(), &ioThread);
+
+  QVERIFY(sender.openPort(m_port1Name, 9600));
+  QVERIFY(receiver.openPort(m_port2Name, 9600));
+
+  QSignalSpy receiveSpy(&receiver, &SerialPortManager::dataReceived);
+
+  QByteArray testMessage = "Hello Shared Thread";
+  QVERIFY(sender.sendData(testMessage));
+
+  QByteArray receivedData;
+  while (receivedData.size() < testMessage.size() && receiveSpy.wait(1000)) {
+    while (!receiveSpy.isEmpty()) {
+      receivedData += receiveSpy.takeFirst().at(0).toByteArray();
+    }
+  }
+  QCOMPARE(receivedData, testMessage);
+
+  sender.closePort();
+  receiver.closePort();
+
+  // Detaching must leave the shared thread running
+  sender.setIoThread(nullptr);
+  receiver.setIoThread(nullptr);
+  QVERIFY(!receiver.isThreadedIo());
+  QVERIFY(ioThread.isRunning());
+
+  ioThread.quit();
+  ioThread.wait();
+}
+
+void TestSerialPortManager::testChunkTimestamps() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  receiver.setThreadedIo(true);
+  QVERIFY(sender.openPort(m_port1Name, 9600));
+  QVERIFY(receiver.openPort(m_port2Name, 9600));
+
+  QSignalSpy chunkSpy(&receiver, &SerialPortManager::chunkReceived);
+
+  // Two writes far enough apart to arrive as separate reads
+  const qint64 before = SerialClock::nowNs();
+  QVERIFY(sender.sendData("first"));
+  QVERIFY(chunkSpy.wait(1000));
+  QThread::msleep(50);
+  QVERIFY(sender.sendData("second"));
+  QVERIFY(chunkSpy.wait(1000));
+  const qint64 after = SerialClock::nowNs();
+
+  // Stamped at the read: within the test window and in arrival order
+  qint64 previous = before;
+  for (const QList<QVariant> &arguments : std::as_const(chunkSpy)) {
+    const SerialChunk chunk = arguments.at(0).value<SerialChunk>();
+    QVERIFY(!chunk.data.isEmpty());
+    QVERIFY(chunk.timestamp >= previous);
+    QVERIFY(chunk.timestamp <= after);
+    previous = chunk.timestamp;
+  }
+
+  const SerialChunk last = chunkSpy.last().at(0).value<SerialChunk>();
+  const SerialChunk first = chunkSpy.first().at(0).value<SerialChunk>();
+  QVERIFY(last.timestamp - first.timestamp >= 50 * 1000000LL);
+
+  sender.closePort();
+  receiver.closePort();
+}
+
+void TestSerialPortManager::testRxBufferReuse() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  receiver.setThreadedIo(true);
+  QVERIFY(sender.openPort(m_port1Name, 115200));
+  QVERIFY(receiver.openPort(m_port2Name, 115200));
+
+  // Consume without keeping references, as the display and log do
+  qint64 received = 0;
+  connect(&receiver, &SerialPortManager::chunkReceived, this,
+          [&](const SerialChunk &chunk) { received += chunk.data.size(); });
+
+  const QByteArray packet(64, 'x');
+  auto stream = [&](int packets) {
+    const qint64 target = received + qint64(packets) * packet.size();
+    for (int i = 0; i < packets; ++i) {
+      QVERIFY(sender.sendData(packet));
+      QTest::qWait(2);
+    }
+    QTRY_VERIFY_WITH_TIMEOUT(received >= target, 2000);
+  };
+
+  // Warm up, then the same traffic must be served from recycled buffers
+  stream(50);
+  const ChunkPool::Stats warm = receiver.rxBufferStats();
+  QVERIFY(warm.allocations > 0);
+  QVERIFY(warm.allocations <= quint64(warm.pooledChunks));
+
+  stream(200);
+  const ChunkPool::Stats steady = receiver.rxBufferStats();
+  QVERIFY(steady.acquisitions > warm.acquisitions);
+  QCOMPARE(steady.allocations, warm.allocations);
+
+  sender.closePort();
+  receiver.closePort();
+}
+
+void TestSerialPortManager::testTxQueue() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  QVERIFY(sender.openPort(m_port1Name, 115200));
+  QVERIFY(receiver.openPort(m_port2Name, 115200));
+
+  QByteArray received;
+  connect(&receiver, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) { received += data; });
+
+  // A bulk send returns immediately and drains in the background
+  QByteArray bulk(256 * 1024, Qt::Uninitialized);
+  for (int i = 0; i < bulk.size(); ++i) {
+    bulk[i] = char('a' + i % 26);
+  }
+  QElapsedTimer timer;
+  timer.start();
+  QVERIFY(sender.sendData(bulk));
+  QVERIFY(timer.elapsed() < 100);
+  QVERIFY(sender.txQueuedBytes() > 0);
+  QTRY_COMPARE_WITH_TIMEOUT(received.size(), bulk.size(), 10000);
+  QCOMPARE(received, bulk);
+  QCOMPARE(sender.txQueuedBytes(), qint64(0));
+
+  // Inter-byte delay: 6 bytes take at least 5 gaps
+  TxOptions options;
+  options.interByteDelayMs = 10;
+  sender.setTxOptions(options);
+  received.clear();
+  timer.restart();
+  QVERIFY(sender.sendData("abcdef"));
+  QTRY_COMPARE_WITH_TIMEOUT(received, QByteArray("abcdef"), 2000);
+  QVERIFY(timer.elapsed() >= 50);
+
+  // Rate limit: 1000 bytes at 4000 B/s take about a quarter of a second
+  options = TxOptions();
+  options.rateLimit = 4000;
+  sender.setTxOptions(options);
+  received.clear();
+  timer.restart();
+  QVERIFY(sender.sendData(QByteArray(1000, 'r')));
+  QTRY_COMPARE_WITH_TIMEOUT(received.size(), qsizetype(1000), 2000);
+  QVERIFY(timer.elapsed() >= 200);
+
+  sender.closePort();
+  receiver.closePort();
+}
+
+void TestSerialPortManager::testStatistics() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  receiver.setThreadedIo(true);
+  QVERIFY(sender.openPort(m_port1Name, 115200));
+  QVERIFY(receiver.openPort(m_port2Name, 115200));
+
+  qint64 received = 0;
+  connect(&receiver, &SerialPortManager::chunkReceived, this,
+          [&](const SerialChunk &chunk) { received += chunk.data.size(); });
+
+  QTest::qWait(20);
+  const QByteArray packet(100, 's');
+  for (int i = 0; i < 10; ++i) {
+    QVERIFY(sender.sendData(packet));
+    QTest::qWait(5);
+  }
+  QTRY_COMPARE_WITH_TIMEOUT(received, qint64(1000), 2000);
+  QTRY_COMPARE_WITH_TIMEOUT(sender.statistics().txBytes, quint64(1000), 2000);
+
+  // Counters are cumulative; every chunk lands in one histogram bucket
+  const PortStatistics stats = receiver.statistics();
+  QCOMPARE(stats.rxBytes, quint64(1000));
+  QVERIFY(stats.rxChunks > 0);
+  quint64 histogramChunks = 0;
+  for (quint64 count : stats.chunkSizes) {
+    histogramChunks += count;
+  }
+  QCOMPARE(histogramChunks, stats.rxChunks);
+  QVERIFY(stats.rxBytesPerSecond > 0);
+  QVERIFY(stats.deliveryLatency.samples > 0);
+  QVERIFY(stats.deliveryLatency.minNs <= stats.deliveryLatency.maxNs);
+
+  // One header row and one row per snapshot
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  StatisticsExporter exporter;
+  QVERIFY(exporter.open(dir.filePath("stats.csv")));
+  QVERIFY(exporter.write(stats));
+  QVERIFY(exporter.write(receiver.statistics()));
+  exporter.close();
+
+  QFile csv(dir.filePath("stats.csv"));
+  QVERIFY(csv.open(QIODevice::ReadOnly | QIODevice::Text));
+  const QList<QByteArray> lines = csv.readAll().trimmed().split('\n');
+  QCOMPARE(lines.size(), 3);
+  QVERIFY(lines[0].startsWith("timestamp,"));
+  QCOMPARE(lines[1].count(','), lines[0].count(','));
+
+  sender.closePort();
+  receiver.closePort();
+}
+
+void TestSerialPortManager::testAutoReconnect() {
+  SerialPortManager receiver;
+  receiver.setAutoReconnect(true);
+  QVERIFY(receiver.openPort(m_port2Name, 115200));
+  QSignalSpy errorSpy(&receiver, &SerialPortManager::errorOccurred);
+  QSignalSpy reconnectedSpy(&receiver, &SerialPortManager::reconnected);
+
+  // Unplug: ending socat removes both PTYs
+  m_socatProcess->terminate();
+  QVERIFY(m_socatProcess->waitForFinished());
+  QTRY_VERIFY_WITH_TIMEOUT(receiver.isReconnecting(), 2000);
+  QVERIFY(!receiver.isOpen());
+  const int lossErrors = errorSpy.count();
+
+  // Plug back in; failed attempts in between stay quiet
+  QVERIFY(startSocat());
+  QTRY_VERIFY_WITH_TIMEOUT(receiver.isOpen(), 5000);
+  QVERIFY(!receiver.isReconnecting());
+  QCOMPARE(reconnectedSpy.count(), 1);
+  QCOMPARE(errorSpy.count(), lossErrors);
+
+  // Same port, same settings
+  SerialPortManager sender;
+  QVERIFY(sender.openPort(m_port1Name, 115200));
+  QByteArray received;
+  connect(&receiver, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) { received += data; });
+  QVERIFY(sender.sendData("back"));
+  QTRY_COMPARE_WITH_TIMEOUT(received, QByteArray("back"), 2000);
+
+  // Closing by hand never reconnects
+  receiver.closePort();
+  QVERIFY(!receiver.isReconnecting());
+  sender.closePort();
+}
+
+void TestSerialPortManager::testSimulatedTransport() {
+  SimulatedTransport::Options options;
+  QString error;
+  QVERIFY(SimulatedTransport::parseOptions(
+      "sim:data=counter,rate=5000000,burst=512,jitter=0.5,echo", options,
+      error));
+  QCOMPARE(options.pattern, SimulatedTransport::Counter);
+  QCOMPARE(options.rate, qint64(5000000));
+  QVERIFY(options.echo);
+  QVERIFY(!SimulatedTransport::parseOptions("sim:rate=fast", options, error));
+  QVERIFY(!SimulatedTransport::parseOptions("sim:colour", options, error));
+
+  // Far beyond any UART, through the I/O thread, without losing a byte.
+  // With errors injected, the same seed corrupts the same bytes.
+  auto receiveCounter = [&](const QString &portName, qsizetype size) {
+    SerialPortManager manager;
+    manager.setThreadedIo(true);
+    QByteArray received;
+    connect(&manager, &SerialPortManager::dataReceived, this,
+            [&](const QByteArray &data) { received += data; });
+    if (!manager.openPort(portName, 115200)) {
+      return QByteArray();
+    }
+    QElapsedTimer wait;
+    wait.start();
+    while (received.size() < size && wait.elapsed() < 5000) {
+      QTest::qWait(10);
+    }
+    manager.closePort();
+    return received.left(size);
+  };
+  auto corrupted = [](const QByteArray &data) {
+    QVector<qsizetype> positions;
+    for (qsizetype i = 0; i < data.size(); ++i) {
+      if (data[i] != char(i)) {
+        positions.append(i);
+      }
+    }
+    return positions;
+  };
+
+  const qsizetype size = 4 * 1024 * 1024;
+  QElapsedTimer timer;
+  timer.start();
+  const QByteArray clean =
+      receiveCounter("sim:data=counter,rate=20000000,burst=4096", size);
+  QCOMPARE(clean.size(), size);
+  QVERIFY(corrupted(clean).isEmpty());
+  qInfo("Simulated 4 MB in %lld ms", qlonglong(timer.elapsed()));
+
+  const QString noisy = "sim:data=counter,rate=20000000,errors=0.001,seed=7";
+  const QVector<qsizetype> first = corrupted(receiveCounter(noisy, 1 << 20));
+  QVERIFY(first.size() > 500 && first.size() < 2000);
+  QCOMPARE(corrupted(receiveCounter(noisy, 1 << 20)), first);
+
+  // Loopback, and a device that disappears and comes back
+  SerialPortManager manager;
+  QByteArray echoed;
+  connect(&manager, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) { echoed += data; });
+  QSignalSpy reconnectedSpy(&manager, &SerialPortManager::reconnected);
+  manager.setAutoReconnect(true);
+  QVERIFY(manager.openPort("sim:data=none,echo,disconnect=100", 115200));
+  QVERIFY(manager.sendData("hello"));
+  QTRY_COMPARE(echoed, QByteArray("hello"));
+  QTRY_COMPARE(reconnectedSpy.count(), 1);
+  QVERIFY(manager.isOpen());
+  manager.closePort();
+
+  // Replaying a capture delivers its RX records only
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  LogWriter writer;
+  LogWriter::Options logOptions;
+  logOptions.path = dir.filePath("replay.sfcap");
+  QVERIFY(writer.start(logOptions));
+  QByteArray expected;
+  for (int i = 0; i < 100; ++i) {
+    const QByteArray line = "line " + QByteArray::number(i) + "\n";
+    writer.write(CaptureFormat::Rx, 1000000LL * i, line);
+    writer.write(CaptureFormat::Tx, 1000000LL * i, "tx\n");
+    expected += line;
+  }
+  writer.stop();
+
+  echoed.clear();
+  QVERIFY(manager.openPort("sim:replay=" + logOptions.path + ",speed=10",
+                           115200));
+  QTRY_COMPARE(echoed, expected);
+  manager.closePort();
+}
+
+void TestSerialPortManager::testPortBridge() {
+  // The simulated device echoes, so whatever a client sends comes back to
+  // every client as received data
+  SerialPortManager manager;
+  QVERIFY(manager.openPort("sim:data=none,echo", 115200));
+  PortBridge bridge(&manager);
+  const QHostAddress localhost(QHostAddress::LocalHost);
+  QVERIFY(bridge.listenTcp(PortBridge::RawTcp, localhost, 0));
+  QVERIFY(bridge.listenTcp(PortBridge::Rfc2217, localhost, 0));
+  QVERIFY(bridge.listenUdp(localhost, 0));
+
+  QTcpSocket first;
+  QTcpSocket second;
+  first.connectToHost(localhost, bridge.tcpPort(PortBridge::RawTcp));
+  second.connectToHost(localhost, bridge.tcpPort(PortBridge::RawTcp));
+  QTRY_COMPARE(bridge.clientCount(), 2);
+  first.write("ping\n");
+  QTRY_COMPARE(first.bytesAvailable(), qint64(5));
+  QTRY_COMPARE(second.bytesAvailable(), qint64(5));
+  QCOMPARE(first.readAll(), QByteArray("ping\n"));
+  QCOMPARE(second.readAll(), QByteArray("ping\n"));
+
+  // RFC 2217: the server offers its options, ignores agreement it already
+  // has, and answers a baud rate request with the port's actual setting
+  QTcpSocket telnet;
+  telnet.connectToHost(localhost, bridge.tcpPort(PortBridge::Rfc2217));
+  QTRY_COMPARE(telnet.bytesAvailable(), qint64(12));
+  QCOMPARE(telnet.readAll(),
+           QByteArray::fromHex("fffb00fffd00fffb03fffb2c"));
+  telnet.write(QByteArray::fromHex("fffd00fffb2cfffa2c0100002580fff0"));
+  const QByteArray reply = QByteArray::fromHex("fffd2cfffa2c650001c200fff0");
+  QTRY_COMPARE(telnet.bytesAvailable(), qint64(reply.size()));
+  QCOMPARE(telnet.readAll(), reply);
+
+  // IAC is escaped on the telnet side only
+  telnet.write(QByteArray::fromHex("41ffff42"));
+  QTRY_COMPARE(telnet.bytesAvailable(), qint64(4));
+  QCOMPARE(telnet.readAll(), QByteArray::fromHex("41ffff42"));
+  QTRY_COMPARE(first.bytesAvailable(), qint64(3));
+  QCOMPARE(first.readAll(), QByteArray::fromHex("41ff42"));
+  QTRY_COMPARE(second.bytesAvailable(), qint64(3));
+  second.readAll();
+
+  // A datagram subscribes its sender and is sent like any client input
+  QUdpSocket udp;
+  QVERIFY(udp.bind(localhost, 0));
+  udp.writeDatagram("udp", localhost, bridge.udpPort());
+  QTRY_VERIFY(udp.hasPendingDatagrams());
+  QCOMPARE(udp.receiveDatagram().data(), QByteArray("udp"));
+  QCOMPARE(bridge.clientCount(), 4);
+  QTRY_COMPARE(first.bytesAvailable(), qint64(3));
+
+  first.disconnectFromHost();
+  QTRY_COMPARE(bridge.clientCount(), 3);
+  QCOMPARE(bridge.droppedBytes(), quint64(0));
+  bridge.stop();
+  QCOMPARE(bridge.clientCount(), 0);
+  QVERIFY(!bridge.isListening());
+  manager.closePort();
+
+  // A client that never reads loses data once its queue and socket buffers
+  // are full; the other client still gets every counting byte
+  SerialPortManager source;
+  PortBridge fanOut(&source);
+  QVERIFY(fanOut.listenTcp(PortBridge::RawTcp, localhost, 0));
+  QTcpSocket reader;
+  QTcpSocket stalled;
+  reader.connectToHost(localhost, fanOut.tcpPort(PortBridge::RawTcp));
+  stalled.connectToHost(localhost, fanOut.tcpPort(PortBridge::RawTcp));
+  QVERIFY(stalled.waitForConnected());
+  stalled.setReadBufferSize(4096);
+  stalled.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption,
+                          4096);
+  QTRY_COMPARE(fanOut.clientCount(), 2);
+  qint64 received = 0;
+  connect(&source, &SerialPortManager::dataReceived, this,
+          [&received](const QByteArray &data) { received += data.size(); });
+  QVERIFY(source.openPort("sim:data=counter,rate=4000000,burst=4096",
+                          115200));
+  QTRY_VERIFY_WITH_TIMEOUT(fanOut.droppedBytes() > 0, 30000);
+  source.closePort();
+  QVERIFY(received > PortBridge::ClientQueueBytes);
+  QTRY_COMPARE(reader.bytesAvailable(), received);
+  const QByteArray counted = reader.readAll();
+  qsizetype gap = 0;
+  while (gap < counted.size() && counted[gap] == char(gap)) {
+    ++gap;
+  }
+  QCOMPARE(gap, counted.size());
+  QVERIFY(fanOut.droppedBytes() <= quint64(received));
+
+  // A client sending faster than the port transmits is left unread while
+  // the TX queue is over its backlog, and then drained
+  SerialPortManager sink;
+  TxOptions txOptions;
+  txOptions.rateLimit = 1000000;
+  sink.setTxOptions(txOptions);
+  QVERIFY(sink.openPort("sim:data=none,echo", 115200));
+  PortBridge fanIn(&sink);
+  QVERIFY(fanIn.listenTcp(PortBridge::RawTcp, localhost, 0));
+  QTcpSocket writer;
+  writer.connectToHost(localhost, fanIn.tcpPort(PortBridge::RawTcp));
+  QTRY_COMPARE(fanIn.clientCount(), 1);
+  qint64 peak = 0;
+  qint64 echoed = 0;
+  connect(&sink, &SerialPortManager::txQueueChanged, this,
+          [&]() { peak = qMax(peak, sink.txQueuedBytes()); });
+  connect(&sink, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) {
+            echoed += data.size();
+            peak = qMax(peak, sink.txQueuedBytes());
+          });
+  const QByteArray bulk(8 * PortBridge::TxBacklogBytes, 'x');
+  writer.write(bulk);
+  QTRY_COMPARE_WITH_TIMEOUT(echoed, qint64(bulk.size()), 10000);
+  // Without the pause the whole write would be queued at once; one read of
+  // client input may go past the backlog, never more
+  QVERIFY(peak > 0);
+  QVERIFY(peak < 2 * PortBridge::TxBacklogBytes);
+  QTRY_COMPARE(sink.txQueuedBytes(), qint64(0));
+  sink.closePort();
+}
+
+void TestSerialPortManager::testFileTransfer() {
+  SerialPortManager sender;
+  SerialPortManager receiver;
+  QVERIFY(sender.openPort(m_port1Name, 115200));
+  QVERIFY(receiver.openPort(m_port2Name, 115200));
+
+  QByteArray contents(5000, Qt::Uninitialized);
+  for (int i = 0; i < contents.size(); ++i) {
+    contents[i] = char(i * 7);
+  }
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  QCOMPARE(file.write(contents), qint64(contents.size()));
+  QVERIFY(file.flush());
+
+  FileTransfer transfer(&sender);
+  QSignalSpy finishedSpy(&transfer, &FileTransfer::finished);
+
+  // Raw: the file arrives unchanged
+  QByteArray received;
+  const QMetaObject::Connection rawConnection =
+      connect(&receiver, &SerialPortManager::dataReceived, this,
+              [&](const QByteArray &data) { received += data; });
+  QVERIFY(transfer.start(file.fileName(), FileTransfer::Raw));
+  QTRY_COMPARE_WITH_TIMEOUT(received, contents, 5000);
+  QTRY_COMPARE(finishedSpy.count(), 1);
+  QVERIFY(finishedSpy.takeFirst().at(0).toBool());
+
+  // Cancelling stops the data at once instead of draining the stream window
+  QTemporaryFile bigFile;
+  QVERIFY(bigFile.open());
+  QCOMPARE(bigFile.write(QByteArray(256 * 1024, 'x')), qint64(256 * 1024));
+  QVERIFY(bigFile.flush());
+  TxOptions slow;
+  slow.rateLimit = 20000;
+  sender.setTxOptions(slow);
+  received.clear();
+  QVERIFY(transfer.start(bigFile.fileName(), FileTransfer::Raw));
+  QTRY_VERIFY(!received.isEmpty());
+  transfer.cancel();
+  QCOMPARE(finishedSpy.count(), 1);
+  QVERIFY(!finishedSpy.takeFirst().at(0).toBool());
+  QTRY_COMPARE(sender.txQueuedBytes(), qint64(0));
+  QTest::qWait(200);
+  const qsizetype afterCancel = received.size();
+  QTest::qWait(500);
+  QCOMPARE(received.size(), afterCancel);
+  QVERIFY(afterCancel < 64 * 1024);
+  sender.setTxOptions(TxOptions());
+  disconnect(rawConnection);
+
+  // XMODEM-1K against a minimal receiver that rejects the first block once
+  const char ack = 0x06;
+  const char nak = 0x15;
+  QByteArray stream;
+  QByteArray payload;
+  bool rejected = false;
+  connect(&receiver, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) {
+            stream += data;
+            while (!stream.isEmpty()) {
+              if (stream[0] == 0x04) { // EOT
+                receiver.sendData(QByteArray(1, ack));
+                stream.remove(0, 1);
+                continue;
+              }
+              const int size = stream[0] == 0x02 ? 1024 : 128;
+              if (stream.size() < 3 + size + 2) {
+                break;
+              }
+              const quint16 crc = FileTransfer::crc16(stream.constData() + 3,
+                                                      size);
+              const bool valid =
+                  quint8(stream[1]) == quint8(~stream[2]) &&
+                  quint8(stream[3 + size]) == crc >> 8 &&
+                  quint8(stream[4 + size]) == (crc & 0xFF);
+              if (valid && rejected) {
+                payload += stream.mid(3, size);
+              }
+              receiver.sendData(QByteArray(1, valid && rejected ? ack : nak));
+              rejected = true;
+              stream.remove(0, 3 + size + 2);
+            }
+          });
+  QVERIFY(transfer.start(file.fileName(), FileTransfer::Xmodem1k));
+  QVERIFY(receiver.sendData("C"));
+  QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 5000);
+  QVERIFY(finishedSpy.takeFirst().at(0).toBool());
+
+  // Five 1K blocks, the last padded with SUB
+  QCOMPARE(payload.size(), qsizetype(5 * 1024));
+  QCOMPARE(payload.left(contents.size()), contents);
+  QCOMPARE(payload.mid(contents.size()),
+           QByteArray(payload.size() - contents.size(), 0x1A));
+
+  sender.closePort();
+  receiver.closePort();
+}
+
+void TestSerialPortManager::testScriptEngine() {
+  SerialPortManager host;
+  SerialPortManager device;
+  QVERIFY(host.openPort(m_port1Name, 115200));
+  QVERIFY(device.openPort(m_port2Name, 115200));
+
+  // The device answers every PING line, in whatever pieces it arrives
+  QByteArray pending;
+  connect(&device, &SerialPortManager::dataReceived, this,
+          [&](const QByteArray &data) {
+            pending += data;
+            qsizetype end;
+            while ((end = pending.indexOf('\n')) >= 0) {
+              if (pending.left(end) == "PING") {
+                device.sendData("PONG\r\n");
+              }
+              pending.remove(0, end + 1);
+            }
+          });
+
+  ScriptEngine engine(&host);
+  QSignalSpy finishedSpy(&engine, &ScriptEngine::finished);
+  QSignalSpy messageSpy(&engine, &ScriptEngine::message);
+
+  // 100 round trips, then an expect nothing answers takes its else branch
+  QVERIFY(engine.load("# ping loop\n"
+                      "timeout 2000\n"
+                      "label again\n"
+                      "send \"PING\\n\"\n"
+                      "expect /po+ng/i\n"
+                      "loop 100 again\n"
+                      "send \"HELLO\\n\"\n"
+                      "expect \"PONG\" 50 else quiet\n"
+                      "fail \"unexpected reply\"\n"
+                      "label quiet\n"
+                      "print \"done\"\n"));
+  QVERIFY(engine.start());
+  QVERIFY(engine.isRunning());
+  QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 10000);
+  QVERIFY2(finishedSpy.first().at(0).toBool(),
+           qPrintable(finishedSpy.first().at(1).toString()));
+  QCOMPARE(engine.commandsSent(), quint64(101));
+  QCOMPARE(engine.responsesMatched(), quint64(100));
+  QCOMPARE(engine.responseLatency().samples, quint64(100));
+  QCOMPARE(messageSpy.count(), 1);
+  QCOMPARE(messageSpy.first().at(0).toString(), QString("done"));
+
+  // Without an else label a timeout fails the script at its line
+  finishedSpy.clear();
+  QVERIFY(engine.load("sendhex 48 49 0a\nexpecthex 06 100\n"));
+  QVERIFY(engine.start());
+  QTRY_COMPARE(finishedSpy.count(), 1);
+  QVERIFY(!finishedSpy.first().at(0).toBool());
+  QVERIFY(finishedSpy.first().at(1).toString().startsWith("Line 2:"));
+
+  // Parse errors name the offending line and leave nothing to run
+  QVERIFY(!engine.load("send \"PING\"\n\nexpect \"PONG\n"));
+  QVERIFY(engine.errorString().startsWith("Line 3:"));
+  QVERIFY(!engine.load("goto nowhere\n"));
+  QVERIFY(engine.errorString().contains("nowhere"));
+  QVERIFY(!engine.start());
+
+  host.closePort();
+  device.closePort();
+}
+
+void TestSerialPortManager::testLogWriter() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  // The second segment cannot be created: a directory has its name
+  QVERIFY(QDir(dir.path()).mkdir("log_001.sfcap"));
+  LogWriter writer;
+  LogWriter::Options options;
+  options.path = dir.filePath("log.sfcap");
+  // Batches of exactly ten records, and room for one in a segment
+  const QByteArray payload(100, 'x');
+  const quint64 batchBytes = 10 * (CaptureFormat::RecordHeaderSize + 100);
+  options.batchBytes = qsizetype(batchBytes);
+  options.flushIntervalMs = 60000;
+  options.maxSegmentBytes = 2048;
+  QSignalSpy errorSpy(&writer, &LogWriter::errorOccurred);
+  QVERIFY(writer.start(options));
+
+  for (int i = 0; i < 10; ++i) {
+    writer.write(CaptureFormat::Rx, i, payload);
+  }
+  QTRY_COMPARE(writer.bytesWritten(), batchBytes);
+  QVERIFY(!writer.hasFailed());
+
+  // Rotating fails: the writer stops, says so once and counts the rest as
+  // dropped rather than written
+  for (int i = 0; i < 10; ++i) {
+    writer.write(CaptureFormat::Rx, 10 + i, payload);
+  }
+  QTRY_VERIFY(writer.hasFailed());
+  QVERIFY(writer.errorString().contains("log_001.sfcap"));
+  writer.write(CaptureFormat::Rx, 20, payload);
+  QTest::qWait(50);
+  QCOMPARE(errorSpy.count(), 1);
+  QCOMPARE(writer.bytesWritten(), batchBytes);
+  QCOMPARE(writer.droppedBytes(), batchBytes + quint64(payload.size()));
+  writer.stop();
+
+  // What was written is a complete segment
+  CaptureReader reader;
+  QVERIFY(reader.open(dir.filePath("log_000.sfcap")));
+  QVERIFY(reader.hasStoredIndex());
+  QCOMPARE(reader.recordCount(), qint64(10));
+
+  // A path that cannot be opened fails start() with a reason
+  options.path = dir.filePath("missing/log.sfcap");
+  options.maxSegmentBytes = 0;
+  QVERIFY(!writer.start(options));
+  QVERIFY(!writer.errorString().isEmpty());
+  QVERIFY(!writer.isRunning());
+}
+
+void TestSerialPortManager::testCaptureReader() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  const QString path = dir.filePath("capture.sfcap");
+
+  // Enough records for several index entries
+  const int recordCount = 1000;
+  LogWriter writer;
+  LogWriter::Options options;
+  options.path = path;
+  options.metadata = CaptureFormat::encodeMetadata({{"port", "ttyTEST"}});
+  QVERIFY(writer.start(options));
+  for (int i = 0; i < recordCount; ++i) {
+    writer.write(i % 2 ? CaptureFormat::Tx : CaptureFormat::Rx,
+                 1000000000LL * i, QByteArray::number(i));
+  }
+  writer.stop();
+
+  CaptureReader reader;
+  QVERIFY2(reader.open(path), qPrintable(reader.errorString()));
+  QVERIFY(reader.hasStoredIndex());
+  QCOMPARE(reader.metadata().value("port"), QString("ttyTEST"));
+  QCOMPARE(reader.recordCount(), qint64(recordCount));
+  QCOMPARE(reader.recordData(0), QByteArray("0"));
+  QCOMPARE(reader.recordData(777), QByteArray("777"));
+  QCOMPARE(reader.record(777).direction, ConsoleSource::Tx);
+  QCOMPARE(reader.recordData(300), QByteArray("300"));
+  QCOMPARE(reader.findRecord(500500000000LL), qint64(501));
+  const quint64 damaged =
+      reader.record(10).offset - CaptureFormat::RecordHeaderSize;
+  reader.close();
+
+  // A damaged record length behind a stored index stays inside the data
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  const qint64 fileSize = file.size();
+  QVERIFY(file.seek(qint64(damaged)));
+  QCOMPARE(file.write(QByteArray(4, '\xff')), qint64(4));
+  file.close();
+  QVERIFY(reader.open(path));
+  QVERIFY(reader.hasStoredIndex());
+  QCOMPARE(reader.recordData(9), QByteArray("9"));
+  for (qint64 id = 0; id < reader.recordCount(); ++id) {
+    const ConsoleSource::Record r = reader.record(id);
+    QVERIFY(r.offset + r.length <= quint64(fileSize));
+  }
+  reader.findRecord(999000000000LL);
+  QCOMPARE(reader.recordData(300), QByteArray("300"));
+  reader.close();
+
+  // Repaired for the scan below: record 10 is "10"
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QVERIFY(file.seek(qint64(damaged)));
+  const char length[4] = {2, 0, 0, 0};
+  QCOMPARE(file.write(length, 4), qint64(4));
+  file.close();
+
+  // Without the index (writer killed) the records are scanned instead
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QVERIFY(file.resize(file.size() - 8));
+  file.close();
+  QVERIFY(reader.open(path));
+  QVERIFY(!reader.hasStoredIndex());
+  QCOMPARE(reader.recordCount(), qint64(recordCount));
+  QCOMPARE(reader.recordData(999), QByteArray("999"));
+}
+
+void TestSerialPortManager::testConsoleSearch() {
+  // Small enough that the oldest lines get evicted
+  ConsoleBuffer buffer(64 * 1024, 1024);
+  ConsoleSearch search(&buffer);
+  for (int i = 0; i < 3000; ++i) {
+    buffer.append(ConsoleBuffer::Rx,
+                  i % 1000 == 999 ? "ERROR code=0x1F\n"
+                                  : "ok " + QByteArray::number(i) + "\n",
+                  i);
+  }
+  search.update();
+
+  // Only lines still held are found: 1999 and 2999
+  QVERIFY(search.setPattern("error", ConsoleSearch::Text, false));
+  ConsoleSearch::Match match = search.findNext(buffer.firstRecord(), 0);
+  QVERIFY(match.isValid());
+  QCOMPARE(buffer.recordData(match.record), QByteArray("ERROR code=0x1F\n"));
+  QCOMPARE(match.start, 0);
+  const qint64 first = match.record;
+  match = search.findNext(match.record, match.start + 1);
+  QCOMPARE(match.record, first + 1000);
+  QVERIFY(!search.findNext(match.record, match.start + 1).isValid());
+  QCOMPARE(search.findPrevious(match.record, match.start).record, first);
+
+  QVERIFY(search.setPattern("error", ConsoleSearch::Text, true));
+  QVERIFY(!search.findNext(buffer.firstRecord(), 0).isValid());
+
+  // Hex and regex find the same bytes
+  QVERIFY(search.setPattern("3d 30", ConsoleSearch::Hex, false));
+  QCOMPARE(search.findNext(buffer.firstRecord(), 0).start, 10);
+  QVERIFY(!search.setPattern("3d 3", ConsoleSearch::Hex, false));
+  QVERIFY(search.setPattern("0x[0-9a-f]+", ConsoleSearch::Regex, false));
+  match = search.findNext(buffer.firstRecord(), 0);
+  QCOMPARE(match.record, first);
+  QCOMPARE(match.start, 11);
+  QCOMPARE(match.length, 4);
+  QVERIFY(!search.setPattern("(", ConsoleSearch::Regex, false));
+
+  // The filter follows appended lines
+  QVERIFY(search.setPattern("ERROR", ConsoleSearch::Text, true));
+  ConsoleFilter filter(&search);
+  filter.rebuild();
+  QCOMPARE(filter.recordCount(), qint64(2));
+  buffer.append(ConsoleBuffer::Rx, "late ERROR\n", 0);
+  search.update();
+  filter.update();
+  QCOMPARE(filter.recordCount(), qint64(3));
+  QCOMPARE(filter.filteredId(first + 1000), filter.firstRecord() + 1);
+  QCOMPARE(filter.filteredId(first + 1), qint64(-1));
+}
+
+void TestSerialPortManager::testHexDumpRow() {
+  QByteArray row(ByteFormatter::DumpRowLength, Qt::Uninitialized);
+
+  // A full row
+  const QByteArray bytes("AT+GMR\r\n\x00\x7f\x80\xffOK!?", 16);
+  ByteFormatter::formatDumpRow(0x1234560, bytes.constData(), 0, 16,
+                               row.data());
+  QCOMPARE(row, QByteArray("0001234560  41 54 2B 47 4D 52 0D 0A  "
+                           "00 7F 80 FF 4F 4B 21 3F  |AT+GMR......OK!?|"));
+
+  // Bytes 3-5 only, as at either end of a history
+  ByteFormatter::formatDumpRow(16, bytes.constData(), 3, 3, row.data());
+  QCOMPARE(row, QByteArray("0000000010           41 54 2B            "
+                           "                     |   AT+          |"));
+
+  // The columns the view colours by
+  QCOMPARE(ByteFormatter::dumpHexColumn(0), 12);
+  QCOMPARE(ByteFormatter::dumpHexColumn(8), 37);
+  QCOMPARE(ByteFormatter::dumpAsciiColumn(15), 78);
+}
+
+void TestSerialPortManager::testFrameDecoder() {
+  using Frame = FrameDecoder::Frame;
+  // Feeds stream in pieces of step bytes
+  auto decode = [](const FrameDecoder::Options &options,
+                   const QByteArray &stream, qsizetype step,
+                   quint64 &errors) {
+    std::unique_ptr<FrameDecoder> decoder = FrameDecoder::create(options);
+    QList<Frame> frames;
+    for (qsizetype i = 0; i < stream.size(); i += step) {
+      decoder->feed(stream.mid(i, step), frames);
+    }
+    errors = decoder->errorCount();
+    return frames;
+  };
+  auto sameFrames = [](const QList<Frame> &frames,
+                       const QList<Frame> &expected) {
+    if (frames.size() != expected.size()) {
+      return false;
+    }
+    for (int i = 0; i < frames.size(); ++i) {
+      if (frames[i].payload != expected[i].payload ||
+          frames[i].offset != expected[i].offset ||
+          frames[i].wireLength != expected[i].wireLength) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  struct Case {
+    FrameDecoder::Options options;
+    QByteArray stream;
+    QList<Frame> frames;
+    quint64 errors;
+  };
+  QList<Case> cases;
+
+  // A two-byte delimiter, also split between chunks, and an empty frame;
+  // the unterminated tail stays pending
+  FrameDecoder::Options delimiter;
+  delimiter.type = FrameDecoder::Delimiter;
+  delimiter.delimiter = "\r\n";
+  cases.append({delimiter,
+                "ab\r\ncd\r\n\r\nxyz",
+                {{"ab", 0, 4}, {"cd", 4, 4}, {"", 8, 2}},
+                0});
+
+  FrameDecoder::Options fixed;
+  fixed.type = FrameDecoder::FixedLength;
+  fixed.frameLength = 3;
+  cases.append({fixed, "abcdefg", {{"abc", 0, 3}, {"def", 3, 3}}, 0});
+
+  // The length counts the payload only, including an empty one
+  FrameDecoder::Options prefix;
+  prefix.type = FrameDecoder::LengthPrefix;
+  prefix.lengthFieldSize = 2;
+  cases.append({prefix,
+                QByteArray::fromHex("0003616263" "0000" "00017a"),
+                {{"abc", 0, 5}, {"", 5, 2}, {"z", 7, 3}},
+                0});
+
+  // The length counts its own byte too, so zero is invalid and skipped
+  FrameDecoder::Options header;
+  header.type = FrameDecoder::LengthPrefix;
+  header.lengthFieldSize = 1;
+  header.lengthIncludesHeader = true;
+  cases.append({header,
+                QByteArray::fromHex("04616263" "00" "0271"),
+                {{"abc", 0, 4}, {"q", 5, 2}},
+                1});
+
+  // Escaped END and ESC, and a frame with an invalid escape in between
+  FrameDecoder::Options slip;
+  slip.type = FrameDecoder::Slip;
+  cases.append({slip,
+                QByteArray::fromHex("c061dbdc62c0" "c078db79c0" "63dbddc0"),
+                {{QByteArray::fromHex("61c062"), 1, 5},
+                 {QByteArray::fromHex("63db"), 11, 4}},
+                1});
+
+  // A zero inside the payload, a block overrunning its frame, and an empty
+  // payload
+  FrameDecoder::Options cobs;
+  cobs.type = FrameDecoder::Cobs;
+  cobs.maxFrameSize = 16;
+  cases.append({cobs,
+                QByteArray::fromHex("0311220233" "00" "051100" "0100"),
+                {{QByteArray::fromHex("11220033"), 0, 6}, {"", 9, 2}},
+                1});
+
+  for (const Case &c : cases) {
+    for (const qsizetype step : {c.stream.size(), qsizetype(1)}) {
+      quint64 errors = 0;
+      const QList<Frame> frames = decode(c.options, c.stream, step, errors);
+      QVERIFY2(sameFrames(frames, c.frames), c.stream.toHex().constData());
+      QCOMPARE(errors, c.errors);
+    }
+  }
+
+  // The delimiter cut at every possible point
+  for (qsizetype cut = 1; cut < 6; ++cut) {
+    std::unique_ptr<FrameDecoder> decoder = FrameDecoder::create(delimiter);
+    const QByteArray stream = "ab\r\ncd";
+    QList<Frame> frames;
+    decoder->feed(stream.left(cut), frames);
+    decoder->feed(stream.mid(cut), frames);
+    QVERIFY(sameFrames(frames, {{"ab", 0, 4}}));
+    QCOMPARE(decoder->streamOffset(), quint64(6));
+  }
+
+  // An oversized frame is dropped up to its delimiter
+  FrameDecoder::Options small = delimiter;
+  small.maxFrameSize = 4;
+  quint64 errors = 0;
+  QVERIFY(sameFrames(decode(small, "0123456789\r\nok\r\n", 3, errors),
+                     {{"ok", 12, 4}}));
+  QCOMPARE(errors, quint64(1));
+
+  QVERIFY(!FrameDecoder::create(FrameDecoder::Options()));
+}
+
+void TestSerialPortManager::testTerminalDecoder() {
+  using Run = TerminalDecoder::Run;
+  auto isRun = [](const Run &run, int start, int length, quint32 foreground,
+                  quint32 background, quint8 attributes) {
+    return run.start == start && run.length == length &&
+           run.style.foreground == foreground &&
+           run.style.background == background &&
+           run.style.attributes == attributes;
+  };
+
+  // However the stream is cut up, characters and sequences come out whole
+  const QByteArray stream =
+      "\x1b[1;31mERR\x1b[0m caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"
+      "\x1b]0;title\x07\x1b[38;5;208mx\x1b[48;2;1;2;3my\x1b[m\x01";
+  const QString expected =
+      QString::fromUtf8("ERR caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80xy.");
+  for (const int piece : {1, 2, 3, 7, 1000}) {
+    TerminalDecoder decoder;
+    TerminalDecoder tracker;
+    QString text;
+    QVector<Run> runs;
+    for (qsizetype i = 0; i < stream.size(); i += piece) {
+      const qsizetype length = qMin<qsizetype>(piece, stream.size() - i);
+      decoder.decode(stream.constData() + i, length, text, runs);
+      tracker.advance(stream.constData() + i, length);
+      QCOMPARE(tracker.state().style, decoder.state().style);
+      QCOMPARE(tracker.state().mode, decoder.state().mode);
+    }
+    QCOMPARE(text, expected);
+    QCOMPARE(runs.size(), 5);
+    QVERIFY(isRun(runs[0], 0, 3, 2, 0, TerminalDecoder::Bold));
+    QVERIFY(isRun(runs[1], 3, 10, 0, 0, 0));
+    QVERIFY(isRun(runs[2], 13, 1, 209, 0, 0));
+    QVERIFY(isRun(runs[3], 14, 1, 209, TerminalDecoder::RgbColor | 0x010203,
+                  0));
+    QVERIFY(isRun(runs[4], 15, 1, 0, 0, 0));
+  }
+  QCOMPARE(TerminalDecoder::rgb(2), quint32(0xCD0000));
+  QCOMPARE(TerminalDecoder::rgb(209), quint32(0xFF8700));
+
+  // Malformed input, and a sequence left open for the next piece
+  TerminalDecoder decoder;
+  QString text;
+  QVector<Run> runs;
+  const QByteArray malformed = "a\xc3(b\xff\x1b[31";
+  decoder.decode(malformed.constData(), malformed.size(), text, runs);
+  QCOMPARE(text, QString::fromUtf8("a\xef\xbf\xbd(b\xef\xbf\xbd"));
+  QCOMPARE(decoder.state().mode, TerminalDecoder::Csi);
+
+  // The buffer keeps the state records start in, per direction
+  ConsoleBuffer buffer;
+  buffer.append(ConsoleSource::Rx, "\x1b[32mok\r\nstill green \xe2\x82", 0);
+  buffer.append(ConsoleSource::Tx, "AT\r\n", 0);
+  buffer.append(ConsoleSource::Rx, "\xac\x1b[0m\r\nplain\r\n", 0);
+  QCOMPARE(buffer.recordCount(), qint64(5));
+  QVERIFY(buffer.textState(0).isInitial());
+  QCOMPARE(buffer.textState(1).style.foreground, quint32(3));
+  QVERIFY(buffer.textState(2).isInitial());
+  QCOMPARE(buffer.textState(3).mode, TerminalDecoder::Utf8);
+  QVERIFY(buffer.textState(4).isInitial());
+
+  TerminalDecoder resumed(buffer.textState(3));
+  text.clear();
+  runs.clear();
+  const QByteArray record = buffer.recordData(3).chopped(2);
+  resumed.decode(record.constData(), record.size(), text, runs);
+  QCOMPARE(text, QString::fromUtf8("\xe2\x82\xac"));
+  QCOMPARE(runs.size(), 1);
+  QCOMPARE(runs[0].style.foreground, quint32(3));
+}
+
+void TestSerialPortManager::testPacketDissector() {
+  PacketDissector dissector;
+  QVERIFY(dissector.load("endian big\n"
+                         "sync AA 55\n"
+                         "packet Reading\n"
+                         "field cmd u8 = 1\n"
+                         "field temperature i16\n"
+                         "field pressure f32le   # the sensor's own order\n"
+                         "checksum crc crc16 le\n"
+                         "packet Blob\n"
+                         "field cmd u8 = 2\n"
+                         "field len u8\n"
+                         "field payload bytes len\n"
+                         "checksum crc crc16 le\n"));
+  QCOMPARE(dissector.layouts().size(), 2);
+
+  // Garbage, a broken sync, a bad CRC and a sync cut off at the end, fed a
+  // byte at a time
+  const QByteArray reading = QByteArray::fromHex("aa5501ff3800507d449f78");
+  const QByteArray blob = QByteArray::fromHex("aa55020378797a7fee");
+  QByteArray badReading = reading;
+  badReading[badReading.size() - 2] = '\x9e';
+  const QByteArray stream = "garbage" + reading + "\xaa" + blob + badReading +
+                            QByteArray("\x03\x00", 2) + blob + "\xaa";
+
+  QVector<PacketDissector::Packet> packets;
+  QVector<PacketDissector::Value> values;
+  for (qsizetype i = 0; i < stream.size(); ++i) {
+    dissector.feed(stream.constData() + i, 1, i, packets, values);
+  }
+  QCOMPARE(packets.size(), 4);
+  QCOMPARE(dissector.skippedBytes(), quint64(10));
+  QCOMPARE(dissector.checksumErrors(), quint64(1));
+
+  const QList<int> layouts = {0, 1, 0, 1};
+  const QList<quint64> offsets = {7, 19, 28, 41};
+  const QList<bool> valid = {true, true, false, true};
+  for (int i = 0; i < packets.size(); ++i) {
+    QCOMPARE(packets[i].layout, layouts[i]);
+    QCOMPARE(packets[i].streamOffset, offsets[i]);
+    QCOMPARE(packets[i].valid, valid[i]);
+    QCOMPARE(packets[i].timestamp,
+             qint64(packets[i].streamOffset + packets[i].data.size() - 1));
+  }
+  QCOMPARE(packets[0].data, reading);
+
+  auto text = [&](int packet, int field) {
+    const PacketDissector::Packet &p = packets[packet];
+    const int index = dissector.layouts()[p.layout].firstField + field;
+    return dissector.fieldName(index) + "=" +
+           dissector.formatValue(index, values[p.firstValue + field], p.data);
+  };
+  QCOMPARE(text(0, 0), QString("sync=AA 55"));
+  QCOMPARE(text(0, 2), QString("temperature=-200 (0xFF38)"));
+  QCOMPARE(text(0, 3), QString("pressure=1013.25"));
+  QCOMPARE(text(0, 4), QString("crc=0x789F"));
+  QCOMPARE(text(1, 2), QString("len=3 (0x03)"));
+  QCOMPARE(text(1, 3), QString("payload=78 79 7A"));
+  QCOMPARE(text(2, 4), QString("crc=0x789E, expected 0x789F"));
+
+  // Bytes passed over while the view is hidden end a partial packet and
+  // still count towards the offsets
+  packets.clear();
+  values.clear();
+  dissector.feed(reading.constData(), 5, 0, packets, values);
+  dissector.skip(100);
+  dissector.feed(reading.constData(), reading.size(), 0, packets, values);
+  QCOMPARE(packets.size(), 1);
+  QCOMPARE(packets[0].streamOffset, quint64(stream.size() + 5 + 100));
+  QVERIFY(packets[0].valid);
+
+  // A layout still waiting for its bytes does not hold up a shorter one that
+  // already matches; with nothing else matching, it waits
+  PacketDissector overlap;
+  QVERIFY(overlap.load("packet Frame\nfield cmd u8 = 1\nfield data bytes 8\n"
+                       "packet Ping\nfield cmd u8 = 1\nfield tag u8 = 80\n"));
+  packets.clear();
+  values.clear();
+  overlap.feed("\x01\x50", 2, 0, packets, values);
+  QCOMPARE(packets.size(), 1);
+  QCOMPARE(packets[0].layout, 1);
+  overlap.feed("\x01\x02", 2, 0, packets, values);
+  QCOMPARE(packets.size(), 1);
+  overlap.feed("abcdefg", 7, 0, packets, values);
+  QCOMPARE(packets.size(), 2);
+  QCOMPARE(packets[1].layout, 0);
+  QCOMPARE(packets[1].streamOffset, quint64(2));
+  QCOMPARE(overlap.skippedBytes(), quint64(0));
+
+  // The other checksums, against their "123456789" check values
+  const QList<QPair<QString, QByteArray>> checks = {
+      {"crc8", QByteArray::fromHex("f4")},
+      {"crc16-ccitt be", QByteArray::fromHex("29b1")},
+      {"crc32 be", QByteArray::fromHex("cbf43926")},
+      {"xor8", QByteArray::fromHex("31")}};
+  for (const auto &check : checks) {
+    PacketDissector crc;
+    QVERIFY(crc.load("field data bytes 9\nchecksum crc " + check.first));
+    packets.clear();
+    values.clear();
+    const QByteArray packet = "123456789" + check.second;
+    crc.feed(packet.constData(), packet.size(), 0, packets, values);
+    QCOMPARE(packets.size(), 1);
+    QVERIFY2(packets[0].valid, qPrintable(check.first));
+  }
+
+  // A bad layout is reported by line and leaves the old one in place
+  QVERIFY(!dissector.load("field a u8\nfield b bytes c\n"));
+  QCOMPARE(dissector.errorString(),
+           QString("Line 2: 'c' is not an earlier unsigned field"));
+  QCOMPARE(dissector.layouts().size(), 2);
+  QVERIFY(!dissector.load("sync AA\nfield a u24\n"));
+  QVERIFY(dissector.errorString().startsWith("Line 2:"));
+  QVERIFY(!dissector.load("packet A\npacket B\nfield b u8\n"));
+  QCOMPARE(dissector.errorString(), QString("Packet 'A' has no fields"));
+  QVERIFY(!dissector.load("sync AA\npacket A\n"));
+}
+
+void TestSerialPortManager::testTriggerCapture() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+
+  TriggerCapture::Options options;
+  QString error;
+  QVERIFY(!TriggerCapture::parseOptions("pattern=DEADBEEF,silence=5", options,
+                                        error));
+  QVERIFY(!TriggerCapture::parseOptions("pattern=XYZ", options, error));
+  QVERIFY(!TriggerCapture::parseOptions("error,bogus", options, error));
+  QCOMPARE(error, QString("Unknown trigger option: bogus"));
+  QVERIFY(TriggerCapture::parseOptions("regex=^ERR,before=1M,before=2s",
+                                       options, error));
+  QCOMPARE(options.preTriggerBytes, qsizetype(1024 * 1024));
+  QCOMPARE(options.preTriggerMs, 2000);
+  QVERIFY(TriggerCapture::parseOptions(
+      "pattern=DEADBEEF,before=64,after=8,dir=" + dir.path(), options,
+      error));
+  QCOMPARE(options.trigger, TriggerCapture::PatternTrigger);
+  QCOMPARE(options.postTriggerBytes, qsizetype(8));
+  QCOMPARE(options.postTriggerMs, 0);
+
+  TriggerCapture trigger;
+  QSignalSpy saved(&trigger, &TriggerCapture::captureSaved);
+  QVERIFY2(trigger.start(options), qPrintable(trigger.errorString()));
+
+  // The 64-byte ring holds only the last reads, each with a 16-byte header
+  for (int i = 0; i < 10; ++i) {
+    trigger.addData(CaptureFormat::Rx, i, QByteArray(8, char('a' + i)));
+  }
+  trigger.addData(CaptureFormat::Tx, 10, "ping");
+  trigger.addData(CaptureFormat::Rx, 11, "\xde\xad");
+  QVERIFY(!trigger.isCapturing());
+  trigger.addData(CaptureFormat::Rx, 12, "\xbe\xefxyz");
+  QVERIFY(trigger.isCapturing());
+
+  // TX does not count towards the 8 bytes after the trigger
+  trigger.addData(CaptureFormat::Tx, 13, "ack");
+  trigger.addData(CaptureFormat::Rx, 14, "12345");
+  trigger.addData(CaptureFormat::Rx, 15, "67890");
+  QVERIFY(!trigger.isCapturing());
+  QVERIFY(trigger.isArmed());
+  QCOMPARE(saved.size(), 1);
+
+  CaptureReader reader;
+  QVERIFY2(reader.open(saved.at(0).at(0).toString()),
+           qPrintable(reader.errorString()));
+  QCOMPARE(reader.metadata().value("trigger"), QString("Pattern DE AD BE EF"));
+  const QList<QByteArray> records = {"ping", "\xde\xad", "\xbe\xefxyz",
+                                     "ack",  "12345",    "678"};
+  QCOMPARE(reader.recordCount(), qint64(records.size()));
+  for (int i = 0; i < records.size(); ++i) {
+    QCOMPARE(reader.recordData(i), records[i]);
+    QCOMPARE(reader.record(i).timestamp, qint64(10 + i));
+  }
+  QCOMPARE(reader.record(0).direction, ConsoleSource::Tx);
+  reader.close();
+
+  // Armed again with only what came since; stopping saves the capture
+  trigger.addData(CaptureFormat::Rx, 20, "later");
+  trigger.trigger("By hand");
+  QVERIFY(trigger.isCapturing());
+  trigger.stop();
+  QVERIFY(!trigger.isArmed());
+  QCOMPARE(saved.size(), 2);
+  QVERIFY(reader.open(saved.at(1).at(0).toString()));
+  QCOMPARE(reader.recordCount(), qint64(1));
+  QCOMPARE(reader.recordData(0), QByteArray("later"));
+}
+
+void TestSerialPortManager::testTelemetryStore() {
+  QVector<float> values;
+  QList<QByteArray> names;
+  QVERIFY(TelemetryStore::parseLine("1.5,-2,3e2\r", values, names));
+  QCOMPARE(values, QVector<float>({1.5f, -2.0f, 300.0f}));
+  QVERIFY(TelemetryStore::parseLine("temp: 21.5 rpm=880 ok", values, names));
+  QCOMPARE(values, QVector<float>({21.5f, 880.0f}));
+  QCOMPARE(names, QList<QByteArray>({"temp", "rpm"}));
+  QVERIFY(!TelemetryStore::parseLine("booting...", values, names));
+
+  // Wrap the ring a few times, then check the pyramid against a scan
+  TelemetryStore store(TelemetryChannel::TopBlock);
+  const quint64 rows = 3 * TelemetryChannel::TopBlock + 1234;
+  for (quint64 i = 0; i < rows; ++i) {
+    const int value = int((i * 7919) % 10007) - 5000;
+    QVERIFY(store.appendLine(QByteArray::number(value), qint64(i) * 1000));
+  }
+  QCOMPARE(store.end(), rows);
+  QCOMPARE(store.begin(), rows - TelemetryChannel::TopBlock);
+  QCOMPARE(store.findRow(qint64(rows - 10) * 1000), rows - 10);
+
+  const TelemetryChannel &channel = store.channel(0);
+  const quint64 ranges[][2] = {{store.begin(), store.end()},
+                               {store.begin() + 1, store.begin() + 17},
+                               {rows - 70000, rows - 300},
+                               {rows - 4097, rows - 4095},
+                               {rows - 1, rows}};
+  for (const auto &range : ranges) {
+    float expectedMin = channel.at(qMax(range[0], channel.begin()));
+    float expectedMax = expectedMin;
+    for (quint64 i = qMax(range[0], channel.begin()); i < range[1]; ++i) {
+      expectedMin = qMin(expectedMin, channel.at(i));
+      expectedMax = qMax(expectedMax, channel.at(i));
+    }
+    float min = 0;
+    float max = 0;
+    QVERIFY(channel.minMax(range[0], range[1], min, max));
+    QCOMPARE(min, expectedMin);
+    QCOMPARE(max, expectedMax);
+  }
+
+  // A channel that appears later has no samples before it
+  QVERIFY(store.appendLine("1,42", qint64(rows) * 1000));
+  QCOMPARE(store.channelCount(), 2);
+  float min = 0;
+  float max = 0;
+  QVERIFY(!store.channel(1).minMax(store.begin(), rows, min, max));
+  QVERIFY(store.channel(1).minMax(store.begin(), store.end(), min, max));
+  QCOMPARE(max, 42.0f);
+}
+
+void TestSerialPortManager::testHeadlessCapture() {
+  // A mistyped number is an error, never a silent default
+  HeadlessCapture::Options options;
+  QString error;
+  auto parse = [&](const QStringList &arguments) {
+    QCommandLineParser parser;
+    HeadlessCapture::addOptions(parser);
+    options = HeadlessCapture::Options();
+    error.clear();
+    return parser.parse(QStringList("SerialFlow") + arguments) &&
+           HeadlessCapture::parseOptions(parser, options, &error);
+  };
+  QVERIFY(parse({"--headless", "-p", "sim", "-d", "30", "--stats-interval",
+                 "250", "-f", "sfcap"}));
+  QCOMPARE(options.portName, QString("sim"));
+  QCOMPARE(options.durationSeconds, 30);
+  QCOMPARE(options.statisticsIntervalMs, 250);
+  QCOMPARE(options.format, HeadlessCapture::CaptureOutput);
+  QVERIFY(parse({"--headless", "-p", "sim"}));
+  QCOMPARE(options.durationSeconds, 0);
+  QCOMPARE(options.statisticsIntervalMs, 1000);
+  QVERIFY(!parse({"--headless", "-p", "sim", "-d", "abc"}));
+  QCOMPARE(error, QString("Invalid duration: abc"));
+  QVERIFY(!parse({"--headless", "-p", "sim", "--stats-interval", "1s"}));
+  QCOMPARE(error, QString("Invalid statistics interval: 1s"));
+  QVERIFY(!parse({"--headless", "-p", "sim", "--stats-interval", "0"}));
+  QVERIFY(!parse({"--headless", "-p", "sim", "--bridge", "http"}));
+  QCOMPARE(error, QString("Invalid bridge port: http"));
+  QVERIFY(!parse({"--headless"}));
+
+  // What is reported as captured is exactly what reached the file
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  options = HeadlessCapture::Options();
+  options.portName = "sim:data=counter,rate=2000000,burst=1024";
+  options.outputPath = dir.filePath("raw.bin");
+  {
+    HeadlessCapture capture(options);
+    QVERIFY(capture.start());
+    QTRY_VERIFY(capture.bytesCaptured() > 256 * 1024);
+    capture.stop();
+
+    QFile file(options.outputPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    QCOMPARE(quint64(data.size()), capture.bytesCaptured());
+    qsizetype mismatch = 0;
+    while (mismatch < data.size() && data[mismatch] == char(mismatch)) {
+      ++mismatch;
+    }
+    QCOMPARE(mismatch, data.size());
+  }
+
+  // A full disk ends the capture with an error, once
+  if (QFile::exists("/dev/full")) {
+    options.outputPath = "/dev/full";
+    HeadlessCapture capture(options);
+    QSignalSpy finishedSpy(&capture, &HeadlessCapture::finished);
+    QVERIFY(capture.start());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(finishedSpy.at(0).at(0).toInt(), 1);
+    capture.stop();
+    QCOMPARE(finishedSpy.count(), 1);
+  }
+}
+
 void TestSerialPortManager::testErrorHandling() {
   SerialPortManager manager;
   QSignalSpy errorSpy(&manager, &SerialPortManager::errorOccurred);